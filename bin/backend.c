@@ -0,0 +1,1114 @@
+// One long-lived backend for Neovim speaking msgpack-RPC on stdio.
+//
+//   gcc -O2 -pthread -o backend backend.c libc11.c $(pkg-config --cflags --libs msgpack)
+//   ./backend [-j workers]
+//
+// Started once per editor session with
+//
+//   local chan = vim.fn.jobstart({"backend"}, {rpc = true})
+//   vim.rpcrequest(chan, "dirwalk", root, {files_only = true})
+//
+// and replaces spawning dirscan, dirwalk, sysinfo and local_time per call.
+// Requests are [0, msgid, method, params] and are answered with
+// [1, msgid, error, result] (error is a message string or nil);
+// notifications are [2, method, params]. Cheap methods are answered on the
+// reader thread as soon as they arrive; tree walks go to a pool of worker
+// threads (-j, default 4), so replies can come back in any order and a
+// long walk never holds up a quick query. Each reply is one write.
+//
+//   local_time                 -> {epoch, local, zone, utc_offset}
+//   sysinfo                    -> {cpu, cpus, mem, mem_total, uptime,
+//                                  timestamp, load}   cpu since last call
+//   dir_size(path)             -> bytes
+//   dirscan(path)              -> [{location, size}]  dirscan's listing
+//   dirwalk(root[, opts])      -> [path, ...]  opts: no_ignore, files_only,
+//                                  dirs_only, shallow, limit
+//   cancel(msgid)              notification: a queued or running walk
+//                              answers "cancelled" as soon as it notices
+//
+// Syntax highlighting from the flexer.h tokens (see highlight.h), for
+// buffers too large for Tree-sitter. The backend keeps its own copy of the
+// lines, fed from nvim_buf_attach()'s on_lines, and remembers the ranges of
+// lines it has already highlighted:
+//
+//   hl_open(lang, lines)       -> id     lang "lua"/"c" or a file name
+//   hl_lines(id, first, last, lines)     replace lines [first, last)
+//   hl_viewport(id, top, bottom)
+//                              -> [[line, col_start, col_end, group], ...]
+//                                 for lines [top, bottom), 0-based, ready
+//                                 for nvim_buf_set_extmark(buf, ns, line,
+//                                 col_start, {end_col = col_end,
+//                                 hl_group = group})
+//   hl_close(id)
+//
+// and, on the same buffers, bracket and block pairs (see fold.h), indexed
+// on first use and kept up to date by hl_lines:
+//
+//   fold_ranges(id)            -> [[start, end], ...]  0-based inclusive
+//                                 lines, sorted, nested, for a foldexpr
+//   fold_match(id, line, col)  -> [line, col] of the bracket or block word
+//                                 pairing the one at line, col (0-based
+//                                 bytes), or nil
+//
+// Buffer mirrors (see piece.h): the whole buffer is sent once, then only
+// on_lines deltas; edits cost O(log n) whatever the buffer size, and
+// searches run over the mirror instead of a copy shipped per request:
+//
+//   buf_open(lines)            -> id
+//   buf_lines(id, first, last, lines)    replace lines [first, last)
+//   buf_get(id, first, last)   -> [line, ...]
+//   buf_search(id, pattern[, opts])
+//                              -> [[line, col, text], ...]  0-based line and
+//                                 byte col of the first match; opts: fixed,
+//                                 icase, limit
+//   buf_close(id)
+//
+// Exits when stdin is closed, after the requests already received are
+// answered.
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include <msgpack.h>
+
+#define FOLD_IMPLEMENTATION
+#include "fold.h"
+#define HIGHLIGHT_IMPLEMENTATION
+#include "highlight.h"
+#include "libc11.h"
+#define PIECE_IMPLEMENTATION
+#include "piece.h"
+#define PROC_SAMPLER_IMPLEMENTATION
+#include "proc_sampler.h"
+#define SEARCH_IMPLEMENTATION
+#include "search.h"
+
+#define READ_CHUNK (64 * 1024)
+#define WALK_CHUNK (64 * 1024)
+#define MAX_WORKERS 64
+
+enum { MSG_REQUEST = 0, MSG_RESPONSE = 1, MSG_NOTIFY = 2 };
+
+typedef struct Job Job;
+
+typedef struct {
+    const char *name;
+    int pooled; // 0: answered on the reader thread, 1: on a worker
+    // Copies what `run` needs out of params (which die with the read
+    // buffer); returns an error message or NULL.
+    const char *(*parse)(Job *job, const msgpack_object *args, uint32_t nargs);
+    // Packs the result into `pk`; returns an error message or NULL.
+    const char *(*run)(Job *job, msgpack_packer *pk);
+} Method;
+
+struct Job {
+    Job *next;
+    uint32_t msgid;
+    const Method *method;
+    char *path;
+    int flags;       // C11_WALK_*
+    uint64_t limit;  // 0 = unlimited
+    atomic_int cancelled;
+    // Inline methods only: the request's params, alive until run returns.
+    const msgpack_object *args;
+    uint32_t nargs;
+};
+
+// Jobs waiting for a worker, plus the ones being worked on (for cancel).
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static Job *queue_head, *queue_tail;
+static Job *running_jobs[MAX_WORKERS];
+static int shutting_down = 0;
+
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+static int out_failed = 0;
+
+static pthread_mutex_t sampler_lock = PTHREAD_MUTEX_INITIALIZER;
+static ProcSampler sampler;
+static int have_sampler = 0;
+
+// A buffer opened with hl_open; its fold index is built on first use.
+typedef struct {
+    HlBuffer hl;
+    FoldIndex *folds;
+} HlDoc;
+
+// Highlighted buffers by id - 1; only the reader thread touches them.
+static HlDoc **hl_buffers;
+static size_t hl_buffer_count;
+
+// Mirrored buffers by id - 1; likewise reader thread only.
+static PieceTable **pt_buffers;
+static size_t pt_buffer_count;
+
+static void pack_str(msgpack_packer *pk, const char *s) {
+    size_t len = strlen(s);
+    msgpack_pack_str(pk, len);
+    msgpack_pack_str_body(pk, s, len);
+}
+
+static int write_all(struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t n = writev(STDOUT_FILENO, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// Sends [1, msgid, error, result]; `result` holds the packed result when
+// error is NULL.
+static void send_response(uint32_t msgid, const char *error, const msgpack_sbuffer *result) {
+    msgpack_sbuffer head;
+    msgpack_packer pk;
+    msgpack_sbuffer_init(&head);
+    msgpack_packer_init(&pk, &head, msgpack_sbuffer_write);
+    msgpack_pack_array(&pk, 4);
+    msgpack_pack_uint32(&pk, MSG_RESPONSE);
+    msgpack_pack_uint32(&pk, msgid);
+    if (error) {
+        pack_str(&pk, error);
+        msgpack_pack_nil(&pk);
+    } else {
+        msgpack_pack_nil(&pk);
+    }
+
+    struct iovec iov[2] = {{head.data, head.size}, {NULL, 0}};
+    int iovcnt = 1;
+    if (!error) {
+        iov[iovcnt++] = (struct iovec){result->data, result->size};
+    }
+    pthread_mutex_lock(&out_lock);
+    if (!out_failed && write_all(iov, iovcnt) != 0) {
+        out_failed = 1;
+    }
+    pthread_mutex_unlock(&out_lock);
+    msgpack_sbuffer_destroy(&head);
+}
+
+static void job_free(Job *job) {
+    free(job->path);
+    free(job);
+}
+
+static void run_job(Job *job) {
+    msgpack_sbuffer result;
+    msgpack_packer pk;
+    msgpack_sbuffer_init(&result);
+    msgpack_packer_init(&pk, &result, msgpack_sbuffer_write);
+    const char *error = atomic_load(&job->cancelled) ? "cancelled" : job->method->run(job, &pk);
+    send_response(job->msgid, error, &result);
+    msgpack_sbuffer_destroy(&result);
+}
+
+// --- Argument helpers ---
+
+static char *dup_str(const msgpack_object *o) {
+    char *s = malloc(o->via.str.size + 1);
+    if (s) {
+        memcpy(s, o->via.str.ptr, o->via.str.size);
+        s[o->via.str.size] = '\0';
+    }
+    return s;
+}
+
+static int key_is(const msgpack_object *o, const char *key) {
+    return o->type == MSGPACK_OBJECT_STR && o->via.str.size == strlen(key) &&
+           memcmp(o->via.str.ptr, key, o->via.str.size) == 0;
+}
+
+static const char *parse_path(Job *job, const msgpack_object *args, uint32_t nargs) {
+    if (nargs < 1 || args[0].type != MSGPACK_OBJECT_STR) {
+        return "expected a path";
+    }
+    job->path = dup_str(&args[0]);
+    return job->path ? NULL : "out of memory";
+}
+
+static const char *parse_none(Job *job, const msgpack_object *args, uint32_t nargs) {
+    (void)job;
+    (void)args;
+    return nargs == 0 ? NULL : "takes no arguments";
+}
+
+static const char *parse_inline(Job *job, const msgpack_object *args, uint32_t nargs) {
+    job->args = args;
+    job->nargs = nargs;
+    return NULL;
+}
+
+static int is_uint(const msgpack_object *o) {
+    return o->type == MSGPACK_OBJECT_POSITIVE_INTEGER;
+}
+
+// --- Methods ---
+
+static const char *run_local_time(Job *job, msgpack_packer *pk) {
+    (void)job;
+    time_t now = time(NULL);
+    struct tm tm;
+    char local[64], zone[16];
+    localtime_r(&now, &tm);
+    strftime(local, sizeof(local), "%Y-%m-%d %H:%M:%S", &tm);
+    strftime(zone, sizeof(zone), "%Z", &tm);
+
+    msgpack_pack_map(pk, 4);
+    pack_str(pk, "epoch");
+    msgpack_pack_int64(pk, (int64_t)now);
+    pack_str(pk, "local");
+    pack_str(pk, local);
+    pack_str(pk, "zone");
+    pack_str(pk, zone);
+    pack_str(pk, "utc_offset");
+    msgpack_pack_int64(pk, tm.tm_gmtoff);
+    return NULL;
+}
+
+static const char *run_sysinfo(Job *job, msgpack_packer *pk) {
+    (void)job;
+    pthread_mutex_lock(&sampler_lock);
+    if (!have_sampler || ps_sample(&sampler) != 0) {
+        pthread_mutex_unlock(&sampler_lock);
+        return "cannot read /proc";
+    }
+    const PsSample *s = sampler.cur, *prev = sampler.prev;
+    int have_prev = sampler.samples > 1;
+
+    msgpack_pack_map(pk, 7);
+    pack_str(pk, "cpu");
+    msgpack_pack_double(pk, have_prev ? ps_cpu_usage(&prev->cpu, &s->cpu) : 0.0);
+    pack_str(pk, "cpus");
+    msgpack_pack_array(pk, s->ncpus);
+    for (int i = 0; i < s->ncpus; i++) {
+        msgpack_pack_double(pk, have_prev && i < prev->ncpus ? ps_cpu_usage(&prev->cpus[i], &s->cpus[i]) : 0.0);
+    }
+    pack_str(pk, "mem");
+    msgpack_pack_uint64(pk, (s->mem_total - s->mem_free) * 1024);
+    pack_str(pk, "mem_total");
+    msgpack_pack_uint64(pk, s->mem_total * 1024);
+    pack_str(pk, "uptime");
+    msgpack_pack_uint64(pk, (uint64_t)s->uptime);
+    pack_str(pk, "timestamp");
+    msgpack_pack_uint64(pk, (uint64_t)s->when.tv_sec);
+    pack_str(pk, "load");
+    msgpack_pack_array(pk, 3);
+    msgpack_pack_double(pk, s->load1);
+    msgpack_pack_double(pk, s->load5);
+    msgpack_pack_double(pk, s->load15);
+    pthread_mutex_unlock(&sampler_lock);
+    return NULL;
+}
+
+static const char *run_dir_size(Job *job, msgpack_packer *pk) {
+    int64_t size = c11_dir_size(job->path);
+    if (size < 0) {
+        return strerror(errno);
+    }
+    msgpack_pack_int64(pk, size);
+    return NULL;
+}
+
+// Runs a walk into one buffer of "path\n" lines; returns the line count or
+// -1 (with *error set).
+static int64_t collect_walk(Job *job, msgpack_sbuffer *lines, const char **error) {
+    c11_walk *w = c11_walk_open(job->path, job->flags);
+    if (!w) {
+        *error = strerror(errno);
+        return -1;
+    }
+    static _Thread_local char chunk[WALK_CHUNK];
+    int64_t count = 0, n;
+    while ((n = c11_walk_next(w, chunk, sizeof(chunk))) > 0) {
+        if (atomic_load(&job->cancelled)) {
+            *error = "cancelled";
+            count = -1;
+            break;
+        }
+        // Cut at `limit` lines.
+        int64_t keep = 0;
+        while (keep < n && (!job->limit || (uint64_t)count < job->limit)) {
+            const char *nl = memchr(chunk + keep, '\n', (size_t)(n - keep));
+            keep = nl - chunk + 1;
+            count++;
+        }
+        msgpack_sbuffer_write(lines, chunk, (size_t)keep);
+        if (keep < n) {
+            break;
+        }
+    }
+    if (n < 0) {
+        *error = strerror(errno);
+        count = -1;
+    }
+    c11_walk_close(w);
+    return count;
+}
+
+static const char *parse_dirwalk(Job *job, const msgpack_object *args, uint32_t nargs) {
+    const char *err = parse_path(job, args, nargs);
+    if (err || nargs < 2) {
+        return err;
+    }
+    if (args[1].type != MSGPACK_OBJECT_MAP) {
+        return "options must be a map";
+    }
+    static const struct {
+        const char *key;
+        int flag;
+    } bools[] = {
+        {"no_ignore", C11_WALK_NO_IGNORE},
+        {"files_only", C11_WALK_NO_DIRS},
+        {"dirs_only", C11_WALK_NO_FILES},
+        {"shallow", C11_WALK_SHALLOW},
+    };
+    for (uint32_t i = 0; i < args[1].via.map.size; i++) {
+        const msgpack_object_kv *kv = &args[1].via.map.ptr[i];
+        if (key_is(&kv->key, "limit") && kv->val.type == MSGPACK_OBJECT_POSITIVE_INTEGER) {
+            job->limit = kv->val.via.u64;
+            continue;
+        }
+        size_t b = 0;
+        while (b < sizeof(bools) / sizeof(bools[0]) && !key_is(&kv->key, bools[b].key)) {
+            b++;
+        }
+        if (b == sizeof(bools) / sizeof(bools[0]) || kv->val.type != MSGPACK_OBJECT_BOOLEAN) {
+            return "unknown option";
+        }
+        if (kv->val.via.boolean) {
+            job->flags |= bools[b].flag;
+        }
+    }
+    return NULL;
+}
+
+static const char *run_dirwalk(Job *job, msgpack_packer *pk) {
+    msgpack_sbuffer lines;
+    msgpack_sbuffer_init(&lines);
+    const char *error = NULL;
+    int64_t count = collect_walk(job, &lines, &error);
+    if (count >= 0) {
+        msgpack_pack_array(pk, (size_t)count);
+        for (const char *p = lines.data, *end = p + lines.size; p < end;) {
+            const char *nl = memchr(p, '\n', (size_t)(end - p));
+            msgpack_pack_str(pk, (size_t)(nl - p));
+            msgpack_pack_str_body(pk, p, (size_t)(nl - p));
+            p = nl + 1;
+        }
+    }
+    msgpack_sbuffer_destroy(&lines);
+    return error;
+}
+
+static const char *run_dirscan(Job *job, msgpack_packer *pk) {
+    job->flags = C11_WALK_NO_IGNORE | C11_WALK_NO_FILES | C11_WALK_SHALLOW;
+    msgpack_sbuffer lines;
+    msgpack_sbuffer_init(&lines);
+    const char *error = NULL;
+    int64_t count = collect_walk(job, &lines, &error);
+    if (count >= 0) {
+        char path[PATH_MAX];
+        size_t root_len = strlen(job->path);
+        msgpack_pack_array(pk, (size_t)count);
+        for (const char *p = lines.data, *end = p + lines.size; p < end;) {
+            const char *nl = memchr(p, '\n', (size_t)(end - p));
+            size_t len = (size_t)(nl - p) - 1; // without the trailing '/'
+            int fits = root_len + 1 + len < sizeof(path);
+            if (fits) {
+                snprintf(path, sizeof(path), "%s/%.*s", job->path, (int)len, p);
+            }
+            msgpack_pack_map(pk, 2);
+            pack_str(pk, "location");
+            msgpack_pack_str(pk, fits ? strlen(path) : 0);
+            msgpack_pack_str_body(pk, path, fits ? strlen(path) : 0);
+            pack_str(pk, "size");
+            msgpack_pack_int64(pk, fits && !atomic_load(&job->cancelled) ? c11_dir_size(path) : -1);
+            p = nl + 1;
+        }
+    }
+    msgpack_sbuffer_destroy(&lines);
+    return error ? error : atomic_load(&job->cancelled) ? "cancelled" : NULL;
+}
+
+// --- Highlighting ---
+
+static HlDoc *hl_lookup(const msgpack_object *id) {
+    if (!is_uint(id) || id->via.u64 == 0 || id->via.u64 > hl_buffer_count) {
+        return NULL;
+    }
+    return hl_buffers[id->via.u64 - 1];
+}
+
+// Points `out` at the strings of a msgpack array (no copies); NULL or an
+// error message.
+static const char *hl_texts(const msgpack_object *lines, HlText **out) {
+    if (lines->type != MSGPACK_OBJECT_ARRAY) {
+        return "lines must be an array of strings";
+    }
+    uint32_t n = lines->via.array.size;
+    *out = malloc((n ? n : 1) * sizeof(HlText));
+    if (!*out) {
+        return "out of memory";
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        const msgpack_object *o = &lines->via.array.ptr[i];
+        if (o->type != MSGPACK_OBJECT_STR) {
+            free(*out);
+            return "lines must be an array of strings";
+        }
+        (*out)[i] = (HlText){o->via.str.ptr, o->via.str.size};
+    }
+    return NULL;
+}
+
+static const char *run_hl_open(Job *job, msgpack_packer *pk) {
+    if (job->nargs != 2 || job->args[0].type != MSGPACK_OBJECT_STR) {
+        return "expected lang, lines";
+    }
+    char *name = dup_str(&job->args[0]);
+    if (!name) {
+        return "out of memory";
+    }
+    const FlexLang *lang = flex_lang_find(name);
+    if (!lang) {
+        lang = flex_lang_for_path(name);
+    }
+    free(name);
+    if (!lang) {
+        return "unknown language";
+    }
+
+    HlText *texts;
+    const char *error = hl_texts(&job->args[1], &texts);
+    if (error) {
+        return error;
+    }
+    size_t id = 0;
+    while (id < hl_buffer_count && hl_buffers[id]) {
+        id++;
+    }
+    HlDoc *d = malloc(sizeof(*d));
+    if (id == hl_buffer_count) {
+        HlDoc **p = realloc(hl_buffers, (hl_buffer_count + 1) * sizeof(*p));
+        if (p) {
+            hl_buffers = p;
+            hl_buffers[hl_buffer_count++] = NULL;
+        }
+    }
+    if (d) {
+        hl_init(&d->hl, lang);
+        d->folds = NULL;
+    }
+    if (!d || id == hl_buffer_count ||
+        hl_set_lines(&d->hl, 0, 0, texts, job->args[1].via.array.size) != 0) {
+        if (d) {
+            hl_free(&d->hl);
+        }
+        free(d);
+        free(texts);
+        return "out of memory";
+    }
+    free(texts);
+    hl_buffers[id] = d;
+    msgpack_pack_uint64(pk, id + 1);
+    return NULL;
+}
+
+static const char *run_hl_lines(Job *job, msgpack_packer *pk) {
+    const msgpack_object *a = job->args;
+    HlDoc *d = job->nargs == 4 ? hl_lookup(&a[0]) : NULL;
+    if (!d || !is_uint(&a[1]) || !is_uint(&a[2])) {
+        return "expected id, first, last, lines";
+    }
+    HlBuffer *b = &d->hl;
+    if (a[1].via.u64 > a[2].via.u64 || a[2].via.u64 > b->nlines) {
+        return "line range out of bounds";
+    }
+    HlText *texts;
+    const char *error = hl_texts(&a[3], &texts);
+    if (error) {
+        return error;
+    }
+    int rc = hl_set_lines(b, a[1].via.u64, a[2].via.u64, texts, a[3].via.array.size);
+    free(texts);
+    if (rc != 0) {
+        return "out of memory";
+    }
+    if (d->folds && fold_set_lines(d->folds, b->text, b->off, a[1].via.u64, a[2].via.u64,
+                                   a[3].via.array.size) != 0) {
+        // Rebuilt from scratch by the next fold request.
+        fold_free(d->folds);
+        free(d->folds);
+        d->folds = NULL;
+    }
+    msgpack_pack_nil(pk);
+    return NULL;
+}
+
+static const char *run_hl_viewport(Job *job, msgpack_packer *pk) {
+    const msgpack_object *a = job->args;
+    HlDoc *d = job->nargs == 3 ? hl_lookup(&a[0]) : NULL;
+    if (!d || !is_uint(&a[1]) || !is_uint(&a[2])) {
+        return "expected id, top, bottom";
+    }
+    HlBuffer *b = &d->hl;
+    size_t top = a[1].via.u64, bottom = a[2].via.u64;
+    if (bottom > b->nlines) {
+        bottom = b->nlines;
+    }
+    long total = top < bottom ? hl_viewport(b, top, bottom) : 0;
+    if (total < 0) {
+        return "out of memory";
+    }
+    msgpack_pack_array(pk, (size_t)total);
+    for (size_t line = top; line < bottom; line++) {
+        size_t count;
+        const HlRange *r = hl_line(b, line, &count);
+        for (size_t i = 0; i < count; i++) {
+            msgpack_pack_array(pk, 4);
+            msgpack_pack_uint64(pk, line);
+            msgpack_pack_uint32(pk, r[i].col_start);
+            msgpack_pack_uint32(pk, r[i].col_end);
+            pack_str(pk, hl_group_name((int)r[i].group));
+        }
+    }
+    return NULL;
+}
+
+static const char *run_hl_close(Job *job, msgpack_packer *pk) {
+    HlDoc *d = job->nargs == 1 ? hl_lookup(&job->args[0]) : NULL;
+    if (!d) {
+        return "expected id";
+    }
+    if (d->folds) {
+        fold_free(d->folds);
+        free(d->folds);
+    }
+    hl_free(&d->hl);
+    free(d);
+    hl_buffers[job->args[0].via.u64 - 1] = NULL;
+    msgpack_pack_nil(pk);
+    return NULL;
+}
+
+// The fold index of a buffer, built over its lines on first use.
+static FoldIndex *fold_index(HlDoc *d) {
+    if (!d->folds) {
+        FoldIndex *fx = malloc(sizeof(*fx));
+        if (!fx) {
+            return NULL;
+        }
+        fold_init(fx, d->hl.lang);
+        if (fold_set_lines(fx, d->hl.text, d->hl.off, 0, 0, d->hl.nlines) != 0) {
+            fold_free(fx);
+            free(fx);
+            return NULL;
+        }
+        d->folds = fx;
+    }
+    return d->folds;
+}
+
+static const char *run_fold_ranges(Job *job, msgpack_packer *pk) {
+    HlDoc *d = job->nargs == 1 ? hl_lookup(&job->args[0]) : NULL;
+    if (!d) {
+        return "expected id";
+    }
+    FoldIndex *fx = fold_index(d);
+    const FoldRange *r;
+    long count = fx ? fold_ranges(fx, &r) : -1;
+    if (count < 0) {
+        return "out of memory";
+    }
+    msgpack_pack_array(pk, (size_t)count);
+    for (long i = 0; i < count; i++) {
+        msgpack_pack_array(pk, 2);
+        msgpack_pack_uint32(pk, r[i].start);
+        msgpack_pack_uint32(pk, r[i].end);
+    }
+    return NULL;
+}
+
+static const char *run_fold_match(Job *job, msgpack_packer *pk) {
+    const msgpack_object *a = job->args;
+    HlDoc *d = job->nargs == 3 ? hl_lookup(&a[0]) : NULL;
+    if (!d || !is_uint(&a[1]) || !is_uint(&a[2])) {
+        return "expected id, line, col";
+    }
+    FoldIndex *fx = fold_index(d);
+    size_t line, col;
+    int found = fx ? fold_match(fx, a[1].via.u64, a[2].via.u64, &line, &col) : -1;
+    if (found < 0) {
+        return "out of memory";
+    }
+    if (!found) {
+        msgpack_pack_nil(pk);
+        return NULL;
+    }
+    msgpack_pack_array(pk, 2);
+    msgpack_pack_uint64(pk, line);
+    msgpack_pack_uint64(pk, col);
+    return NULL;
+}
+
+// --- Buffer mirrors ---
+
+static PieceTable *pt_lookup(const msgpack_object *id) {
+    if (!is_uint(id) || id->via.u64 == 0 || id->via.u64 > pt_buffer_count) {
+        return NULL;
+    }
+    return pt_buffers[id->via.u64 - 1];
+}
+
+// As hl_texts(), for piece.h.
+static const char *pt_texts(const msgpack_object *lines, PtText **out) {
+    if (lines->type != MSGPACK_OBJECT_ARRAY) {
+        return "lines must be an array of strings";
+    }
+    uint32_t n = lines->via.array.size;
+    *out = malloc((n ? n : 1) * sizeof(PtText));
+    if (!*out) {
+        return "out of memory";
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        const msgpack_object *o = &lines->via.array.ptr[i];
+        if (o->type != MSGPACK_OBJECT_STR) {
+            free(*out);
+            return "lines must be an array of strings";
+        }
+        (*out)[i] = (PtText){o->via.str.ptr, o->via.str.size};
+    }
+    return NULL;
+}
+
+static const char *run_buf_open(Job *job, msgpack_packer *pk) {
+    if (job->nargs != 1) {
+        return "expected lines";
+    }
+    PtText *texts;
+    const char *error = pt_texts(&job->args[0], &texts);
+    if (error) {
+        return error;
+    }
+    size_t id = 0;
+    while (id < pt_buffer_count && pt_buffers[id]) {
+        id++;
+    }
+    PieceTable *pt = malloc(sizeof(*pt));
+    if (id == pt_buffer_count) {
+        PieceTable **p = realloc(pt_buffers, (pt_buffer_count + 1) * sizeof(*p));
+        if (p) {
+            pt_buffers = p;
+            pt_buffers[pt_buffer_count++] = NULL;
+        }
+    }
+    if (pt) {
+        pt_init(pt);
+    }
+    if (!pt || id == pt_buffer_count ||
+        pt_set_lines(pt, 0, 0, texts, job->args[0].via.array.size) != 0) {
+        if (pt) {
+            pt_free(pt);
+        }
+        free(pt);
+        free(texts);
+        return "out of memory";
+    }
+    free(texts);
+    pt_buffers[id] = pt;
+    msgpack_pack_uint64(pk, id + 1);
+    return NULL;
+}
+
+static const char *run_buf_lines(Job *job, msgpack_packer *pk) {
+    const msgpack_object *a = job->args;
+    PieceTable *pt = job->nargs == 4 ? pt_lookup(&a[0]) : NULL;
+    if (!pt || !is_uint(&a[1]) || !is_uint(&a[2])) {
+        return "expected id, first, last, lines";
+    }
+    if (a[1].via.u64 > a[2].via.u64 || a[2].via.u64 > pt_line_count(pt)) {
+        return "line range out of bounds";
+    }
+    PtText *texts;
+    const char *error = pt_texts(&a[3], &texts);
+    if (error) {
+        return error;
+    }
+    int rc = pt_set_lines(pt, a[1].via.u64, a[2].via.u64, texts, a[3].via.array.size);
+    free(texts);
+    if (rc != 0) {
+        return "out of memory";
+    }
+    msgpack_pack_nil(pk);
+    return NULL;
+}
+
+static const char *run_buf_get(Job *job, msgpack_packer *pk) {
+    const msgpack_object *a = job->args;
+    PieceTable *pt = job->nargs == 3 ? pt_lookup(&a[0]) : NULL;
+    if (!pt || !is_uint(&a[1]) || !is_uint(&a[2])) {
+        return "expected id, first, last";
+    }
+    size_t first = a[1].via.u64, last = a[2].via.u64;
+    if (last > pt_line_count(pt)) {
+        last = pt_line_count(pt);
+    }
+    msgpack_pack_array(pk, first < last ? last - first : 0);
+    PtChunk c;
+    for (size_t l = first; l < last && pt_chunk(pt, l, &c); l += c.lines) {
+        const char *p = c.ptr;
+        for (size_t i = 0; i < c.lines && l + i < last; i++) {
+            const char *nl = memchr(p, '\n', c.len - (size_t)(p - c.ptr));
+            msgpack_pack_str(pk, (size_t)(nl - p));
+            msgpack_pack_str_body(pk, p, (size_t)(nl - p));
+            p = nl + 1;
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    size_t line, col;
+    const char *text;
+    size_t len;
+} BufMatch;
+
+typedef struct {
+    BufMatch *matches;
+    size_t count, cap;
+    size_t limit; // 0 = unlimited
+    size_t base;  // first line of the chunk being searched
+    int failed;
+} BufSearch;
+
+static int buf_search_emit(void *ud, size_t line_no, size_t col, const char *line,
+                           size_t len) {
+    BufSearch *s = ud;
+    if (s->count == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 64;
+        BufMatch *m = realloc(s->matches, cap * sizeof(*m));
+        if (!m) {
+            s->failed = 1;
+            return 1;
+        }
+        s->matches = m;
+        s->cap = cap;
+    }
+    s->matches[s->count++] = (BufMatch){s->base + line_no - 1, col - 1, line, len};
+    return s->limit && s->count >= s->limit;
+}
+
+static const char *run_buf_search(Job *job, msgpack_packer *pk) {
+    const msgpack_object *a = job->args;
+    PieceTable *pt = job->nargs == 2 || job->nargs == 3 ? pt_lookup(&a[0]) : NULL;
+    if (!pt || a[1].type != MSGPACK_OBJECT_STR) {
+        return "expected id, pattern[, opts]";
+    }
+    int flags = 0;
+    BufSearch s = {NULL, 0, 0, 0, 0, 0};
+    if (job->nargs == 3) {
+        if (a[2].type != MSGPACK_OBJECT_MAP) {
+            return "options must be a map";
+        }
+        for (uint32_t i = 0; i < a[2].via.map.size; i++) {
+            const msgpack_object_kv *kv = &a[2].via.map.ptr[i];
+            if (key_is(&kv->key, "limit") && is_uint(&kv->val)) {
+                s.limit = kv->val.via.u64;
+            } else if (key_is(&kv->key, "fixed") && kv->val.type == MSGPACK_OBJECT_BOOLEAN) {
+                flags |= kv->val.via.boolean ? SR_FIXED : 0;
+            } else if (key_is(&kv->key, "icase") && kv->val.type == MSGPACK_OBJECT_BOOLEAN) {
+                flags |= kv->val.via.boolean ? SR_ICASE : 0;
+            } else {
+                return "unknown option";
+            }
+        }
+    }
+    char *pattern = dup_str(&a[1]);
+    if (!pattern) {
+        return "out of memory";
+    }
+    SrPattern p;
+    static char err[128]; // reader thread only, and read before the next call
+    int rc = sr_compile(&p, pattern, flags, err, sizeof(err));
+    free(pattern);
+    if (rc != 0) {
+        return err;
+    }
+    // Chunks are whole lines, so a line-oriented search sees every line
+    // intact; only the line numbers need the chunk's offset.
+    PtChunk c;
+    for (size_t l = 0; pt_chunk(pt, l, &c); l += c.lines) {
+        s.base = c.line;
+        sr_search(&p, c.ptr, c.len, buf_search_emit, &s);
+        if (s.failed || (s.limit && s.count >= s.limit)) {
+            break;
+        }
+    }
+    sr_free(&p);
+    if (s.failed) {
+        free(s.matches);
+        return "out of memory";
+    }
+    msgpack_pack_array(pk, s.count);
+    for (size_t i = 0; i < s.count; i++) {
+        msgpack_pack_array(pk, 3);
+        msgpack_pack_uint64(pk, s.matches[i].line);
+        msgpack_pack_uint64(pk, s.matches[i].col);
+        msgpack_pack_str(pk, s.matches[i].len);
+        msgpack_pack_str_body(pk, s.matches[i].text, s.matches[i].len);
+    }
+    free(s.matches);
+    return NULL;
+}
+
+static const char *run_buf_close(Job *job, msgpack_packer *pk) {
+    PieceTable *pt = job->nargs == 1 ? pt_lookup(&job->args[0]) : NULL;
+    if (!pt) {
+        return "expected id";
+    }
+    pt_free(pt);
+    free(pt);
+    pt_buffers[job->args[0].via.u64 - 1] = NULL;
+    msgpack_pack_nil(pk);
+    return NULL;
+}
+
+static const Method methods[] = {
+    {"local_time", 0, parse_none, run_local_time},
+    {"sysinfo", 0, parse_none, run_sysinfo},
+    {"dir_size", 1, parse_path, run_dir_size},
+    {"dirscan", 1, parse_path, run_dirscan},
+    {"dirwalk", 1, parse_dirwalk, run_dirwalk},
+    {"hl_open", 0, parse_inline, run_hl_open},
+    {"hl_lines", 0, parse_inline, run_hl_lines},
+    {"hl_viewport", 0, parse_inline, run_hl_viewport},
+    {"hl_close", 0, parse_inline, run_hl_close},
+    {"fold_ranges", 0, parse_inline, run_fold_ranges},
+    {"fold_match", 0, parse_inline, run_fold_match},
+    {"buf_open", 0, parse_inline, run_buf_open},
+    {"buf_lines", 0, parse_inline, run_buf_lines},
+    {"buf_get", 0, parse_inline, run_buf_get},
+    {"buf_search", 0, parse_inline, run_buf_search},
+    {"buf_close", 0, parse_inline, run_buf_close},
+};
+
+// --- Worker pool ---
+
+static void *worker_main(void *arg) {
+    int slot = (int)(intptr_t)arg;
+    pthread_mutex_lock(&queue_lock);
+    for (;;) {
+        while (!queue_head && !shutting_down) {
+            pthread_cond_wait(&queue_cond, &queue_lock);
+        }
+        if (!queue_head) {
+            break;
+        }
+        Job *job = queue_head;
+        queue_head = job->next;
+        if (!queue_head) {
+            queue_tail = NULL;
+        }
+        running_jobs[slot] = job;
+        pthread_mutex_unlock(&queue_lock);
+
+        run_job(job);
+
+        pthread_mutex_lock(&queue_lock);
+        running_jobs[slot] = NULL;
+        job_free(job);
+    }
+    pthread_mutex_unlock(&queue_lock);
+    return NULL;
+}
+
+static void enqueue(Job *job) {
+    pthread_mutex_lock(&queue_lock);
+    job->next = NULL;
+    if (queue_tail) {
+        queue_tail->next = job;
+    } else {
+        queue_head = job;
+    }
+    queue_tail = job;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+static void cancel(uint32_t msgid, int nworkers) {
+    pthread_mutex_lock(&queue_lock);
+    for (Job *job = queue_head; job; job = job->next) {
+        if (job->msgid == msgid) {
+            atomic_store(&job->cancelled, 1);
+        }
+    }
+    for (int i = 0; i < nworkers; i++) {
+        if (running_jobs[i] && running_jobs[i]->msgid == msgid) {
+            atomic_store(&running_jobs[i]->cancelled, 1);
+        }
+    }
+    pthread_mutex_unlock(&queue_lock);
+}
+
+// --- Dispatch ---
+
+static const Method *find_method(const msgpack_object *name) {
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (key_is(name, methods[i].name)) {
+            return &methods[i];
+        }
+    }
+    return NULL;
+}
+
+static void handle_message(const msgpack_object *msg, int nworkers) {
+    if (msg->type != MSGPACK_OBJECT_ARRAY || msg->via.array.size < 3 ||
+        msg->via.array.ptr[0].type != MSGPACK_OBJECT_POSITIVE_INTEGER) {
+        return; // not msgpack-RPC; nobody to answer
+    }
+    const msgpack_object *f = msg->via.array.ptr;
+    uint64_t type = f[0].via.u64;
+
+    if (type == MSG_NOTIFY) {
+        const msgpack_object *params = &f[2];
+        if (key_is(&f[1], "cancel") && params->type == MSGPACK_OBJECT_ARRAY && params->via.array.size == 1 &&
+            params->via.array.ptr[0].type == MSGPACK_OBJECT_POSITIVE_INTEGER) {
+            cancel((uint32_t)params->via.array.ptr[0].via.u64, nworkers);
+        }
+        return;
+    }
+    if (type != MSG_REQUEST || msg->via.array.size != 4 || f[1].type != MSGPACK_OBJECT_POSITIVE_INTEGER) {
+        return;
+    }
+
+    uint32_t msgid = (uint32_t)f[1].via.u64;
+    const Method *method = f[2].type == MSGPACK_OBJECT_STR ? find_method(&f[2]) : NULL;
+    if (!method) {
+        send_response(msgid, "unknown method", NULL);
+        return;
+    }
+    if (f[3].type != MSGPACK_OBJECT_ARRAY) {
+        send_response(msgid, "params must be an array", NULL);
+        return;
+    }
+    Job *job = calloc(1, sizeof(*job));
+    if (!job) {
+        send_response(msgid, "out of memory", NULL);
+        return;
+    }
+    job->msgid = msgid;
+    job->method = method;
+    const char *error = method->parse(job, f[3].via.array.ptr, f[3].via.array.size);
+    if (error) {
+        send_response(msgid, error, NULL);
+        job_free(job);
+    } else if (method->pooled) {
+        enqueue(job);
+    } else {
+        run_job(job);
+        job_free(job);
+    }
+}
+
+int main(int argc, char **argv) {
+    int nworkers = 4;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:")) != -1) {
+        if (opt == 'j' && atoi(optarg) >= 1 && atoi(optarg) <= MAX_WORKERS) {
+            nworkers = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-j workers (1-%d)]\n", argv[0], MAX_WORKERS);
+            return 2;
+        }
+    }
+    // A closed stdout must surface as EPIPE from write(), not kill us.
+    signal(SIGPIPE, SIG_IGN);
+    have_sampler = ps_open(&sampler) == 0;
+
+    pthread_t workers[MAX_WORKERS];
+    for (int i = 0; i < nworkers; i++) {
+        if (pthread_create(&workers[i], NULL, worker_main, (void *)(intptr_t)i) != 0) {
+            fprintf(stderr, "backend: cannot start workers\n");
+            return 1;
+        }
+    }
+
+    msgpack_unpacker unpacker;
+    msgpack_unpacked msg;
+    if (!msgpack_unpacker_init(&unpacker, READ_CHUNK)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    msgpack_unpacked_init(&msg);
+
+    int rc = 0;
+    for (;;) {
+        if (!msgpack_unpacker_reserve_buffer(&unpacker, READ_CHUNK)) {
+            fprintf(stderr, "Out of memory\n");
+            rc = 1;
+            break;
+        }
+        ssize_t n = read(STDIN_FILENO, msgpack_unpacker_buffer(&unpacker), READ_CHUNK);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        msgpack_unpacker_buffer_consumed(&unpacker, (size_t)n);
+
+        msgpack_unpack_return ret;
+        while ((ret = msgpack_unpacker_next(&unpacker, &msg)) == MSGPACK_UNPACK_SUCCESS) {
+            handle_message(&msg.data, nworkers);
+        }
+        if (ret == MSGPACK_UNPACK_PARSE_ERROR) {
+            fprintf(stderr, "backend: malformed msgpack on stdin\n");
+            rc = 1;
+            break;
+        }
+        pthread_mutex_lock(&out_lock);
+        int failed = out_failed;
+        pthread_mutex_unlock(&out_lock);
+        if (failed) {
+            rc = 1;
+            break;
+        }
+    }
+
+    // Let the workers drain the queue, then stop them.
+    pthread_mutex_lock(&queue_lock);
+    shutting_down = 1;
+    pthread_cond_broadcast(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+    for (int i = 0; i < nworkers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    msgpack_unpacked_destroy(&msg);
+    msgpack_unpacker_destroy(&unpacker);
+    if (have_sampler) {
+        ps_close(&sampler);
+    }
+    return rc;
+}
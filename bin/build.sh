@@ -8,3 +8,29 @@ gcc -o sysinfo sysinfo.c \
     -I/opt/homebrew/include \
     -L/opt/homebrew/lib \
     -lmsgpackc
+
+# In-process backends for Neovim's LuaJIT (ffi.load), see libc11.h / libc11.lua
+# gcc -O2 -shared -fPIC -o libc11.so libc11.c
+
+# msgpack-RPC backend for jobstart({rpc = true}), see backend.c
+# gcc -O2 -pthread -o backend backend.c libc11.c $(pkg-config --cflags --libs msgpack)
+
+# Parallel grep over the walker's file list, see search.c / search.h
+# gcc -O2 -pthread -o search search.c libc11.c
+# ./search_check.sh ..   (parity with grep -rnIE)
+
+# cloc-style line/token counts per language, see codestats.c
+# gcc -O2 -pthread -o codestats codestats.c
+
+# Specialized lexers from the flexer_langs.h tables (rerun when they change)
+# gcc -O2 -o flexgen flexgen.c && ./flexgen > flexer_gen.h
+# gcc -O2 -o flexgen_bench flexgen_bench.c && ./flexgen_bench ../lua/**/*.lua
+
+# Viewport highlighting (highlight.h): redraw cost, incremental re-lex checked against rebuilds
+# gcc -O2 -o highlight_bench highlight_bench.c && ./highlight_bench -l 100000 ../lua/**/*.lua
+
+# Fold index (fold.h): build time, and incremental edits checked against rebuilds
+# gcc -O2 -o fold_bench fold_bench.c && ./fold_bench ../lua/**/*.lua
+
+# Piece table buffer mirror (piece.h): edits vs a flat copy, chunked search, checked
+# gcc -O2 -o piece_bench piece_bench.c && ./piece_bench ../lua/**/*.lua
@@ -0,0 +1,426 @@
+// Line and token statistics per language over a file list, cloc-style.
+//
+//   gcc -O2 -pthread -o codestats codestats.c
+//   cd lua && ../bin/dirwalk | ../bin/codestats [-f] [-m] [-j threads]
+//
+// Paths are read one per line from stdin (or -i file) as they arrive;
+// dirwalk's "[FILE]: " prefix and a leading "./" are stripped and "[DIR]: "
+// lines are skipped. Files whose extension has a table in flexer_langs.h
+// are lexed by a pool of threads, each with its own Flexer, using the
+// generated lexers in flexer_gen.h; the others are ignored. Every line
+// counts once:
+//
+//   code     a token starts on it or spans it (multi-line strings, C
+//            preprocessor lines with continuations)
+//   comment  anything else that is not whitespace, which is what the lexer
+//            skipped as a comment
+//   blank    the rest
+//
+// Output is TOON on stdout, or one msgpack map with -m: a `languages`
+// table, a `tokens` table with one column per token kind, and with -f a
+// `files` table in input order. The elapsed time goes to stderr.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flexer_gen.h"
+#define TOON_IMPLEMENTATION
+#include "toon_format.h"
+#include "toon_msgpack.h"
+
+#define MAX_THREADS 64
+
+// Token kinds are counted in slots: 0 for invalid input, then the flexer.h
+// base types, then the flexer_langs.h classes.
+#define KIND_SLOTS (TOK_STRING + 1 + (FL_KIND_END - FL_KEYWORD))
+
+static int kind_slot(int type) {
+  if (type >= FL_KEYWORD && type < FL_KIND_END)
+    return TOK_STRING + 1 + (type - FL_KEYWORD);
+  return type > 0 && type <= TOK_STRING ? type : 0;
+}
+
+static int slot_type(int slot) {
+  if (slot == 0)
+    return TOK_INVALID;
+  return slot <= TOK_STRING ? slot : FL_KEYWORD + (slot - TOK_STRING - 1);
+}
+
+typedef struct {
+  size_t files, blank, comment, code, tokens;
+  size_t kinds[KIND_SLOTS];
+} Stats;
+
+typedef struct {
+  char *path;
+  const FlexLang *lang;
+  Stats stats;
+  int ok; // read and lexed
+} Entry;
+
+typedef struct {
+  char *data;
+  size_t cap;
+} Scratch;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static Entry *entries;
+static size_t entry_count, entry_cap;
+static size_t next_entry; // first entry no worker has claimed
+static int input_done = 0;
+
+static int grow(Scratch *s, size_t need) {
+  if (s->cap >= need)
+    return 0;
+  size_t cap = s->cap ? s->cap : 1 << 16;
+  while (cap < need)
+    cap *= 2;
+  char *p = realloc(s->data, cap);
+  if (!p)
+    return -1;
+  s->data = p;
+  s->cap = cap;
+  return 0;
+}
+
+static int read_file(const char *path, Scratch *buf, size_t *len) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      grow(buf, (size_t)st.st_size + 1) != 0) {
+    close(fd);
+    return -1;
+  }
+  size_t got = 0, size = (size_t)st.st_size;
+  while (got < size) {
+    ssize_t n = pread(fd, buf->data + got, size - got, (off_t)got);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    got += (size_t)n;
+  }
+  close(fd);
+  *len = got;
+  return 0;
+}
+
+static void count_line(Stats *st, int has_token, int ink) {
+  if (has_token)
+    st->code++;
+  else if (ink)
+    st->comment++;
+  else
+    st->blank++;
+}
+
+// Lexes src and classifies its lines. `marks` is scratch for one byte per
+// line.
+static void count_file(const FlexLang *lang, const char *src, size_t len,
+                       Scratch *marks, Stats *st) {
+  size_t lines = 0;
+  for (const char *p = src; (p = memchr(p, '\n', (size_t)(src + len - p)));
+       p++)
+    lines++;
+  if (len > 0 && src[len - 1] != '\n')
+    lines++;
+  if (grow(marks, lines + 1) != 0)
+    return;
+  memset(marks->data, 0, lines + 1);
+
+  FlexNextFn next = flex_next_for(lang);
+  Flexer f;
+  flex_init(&f, src, len);
+  flex_lang_apply(&f, lang);
+  for (Token t; (t = next(&f)).type != TOK_EOF;) {
+    st->kinds[kind_slot(t.type)]++;
+    st->tokens++;
+    // Long strings and continued directives cover several lines.
+    size_t last = (size_t)t.line;
+    for (size_t i = 0; i + 1 < t.text.len; i++)
+      last += t.text.start[i] == '\n';
+    for (size_t l = (size_t)t.line; l <= last && l <= lines; l++)
+      marks->data[l] = 1;
+  }
+
+  size_t line = 1;
+  int ink = 0;
+  for (size_t i = 0; i < len; i++) {
+    char c = src[i];
+    if (c == '\n') {
+      count_line(st, marks->data[line], ink);
+      line++;
+      ink = 0;
+    } else if (c != ' ' && c != '\t' && c != '\r' && c != '\f' && c != '\v') {
+      ink = 1;
+    }
+  }
+  if (line <= lines) // no final newline
+    count_line(st, marks->data[line], ink);
+  st->files = 1;
+}
+
+static void *worker_main(void *arg) {
+  (void)arg;
+  Scratch buf = {0}, marks = {0};
+  for (;;) {
+    pthread_mutex_lock(&lock);
+    while (next_entry == entry_count && !input_done)
+      pthread_cond_wait(&work_cond, &lock);
+    if (next_entry == entry_count) {
+      pthread_mutex_unlock(&lock);
+      break;
+    }
+    size_t i = next_entry++;
+    Entry e = entries[i]; // the array may move while we work
+    pthread_mutex_unlock(&lock);
+
+    size_t len;
+    if (read_file(e.path, &buf, &len) == 0) {
+      count_file(e.lang, buf.data, len, &marks, &e.stats);
+      e.ok = e.stats.files == 1;
+    }
+
+    pthread_mutex_lock(&lock);
+    entries[i].stats = e.stats;
+    entries[i].ok = e.ok;
+    pthread_mutex_unlock(&lock);
+  }
+  free(buf.data);
+  free(marks.data);
+  return NULL;
+}
+
+// Queues one input line if it names a file in a known language; -1 if out
+// of memory.
+static int add_line(char *s, ssize_t n) {
+  if (n > 0 && s[n - 1] == '\n')
+    s[--n] = '\0';
+  if (strncmp(s, "[DIR]: ", 7) == 0)
+    return 0;
+  if (strncmp(s, "[FILE]: ", 8) == 0) {
+    s += 8;
+    n -= 8;
+  }
+  if (strncmp(s, "./", 2) == 0) {
+    s += 2;
+    n -= 2;
+  }
+  const FlexLang *lang = n > 0 ? flex_lang_for_path(s) : NULL;
+  if (!lang)
+    return 0;
+  char *path = strdup(s);
+  if (!path)
+    return -1;
+  pthread_mutex_lock(&lock);
+  if (entry_count == entry_cap) {
+    size_t cap = entry_cap ? entry_cap * 2 : 256;
+    Entry *p = realloc(entries, cap * sizeof(*p));
+    if (!p) {
+      pthread_mutex_unlock(&lock);
+      free(path);
+      return -1;
+    }
+    entries = p;
+    entry_cap = cap;
+  }
+  entries[entry_count++] = (Entry){path, lang, {0}, 0};
+  pthread_cond_signal(&work_cond);
+  pthread_mutex_unlock(&lock);
+  return 0;
+}
+
+static void add_stats(Stats *into, const Stats *s) {
+  into->files += s->files;
+  into->blank += s->blank;
+  into->comment += s->comment;
+  into->code += s->code;
+  into->tokens += s->tokens;
+  for (int k = 0; k < KIND_SLOTS; k++)
+    into->kinds[k] += s->kinds[k];
+}
+
+static ToonValue *tv_int(size_t n) {
+  ToonValue *v = tv_new(TOON_INT);
+  if (v)
+    v->data.int_val = (int64_t)n;
+  return v;
+}
+
+static int add_counts(ToonValue *row, const Stats *s) {
+  return tv_obj_add(row, "blank", tv_int(s->blank)) ||
+         tv_obj_add(row, "comment", tv_int(s->comment)) ||
+         tv_obj_add(row, "code", tv_int(s->code));
+}
+
+// The report, or NULL if out of memory.
+static ToonValue *build_report(const Stats *by_lang, int per_file) {
+  ToonValue *root = tv_new(TOON_OBJECT), *langs = tv_new(TOON_ARRAY),
+            *kinds = tv_new(TOON_ARRAY);
+  Stats total = {0};
+  int bad = !root || !langs || !kinds;
+  for (size_t l = 0; !bad && l < FLEX_LANG_COUNT; l++) {
+    const Stats *s = &by_lang[l];
+    if (s->files == 0)
+      continue;
+    add_stats(&total, s);
+    ToonValue *row = tv_new(TOON_OBJECT), *krow = tv_new(TOON_OBJECT);
+    bad = !row || !krow ||
+          tv_obj_add(row, "language", tv_str(strdup(flex_langs[l].name))) ||
+          tv_obj_add(row, "files", tv_int(s->files)) || add_counts(row, s) ||
+          tv_obj_add(row, "tokens", tv_int(s->tokens)) ||
+          tv_obj_add(krow, "language", tv_str(strdup(flex_langs[l].name)));
+    for (int k = 0; !bad && k < KIND_SLOTS; k++)
+      bad = tv_obj_add(krow, flex_kind_name(slot_type(k)), tv_int(s->kinds[k]));
+    bad = bad || tv_arr_push(langs, row) || tv_arr_push(kinds, krow);
+  }
+  ToonValue *sum = tv_new(TOON_OBJECT);
+  bad = bad || !sum || tv_obj_add(sum, "files", tv_int(total.files)) ||
+        add_counts(sum, &total) ||
+        tv_obj_add(sum, "tokens", tv_int(total.tokens)) ||
+        tv_obj_add(root, "languages", langs) ||
+        tv_obj_add(root, "tokens", kinds) || tv_obj_add(root, "total", sum);
+  if (!bad && per_file) {
+    ToonValue *files = tv_new(TOON_ARRAY);
+    for (size_t i = 0; !bad && files && i < entry_count; i++) {
+      const Entry *e = &entries[i];
+      ToonValue *row = tv_new(TOON_OBJECT);
+      if (!e->ok) {
+        toon_free(row);
+        continue;
+      }
+      bad = !row || tv_obj_add(row, "path", tv_str(strdup(e->path))) ||
+            tv_obj_add(row, "language", tv_str(strdup(e->lang->name))) ||
+            add_counts(row, &e->stats) ||
+            tv_obj_add(row, "tokens", tv_int(e->stats.tokens)) ||
+            tv_arr_push(files, row);
+    }
+    bad = bad || !files || tv_obj_add(root, "files", files);
+  }
+  if (bad) {
+    toon_free(root);
+    return NULL;
+  }
+  return root;
+}
+
+static double elapsed_ms(const struct timespec *t0) {
+  struct timespec t1;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) * 1e3 + (t1.tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+int main(int argc, char **argv) {
+  int nthreads = 0, per_file = 0, msgpack = 0, bad = 0;
+  const char *input = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "fmj:i:")) != -1) {
+    switch (opt) {
+    case 'f':
+      per_file = 1;
+      break;
+    case 'm':
+      msgpack = 1;
+      break;
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+    case 'i':
+      input = optarg;
+      break;
+    default:
+      bad = 1;
+      break;
+    }
+  }
+  if (bad || optind != argc) {
+    fprintf(stderr, "Usage: %s [-f] [-m] [-j threads] [-i list] < list\n",
+            argv[0]);
+    return 2;
+  }
+  FILE *in = input ? fopen(input, "r") : stdin;
+  if (!in) {
+    perror(input);
+    return 1;
+  }
+
+  struct timespec t0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if (nthreads <= 0) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = n > 0 ? (int)n : 1;
+  }
+  if (nthreads > MAX_THREADS)
+    nthreads = MAX_THREADS;
+  pthread_t threads[MAX_THREADS];
+  int started = 0;
+  while (started < nthreads &&
+         pthread_create(&threads[started], NULL, worker_main, NULL) == 0)
+    started++;
+  if (started == 0) {
+    fprintf(stderr, "Could not start a worker thread\n");
+    return 1;
+  }
+
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t n;
+  int rc = 0;
+  while (rc == 0 && (n = getline(&line, &cap, in)) > 0)
+    rc = add_line(line, n);
+  free(line);
+  if (in != stdin)
+    fclose(in);
+  pthread_mutex_lock(&lock);
+  input_done = 1;
+  pthread_cond_broadcast(&work_cond);
+  pthread_mutex_unlock(&lock);
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  if (rc != 0) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  Stats by_lang[FLEX_LANG_COUNT] = {{0}};
+  size_t files = 0;
+  for (size_t i = 0; i < entry_count; i++)
+    if (entries[i].ok) {
+      add_stats(&by_lang[entries[i].lang - flex_langs], &entries[i].stats);
+      files++;
+    }
+  ToonValue *report = build_report(by_lang, per_file);
+  double ms = elapsed_ms(&t0);
+  if (!report) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  if (msgpack) {
+    ToonMpBuf out = {0};
+    if (toon_to_msgpack(report, &out) != 0) {
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+    }
+    fwrite(out.data, 1, out.size, stdout);
+    toon_mpbuf_free(&out);
+  } else {
+    toon_write(stdout, report);
+  }
+  fprintf(stderr, "%zu files, %.2f ms\n", files, ms);
+
+  toon_free(report);
+  for (size_t i = 0; i < entry_count; i++)
+    free(entries[i].path);
+  free(entries);
+  return 0;
+}
@@ -1,6 +1,7 @@
 // lua_tokens.h  –  put this in your project or directly in main.c
 
-#define FLEXER_IMPLEMENTATION
+#include <stdio.h>
+
 #include "flexer.h"
 
 typedef enum {
@@ -126,8 +127,6 @@ static void lua_long_string_rule(Flexer *f, Token *out) {
   }
   flex_advance(f); // consume the second '['
 
-  const char *content_start = f->cur;
-
   // find matching closing bracket
   while (1) {
     if (flex_at_end(f)) {
@@ -185,15 +184,18 @@ int main() {
   // automatically
 
   Token t;
-  const char *names[] = {
-      [T_NAME] = "NAME", [T_NUMBER] = "NUMBER", [T_STRING] = "STRING"};
-
   while ((t = flex_next(&f)).type != T_EOF) {
     if (t.type <= 0)
       continue; // skip whitespace/comments
 
     const char *name = "UNKNOWN";
-    if (t.type >= TOK_USER && t.type < TOK_USER + 1000) {
+    if (t.type == TOK_IDENTIFIER || t.type == T_NAME)
+      name = "NAME";
+    else if (t.type == TOK_NUMBER || t.type == T_NUMBER)
+      name = "NUMBER";
+    else if (t.type == TOK_STRING || t.type == T_STRING)
+      name = "STRING";
+    else if (t.type >= TOK_USER && t.type < TOK_USER + 1000) {
       if (t.type == T_NAME)
         name = "NAME";
       else if (t.type == T_NUMBER)
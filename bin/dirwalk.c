@@ -1,21 +1,115 @@
 #include <dirent.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h> // Needed for stat() function
+#include <unistd.h>
+
+#define IGNORE_IMPLEMENTATION
+#include "ignore.h"
 
 // Maximum path length is often 4096, but 1024 is used for simplicity
 #define MAX_PATH 1024
 
+// Output is collected here and written in large chunks instead of one
+// printf() per entry.
+#define OUT_BUF_SIZE (1 << 20)
+
+// Binary mode (-b): the stream starts with the line "DWB1\n" and is
+// followed by one record per entry:
+//
+//   u8 kind        1 = directory, 2 = regular file
+//   varint parent  id of the containing directory, 0 = the start directory
+//   varint len     name length, then the name bytes (no path, no NUL)
+//
+// Directory records are numbered 1, 2, 3, ... in stream order, and a
+// directory always comes before its contents, so a reader rebuilds a full
+// path as path[parent] + "/" + name with one table of directory paths.
+// Varints are LEB128 (7 bits per byte, low bits first).
+#define DW_MAGIC "DWB1\n"
+enum { DW_DIR = 1, DW_FILE = 2 };
+
+static char out_buf[OUT_BUF_SIZE];
+static size_t out_len = 0;
+static int binary = 0;
+static uint64_t next_dir_id = 1;
+
+// .gitignore / .ignore rules of the directories being walked; -u disables
+// them (and walks into .git).
+static int use_ignore = 1;
+static IgStack ignores;
+
 // Function prototype
-void walk_directory(const char *path);
+void walk_directory(const char *path, uint64_t dir_id);
+
+static void flush_output(void) {
+  size_t done = 0;
+  while (done < out_len) {
+    ssize_t n = write(STDOUT_FILENO, out_buf + done, out_len - done);
+    if (n <= 0) {
+      perror("write failed");
+      _exit(1);
+    }
+    done += (size_t)n;
+  }
+  out_len = 0;
+}
+
+static void put_bytes(const void *data, size_t len) {
+  if (out_len + len > sizeof(out_buf))
+    flush_output();
+  memcpy(out_buf + out_len, data, len);
+  out_len += len;
+}
+
+static void put_varint(unsigned char *p, size_t *n, uint64_t v) {
+  do {
+    p[(*n)++] = (unsigned char)((v > 0x7f ? 0x80 : 0) | (v & 0x7f));
+    v >>= 7;
+  } while (v);
+}
+
+static void emit(int kind, uint64_t parent, const char *path,
+                 const char *name) {
+  if (binary) {
+    unsigned char head[1 + 10 + 10];
+    size_t n = 0, len = strlen(name);
+    head[n++] = (unsigned char)kind;
+    put_varint(head, &n, parent);
+    put_varint(head, &n, len);
+    put_bytes(head, n);
+    put_bytes(name, len);
+  } else {
+    put_bytes(kind == DW_DIR ? "[DIR]: " : "[FILE]: ", kind == DW_DIR ? 7 : 8);
+    put_bytes(path, strlen(path));
+    put_bytes("\n", 1);
+  }
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "bu")) != -1) {
+    if (opt == 'b') {
+      binary = 1;
+    } else if (opt == 'u') {
+      use_ignore = 0;
+    } else {
+      fprintf(stderr, "Usage: %s [-b] [-u]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (binary)
+    put_bytes(DW_MAGIC, 5);
 
-int main() {
   // Start walking from the current directory
-  walk_directory(".");
+  ig_stack_init(&ignores);
+  walk_directory(".", 0);
+  flush_output();
+  ig_stack_free(&ignores);
   return 0;
 }
 
-void walk_directory(const char *path) {
+void walk_directory(const char *path, uint64_t dir_id) {
   DIR *dir;
   struct dirent *entry;
   struct stat statbuf; // Structure to hold file status information
@@ -25,6 +119,11 @@ void walk_directory(const char *path) {
     perror("opendir failed");
     return;
   }
+  int pushed = use_ignore ? ig_push_dir(&ignores, path) : 0;
+  if (pushed < 0) {
+    perror("ignore rules");
+    pushed = 0;
+  }
 
   // 2. Loop through entries
   while ((entry = readdir(dir)) != NULL) {
@@ -45,19 +144,28 @@ void walk_directory(const char *path) {
       continue;
     }
 
+    // Ignored directories are skipped before they are ever opened.
+    if (use_ignore && ig_ignored(&ignores, full_path, strlen(full_path),
+                                 S_ISDIR(statbuf.st_mode))) {
+      continue;
+    }
+
     // Check if the entry is a Directory
     if (S_ISDIR(statbuf.st_mode)) {
-      printf("[DIR]: %s\n", full_path);
+      uint64_t id = next_dir_id++;
+      emit(DW_DIR, dir_id, full_path, entry->d_name);
 
       // 3. RECUSION: Call the function for the subdirectory
-      walk_directory(full_path);
+      walk_directory(full_path, id);
 
       // Check if the entry is a Regular File
     } else if (S_ISREG(statbuf.st_mode)) {
-      printf("[FILE]: %s\n", full_path);
+      emit(DW_FILE, dir_id, full_path, entry->d_name);
     }
   }
 
   // 4. Close the directory stream
+  if (pushed)
+    ig_pop(&ignores);
   closedir(dir);
 }
@@ -9,6 +9,7 @@
  *   - Custom number formats (hex, bin, scientific, suffixes like 10f, 0xFFu64)
  *   - String escapes, raw strings, char literals
  *   - Nested comments
+ *   - Optional identifier interning: dense 32-bit IDs on the tokens
  *   - Custom block/string delimiters (e.g. Python triple quotes, Rust raw
  * strings)
  *   - Excellent error reporting (line, column, context)
@@ -21,15 +22,22 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
-typedef enum { const char *start; size_t len; }
-Str;
+typedef struct {
+  const char *start;
+  size_t len;
+} Str;
 
 typedef enum {
   TOK_EOF = 0,
   TOK_INVALID = -1,
-  TOK_USER = 256 // your token types start here
+  TOK_IDENTIFIER = 1, // names that are not keywords
+  TOK_NUMBER = 2,     // default_number_rule() fills value
+  TOK_STRING = 3,     // "..." / '...' (or whatever custom_string accepts)
+  TOK_COMMENT = 4,    // only with keep_comments set
+  TOK_USER = 256      // your token types start here
 } TokenBaseType;
 
 typedef struct {
@@ -42,12 +50,39 @@ typedef struct {
     int64_t i64;
     uint64_t u64;
     double f64;
+    uint32_t id; // TOK_IDENTIFIER with an interner set: its FlexInterner ID
   } value;
 } Token;
 
-typedef struct Flexer;
+typedef struct Flexer Flexer;
 
-typedef void (*FlexRuleFn)(struct Flexer *f, Token *out);
+// Identifier interning: each distinct name gets a dense ID, 1, 2, 3, ... in
+// order of first appearance (0 = none), so comparing names is comparing
+// IDs. The names are stored once, back to back and NUL-terminated, in one
+// arena; the table holds (hash, ID) pairs, so probing never touches the
+// arena unless the hash matches. One interner can be shared by many
+// Flexers (one at a time) to give names the same ID across files.
+typedef struct {
+  uint32_t hash, id; // id 0 = empty slot
+} FlexInternSlot;
+
+typedef struct {
+  char *arena; // the names, each followed by a NUL
+  size_t arena_len, arena_cap;
+  uint32_t *offsets; // by ID: arena offset; offsets[0] is unused
+  uint32_t *lengths;
+  uint32_t count;    // IDs handed out so far
+  uint32_t id_cap;
+  FlexInternSlot *slots;
+  uint32_t mask; // slot count - 1 (a power of two), 0 before the first name
+} FlexInterner;
+
+typedef void (*FlexRuleFn)(Flexer *f, Token *out);
+
+// Tried at the start of every token, before anything else. Return false
+// without consuming input to decline; return true with out->type == 0 to skip
+// what was consumed (e.g. a comment form the tables can't express).
+typedef bool (*FlexTokenFn)(Flexer *f, Token *out);
 
 typedef struct {
   const char *prefix; // e.g. "==", "+", "//", "/*"
@@ -59,7 +94,7 @@ typedef struct {
   int token_type;
 } FlexKeyword;
 
-typedef struct Flexer {
+struct Flexer {
   const char *src;
   size_t len;
   const char *cur;
@@ -76,14 +111,20 @@ typedef struct Flexer {
   const char *block_comment_start; // e.g. "/*"
   const char *block_comment_end;   // e.g. "*/"
   bool nested_comments;
+  bool keep_comments; // report comments as TOK_COMMENT instead of skipping
 
   // optional custom literal handlers
   FlexRuleFn custom_number;
   FlexRuleFn custom_string;
   FlexRuleFn custom_char;
+  FlexTokenFn custom_token; // e.g. Lua's [==[ long brackets ]==]
+
+  // If set, identifiers carry their ID in value.id. Interning is the one
+  // thing that allocates; an ID of 0 means the interner ran out of memory.
+  FlexInterner *interner;
 
   Token current;
-} Flexer;
+};
 
 // ─────────────────────────────────────────────────────────────────────────────
 // Core API
@@ -118,55 +159,199 @@ static inline char flex_advance(Flexer *f) {
   return c;
 }
 
+// True if the unread input at `at` starts with `s`.
+static inline bool flex_starts_with(Flexer *f, const char *at, const char *s) {
+  size_t n = strlen(s);
+  return n <= f->len - (size_t)(at - f->src) && memcmp(at, s, n) == 0;
+}
+
 // ──────────────────────────────────────────────────────
 // Internal: longest-match symbol lookup (trie-like linear scan)
 // ──────────────────────────────────────────────────────
-static int lookup_symbol(Flexer *f, const char *start, size_t max_len) {
-  int best_type = 0;
+// Returns the length of the longest symbol at `start` (0 if none) and its
+// type in *type. Symbols never span lines.
+static size_t lookup_symbol(Flexer *f, const char *start, size_t max_len,
+                            int *type) {
   size_t best_len = 0;
 
   for (size_t i = 0; i < f->symbol_count; ++i) {
     const char *p = f->symbols[i].prefix;
+    if (p[0] != *start) // most candidates fail here, before any strlen()
+      continue;
     size_t len = strlen(p);
     if (len <= max_len && len > best_len && memcmp(start, p, len) == 0) {
       best_len = len;
-      best_type = f->symbols[i].token_type;
+      *type = f->symbols[i].token_type;
     }
   }
   if (best_len > 0) {
     f->cur = start + best_len; // consume it
-    while ((size_t)(f->cur - f->line_start) > 0 && f->cur[-1] != '\n')
-      f->col++;
+    f->col += (int)best_len - 1;
+  }
+  return best_len;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Identifier interning
+// ─────────────────────────────────────────────────────────────────────────────
+
+static inline void flex_interner_init(FlexInterner *in) {
+  *in = (FlexInterner){0};
+}
+
+static inline void flex_interner_free(FlexInterner *in) {
+  free(in->arena);
+  free(in->offsets);
+  free(in->lengths);
+  free(in->slots);
+  *in = (FlexInterner){0};
+}
+
+// Eight bytes at a time; names are short, so this is one or two multiplies
+// plus the final mix.
+static inline uint32_t flex_intern_hash(const char *s, size_t len) {
+  uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+  while (len >= 8) {
+    uint64_t w;
+    memcpy(&w, s, 8);
+    h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+    h ^= h >> 32;
+    s += 8;
+    len -= 8;
   }
-  return best_type;
+  if (len > 0) {
+    uint64_t w = 0;
+    memcpy(&w, s, len);
+    h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+  }
+  h ^= h >> 29;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  return (uint32_t)(h >> 32);
+}
+
+static inline uint32_t flex_intern_probe(const FlexInterner *in,
+                                         const char *s, size_t len,
+                                         uint32_t hash, uint32_t *slot) {
+  uint32_t i = hash & in->mask;
+  for (;; i = (i + 1) & in->mask) {
+    FlexInternSlot e = in->slots[i];
+    if (e.id == 0 ||
+        (e.hash == hash && in->lengths[e.id] == len &&
+         memcmp(in->arena + in->offsets[e.id], s, len) == 0)) {
+      *slot = i;
+      return e.id;
+    }
+  }
+}
+
+// The ID of s[0..len), or 0 if it was never interned.
+static inline uint32_t flex_intern_find(const FlexInterner *in, const char *s,
+                                        size_t len) {
+  uint32_t slot;
+  if (in->mask == 0)
+    return 0;
+  return flex_intern_probe(in, s, len, flex_intern_hash(s, len), &slot);
+}
+
+// Doubles the table (kept at most half full), reinserting by stored hash.
+static inline bool flex_intern_grow(FlexInterner *in) {
+  uint32_t cap = in->mask ? (in->mask + 1) * 2 : 256;
+  FlexInternSlot *slots = calloc(cap, sizeof(*slots));
+  if (!slots)
+    return false;
+  for (uint32_t i = 0; in->mask && i <= in->mask; ++i) {
+    FlexInternSlot e = in->slots[i];
+    if (e.id == 0)
+      continue;
+    uint32_t j = e.hash & (cap - 1);
+    while (slots[j].id)
+      j = (j + 1) & (cap - 1);
+    slots[j] = e;
+  }
+  free(in->slots);
+  in->slots = slots;
+  in->mask = cap - 1;
+  return true;
+}
+
+// The ID of s[0..len), adding it if new; 0 if out of memory.
+static inline uint32_t flex_intern(FlexInterner *in, const char *s,
+                                   size_t len) {
+  if ((in->count + 1) * 2 > in->mask && !flex_intern_grow(in))
+    return 0;
+  uint32_t hash = flex_intern_hash(s, len), slot;
+  uint32_t id = flex_intern_probe(in, s, len, hash, &slot);
+  if (id)
+    return id;
+  if (len >= UINT32_MAX || in->count + 1 == UINT32_MAX)
+    return 0;
+
+  if (in->arena_len + len + 1 > in->arena_cap) {
+    size_t cap = in->arena_cap ? in->arena_cap * 2 : 4096;
+    while (cap < in->arena_len + len + 1)
+      cap *= 2;
+    if (cap > UINT32_MAX)
+      return 0; // offsets are 32-bit
+    char *p = realloc(in->arena, cap);
+    if (!p)
+      return 0;
+    in->arena = p;
+    in->arena_cap = cap;
+  }
+  if (in->count + 2 > in->id_cap) {
+    uint32_t cap = in->id_cap ? in->id_cap * 2 : 256;
+    uint32_t *o = realloc(in->offsets, cap * sizeof(*o));
+    if (o)
+      in->offsets = o;
+    uint32_t *l = o ? realloc(in->lengths, cap * sizeof(*l)) : NULL;
+    if (!l)
+      return 0;
+    in->lengths = l;
+    in->id_cap = cap;
+  }
+
+  id = ++in->count;
+  in->offsets[id] = (uint32_t)in->arena_len;
+  in->lengths[id] = (uint32_t)len;
+  memcpy(in->arena + in->arena_len, s, len);
+  in->arena[in->arena_len + len] = '\0';
+  in->arena_len += len + 1;
+  in->slots[slot] = (FlexInternSlot){hash, id};
+  return id;
+}
+
+// The name for an ID from flex_intern() (NUL-terminated). Valid until the
+// next name is added, which may move the arena.
+static inline Str flex_intern_str(const FlexInterner *in, uint32_t id) {
+  if (id == 0 || id > in->count)
+    return (Str){"", 0};
+  return (Str){in->arena + in->offsets[id], in->lengths[id]};
 }
 
 // ─────────────────────────────────────────────────────────────────────────────
 // Default literal handlers (you can replace them)
 // ─────────────────────────────────────────────────────────────────────────────
 static void default_number_rule(Flexer *f, Token *out) {
-  const char *start = f->cur - 1;
+  const char *start = f->cur - 1; // the first digit is already consumed
   bool is_float = false, is_hex = false, is_bin = false;
 
-  if (flex_peek(f) == '0' && (flex_peek_next(f) | 32) == 'x') {
+  if (*start == '0' && (flex_peek(f) | 32) == 'x') {
     is_hex = true;
     flex_advance(f);
-    flex_advance(f);
-    while (isxdigit(flex_peek(f)) || flex_peek(f) == '_')
+    while (isxdigit((unsigned char)flex_peek(f)) || flex_peek(f) == '_')
       flex_advance(f);
-  } else if (flex_peek(f) == '0' && (flex_peek_next(f) | 32) == 'b') {
+  } else if (*start == '0' && (flex_peek(f) | 32) == 'b') {
     is_bin = true;
     flex_advance(f);
-    flex_advance(f);
     while (flex_peek(f) == '0' || flex_peek(f) == '1' || flex_peek(f) == '_')
       flex_advance(f);
   } else {
-    while (isdigit(flex_peek(f)) || flex_peek(f) == '_')
+    while (isdigit((unsigned char)flex_peek(f)) || flex_peek(f) == '_')
       flex_advance(f);
     if (flex_peek(f) == '.') {
       is_float = true;
       flex_advance(f);
-      while (isdigit(flex_peek(f)))
+      while (isdigit((unsigned char)flex_peek(f)))
         flex_advance(f);
     }
     if (flex_peek(f) == 'e' || flex_peek(f) == 'E') {
@@ -174,13 +359,13 @@ static void default_number_rule(Flexer *f, Token *out) {
       flex_advance(f);
       if (flex_peek(f) == '+' || flex_peek(f) == '-')
         flex_advance(f);
-      while (isdigit(flex_peek(f)))
+      while (isdigit((unsigned char)flex_peek(f)))
         flex_advance(f);
     }
   }
 
   // optional suffixes like u64, f32, etc.
-  while (isalpha(flex_peek(f)) || flex_peek(f) == '_')
+  while (isalpha((unsigned char)flex_peek(f)) || flex_peek(f) == '_')
     flex_advance(f);
 
   out->text = (Str){start, (size_t)(f->cur - start)};
@@ -194,14 +379,17 @@ static void default_number_rule(Flexer *f, Token *out) {
     out->value.f64 = strtod(buf, NULL);
   } else {
     uint64_t val = 0;
-    for (const char *p = start; p < f->cur; ++p) {
-      char c = *p;
-      if (c >= '0' && c <= '9')
-        val = val * 10 + (c - '0');
-      else if (is_hex && isxdigit(c))
-        val = val * 16 + (c <= '9' ? c - '0' : (c | 32) - 'a' + 10);
-      else if (is_bin && (c == '0' || c == '1'))
-        val = val * 2 + (c - '0');
+    unsigned base = is_hex ? 16 : is_bin ? 2 : 10;
+    for (const char *p = start + (is_hex || is_bin ? 2 : 0); p < f->cur; ++p) {
+      unsigned char c = (unsigned char)*p;
+      unsigned d = c >= '0' && c <= '9' ? (unsigned)(c - '0')
+                   : isxdigit(c)        ? (unsigned)((c | 32) - 'a' + 10)
+                                        : base;
+      if (c == '_')
+        continue;
+      if (d >= base)
+        break; // suffix
+      val = val * base + d;
     }
     out->value.u64 = val;
   }
@@ -224,81 +412,110 @@ static void default_string_rule(Flexer *f, Token *out, char quote) {
 // ─────────────────────────────────────────────────────────────────────────────
 // Main lexing function
 // ─────────────────────────────────────────────────────────────────────────────
-static Token flex_next(Flexer *f) {
+static inline Token flex_next(Flexer *f) {
   while (!flex_at_end(f)) {
+    // Whitespace runs are skipped here, not one loop turn (and one
+    // custom_token call) per byte.
+    while (!flex_at_end(f) && isspace((unsigned char)*f->cur))
+      flex_advance(f);
+    if (flex_at_end(f))
+      break;
     const char *start = f->cur;
     int line = f->line, col = f->col;
+
+    if (f->custom_token) {
+      Token t = {TOK_EOF, {start, 0}, line, col, {0}};
+      if (f->custom_token(f, &t)) {
+        if (t.type == 0)
+          continue;
+        t.line = line;
+        t.col = col;
+        return t;
+      }
+    }
+
     char c = flex_advance(f);
 
     // whitespace
-    if (isspace(c))
-      continue;
-
-    // line comment
-    if (f->line_comment &&
-        memcmp(start, f->line_comment, strlen(f->line_comment)) == 0) {
-      while (flex_peek(f) && flex_peek(f) != '\n')
-        flex_advance(f);
+    if (isspace((unsigned char)c))
       continue;
-    }
 
-    // block comment
-    if (f->block_comment_start && memcmp(start, f->block_comment_start,
-                                         strlen(f->block_comment_start)) == 0) {
+    // block comment (checked first: Lua's "--[[" starts like its "--")
+    if (f->block_comment_start &&
+        flex_starts_with(f, start, f->block_comment_start)) {
       const char *end = f->block_comment_end;
-      size_t elen = strlen(end);
+      size_t slen = strlen(f->block_comment_start), elen = strlen(end);
       int level = 1;
-      f->cur = start + strlen(f->block_comment_start);
+      f->cur = start + slen;
+      f->col += (int)slen - 1;
       while (level > 0 && !flex_at_end(f)) {
-        if (f->nested_comments && memcmp(f->cur, f->block_comment_start,
-                                         strlen(f->block_comment_start)) == 0) {
+        if (f->nested_comments &&
+            flex_starts_with(f, f->cur, f->block_comment_start)) {
           level++;
-          f->cur += strlen(f->block_comment_start);
-        } else if (memcmp(f->cur, end, elen) == 0) {
+          f->cur += slen;
+          f->col += (int)slen;
+        } else if (flex_starts_with(f, f->cur, end)) {
           level--;
           f->cur += elen;
+          f->col += (int)elen;
         } else {
           flex_advance(f);
         }
       }
+      if (f->keep_comments)
+        return (Token){TOK_COMMENT, {start, (size_t)(f->cur - start)}, line, col};
       continue;
     }
 
-    // symbols / operators (longest match)
-    int sym_type = lookup_symbol(f, start, f->len - (size_t)(start - f->src));
-    if (sym_type != 0) {
-      return (Token){sym_type ? sym_type : 0,
-                     {start, (size_t)(f->cur - start)},
-                     line,
-                     col};
+    // line comment
+    if (f->line_comment && flex_starts_with(f, start, f->line_comment)) {
+      while (flex_peek(f) && flex_peek(f) != '\n')
+        flex_advance(f);
+      if (f->keep_comments)
+        return (Token){TOK_COMMENT, {start, (size_t)(f->cur - start)}, line, col};
+      continue;
+    }
+
+    // numbers (before symbols, so ".5" is not "." then "5")
+    if (isdigit((unsigned char)c) ||
+        (c == '.' && isdigit((unsigned char)flex_peek(f)))) {
+      Token t = {TOK_NUMBER, {start, 0}, line, col};
+      if (f->custom_number)
+        f->custom_number(f, &t);
+      else
+        default_number_rule(f, &t);
+      t.line = line;
+      t.col = col;
+      return t;
+    }
+
+    // symbols / operators (longest match; type 0 = skip)
+    int sym_type = 0;
+    if (lookup_symbol(f, start, f->len - (size_t)(start - f->src),
+                      &sym_type) > 0) {
+      if (sym_type == 0)
+        continue;
+      return (Token){sym_type, {start, (size_t)(f->cur - start)}, line, col};
     }
 
     // identifiers & keywords
-    if (isalpha(c) || c == '_') {
-      while (isalnum(flex_peek(f)) || flex_peek(f) == '_')
+    if (isalpha((unsigned char)c) || c == '_') {
+      while (isalnum((unsigned char)flex_peek(f)) || flex_peek(f) == '_')
         flex_advance(f);
       Str id = {start, (size_t)(f->cur - start)};
 
       // keyword lookup (linear for simplicity - replace with hash table for
       // 100+ keywords)
       for (size_t i = 0; i < f->keyword_count; ++i) {
-        if (strlen(f->keywords[i].word) == id.len &&
-            memcmp(id.start, f->keywords[i].word, id.len) == 0) {
+        const char *w = f->keywords[i].word;
+        if (w[0] == id.start[0] && strncmp(w, id.start, id.len) == 0 &&
+            w[id.len] == '\0') {
           return (Token){f->keywords[i].token_type, id, line, col};
         }
       }
-      return (Token){TOK_IDENTIFIER, id, line, col};
-    }
-
-    // numbers
-    if (isdigit(c) || (c == '.' && isdigit(flex_peek(f)))) {
-      Token t = {TOK_NUMBER, {start, 0}, line, col};
-      if (f->custom_number)
-        f->custom_number(f, &t);
-      else
-        default_number_rule(f, &t);
-      t.line = line;
-      t.col = col;
+      Token t = {TOK_IDENTIFIER, id, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, id.start, id.len);
       return t;
     }
 
@@ -318,8 +535,7 @@ static Token flex_next(Flexer *f) {
     return (Token){TOK_INVALID, {start, 1}, line, col};
   }
 
-  return (Token){TOK_EOF, {NULL, 0}, f->cur}, f->line, f->col
-};
+  return (Token){TOK_EOF, {f->cur, 0}, f->line, f->col};
 }
 
 #endif // FLEXER_H
@@ -327,14 +543,11 @@ static Token flex_next(Flexer *f) {
 // ─────────────────────────────────────────────────────────────────────────────
 // Example: Tokenizing a tiny Python-like language
 // ─────────────────────────────────────────────────────────────────────────────
-#ifdef FLEXER_IMPLEMENTATION
+#ifdef FLEXER_EXAMPLE
 #include <stdio.h>
 
 enum {
-  TOK_IDENTIFIER = TOK_USER,
-  TOK_NUMBER,
-  TOK_STRING,
-  TOK_DEF,
+  TOK_DEF = TOK_USER,
   TOK_IF,
   TOK_ELSE,
   TOK_RETURN,
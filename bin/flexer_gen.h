@@ -0,0 +1,1386 @@
+/* flexer_gen.h - Specialized flex_next() per language, generated by flexgen.c
+ * from flexer_langs.h. Do not edit; rerun:
+ *
+ *   gcc -O2 -o flexgen flexgen.c && ./flexgen > flexer_gen.h
+ *
+ * Usage (same tokens as flex_next, a few times faster):
+ *   FlexNextFn next = flex_next_for(lang);
+ *   flex_init(&f, src, len);
+ *   flex_lang_apply(&f, lang);
+ *   for (Token t; (t = next(&f)).type != TOK_EOF;)
+ *     ...
+ */
+
+#ifndef FLEXER_GEN_H
+#define FLEXER_GEN_H
+
+#include "flexer_langs.h"
+
+_Static_assert(FLEX_LANG_COUNT == 2,
+               "flexer_langs.h changed: rerun flexgen");
+
+typedef Token (*FlexNextFn)(Flexer *f);
+
+// isalnum() || '_' in the C locale, as flex_next() tests it.
+static const unsigned char flex_gen_ident[256] = {
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,
+    0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,0,0,1,
+    0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+};
+
+static Token flex_next_lua(Flexer *f) {
+  const char *end = f->src + f->len;
+  while (f->cur < end) {
+    const char *start = f->cur;
+    int line = f->line, col = f->col;
+    switch (*start) {
+    case ' ':
+    case '\t':
+    case '\v':
+    case '\f':
+    case '\r':
+      f->cur++;
+      f->col++;
+      continue;
+    case '\n':
+      f->cur++;
+      f->line++;
+      f->line_start = f->cur;
+      f->col = 1;
+      continue;
+    case '"': {
+      f->cur = start + 1;
+      f->col++;
+      Token t = {TOK_STRING, {start, 0}, line, col};
+      if (f->custom_string)
+        f->custom_string(f, &t);
+      else
+        default_string_rule(f, &t, '"');
+      t.line = line;
+      t.col = col;
+      return t;
+    }
+    case '#':
+    case '%':
+    case '&':
+    case '*':
+    case '+':
+    case '^':
+    case '|': {
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '\'': {
+      f->cur = start + 1;
+      f->col++;
+      Token t = {TOK_STRING, {start, 0}, line, col};
+      if (f->custom_string)
+        f->custom_string(f, &t);
+      else
+        default_string_rule(f, &t, '\'');
+      t.line = line;
+      t.col = col;
+      return t;
+    }
+    case '(':
+    case ')':
+    case ',':
+    case ';':
+    case ']':
+    case '{':
+    case '}': {
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_PUNCT, {start, 1}, line, col};
+    }
+    case '-': {
+      {
+        Token t = {TOK_EOF, {start, 0}, line, col, {0}};
+        if (flex_lua_long_bracket(f, &t)) {
+          if (t.type == 0)
+            continue;
+          t.line = line;
+          t.col = col;
+          return t;
+        }
+      }
+      if (flex_starts_with(f, start, "--")) {
+        const char *p = start + 1;
+        while (p < end && *p && *p != '\n')
+          p++;
+        f->col += (int)(p - start);
+        f->cur = p;
+        if (f->keep_comments)
+          return (Token){TOK_COMMENT, {start, (size_t)(f->cur - start)},
+                         line, col};
+        continue;
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '.': {
+      if (start + 1 < end && (unsigned)(start[1] - '0') < 10) {
+        f->cur = start + 1;
+        f->col++;
+        Token t = {TOK_NUMBER, {start, 0}, line, col};
+        if (f->custom_number)
+          f->custom_number(f, &t);
+        else
+          default_number_rule(f, &t);
+        t.line = line;
+        t.col = col;
+        return t;
+      }
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '.':
+          if (start + 2 < end) {
+            switch (start[2]) {
+            case '.':
+              f->cur = start + 3;
+              f->col += 3;
+              return (Token){FL_PUNCT, {start, 3}, line, col};
+            }
+          }
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_PUNCT, {start, 1}, line, col};
+    }
+    case '/': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '/':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9': {
+      f->cur = start + 1;
+      f->col++;
+      Token t = {TOK_NUMBER, {start, 0}, line, col};
+      if (f->custom_number)
+        f->custom_number(f, &t);
+      else
+        default_number_rule(f, &t);
+      t.line = line;
+      t.col = col;
+      return t;
+    }
+    case ':': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case ':':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_PUNCT, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_PUNCT, {start, 1}, line, col};
+    }
+    case '<': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '<':
+        case '=':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '=':
+    case '~': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '=':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '>': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '=':
+        case '>':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case 'A':
+    case 'B':
+    case 'C':
+    case 'D':
+    case 'E':
+    case 'F':
+    case 'G':
+    case 'H':
+    case 'I':
+    case 'J':
+    case 'K':
+    case 'L':
+    case 'M':
+    case 'N':
+    case 'O':
+    case 'P':
+    case 'Q':
+    case 'R':
+    case 'S':
+    case 'T':
+    case 'U':
+    case 'V':
+    case 'W':
+    case 'X':
+    case 'Y':
+    case 'Z':
+    case '_':
+    case 'c':
+    case 'h':
+    case 'j':
+    case 'k':
+    case 'm':
+    case 'p':
+    case 'q':
+    case 's':
+    case 'v':
+    case 'x':
+    case 'y':
+    case 'z': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case '[': {
+      {
+        Token t = {TOK_EOF, {start, 0}, line, col, {0}};
+        if (flex_lua_long_bracket(f, &t)) {
+          if (t.type == 0)
+            continue;
+          t.line = line;
+          t.col = col;
+          return t;
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_PUNCT, {start, 1}, line, col};
+    }
+    case 'a': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 3:
+        if (memcmp(start + 1, "nd", 2) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'b': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 5:
+        if (memcmp(start + 1, "reak", 4) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'd': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 2:
+        if (memcmp(start + 1, "o", 1) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'e': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 3:
+        if (memcmp(start + 1, "nd", 2) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 4:
+        if (memcmp(start + 1, "lse", 3) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 6:
+        if (memcmp(start + 1, "lseif", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'f': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 3:
+        if (memcmp(start + 1, "or", 2) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 5:
+        if (memcmp(start + 1, "alse", 4) == 0)
+          return (Token){FL_CONSTANT, {start, n}, line, col};
+        break;
+      case 8:
+        if (memcmp(start + 1, "unction", 7) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'g': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "oto", 3) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'i': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 2:
+        if (memcmp(start + 1, "f", 1) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "n", 1) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'l': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 5:
+        if (memcmp(start + 1, "ocal", 4) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'n': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 3:
+        if (memcmp(start + 1, "ot", 2) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "il", 2) == 0)
+          return (Token){FL_CONSTANT, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'o': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 2:
+        if (memcmp(start + 1, "r", 1) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'r': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 6:
+        if (memcmp(start + 1, "epeat", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "eturn", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 't': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "hen", 3) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "rue", 3) == 0)
+          return (Token){FL_CONSTANT, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'u': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 5:
+        if (memcmp(start + 1, "ntil", 4) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'w': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 5:
+        if (memcmp(start + 1, "hile", 4) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    }
+    f->cur++;
+    f->col++;
+    return (Token){TOK_INVALID, {start, 1}, line, col};
+  }
+  return (Token){TOK_EOF, {f->cur, 0}, f->line, f->col};
+}
+
+static Token flex_next_c(Flexer *f) {
+  const char *end = f->src + f->len;
+  while (f->cur < end) {
+    const char *start = f->cur;
+    int line = f->line, col = f->col;
+    switch (*start) {
+    case ' ':
+    case '\t':
+    case '\v':
+    case '\f':
+    case '\r':
+      f->cur++;
+      f->col++;
+      continue;
+    case '\n':
+      f->cur++;
+      f->line++;
+      f->line_start = f->cur;
+      f->col = 1;
+      continue;
+    case '!':
+    case '%':
+    case '*':
+    case '=':
+    case '^': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '=':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '"': {
+      f->cur = start + 1;
+      f->col++;
+      Token t = {TOK_STRING, {start, 0}, line, col};
+      if (f->custom_string)
+        f->custom_string(f, &t);
+      else
+        default_string_rule(f, &t, '"');
+      t.line = line;
+      t.col = col;
+      return t;
+    }
+    case '#': {
+      {
+        Token t = {TOK_EOF, {start, 0}, line, col, {0}};
+        if (flex_c_preproc(f, &t)) {
+          if (t.type == 0)
+            continue;
+          t.line = line;
+          t.col = col;
+          return t;
+        }
+      }
+      break;
+    }
+    case '&': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '&':
+        case '=':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '\'': {
+      f->cur = start + 1;
+      f->col++;
+      Token t = {TOK_STRING, {start, 0}, line, col};
+      if (f->custom_string)
+        f->custom_string(f, &t);
+      else
+        default_string_rule(f, &t, '\'');
+      t.line = line;
+      t.col = col;
+      return t;
+    }
+    case '(':
+    case ')':
+    case ',':
+    case ':':
+    case ';':
+    case '[':
+    case ']':
+    case '{':
+    case '}': {
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_PUNCT, {start, 1}, line, col};
+    }
+    case '+': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '+':
+        case '=':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '-': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '-':
+        case '=':
+        case '>':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '.': {
+      if (start + 1 < end && (unsigned)(start[1] - '0') < 10) {
+        f->cur = start + 1;
+        f->col++;
+        Token t = {TOK_NUMBER, {start, 0}, line, col};
+        if (f->custom_number)
+          f->custom_number(f, &t);
+        else
+          default_number_rule(f, &t);
+        t.line = line;
+        t.col = col;
+        return t;
+      }
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '.':
+          if (start + 2 < end) {
+            switch (start[2]) {
+            case '.':
+              f->cur = start + 3;
+              f->col += 3;
+              return (Token){FL_PUNCT, {start, 3}, line, col};
+            }
+          }
+          break;
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_PUNCT, {start, 1}, line, col};
+    }
+    case '/': {
+      if (flex_starts_with(f, start, "/*")) {
+        int level = 1;
+        f->cur = start + 2;
+        f->col += 2;
+        while (level > 0 && f->cur < end) {
+          if (f->nested_comments && flex_starts_with(f, f->cur, "/*")) {
+            level++;
+            f->cur += 2;
+            f->col += 2;
+          } else if (*f->cur == '*' && flex_starts_with(f, f->cur, "*/")) {
+            level--;
+            f->cur += 2;
+            f->col += 2;
+          } else
+            flex_advance(f);
+        }
+        if (f->keep_comments)
+          return (Token){TOK_COMMENT, {start, (size_t)(f->cur - start)},
+                         line, col};
+        continue;
+      }
+      if (flex_starts_with(f, start, "//")) {
+        const char *p = start + 1;
+        while (p < end && *p && *p != '\n')
+          p++;
+        f->col += (int)(p - start);
+        f->cur = p;
+        if (f->keep_comments)
+          return (Token){TOK_COMMENT, {start, (size_t)(f->cur - start)},
+                         line, col};
+        continue;
+      }
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '=':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9': {
+      f->cur = start + 1;
+      f->col++;
+      Token t = {TOK_NUMBER, {start, 0}, line, col};
+      if (f->custom_number)
+        f->custom_number(f, &t);
+      else
+        default_number_rule(f, &t);
+      t.line = line;
+      t.col = col;
+      return t;
+    }
+    case '<': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '<':
+          if (start + 2 < end) {
+            switch (start[2]) {
+            case '=':
+              f->cur = start + 3;
+              f->col += 3;
+              return (Token){FL_OPERATOR, {start, 3}, line, col};
+            }
+          }
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        case '=':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '>': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '=':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        case '>':
+          if (start + 2 < end) {
+            switch (start[2]) {
+            case '=':
+              f->cur = start + 3;
+              f->col += 3;
+              return (Token){FL_OPERATOR, {start, 3}, line, col};
+            }
+          }
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case '?':
+    case '~': {
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    case 'A':
+    case 'B':
+    case 'C':
+    case 'D':
+    case 'E':
+    case 'F':
+    case 'G':
+    case 'H':
+    case 'I':
+    case 'J':
+    case 'K':
+    case 'L':
+    case 'M':
+    case 'O':
+    case 'P':
+    case 'Q':
+    case 'R':
+    case 'S':
+    case 'T':
+    case 'U':
+    case 'V':
+    case 'W':
+    case 'X':
+    case 'Y':
+    case 'Z':
+    case 'h':
+    case 'j':
+    case 'k':
+    case 'm':
+    case 'n':
+    case 'o':
+    case 'p':
+    case 'q':
+    case 'x':
+    case 'y':
+    case 'z': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'N': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "ULL", 3) == 0)
+          return (Token){FL_CONSTANT, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case '_': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 5:
+        if (memcmp(start + 1, "Bool", 4) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 7:
+        if (memcmp(start + 1, "Atomic", 6) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 8:
+        if (memcmp(start + 1, "Alignas", 7) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "Alignof", 7) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "Generic", 7) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "Complex", 7) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 9:
+        if (memcmp(start + 1, "Noreturn", 8) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 13:
+        if (memcmp(start + 1, "Thread_local", 12) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 14:
+        if (memcmp(start + 1, "Static_assert", 13) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'a': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "uto", 3) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'b': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "ool", 3) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 5:
+        if (memcmp(start + 1, "reak", 4) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'c': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "ase", 3) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "har", 3) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 5:
+        if (memcmp(start + 1, "onst", 4) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 8:
+        if (memcmp(start + 1, "ontinue", 7) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'd': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 2:
+        if (memcmp(start + 1, "o", 1) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 6:
+        if (memcmp(start + 1, "ouble", 5) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 7:
+        if (memcmp(start + 1, "efault", 6) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'e': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "lse", 3) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "num", 3) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 6:
+        if (memcmp(start + 1, "xtern", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'f': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 3:
+        if (memcmp(start + 1, "or", 2) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 5:
+        if (memcmp(start + 1, "loat", 4) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        if (memcmp(start + 1, "alse", 4) == 0)
+          return (Token){FL_CONSTANT, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'g': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "oto", 3) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'i': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 2:
+        if (memcmp(start + 1, "f", 1) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 3:
+        if (memcmp(start + 1, "nt", 2) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 6:
+        if (memcmp(start + 1, "nline", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "nt8_t", 5) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 7:
+        if (memcmp(start + 1, "nt16_t", 6) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        if (memcmp(start + 1, "nt32_t", 6) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        if (memcmp(start + 1, "nt64_t", 6) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'l': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "ong", 3) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'r': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 6:
+        if (memcmp(start + 1, "eturn", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 8:
+        if (memcmp(start + 1, "egister", 7) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "estrict", 7) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 's': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 5:
+        if (memcmp(start + 1, "hort", 4) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 6:
+        if (memcmp(start + 1, "izeof", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "tatic", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "truct", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "witch", 5) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        if (memcmp(start + 1, "igned", 5) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        if (memcmp(start + 1, "ize_t", 5) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 't': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "rue", 3) == 0)
+          return (Token){FL_CONSTANT, {start, n}, line, col};
+        break;
+      case 7:
+        if (memcmp(start + 1, "ypedef", 6) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'u': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 5:
+        if (memcmp(start + 1, "nion", 4) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      case 7:
+        if (memcmp(start + 1, "int8_t", 6) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 8:
+        if (memcmp(start + 1, "nsigned", 7) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        if (memcmp(start + 1, "int16_t", 7) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        if (memcmp(start + 1, "int32_t", 7) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        if (memcmp(start + 1, "int64_t", 7) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'v': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 4:
+        if (memcmp(start + 1, "oid", 3) == 0)
+          return (Token){FL_TYPE, {start, n}, line, col};
+        break;
+      case 8:
+        if (memcmp(start + 1, "olatile", 7) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case 'w': {
+      const char *p = start + 1;
+      while (p < end && flex_gen_ident[(unsigned char)*p])
+        p++;
+      size_t n = (size_t)(p - start);
+      f->cur = p;
+      f->col += (int)n;
+      switch (n) {
+      case 5:
+        if (memcmp(start + 1, "hile", 4) == 0)
+          return (Token){FL_KEYWORD, {start, n}, line, col};
+        break;
+      }
+      Token t = {TOK_IDENTIFIER, {start, n}, line, col};
+      if (f->interner)
+        t.value.id = flex_intern(f->interner, start, n);
+      return t;
+    }
+    case '|': {
+      if (start + 1 < end) {
+        switch (start[1]) {
+        case '=':
+        case '|':
+          f->cur = start + 2;
+          f->col += 2;
+          return (Token){FL_OPERATOR, {start, 2}, line, col};
+        }
+      }
+      f->cur = start + 1;
+      f->col += 1;
+      return (Token){FL_OPERATOR, {start, 1}, line, col};
+    }
+    }
+    f->cur++;
+    f->col++;
+    return (Token){TOK_INVALID, {start, 1}, line, col};
+  }
+  return (Token){TOK_EOF, {f->cur, 0}, f->line, f->col};
+}
+
+// The generated lexer for `lang`, or flex_next() for one without.
+static inline FlexNextFn flex_next_for(const FlexLang *lang) {
+  if (lang == &flex_langs[0])
+    return flex_next_lua;
+  if (lang == &flex_langs[1])
+    return flex_next_c;
+  return flex_next;
+}
+
+#endif // FLEXER_GEN_H
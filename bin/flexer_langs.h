@@ -0,0 +1,268 @@
+/* flexer_langs.h - Ready-made flexer.h tables for Lua and C
+ *
+ * Tokens are reported by class rather than one type per keyword, which is
+ * what highlighters and counters want; the exact word is still in t.text.
+ *
+ * Usage:
+ *   const FlexLang *lang = flex_lang_for_path("init.lua"); // or _find("lua")
+ *   Flexer f;
+ *   flex_init(&f, src, len);
+ *   flex_lang_apply(&f, lang);
+ *   for (Token t; (t = flex_next(&f)).type != TOK_EOF;)
+ *     printf("%s %.*s\n", flex_kind_name(t.type), (int)t.text.len,
+ *            t.text.start);
+ */
+
+#ifndef FLEXER_LANGS_H
+#define FLEXER_LANGS_H
+
+#include "flexer.h"
+
+enum {
+  FL_KEYWORD = TOK_USER, // statements and declarations
+  FL_TYPE,               // built-in type names
+  FL_CONSTANT,           // nil, true, false, NULL
+  FL_OPERATOR,           // + == .. -> etc.
+  FL_PUNCT,              // ( ) [ ] { } , ; and friends
+  FL_PREPROC,            // a whole C preprocessor line
+  FL_KIND_END
+};
+
+typedef struct {
+  const char *name;
+  const char *const *extensions; // NULL-terminated, with the dot
+  const FlexSymbol *symbols;
+  size_t symbol_count;
+  const FlexKeyword *keywords;
+  size_t keyword_count;
+  const char *line_comment;
+  const char *block_comment_start;
+  const char *block_comment_end;
+  FlexTokenFn custom_token;
+} FlexLang;
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Lua 5.4
+// ─────────────────────────────────────────────────────────────────────────────
+
+static const FlexKeyword flex_lua_keywords[] = {
+    {"and", FL_KEYWORD},      {"break", FL_KEYWORD},  {"do", FL_KEYWORD},
+    {"else", FL_KEYWORD},     {"elseif", FL_KEYWORD}, {"end", FL_KEYWORD},
+    {"for", FL_KEYWORD},      {"function", FL_KEYWORD},
+    {"goto", FL_KEYWORD},     {"if", FL_KEYWORD},     {"in", FL_KEYWORD},
+    {"local", FL_KEYWORD},    {"not", FL_KEYWORD},    {"or", FL_KEYWORD},
+    {"repeat", FL_KEYWORD},   {"return", FL_KEYWORD}, {"then", FL_KEYWORD},
+    {"until", FL_KEYWORD},    {"while", FL_KEYWORD},  {"nil", FL_CONSTANT},
+    {"true", FL_CONSTANT},    {"false", FL_CONSTANT},
+};
+
+static const FlexSymbol flex_lua_symbols[] = {
+    {"+", FL_OPERATOR},  {"-", FL_OPERATOR},   {"*", FL_OPERATOR},
+    {"/", FL_OPERATOR},  {"//", FL_OPERATOR},  {"%", FL_OPERATOR},
+    {"^", FL_OPERATOR},  {"#", FL_OPERATOR},   {"&", FL_OPERATOR},
+    {"~", FL_OPERATOR},  {"|", FL_OPERATOR},   {"<<", FL_OPERATOR},
+    {">>", FL_OPERATOR}, {"==", FL_OPERATOR},  {"~=", FL_OPERATOR},
+    {"<=", FL_OPERATOR}, {">=", FL_OPERATOR},  {"<", FL_OPERATOR},
+    {">", FL_OPERATOR},  {"=", FL_OPERATOR},   {"..", FL_OPERATOR},
+    {"...", FL_PUNCT},   {"(", FL_PUNCT},      {")", FL_PUNCT},
+    {"{", FL_PUNCT},     {"}", FL_PUNCT},      {"[", FL_PUNCT},
+    {"]", FL_PUNCT},     {"::", FL_PUNCT},     {";", FL_PUNCT},
+    {":", FL_PUNCT},     {",", FL_PUNCT},      {".", FL_PUNCT},
+};
+
+static const char *const flex_lua_extensions[] = {".lua", NULL};
+
+// Level of the long bracket "[", "="*level, "[" at `p`, or -1.
+static inline int flex_lua_long_open(Flexer *f, const char *p) {
+  const char *end = f->src + f->len;
+  if (p >= end || *p != '[')
+    return -1;
+  int level = 0;
+  for (++p; p < end && *p == '='; ++p)
+    level++;
+  return p < end && *p == '[' ? level : -1;
+}
+
+// Consumes up to and including the "]", "="*level, "]" that closes a long
+// bracket whose opener has already been consumed. False at end of input.
+static inline bool flex_lua_long_close(Flexer *f, int level) {
+  while (!flex_at_end(f)) {
+    if (flex_advance(f) != ']')
+      continue;
+    const char *p = f->cur;
+    int eqs = 0;
+    while (p < f->src + f->len && *p == '=')
+      p++, eqs++;
+    if (eqs == level && p < f->src + f->len && *p == ']') {
+      while (f->cur <= p)
+        flex_advance(f);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Long strings [[...]] / [==[...]==] and long comments --[[...]].
+static inline bool flex_lua_long_bracket(Flexer *f, Token *out) {
+  const char *start = f->cur;
+  bool comment = flex_starts_with(f, start, "--");
+  int level = flex_lua_long_open(f, comment ? start + 2 : start);
+  if (level < 0)
+    return false;
+  size_t open_len = (comment ? 2 : 0) + (size_t)level + 2;
+  for (size_t i = 0; i < open_len; ++i)
+    flex_advance(f);
+  bool closed = flex_lua_long_close(f, level);
+  out->type = comment ? (f->keep_comments ? TOK_COMMENT : 0)
+            : closed  ? TOK_STRING
+                      : TOK_INVALID;
+  out->text = (Str){start, (size_t)(f->cur - start)};
+  return true;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// C11
+// ─────────────────────────────────────────────────────────────────────────────
+
+static const FlexKeyword flex_c_keywords[] = {
+    {"break", FL_KEYWORD},        {"case", FL_KEYWORD},
+    {"continue", FL_KEYWORD},     {"default", FL_KEYWORD},
+    {"do", FL_KEYWORD},           {"else", FL_KEYWORD},
+    {"enum", FL_KEYWORD},         {"extern", FL_KEYWORD},
+    {"for", FL_KEYWORD},          {"goto", FL_KEYWORD},
+    {"if", FL_KEYWORD},           {"inline", FL_KEYWORD},
+    {"register", FL_KEYWORD},     {"restrict", FL_KEYWORD},
+    {"return", FL_KEYWORD},       {"sizeof", FL_KEYWORD},
+    {"static", FL_KEYWORD},       {"struct", FL_KEYWORD},
+    {"switch", FL_KEYWORD},       {"typedef", FL_KEYWORD},
+    {"union", FL_KEYWORD},        {"volatile", FL_KEYWORD},
+    {"while", FL_KEYWORD},        {"auto", FL_KEYWORD},
+    {"const", FL_KEYWORD},        {"_Alignas", FL_KEYWORD},
+    {"_Alignof", FL_KEYWORD},     {"_Atomic", FL_KEYWORD},
+    {"_Generic", FL_KEYWORD},     {"_Noreturn", FL_KEYWORD},
+    {"_Static_assert", FL_KEYWORD}, {"_Thread_local", FL_KEYWORD},
+    {"void", FL_TYPE},            {"char", FL_TYPE},
+    {"short", FL_TYPE},           {"int", FL_TYPE},
+    {"long", FL_TYPE},            {"float", FL_TYPE},
+    {"double", FL_TYPE},          {"signed", FL_TYPE},
+    {"unsigned", FL_TYPE},        {"_Bool", FL_TYPE},
+    {"_Complex", FL_TYPE},        {"bool", FL_TYPE},
+    {"size_t", FL_TYPE},          {"int8_t", FL_TYPE},
+    {"int16_t", FL_TYPE},         {"int32_t", FL_TYPE},
+    {"int64_t", FL_TYPE},         {"uint8_t", FL_TYPE},
+    {"uint16_t", FL_TYPE},        {"uint32_t", FL_TYPE},
+    {"uint64_t", FL_TYPE},        {"NULL", FL_CONSTANT},
+    {"true", FL_CONSTANT},        {"false", FL_CONSTANT},
+};
+
+static const FlexSymbol flex_c_symbols[] = {
+    {"+", FL_OPERATOR},   {"-", FL_OPERATOR},   {"*", FL_OPERATOR},
+    {"/", FL_OPERATOR},   {"%", FL_OPERATOR},   {"++", FL_OPERATOR},
+    {"--", FL_OPERATOR},  {"==", FL_OPERATOR},  {"!=", FL_OPERATOR},
+    {"<", FL_OPERATOR},   {">", FL_OPERATOR},   {"<=", FL_OPERATOR},
+    {">=", FL_OPERATOR},  {"&&", FL_OPERATOR},  {"||", FL_OPERATOR},
+    {"!", FL_OPERATOR},   {"&", FL_OPERATOR},   {"|", FL_OPERATOR},
+    {"^", FL_OPERATOR},   {"~", FL_OPERATOR},   {"<<", FL_OPERATOR},
+    {">>", FL_OPERATOR},  {"=", FL_OPERATOR},   {"+=", FL_OPERATOR},
+    {"-=", FL_OPERATOR},  {"*=", FL_OPERATOR},  {"/=", FL_OPERATOR},
+    {"%=", FL_OPERATOR},  {"&=", FL_OPERATOR},  {"|=", FL_OPERATOR},
+    {"^=", FL_OPERATOR},  {"<<=", FL_OPERATOR}, {">>=", FL_OPERATOR},
+    {"->", FL_OPERATOR},  {"?", FL_OPERATOR},   {".", FL_PUNCT},
+    {"...", FL_PUNCT},    {"(", FL_PUNCT},      {")", FL_PUNCT},
+    {"{", FL_PUNCT},      {"}", FL_PUNCT},      {"[", FL_PUNCT},
+    {"]", FL_PUNCT},      {";", FL_PUNCT},      {":", FL_PUNCT},
+    {",", FL_PUNCT},
+};
+
+static const char *const flex_c_extensions[] = {".c", ".h", NULL};
+
+// A '#' that is the first thing on its line starts a directive, which runs
+// to the end of the line (backslash continuations included).
+static inline bool flex_c_preproc(Flexer *f, Token *out) {
+  const char *start = f->cur;
+  if (*start != '#')
+    return false;
+  for (const char *p = f->line_start; p < start; ++p)
+    if (*p != ' ' && *p != '\t')
+      return false;
+  while (!flex_at_end(f) && flex_peek(f) != '\n') {
+    if (flex_peek(f) == '\\' && flex_peek_next(f) == '\n')
+      flex_advance(f);
+    flex_advance(f);
+  }
+  out->type = FL_PREPROC;
+  out->text = (Str){start, (size_t)(f->cur - start)};
+  return true;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Lookup
+// ─────────────────────────────────────────────────────────────────────────────
+
+#define FLEX_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static const FlexLang flex_langs[] = {
+    {"lua", flex_lua_extensions, flex_lua_symbols,
+     FLEX_COUNT(flex_lua_symbols), flex_lua_keywords,
+     FLEX_COUNT(flex_lua_keywords), "--", NULL, NULL, flex_lua_long_bracket},
+    {"c", flex_c_extensions, flex_c_symbols, FLEX_COUNT(flex_c_symbols),
+     flex_c_keywords, FLEX_COUNT(flex_c_keywords), "//", "/*", "*/",
+     flex_c_preproc},
+};
+
+#define FLEX_LANG_COUNT FLEX_COUNT(flex_langs)
+
+static inline const FlexLang *flex_lang_find(const char *name) {
+  for (size_t i = 0; i < FLEX_LANG_COUNT; ++i)
+    if (strcmp(flex_langs[i].name, name) == 0)
+      return &flex_langs[i];
+  return NULL;
+}
+
+// By file extension; NULL if no table matches.
+static inline const FlexLang *flex_lang_for_path(const char *path) {
+  const char *dot = strrchr(path, '.');
+  if (!dot || strchr(dot, '/'))
+    return NULL;
+  for (size_t i = 0; i < FLEX_LANG_COUNT; ++i)
+    for (const char *const *e = flex_langs[i].extensions; *e; ++e)
+      if (strcmp(*e, dot) == 0)
+        return &flex_langs[i];
+  return NULL;
+}
+
+// Call after flex_init(), which clears the configuration.
+static inline void flex_lang_apply(Flexer *f, const FlexLang *lang) {
+  f->symbols = lang->symbols;
+  f->symbol_count = lang->symbol_count;
+  f->keywords = lang->keywords;
+  f->keyword_count = lang->keyword_count;
+  f->line_comment = lang->line_comment;
+  f->block_comment_start = lang->block_comment_start;
+  f->block_comment_end = lang->block_comment_end;
+  f->custom_token = lang->custom_token;
+}
+
+static inline const char *flex_kind_name(int type) {
+  static const char *const names[] = {"keyword",  "type",  "constant",
+                                      "operator", "punct", "preproc"};
+  switch (type) {
+  case TOK_EOF:
+    return "eof";
+  case TOK_INVALID:
+    return "invalid";
+  case TOK_IDENTIFIER:
+    return "identifier";
+  case TOK_NUMBER:
+    return "number";
+  case TOK_STRING:
+    return "string";
+  case TOK_COMMENT:
+    return "comment";
+  }
+  if (type >= FL_KEYWORD && type < FL_KIND_END)
+    return names[type - FL_KEYWORD];
+  return "user";
+}
+
+#endif // FLEXER_LANGS_H
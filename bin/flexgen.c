@@ -0,0 +1,616 @@
+// Lexer generator: flexer_langs.h tables in, specialized flex_next() out.
+//
+//   gcc -O2 -o flexgen flexgen.c
+//   ./flexgen > flexer_gen.h          # or: ./flexgen lua > ...
+//
+// flex_next() walks the FlexSymbol and FlexKeyword tables for every token.
+// This reads the same tables and writes one function per language,
+// flex_next_<name>(), that does the work with code instead, re2c-style:
+// a switch on the first byte, nested switches for the rest of a symbol
+// (longest match), and keywords checked by length and memcmp() inside the
+// identifier case of their first letter. Comment delimiters are inlined
+// the same way, and the custom_token hook is called directly and only on
+// the bytes it can start a token on.
+//
+// The generated functions take a Flexer set up with flex_init() and
+// flex_lang_apply() and return exactly the tokens flex_next() would, so
+// they can replace it call for call; flex_next_for(lang) picks the right
+// one. They still honour the run-time switches (keep_comments,
+// nested_comments, custom_number, custom_string, interner) but ignore the
+// tables in the Flexer. Rerun the generator whenever flexer_langs.h changes; the
+// output refuses to compile against a different number of languages.
+//
+// flexgen_bench.c checks both lexers token for token and times them.
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flexer_langs.h"
+
+// What the generator can't read off a FlexLang: the name to call its
+// custom_token hook by, and the bytes the hook may accept a token on.
+static const struct {
+  FlexTokenFn fn;
+  const char *name;
+  const char *first; // NULL = try it on every byte, like flex_next()
+} hooks[] = {
+    {flex_lua_long_bracket, "flex_lua_long_bracket", "-["},
+    {flex_c_preproc, "flex_c_preproc", "#"},
+};
+
+typedef struct {
+  char *data;
+  size_t len, cap;
+} Buf;
+
+static void put(Buf *b, const char *fmt, ...) {
+  va_list ap;
+  for (;;) {
+    va_start(ap, fmt);
+    int n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+      perror("flexgen");
+      exit(1);
+    }
+    if (b->len + (size_t)n < b->cap) {
+      b->len += (size_t)n;
+      return;
+    }
+    size_t cap = b->cap ? b->cap * 2 : 4096;
+    while (cap <= b->len + (size_t)n)
+      cap *= 2;
+    char *p = realloc(b->data, cap);
+    if (!p) {
+      perror("flexgen");
+      exit(1);
+    }
+    b->data = p;
+    b->cap = cap;
+  }
+}
+
+static void indent(Buf *b, int depth) { put(b, "%*s", depth * 2, ""); }
+
+// A C string literal for s[0..n).
+static const char *quote(const char *s, size_t n) {
+  static char out[4][256];
+  static int slot;
+  char *o = out[slot++ & 3], *w = o;
+  *w++ = '"';
+  for (size_t i = 0; i < n && w < o + 248; i++) {
+    unsigned char c = (unsigned char)s[i];
+    if (c == '"' || c == '\\')
+      w += sprintf(w, "\\%c", c);
+    else if (isprint(c))
+      *w++ = (char)c;
+    else
+      w += sprintf(w, "\\%03o", c);
+  }
+  *w++ = '"';
+  *w = '\0';
+  return o;
+}
+
+// A character literal for c.
+static const char *char_lit(unsigned char c) {
+  static char out[4][8];
+  static int slot;
+  char *o = out[slot++ & 3];
+  if (c == '\'' || c == '\\')
+    sprintf(o, "'\\%c'", c);
+  else if (isprint(c))
+    sprintf(o, "'%c'", c);
+  else
+    sprintf(o, "'\\%03o'", c);
+  return o;
+}
+
+// Token types by name where flexer.h / flexer_langs.h has one.
+static const char *type_name(int type) {
+  static const char *const fl[] = {"FL_KEYWORD", "FL_TYPE",  "FL_CONSTANT",
+                                   "FL_OPERATOR", "FL_PUNCT", "FL_PREPROC"};
+  static char num[16];
+  switch (type) {
+  case TOK_INVALID:
+    return "TOK_INVALID";
+  case TOK_IDENTIFIER:
+    return "TOK_IDENTIFIER";
+  case TOK_NUMBER:
+    return "TOK_NUMBER";
+  case TOK_STRING:
+    return "TOK_STRING";
+  case TOK_COMMENT:
+    return "TOK_COMMENT";
+  }
+  if (type >= FL_KEYWORD && type < FL_KIND_END)
+    return fl[type - FL_KEYWORD];
+  sprintf(num, "%d", type);
+  return num;
+}
+
+static int is_ident_start(unsigned char c) { return isalpha(c) || c == '_'; }
+static int is_ident(unsigned char c) { return isalnum(c) || c == '_'; }
+
+// The token just matched is start[0..n): skip it or return it.
+static void emit_accept(Buf *b, int depth, size_t n, int type) {
+  indent(b, depth);
+  put(b, "f->cur = start + %zu;\n", n);
+  indent(b, depth);
+  put(b, "f->col += %zu;\n", n);
+  indent(b, depth);
+  if (type == 0)
+    put(b, "continue;\n");
+  else
+    put(b, "return (Token){%s, {start, %zu}, line, col};\n", type_name(type),
+        n);
+}
+
+// Index of the symbol that is exactly prefix[0..n), or -1. The first one
+// in the table wins, as in lookup_symbol().
+static long find_symbol(const FlexLang *lang, const char *prefix, size_t n) {
+  for (size_t i = 0; i < lang->symbol_count; i++) {
+    const char *p = lang->symbols[i].prefix;
+    if (strlen(p) == n && memcmp(p, prefix, n) == 0)
+      return (long)i;
+  }
+  return -1;
+}
+
+// Longest match below the symbol prefix prefix[0..n): switch on the next
+// byte for the longer symbols, then accept prefix itself if it is one.
+// Falls out (to the caller's accept, or past the trie) when nothing fits.
+static void emit_trie(Buf *b, const FlexLang *lang, char *prefix, size_t n,
+                      int depth) {
+  int next[256] = {0}, any = 0;
+  for (size_t i = 0; i < lang->symbol_count; i++) {
+    const char *p = lang->symbols[i].prefix;
+    if (strlen(p) > n && memcmp(p, prefix, n) == 0)
+      next[(unsigned char)p[n]] = any = 1;
+  }
+  if (any) {
+    indent(b, depth);
+    put(b, "if (start + %zu < end) {\n", n);
+    indent(b, depth + 1);
+    put(b, "switch (start[%zu]) {\n", n);
+    // Bytes that lead to the same code share one case.
+    Buf code[256] = {{0}};
+    for (int c = 1; c < 256; c++) {
+      if (!next[c])
+        continue;
+      prefix[n] = (char)c;
+      emit_trie(&code[c], lang, prefix, n + 1, depth + 2);
+    }
+    for (int c = 1; c < 256; c++) {
+      if (!next[c])
+        continue;
+      for (int d = c; d < 256; d++) {
+        if (next[d] && code[d].len == code[c].len &&
+            memcmp(code[d].data, code[c].data, code[c].len) == 0) {
+          indent(b, depth + 1);
+          put(b, "case %s:\n", char_lit((unsigned char)d));
+          next[d] = d == c;
+        }
+      }
+      put(b, "%.*s", (int)code[c].len, code[c].data);
+      next[c] = 0;
+    }
+    for (int c = 0; c < 256; c++)
+      free(code[c].data);
+    indent(b, depth + 1);
+    put(b, "}\n");
+    indent(b, depth);
+    put(b, "}\n");
+  }
+  long sym = find_symbol(lang, prefix, n);
+  if (sym >= 0)
+    emit_accept(b, depth, n, lang->symbols[sym].token_type);
+  else if (n > 1) {
+    indent(b, depth);
+    put(b, "break;\n");
+  }
+}
+
+// Index into hooks[] of the language's custom_token hook, or -1.
+static int find_hook(const FlexLang *lang) {
+  for (size_t i = 0; i < sizeof(hooks) / sizeof(hooks[0]); i++)
+    if (hooks[i].fn == lang->custom_token)
+      return (int)i;
+  return -1;
+}
+
+static void emit_hook(Buf *b, const FlexLang *lang, int depth) {
+  int i = find_hook(lang);
+  indent(b, depth);
+  put(b, "{\n");
+  indent(b, depth + 1);
+  put(b, "Token t = {TOK_EOF, {start, 0}, line, col, {0}};\n");
+  indent(b, depth + 1);
+  put(b, "if (%s(f, &t)) {\n", hooks[i].name);
+  indent(b, depth + 2);
+  put(b, "if (t.type == 0)\n");
+  indent(b, depth + 3);
+  put(b, "continue;\n");
+  indent(b, depth + 2);
+  put(b, "t.line = line;\n");
+  indent(b, depth + 2);
+  put(b, "t.col = col;\n");
+  indent(b, depth + 2);
+  put(b, "return t;\n");
+  indent(b, depth + 1);
+  put(b, "}\n");
+  indent(b, depth);
+  put(b, "}\n");
+}
+
+static const char *hook_first(const FlexLang *lang) {
+  int i = find_hook(lang);
+  return i < 0 ? NULL : hooks[i].first;
+}
+
+static void emit_comment_end(Buf *b, int depth) {
+  indent(b, depth);
+  put(b, "if (f->keep_comments)\n");
+  indent(b, depth + 1);
+  put(b, "return (Token){TOK_COMMENT, {start, (size_t)(f->cur - start)},\n");
+  indent(b, depth + 1);
+  put(b, "               line, col};\n");
+  indent(b, depth);
+  put(b, "continue;\n");
+}
+
+static void emit_block_comment(Buf *b, const FlexLang *lang, int depth) {
+  const char *open = lang->block_comment_start, *close = lang->block_comment_end;
+  size_t olen = strlen(open), clen = strlen(close);
+  indent(b, depth);
+  put(b, "if (flex_starts_with(f, start, %s)) {\n", quote(open, olen));
+  indent(b, depth + 1);
+  put(b, "int level = 1;\n");
+  indent(b, depth + 1);
+  put(b, "f->cur = start + %zu;\n", olen);
+  indent(b, depth + 1);
+  put(b, "f->col += %zu;\n", olen);
+  indent(b, depth + 1);
+  put(b, "while (level > 0 && f->cur < end) {\n");
+  indent(b, depth + 2);
+  put(b, "if (f->nested_comments && flex_starts_with(f, f->cur, %s)) {\n",
+      quote(open, olen));
+  indent(b, depth + 3);
+  put(b, "level++;\n");
+  indent(b, depth + 3);
+  put(b, "f->cur += %zu;\n", olen);
+  indent(b, depth + 3);
+  put(b, "f->col += %zu;\n", olen);
+  indent(b, depth + 2);
+  put(b, "} else if (*f->cur == %s && flex_starts_with(f, f->cur, %s)) {\n",
+      char_lit((unsigned char)close[0]), quote(close, clen));
+  indent(b, depth + 3);
+  put(b, "level--;\n");
+  indent(b, depth + 3);
+  put(b, "f->cur += %zu;\n", clen);
+  indent(b, depth + 3);
+  put(b, "f->col += %zu;\n", clen);
+  indent(b, depth + 2);
+  put(b, "} else\n");
+  indent(b, depth + 3);
+  put(b, "flex_advance(f);\n");
+  indent(b, depth + 1);
+  put(b, "}\n");
+  emit_comment_end(b, depth + 1);
+  indent(b, depth);
+  put(b, "}\n");
+}
+
+// Like flex_next(), a line comment also stops at a NUL byte.
+static void emit_line_comment(Buf *b, const FlexLang *lang, int depth) {
+  const char *open = lang->line_comment;
+  size_t olen = strlen(open);
+  if (olen > 1) {
+    indent(b, depth);
+    put(b, "if (flex_starts_with(f, start, %s)) {\n", quote(open, olen));
+  } else {
+    indent(b, depth);
+    put(b, "{\n");
+  }
+  indent(b, depth + 1);
+  put(b, "const char *p = start + 1;\n");
+  indent(b, depth + 1);
+  put(b, "while (p < end && *p && *p != '\\n')\n");
+  indent(b, depth + 2);
+  put(b, "p++;\n");
+  indent(b, depth + 1);
+  put(b, "f->col += (int)(p - start);\n");
+  indent(b, depth + 1);
+  put(b, "f->cur = p;\n");
+  emit_comment_end(b, depth + 1);
+  indent(b, depth);
+  put(b, "}\n");
+}
+
+// The first byte is consumed as flex_advance() would, then the literal is
+// left to the Flexer's handlers.
+static void emit_literal(Buf *b, int depth, const char *type,
+                         const char *custom, const char *deflt) {
+  indent(b, depth);
+  put(b, "f->cur = start + 1;\n");
+  indent(b, depth);
+  put(b, "f->col++;\n");
+  indent(b, depth);
+  put(b, "Token t = {%s, {start, 0}, line, col};\n", type);
+  indent(b, depth);
+  put(b, "if (f->%s)\n", custom);
+  indent(b, depth + 1);
+  put(b, "f->%s(f, &t);\n", custom);
+  indent(b, depth);
+  put(b, "else\n");
+  indent(b, depth + 1);
+  put(b, "%s;\n", deflt);
+  indent(b, depth);
+  put(b, "t.line = line;\n");
+  indent(b, depth);
+  put(b, "t.col = col;\n");
+  indent(b, depth);
+  put(b, "return t;\n");
+}
+
+static void emit_number(Buf *b, int depth) {
+  emit_literal(b, depth, "TOK_NUMBER", "custom_number",
+               "default_number_rule(f, &t)");
+}
+
+static void emit_identifier(Buf *b, const FlexLang *lang, unsigned char c,
+                            int depth) {
+  indent(b, depth);
+  put(b, "const char *p = start + 1;\n");
+  indent(b, depth);
+  put(b, "while (p < end && flex_gen_ident[(unsigned char)*p])\n");
+  indent(b, depth + 1);
+  put(b, "p++;\n");
+  indent(b, depth);
+  put(b, "size_t n = (size_t)(p - start);\n");
+  indent(b, depth);
+  put(b, "f->cur = p;\n");
+  indent(b, depth);
+  put(b, "f->col += (int)n;\n");
+
+  // Keywords starting with c, first occurrence of each word only.
+  size_t maxlen = 0;
+  for (size_t i = 0; i < lang->keyword_count; i++) {
+    size_t len = strlen(lang->keywords[i].word);
+    if ((unsigned char)lang->keywords[i].word[0] == c && len > maxlen)
+      maxlen = len;
+  }
+  int opened = 0;
+  for (size_t len = 1; len <= maxlen; len++) {
+    int header = 0;
+    for (size_t i = 0; i < lang->keyword_count; i++) {
+      const char *w = lang->keywords[i].word;
+      int valid = (unsigned char)w[0] == c && strlen(w) == len;
+      for (size_t j = 1; valid && j < len; j++)
+        valid = is_ident((unsigned char)w[j]);
+      for (size_t j = 0; valid && j < i; j++)
+        valid = strcmp(lang->keywords[j].word, w) != 0;
+      if (!valid)
+        continue;
+      if (!opened) {
+        indent(b, depth);
+        put(b, "switch (n) {\n");
+        opened = 1;
+      }
+      if (!header) {
+        indent(b, depth);
+        put(b, "case %zu:\n", len);
+        header = 1;
+      }
+      const char *type = type_name(lang->keywords[i].token_type);
+      if (len == 1) {
+        indent(b, depth + 1);
+        put(b, "return (Token){%s, {start, n}, line, col};\n", type);
+      } else {
+        indent(b, depth + 1);
+        put(b, "if (memcmp(start + 1, %s, %zu) == 0)\n", quote(w + 1, len - 1),
+            len - 1);
+        indent(b, depth + 2);
+        put(b, "return (Token){%s, {start, n}, line, col};\n", type);
+      }
+    }
+    if (header && len > 1) {
+      indent(b, depth + 1);
+      put(b, "break;\n");
+    }
+  }
+  if (opened) {
+    indent(b, depth);
+    put(b, "}\n");
+  }
+  indent(b, depth);
+  put(b, "Token t = {TOK_IDENTIFIER, {start, n}, line, col};\n");
+  indent(b, depth);
+  put(b, "if (f->interner)\n");
+  indent(b, depth + 1);
+  put(b, "t.value.id = flex_intern(f->interner, start, n);\n");
+  indent(b, depth);
+  put(b, "return t;\n");
+}
+
+// Everything flex_next() would try for a token starting with c, in its
+// order. Empty if it would only report c as invalid.
+static void emit_byte(Buf *b, const FlexLang *lang, unsigned char c) {
+  const int depth = 3;
+  const char *first = hook_first(lang);
+  if (lang->custom_token && first && strchr(first, c))
+    emit_hook(b, lang, depth);
+  if (lang->block_comment_start && (unsigned char)lang->block_comment_start[0] == c)
+    emit_block_comment(b, lang, depth);
+  if (lang->line_comment && (unsigned char)lang->line_comment[0] == c)
+    emit_line_comment(b, lang, depth);
+  if (isdigit(c)) {
+    emit_number(b, depth);
+    return;
+  }
+  if (c == '.') {
+    indent(b, depth);
+    put(b, "if (start + 1 < end && (unsigned)(start[1] - '0') < 10) {\n");
+    emit_number(b, depth + 1);
+    indent(b, depth);
+    put(b, "}\n");
+  }
+  char prefix[256] = {(char)c};
+  int has_symbol = 0;
+  for (size_t i = 0; i < lang->symbol_count; i++)
+    has_symbol |= (unsigned char)lang->symbols[i].prefix[0] == c;
+  if (has_symbol) {
+    // A symbol is always accepted at depth 1 unless only longer ones start
+    // with c; then the trie falls through to what follows.
+    emit_trie(b, lang, prefix, 1, depth);
+    if (find_symbol(lang, prefix, 1) >= 0)
+      return;
+  }
+  if (is_ident_start(c)) {
+    emit_identifier(b, lang, c, depth);
+    return;
+  }
+  if (c == '"' || c == '\'') {
+    char call[64];
+    snprintf(call, sizeof(call), "default_string_rule(f, &t, %s)",
+             char_lit(c));
+    emit_literal(b, depth, "TOK_STRING", "custom_string", call);
+  }
+}
+
+// Whether a case's code always returns or continues at its top level.
+static int ends_case(const Buf *code) {
+  size_t i = code->len - 1; // the code ends in '\n'
+  while (i > 0 && code->data[i - 1] != '\n')
+    i--;
+  const char *last = code->data + i;
+  return strncmp(last, "      return ", 13) == 0 ||
+         strncmp(last, "      continue;", 15) == 0;
+}
+
+static int emit_lang(Buf *out, const FlexLang *lang) {
+  if (lang->custom_token && find_hook(lang) < 0) {
+    fprintf(stderr, "flexgen: %s: add its custom_token hook to hooks[]\n",
+            lang->name);
+    return -1;
+  }
+  put(out, "static Token flex_next_%s(Flexer *f) {\n", lang->name);
+  put(out, "  const char *end = f->src + f->len;\n");
+  put(out, "  while (f->cur < end) {\n");
+  put(out, "    const char *start = f->cur;\n");
+  put(out, "    int line = f->line, col = f->col;\n");
+  if (lang->custom_token && !hook_first(lang))
+    emit_hook(out, lang, 2);
+  put(out, "    switch (*start) {\n");
+  put(out, "    case ' ':\n    case '\\t':\n    case '\\v':\n    case '\\f':\n"
+           "    case '\\r':\n");
+  put(out, "      f->cur++;\n      f->col++;\n      continue;\n");
+  put(out, "    case '\\n':\n      f->cur++;\n      f->line++;\n"
+           "      f->line_start = f->cur;\n      f->col = 1;\n"
+           "      continue;\n");
+
+  // Bytes whose code comes out the same share one case.
+  Buf code[256] = {{0}};
+  int done[256] = {0};
+  for (int c = 1; c < 256; c++)
+    if (!isspace(c))
+      emit_byte(&code[c], lang, (unsigned char)c);
+  for (int c = 1; c < 256; c++) {
+    if (done[c] || !code[c].len)
+      continue;
+    int last = c;
+    for (int d = c; d < 256; d++)
+      if (code[d].len == code[c].len &&
+          memcmp(code[d].data, code[c].data, code[c].len) == 0)
+        last = d;
+    for (int d = c; d <= last; d++) {
+      if (!done[d] && code[d].len == code[c].len &&
+          memcmp(code[d].data, code[c].data, code[c].len) == 0) {
+        put(out, "    case %s:%s", char_lit((unsigned char)d),
+            d == last ? " {\n" : "\n");
+        done[d] = 1;
+      }
+    }
+    put(out, "%.*s", (int)code[c].len, code[c].data);
+    // Falling out of a case means the byte is not a token start after all.
+    if (!ends_case(&code[c]))
+      put(out, "      break;\n");
+    put(out, "    }\n");
+  }
+  for (int c = 0; c < 256; c++)
+    free(code[c].data);
+
+  put(out, "    }\n");
+  put(out, "    f->cur++;\n    f->col++;\n");
+  put(out, "    return (Token){TOK_INVALID, {start, 1}, line, col};\n");
+  put(out, "  }\n");
+  put(out, "  return (Token){TOK_EOF, {f->cur, 0}, f->line, f->col};\n");
+  put(out, "}\n\n");
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const FlexLang *langs[FLEX_LANG_COUNT];
+  size_t nlangs = 0;
+  if (argc == 1) {
+    for (size_t i = 0; i < FLEX_LANG_COUNT; i++)
+      langs[nlangs++] = &flex_langs[i];
+  }
+  for (int i = 1; i < argc; i++) {
+    const FlexLang *lang = flex_lang_find(argv[i]);
+    if (!lang) {
+      fprintf(stderr, "flexgen: no table for %s\n", argv[i]);
+      return 1;
+    }
+    size_t j = 0;
+    while (j < nlangs && langs[j] != lang)
+      j++;
+    if (j == nlangs)
+      langs[nlangs++] = lang;
+  }
+
+  Buf out = {0};
+  put(&out, "/* flexer_gen.h - Specialized flex_next() per language, generated "
+            "by flexgen.c\n"
+            " * from flexer_langs.h. Do not edit; rerun:\n"
+            " *\n"
+            " *   gcc -O2 -o flexgen flexgen.c && ./flexgen > flexer_gen.h\n"
+            " *\n"
+            " * Usage (same tokens as flex_next, a few times faster):\n"
+            " *   FlexNextFn next = flex_next_for(lang);\n"
+            " *   flex_init(&f, src, len);\n"
+            " *   flex_lang_apply(&f, lang);\n"
+            " *   for (Token t; (t = next(&f)).type != TOK_EOF;)\n"
+            " *     ...\n"
+            " */\n\n"
+            "#ifndef FLEXER_GEN_H\n#define FLEXER_GEN_H\n\n"
+            "#include \"flexer_langs.h\"\n\n"
+            "_Static_assert(FLEX_LANG_COUNT == %zu,\n"
+            "               \"flexer_langs.h changed: rerun flexgen\");\n\n"
+            "typedef Token (*FlexNextFn)(Flexer *f);\n\n",
+      FLEX_LANG_COUNT);
+
+  put(&out, "// isalnum() || '_' in the C locale, as flex_next() tests it.\n");
+  put(&out, "static const unsigned char flex_gen_ident[256] = {");
+  for (int c = 0; c < 256; c++)
+    put(&out, "%s%d,", c % 32 ? "" : "\n    ", is_ident((unsigned char)c));
+  put(&out, "\n};\n\n");
+
+  for (size_t i = 0; i < nlangs; i++)
+    if (emit_lang(&out, langs[i]) != 0)
+      return 1;
+
+  put(&out, "// The generated lexer for `lang`, or flex_next() for one without.\n"
+            "static inline FlexNextFn flex_next_for(const FlexLang *lang) {\n");
+  for (size_t i = 0; i < nlangs; i++)
+    put(&out, "  if (lang == &flex_langs[%zu])\n    return flex_next_%s;\n",
+        (size_t)(langs[i] - flex_langs), langs[i]->name);
+  put(&out, "  return flex_next;\n}\n\n#endif // FLEXER_GEN_H\n");
+
+  fwrite(out.data, 1, out.len, stdout);
+  free(out.data);
+  return ferror(stdout) ? 1 : 0;
+}
@@ -0,0 +1,283 @@
+// Generated (flexer_gen.h) vs table-driven (flex_next) lexing.
+//
+//   gcc -O2 -o flexgen flexgen.c && ./flexgen > flexer_gen.h
+//   gcc -O2 -o flexgen_bench flexgen_bench.c
+//   ./flexgen_bench [-n runs] file...
+//
+// Every file whose extension has a table in flexer_langs.h is lexed with
+// both and the token streams compared field by field, then each lexer is
+// timed over all of them (best of -n runs) per language. The same check
+// then runs on random soup built from each language's symbols, keywords,
+// comment delimiters and odd bytes, which reaches the edge cases (input
+// ending mid-symbol, unclosed comments, NULs) real files rarely do. Any
+// mismatch is printed and makes the exit status 1. The last columns time
+// the generated lexer again with a FlexInterner shared by all the files.
+// The .lua files are also timed with luatoken.h's ltok_next() loop (only
+// ltok_init()/ltok_next() are used, so an older luatoken.h can be dropped in
+// to compare).
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flexer_gen.h"
+#include "luatoken.h"
+
+typedef struct {
+  const FlexLang *lang;
+  const char *path;
+  char *src;
+  size_t len;
+} Input;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *path, size_t *len) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  char *buf = malloc((size_t)st.st_size + 1);
+  ssize_t n = buf ? read(fd, buf, (size_t)st.st_size) : -1;
+  close(fd);
+  if (n < 0) {
+    free(buf);
+    return NULL;
+  }
+  buf[n] = '\0'; // for ltok_init()
+  *len = (size_t)n;
+  return buf;
+}
+
+static int same_token(Token a, Token b) {
+  return a.type == b.type && a.text.start == b.text.start &&
+         a.text.len == b.text.len && a.line == b.line && a.col == b.col &&
+         a.value.u64 == b.value.u64;
+}
+
+// Lexes src with both: with comments skipped, with keep_comments, and with
+// an interner each (so identifier IDs must agree too). Returns the token
+// count, or -1 after reporting the first difference.
+static long compare(const FlexLang *lang, const char *name, const char *src,
+                    size_t len) {
+  FlexNextFn next = flex_next_for(lang);
+  long count = 0;
+  for (int pass = 0; pass < 3; pass++) {
+    FlexInterner ia, ib;
+    flex_interner_init(&ia);
+    flex_interner_init(&ib);
+    Flexer a, b;
+    flex_init(&a, src, len);
+    flex_lang_apply(&a, lang);
+    a.keep_comments = pass == 1;
+    b = a;
+    if (pass == 2) {
+      a.interner = &ia;
+      b.interner = &ib;
+    }
+    for (;; count++) {
+      Token x = flex_next(&a), y = next(&b);
+      if (!same_token(x, y) || a.line_start != b.line_start) {
+        fprintf(stderr,
+                "%s: token %ld differs at offset %zu:\n"
+                "  flex_next   type %d line %d col %d \"%.*s\"\n"
+                "  generated   type %d line %d col %d \"%.*s\"\n",
+                name, count, (size_t)(x.text.start - src), x.type, x.line,
+                x.col, (int)x.text.len, x.text.start, y.type, y.line, y.col,
+                (int)y.text.len, y.text.start);
+        count = -1;
+        break;
+      }
+      if (x.type == TOK_EOF)
+        break;
+    }
+    flex_interner_free(&ia);
+    flex_interner_free(&ib);
+    if (count < 0)
+      return -1;
+  }
+  return count;
+}
+
+static volatile size_t sink;
+
+// With `intern`, one interner is shared by all the files, as an indexer
+// would; *names is set to the number of distinct identifiers.
+static double time_lexer(const Input *in, size_t n, const FlexLang *lang,
+                         int generated, int intern, uint32_t *names,
+                         int runs) {
+  double best = 1e30;
+  for (int r = 0; r < runs; r++) {
+    FlexInterner interner;
+    flex_interner_init(&interner);
+    double t0 = now_ms();
+    for (size_t i = 0; i < n; i++) {
+      if (in[i].lang != lang)
+        continue;
+      FlexNextFn next = generated ? flex_next_for(lang) : flex_next;
+      Flexer f;
+      flex_init(&f, in[i].src, in[i].len);
+      flex_lang_apply(&f, lang);
+      if (intern)
+        f.interner = &interner;
+      for (Token t; (t = next(&f)).type != TOK_EOF;)
+        sink += (size_t)t.type;
+    }
+    double ms = now_ms() - t0;
+    if (names)
+      *names = interner.count;
+    flex_interner_free(&interner);
+    if (ms < best)
+      best = ms;
+  }
+  return best;
+}
+
+// The ltok_next() loop over the inputs lexed as `lang` (Lua).
+static double time_luatoken(const Input *in, size_t n, const FlexLang *lang,
+                            int runs) {
+  double best = 1e30;
+  for (int r = 0; r < runs; r++) {
+    double t0 = now_ms();
+    for (size_t i = 0; i < n; i++) {
+      if (in[i].lang != lang)
+        continue;
+      ltok_state S;
+      ltok_init(&S, in[i].src);
+      for (ltok_next(&S); S.tok.kind != LTOK_EOF; ltok_next(&S))
+        sink += (size_t)S.tok.kind;
+    }
+    double ms = now_ms() - t0;
+    if (ms < best)
+      best = ms;
+  }
+  return best;
+}
+
+// Random concatenation, about *len bytes long, of the pieces a lexer for
+// `lang` cares about. *len is set to the real length.
+static char *soup(const FlexLang *lang, size_t *len, unsigned *seed) {
+  static const char *const extra[] = {
+      " ", "  ", "\n", "\t", "\r\n", "\\\n", "\"", "'", "\\", "0x1F", "1e+5",
+      ".5", "12.", "0b101", "10u64", "[[", "]]", "[==[", "]==]", "--[[",
+      "#", "\n#define X \\\n", "_a1", "x", "\xc3\xa9", "\x01", "@", "$",
+      "`", "",
+  };
+  const size_t nextra = sizeof(extra) / sizeof(extra[0]);
+  char *buf = malloc(*len + 64);
+  size_t at = 0;
+  while (buf && at < *len) {
+    unsigned r = (*seed = *seed * 1103515245u + 12345u) >> 8;
+    const char *piece;
+    switch (r % 4) {
+    case 0:
+      piece = lang->symbols[(r >> 2) % lang->symbol_count].prefix;
+      break;
+    case 1:
+      piece = lang->keywords[(r >> 2) % lang->keyword_count].word;
+      break;
+    case 2: {
+      const char *d[] = {lang->line_comment, lang->block_comment_start,
+                         lang->block_comment_end};
+      piece = d[(r >> 2) % 3];
+      if (piece)
+        break;
+    }
+    // fallthrough
+    default:
+      piece = extra[(r >> 2) % nextra];
+      break;
+    }
+    size_t n = strlen(piece);
+    if (at + n > *len)
+      break;
+    memcpy(buf + at, piece, n);
+    at += n;
+    if (r % 64 == 0)
+      buf[at++] = '\0';
+  }
+  *len = at;
+  return buf;
+}
+
+int main(int argc, char **argv) {
+  int runs = 5, opt;
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    if (opt != 'n') {
+      fprintf(stderr, "Usage: %s [-n runs] file...\n", argv[0]);
+      return 2;
+    }
+    runs = atoi(optarg);
+  }
+
+  Input *in = calloc((size_t)argc, sizeof(*in));
+  size_t n = 0;
+  int bad = 0;
+  for (int i = optind; i < argc; i++) {
+    const FlexLang *lang = flex_lang_for_path(argv[i]);
+    if (!lang)
+      continue;
+    in[n] = (Input){lang, argv[i], NULL, 0};
+    if (!(in[n].src = read_file(argv[i], &in[n].len))) {
+      perror(argv[i]);
+      continue;
+    }
+    bad |= compare(lang, argv[i], in[n].src, in[n].len) < 0;
+    n++;
+  }
+
+  printf("%-5s %6s %10s %12s %12s %8s %14s %7s\n", "lang", "files", "bytes",
+         "flex_next", "generated", "speedup", "+interner", "names");
+  for (size_t l = 0; l < FLEX_LANG_COUNT; l++) {
+    const FlexLang *lang = &flex_langs[l];
+    size_t files = 0, bytes = 0;
+    for (size_t i = 0; i < n; i++)
+      if (in[i].lang == lang)
+        files++, bytes += in[i].len;
+    if (!files)
+      continue;
+    uint32_t names = 0;
+    double table = time_lexer(in, n, lang, 0, 0, NULL, runs);
+    double gen = time_lexer(in, n, lang, 1, 0, NULL, runs);
+    double interned = time_lexer(in, n, lang, 1, 1, &names, runs);
+    printf("%-5s %6zu %10zu %7.1f MB/s %7.1f MB/s %7.2fx %9.1f MB/s %7u\n",
+           lang->name, files, bytes, bytes / table / 1e3, bytes / gen / 1e3,
+           table / gen, bytes / interned / 1e3, names);
+    if (strcmp(lang->name, "lua") == 0)
+      printf("%-5s %6s %10s %7.1f MB/s  (luatoken.h ltok_next)\n", "", "", "",
+             bytes / time_luatoken(in, n, lang, runs) / 1e3);
+  }
+
+  unsigned seed = 1;
+  long tokens = 0;
+  for (size_t l = 0; l < FLEX_LANG_COUNT; l++) {
+    for (int i = 0; i < 200; i++) {
+      size_t len = 1 + (seed >> 4) % 4096;
+      char *src = soup(&flex_langs[l], &len, &seed);
+      if (!src)
+        return 2;
+      long count = compare(&flex_langs[l], flex_langs[l].name, src, len);
+      bad |= count < 0;
+      tokens += count > 0 ? count : 0;
+      free(src);
+    }
+  }
+  printf("random inputs: %ld tokens, %s\n", tokens,
+         bad ? "MISMATCH" : "identical");
+
+  for (size_t i = 0; i < n; i++)
+    free(in[i].src);
+  free(in);
+  return bad;
+}
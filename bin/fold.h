@@ -0,0 +1,440 @@
+/* fold.h - Bracket pairs and fold ranges from flexer.h tokens (single-header)
+
+   Keeps the structural tokens of a buffer in one array sorted by position:
+   brackets, Lua's block words (function/if/do/while/for/repeat ... end/
+   until) and tokens that span lines (block comments, long strings). The
+   text itself is the caller's (an HlBuffer's, say); only those tokens and
+   one byte per line are stored here. Like highlight.h, an edit re-lexes
+   from the last line before it that starts outside any token, and stops
+   at the first line after it that starts clean both before and after the
+   edit, so typing costs the edited lines plus at most one multi-line token
+   around them, and a splice of the token array.
+
+   Pairing is a single stack pass over the tokens, done the first time
+   fold_ranges() or fold_match() is called after an edit; it never touches
+   the text. An unbalanced closer pops back to the nearest opener it closes
+   (the openers in between stay unpaired), or is ignored if there is none.
+   `while`/`for` take their `do` as part of the loop.
+
+   Fold ranges are 0-based inclusive line ranges, sorted by start line, at
+   most one per start line (the outermost) and properly nested: a range
+   ending on a line where another one starts ("} else {", "end, function()")
+   stops on the line before, as a foldexpr would want it.
+
+   Usage:
+
+     #define FOLD_IMPLEMENTATION
+     #include "fold.h"
+
+     FoldIndex fx;
+     fold_init(&fx, flex_lang_find("lua"));
+     // after every change to the lines (text/off as highlight.h keeps them:
+     // off[i] = start of line i, each line ends in '\n')
+     fold_set_lines(&fx, text, off, first, last, n);
+     const FoldRange *r;
+     long count = fold_ranges(&fx, &r);
+     size_t line, col;
+     if (fold_match(&fx, cursor_line, cursor_col, &line, &col) == 1)
+       ... jump to line, col ...
+     fold_free(&fx);
+*/
+
+#ifndef FOLD_H
+#define FOLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flexer_gen.h"
+
+typedef enum {
+  FOLD_NONE,
+  FOLD_OPEN_PAREN,
+  FOLD_CLOSE_PAREN,
+  FOLD_OPEN_BRACKET,
+  FOLD_CLOSE_BRACKET,
+  FOLD_OPEN_BRACE,
+  FOLD_CLOSE_BRACE,
+  FOLD_BLOCK,  // function, if: closed by end
+  FOLD_LOOP,   // while, for: their do opens nothing more
+  FOLD_DO,
+  FOLD_REPEAT, // closed by until
+  FOLD_END,
+  FOLD_UNTIL,
+  FOLD_SPAN // a token over several lines
+} FoldKind;
+
+typedef struct {
+  uint32_t line, col, len; // 0-based, bytes
+  uint32_t kind;           // FoldKind
+  // FOLD_SPAN: the number of lines after the first. Otherwise the index of
+  // the partner token, UINT32_MAX if unpaired (set by pairing).
+  uint32_t other;
+} FoldToken;
+
+typedef struct {
+  uint32_t start, end; // 0-based lines, inclusive
+} FoldRange;
+
+typedef struct {
+  const FlexLang *lang;
+  int lua; // block words count
+  FoldToken *tokens;
+  size_t ntokens, tokens_cap;
+  uint8_t *clean; // per line: lexing can start there
+  size_t nlines, clean_cap;
+  FoldToken *scratch; // tokens of the re-lexed lines
+  size_t scratch_cap;
+  // Built by the next query after an edit.
+  int paired;
+  FoldRange *ranges;
+  size_t nranges, ranges_cap;
+} FoldIndex;
+
+void fold_init(FoldIndex *fx, const FlexLang *lang);
+void fold_free(FoldIndex *fx);
+// Records that lines [first, last) were replaced by `n` lines. `text` and
+// `off` describe the whole buffer after the change: off[i] is the start of
+// line i and off[nlines] the length, every line ending in '\n'. The first
+// call is fold_set_lines(fx, text, off, 0, 0, nlines). Returns 0, or -1 if
+// out of memory or the range is outside the index.
+int fold_set_lines(FoldIndex *fx, const char *text, const size_t *off,
+                   size_t first, size_t last, size_t n);
+// Points *out at the fold ranges; returns their count, or -1 if out of
+// memory. Valid until the next fold_set_lines().
+long fold_ranges(FoldIndex *fx, const FoldRange **out);
+// If a bracket or block word with a partner covers byte `col` of `line`,
+// stores the partner's position and returns 1; 0 if none, -1 if out of
+// memory.
+int fold_match(FoldIndex *fx, size_t line, size_t col, size_t *match_line,
+               size_t *match_col);
+
+#ifdef FOLD_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+void fold_init(FoldIndex *fx, const FlexLang *lang) {
+  memset(fx, 0, sizeof(*fx));
+  fx->lang = lang;
+  fx->lua = strcmp(lang->name, "lua") == 0;
+}
+
+void fold_free(FoldIndex *fx) {
+  free(fx->tokens);
+  free(fx->clean);
+  free(fx->scratch);
+  free(fx->ranges);
+  memset(fx, 0, sizeof(*fx));
+}
+
+static int fold_reserve(void **p, size_t *cap, size_t need, size_t size) {
+  if (need <= *cap)
+    return 0;
+  size_t n = *cap ? *cap : 64;
+  while (n < need)
+    n *= 2;
+  void *q = realloc(*p, n * size);
+  if (!q)
+    return -1;
+  *p = q;
+  *cap = n;
+  return 0;
+}
+
+static FoldKind fold_kind_of(const FoldIndex *fx, const Token *t) {
+  const char *s = t->text.start;
+  if (t->type == FL_PUNCT && t->text.len == 1) {
+    switch (s[0]) {
+    case '(':
+      return FOLD_OPEN_PAREN;
+    case ')':
+      return FOLD_CLOSE_PAREN;
+    case '[':
+      return FOLD_OPEN_BRACKET;
+    case ']':
+      return FOLD_CLOSE_BRACKET;
+    case '{':
+      return FOLD_OPEN_BRACE;
+    case '}':
+      return FOLD_CLOSE_BRACE;
+    }
+    return FOLD_NONE;
+  }
+  if (t->type != FL_KEYWORD || !fx->lua)
+    return FOLD_NONE;
+  switch (t->text.len) {
+  case 2:
+    if (s[0] == 'i' && s[1] == 'f')
+      return FOLD_BLOCK;
+    if (s[0] == 'd' && s[1] == 'o')
+      return FOLD_DO;
+    break;
+  case 3:
+    if (memcmp(s, "end", 3) == 0)
+      return FOLD_END;
+    if (memcmp(s, "for", 3) == 0)
+      return FOLD_LOOP;
+    break;
+  case 5:
+    if (memcmp(s, "while", 5) == 0)
+      return FOLD_LOOP;
+    if (memcmp(s, "until", 5) == 0)
+      return FOLD_UNTIL;
+    break;
+  case 6:
+    if (memcmp(s, "repeat", 6) == 0)
+      return FOLD_REPEAT;
+    break;
+  case 8:
+    if (memcmp(s, "function", 8) == 0)
+      return FOLD_BLOCK;
+    break;
+  }
+  return FOLD_NONE;
+}
+
+// Index of the first token on line `line` or later.
+static size_t fold_lower(const FoldIndex *fx, size_t line) {
+  size_t lo = 0, hi = fx->ntokens;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (fx->tokens[mid].line < line)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Replaces tokens [lo, hi) with `n` new ones.
+static int fold_splice(FoldIndex *fx, size_t lo, size_t hi,
+                       const FoldToken *tokens, size_t n) {
+  size_t count = fx->ntokens - (hi - lo) + n;
+  if (fold_reserve((void **)&fx->tokens, &fx->tokens_cap, count,
+                   sizeof(FoldToken)))
+    return -1;
+  if (hi < fx->ntokens)
+    memmove(fx->tokens + lo + n, fx->tokens + hi,
+            (fx->ntokens - hi) * sizeof(FoldToken));
+  if (n)
+    memcpy(fx->tokens + lo, tokens, n * sizeof(FoldToken));
+  fx->ntokens = count;
+  return 0;
+}
+
+// Re-lexes from line `from` (which starts clean) until a line at or after
+// `stable` starts clean both before and after, i.e. the rest of the buffer
+// lexes as it did, and puts the new tokens in place of the old ones.
+static int fold_relex(FoldIndex *fx, const char *text, const size_t *off,
+                      size_t from, size_t stable) {
+  Flexer f;
+  flex_init(&f, text + off[from], off[fx->nlines] - off[from]);
+  flex_lang_apply(&f, fx->lang);
+  f.keep_comments = true;
+  FlexNextFn next_token = flex_next_for(fx->lang);
+  uint8_t *clean = fx->clean;
+  size_t count = 0;
+  size_t next = from; // first line not yet re-lexed
+  for (Token t; (t = next_token(&f)).type != TOK_EOF;) {
+    size_t first = from + (size_t)t.line - 1;
+    for (; next <= first; next++) {
+      if (next >= stable && next > from && clean[next])
+        goto done;
+      clean[next] = 1;
+    }
+    // f.line is now on the token's last line, or just past it if the token
+    // took its line's '\n' (a C directive).
+    size_t last = from + (size_t)f.line - 1;
+    if (t.text.len && t.text.start[t.text.len - 1] == '\n')
+      last--;
+    if (last >= fx->nlines)
+      last = fx->nlines - 1;
+    for (; next <= last; next++)
+      clean[next] = 0;
+    FoldKind kind = last > first ? FOLD_SPAN : fold_kind_of(fx, &t);
+    if (kind == FOLD_NONE)
+      continue;
+    if (fold_reserve((void **)&fx->scratch, &fx->scratch_cap, count + 1,
+                     sizeof(FoldToken)))
+      return -1;
+    fx->scratch[count++] =
+        (FoldToken){(uint32_t)first, (uint32_t)t.col - 1, (uint32_t)t.text.len,
+                    kind, (uint32_t)(last - first)};
+  }
+  for (; next < fx->nlines; next++)
+    clean[next] = 1;
+done:
+  return fold_splice(fx, fold_lower(fx, from), fold_lower(fx, next),
+                     fx->scratch, count);
+}
+
+int fold_set_lines(FoldIndex *fx, const char *text, const size_t *off,
+                   size_t first, size_t last, size_t n) {
+  if (first > last || last > fx->nlines)
+    return -1;
+  size_t nlines = fx->nlines - (last - first) + n;
+  if (fold_reserve((void **)&fx->clean, &fx->clean_cap, nlines, 1))
+    return -1;
+  if (last < fx->nlines)
+    memmove(fx->clean + first + n, fx->clean + last, fx->nlines - last);
+  if (n)
+    memset(fx->clean + first, 0, n);
+
+  // Drop the tokens of the replaced lines and renumber the ones after.
+  size_t lo = fold_lower(fx, first), hi = fold_lower(fx, last);
+  fold_splice(fx, lo, hi, NULL, 0); // shrinking, cannot fail
+  for (size_t i = lo; i < fx->ntokens; i++)
+    fx->tokens[i].line = (uint32_t)(fx->tokens[i].line - last + first + n);
+  fx->nlines = nlines;
+  fx->paired = 0;
+
+  // The line before the edit may hold a token that now runs on into it.
+  size_t from = first;
+  if (from > 0)
+    from--;
+  while (from > 0 && !fx->clean[from])
+    from--;
+  if (!nlines)
+    return 0;
+  if (fold_relex(fx, text, off, from, first + n) != 0) {
+    // The tokens are stale now; make the next edit re-lex everything.
+    memset(fx->clean, 0, nlines);
+    return -1;
+  }
+  return 0;
+}
+
+// Whether `closer` closes `opener`.
+static int fold_closes(uint32_t closer, uint32_t opener) {
+  switch (closer) {
+  case FOLD_CLOSE_PAREN:
+    return opener == FOLD_OPEN_PAREN;
+  case FOLD_CLOSE_BRACKET:
+    return opener == FOLD_OPEN_BRACKET;
+  case FOLD_CLOSE_BRACE:
+    return opener == FOLD_OPEN_BRACE;
+  case FOLD_END:
+    return opener == FOLD_BLOCK || opener == FOLD_LOOP || opener == FOLD_DO;
+  case FOLD_UNTIL:
+    return opener == FOLD_REPEAT;
+  }
+  return 0;
+}
+
+static int fold_range_cmp(const void *a, const void *b) {
+  const FoldRange *x = a, *y = b;
+  if (x->start != y->start)
+    return x->start < y->start ? -1 : 1;
+  return x->end > y->end ? -1 : x->end < y->end;
+}
+
+static int fold_pair(FoldIndex *fx) {
+  // Every token can open at most one range.
+  if (fold_reserve((void **)&fx->ranges, &fx->ranges_cap,
+                   fx->ntokens ? fx->ntokens : 1, sizeof(FoldRange)))
+    return -1;
+  // Open brackets and words as token indexes; the top bit marks a while/for
+  // whose do hasn't come yet.
+  uint32_t *stack = malloc((fx->ntokens ? fx->ntokens : 1) * sizeof(uint32_t));
+  uint8_t *starts = calloc(fx->nlines ? fx->nlines : 1, 1);
+  if (!stack || !starts) {
+    free(stack);
+    free(starts);
+    return -1;
+  }
+  const uint32_t waiting = 1u << 31;
+  FoldToken *tokens = fx->tokens;
+  FoldRange *ranges = fx->ranges;
+  size_t depth = 0, n = 0;
+  for (size_t i = 0; i < fx->ntokens; i++) {
+    FoldToken *t = &tokens[i];
+    switch (t->kind) {
+    case FOLD_SPAN:
+      ranges[n++] = (FoldRange){t->line, t->line + t->other};
+      starts[t->line] = 1;
+      continue;
+    case FOLD_DO:
+      if (depth && (stack[depth - 1] & waiting)) {
+        stack[depth - 1] &= ~waiting;
+        t->other = UINT32_MAX;
+        continue;
+      }
+      // fallthrough
+    case FOLD_OPEN_PAREN:
+    case FOLD_OPEN_BRACKET:
+    case FOLD_OPEN_BRACE:
+    case FOLD_BLOCK:
+    case FOLD_REPEAT:
+      t->other = UINT32_MAX;
+      stack[depth++] = (uint32_t)i;
+      continue;
+    case FOLD_LOOP:
+      t->other = UINT32_MAX;
+      stack[depth++] = (uint32_t)i | waiting;
+      continue;
+    }
+    t->other = UINT32_MAX;
+    size_t d = depth;
+    while (d > 0 && !fold_closes(t->kind, tokens[stack[d - 1] & ~waiting].kind))
+      d--;
+    if (d == 0)
+      continue;
+    FoldToken *o = &tokens[stack[d - 1] & ~waiting];
+    depth = d - 1;
+    o->other = (uint32_t)i;
+    t->other = (uint32_t)(o - tokens);
+    if (o->line < t->line) {
+      ranges[n++] = (FoldRange){o->line, t->line};
+      starts[o->line] = 1;
+    }
+  }
+  free(stack);
+
+  // Stop short of a line another range starts on, then keep the outermost
+  // range per start line.
+  size_t kept = 0;
+  for (size_t i = 0; i < n; i++) {
+    FoldRange r = ranges[i];
+    if (starts[r.end])
+      r.end--;
+    if (r.end > r.start)
+      ranges[kept++] = r;
+  }
+  free(starts);
+  qsort(ranges, kept, sizeof(FoldRange), fold_range_cmp);
+  n = 0;
+  for (size_t i = 0; i < kept; i++)
+    if (!n || ranges[n - 1].start != ranges[i].start)
+      ranges[n++] = ranges[i];
+  fx->nranges = n;
+  fx->paired = 1;
+  return 0;
+}
+
+long fold_ranges(FoldIndex *fx, const FoldRange **out) {
+  if (!fx->paired && fold_pair(fx) != 0)
+    return -1;
+  *out = fx->ranges;
+  return (long)fx->nranges;
+}
+
+int fold_match(FoldIndex *fx, size_t line, size_t col, size_t *match_line,
+               size_t *match_col) {
+  if (!fx->paired && fold_pair(fx) != 0)
+    return -1;
+  for (size_t i = fold_lower(fx, line);
+       i < fx->ntokens && fx->tokens[i].line == line; i++) {
+    const FoldToken *t = &fx->tokens[i];
+    if (t->kind != FOLD_SPAN && t->other != UINT32_MAX && col >= t->col &&
+        col < (size_t)t->col + t->len) {
+      *match_line = fx->tokens[t->other].line;
+      *match_col = fx->tokens[t->other].col;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#endif // FOLD_IMPLEMENTATION
+#endif // FOLD_H
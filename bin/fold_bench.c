@@ -0,0 +1,248 @@
+// Fold index build time, and incremental updates checked against rebuilds.
+//
+//   gcc -O2 -o fold_bench fold_bench.c
+//   ./fold_bench [-n edits] file...
+//
+// Each file (by extension, see flexer_langs.h) is loaded into an HlBuffer
+// as backend.c would on hl_open, and a FoldIndex is built over it: the
+// first lex and the pairing pass are timed separately. Then `-n` random
+// line edits (default 2000) are applied through hl_set_lines() and
+// fold_set_lines(), each followed by a fold_ranges() query as a foldexpr
+// refresh would do; the edits insert and delete brackets, block words,
+// comment and long string openers and closers, split and join lines. Every
+// 50th edit, and after the last one, the index is compared with one built
+// from scratch over the same lines; any difference is printed and makes
+// the exit status 1.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HIGHLIGHT_IMPLEMENTATION
+#include "highlight.h"
+#define FOLD_IMPLEMENTATION
+#include "fold.h"
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *path, size_t *len) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  char *buf = malloc((size_t)st.st_size + 1);
+  ssize_t n = buf ? read(fd, buf, (size_t)st.st_size) : -1;
+  close(fd);
+  if (n < 0) {
+    free(buf);
+    return NULL;
+  }
+  *len = (size_t)n;
+  return buf;
+}
+
+// Splits src into lines, as nvim_buf_get_lines() would return them.
+static HlText *split_lines(const char *src, size_t len, size_t *n) {
+  size_t count = 1;
+  for (size_t i = 0; i < len; i++)
+    count += src[i] == '\n';
+  HlText *lines = malloc(count * sizeof(*lines));
+  if (!lines)
+    return NULL;
+  *n = 0;
+  const char *p = src, *end = src + len;
+  while (p <= end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    if (!nl)
+      nl = end;
+    lines[(*n)++] = (HlText){p, (size_t)(nl - p)};
+    p = nl + 1;
+  }
+  if (*n > 1 && lines[*n - 1].len == 0) // the file's final '\n'
+    (*n)--;
+  return lines;
+}
+
+static int same_index(FoldIndex *a, FoldIndex *b, const char *name) {
+  const FoldRange *ra = NULL, *rb = NULL;
+  long na = fold_ranges(a, &ra), nb = fold_ranges(b, &rb);
+  if (na != nb || memcmp(ra, rb, (size_t)na * sizeof(*ra)) != 0) {
+    fprintf(stderr, "%s: %ld ranges incrementally, %ld rebuilt\n", name, na,
+            nb);
+    for (long i = 0; i < na && i < nb; i++)
+      if (ra[i].start != rb[i].start || ra[i].end != rb[i].end) {
+        fprintf(stderr, "  first difference: %u-%u vs %u-%u\n", ra[i].start,
+                ra[i].end, rb[i].start, rb[i].end);
+        break;
+      }
+    return 0;
+  }
+  if (a->ntokens != b->ntokens) {
+    fprintf(stderr, "%s: %zu tokens incrementally, %zu rebuilt\n", name,
+            a->ntokens, b->ntokens);
+    return 0;
+  }
+  for (size_t i = 0; i < a->ntokens; i++) {
+    const FoldToken *x = &a->tokens[i], *y = &b->tokens[i];
+    if (x->line != y->line || x->col != y->col || x->len != y->len ||
+        x->kind != y->kind || x->other != y->other) {
+      fprintf(stderr, "%s: token %zu differs: line %u col %u vs line %u col %u\n",
+              name, i, x->line, x->col, y->line, y->col);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int check(const HlBuffer *b, FoldIndex *fx, const char *name) {
+  FoldIndex fresh;
+  fold_init(&fresh, b->lang);
+  int ok = fold_set_lines(&fresh, b->text, b->off, 0, 0, b->nlines) == 0 &&
+           same_index(fx, &fresh, name);
+  fold_free(&fresh);
+  return ok;
+}
+
+// Applies one random edit around line `at`; returns 0 or -1.
+static int edit(HlBuffer *b, FoldIndex *fx, size_t at, unsigned r) {
+  static const char *const pieces[] = {
+      "(", ")", "{", "}", "[", "]", " function() ", " end ", " do ",
+      " if x then ", " while x do ", " repeat ", " until x ", "--[[", "]]",
+      "[==[", "]==]", "/*", "*/", "\"", "-- ", "",
+  };
+  const size_t npieces = sizeof(pieces) / sizeof(pieces[0]);
+  char buf[4096];
+  const char *line = b->text + b->off[at];
+  size_t len = b->off[at + 1] - b->off[at] - 1;
+  if (len > sizeof(buf) / 2)
+    len = sizeof(buf) / 2;
+  size_t cut = len ? (r >> 4) % (len + 1) : 0;
+  const char *piece = pieces[(r >> 12) % npieces];
+  size_t plen = strlen(piece);
+  HlText texts[2];
+  switch (r % 4) {
+  case 0: // insert a piece into the line
+  case 1:
+    memcpy(buf, line, cut);
+    memcpy(buf + cut, piece, plen);
+    memcpy(buf + cut + plen, line + cut, len - cut);
+    texts[0] = (HlText){buf, len + plen};
+    if (hl_set_lines(b, at, at + 1, texts, 1) != 0)
+      return -1;
+    return fold_set_lines(fx, b->text, b->off, at, at + 1, 1);
+  case 2: // split the line, or insert a piece on a line of its own
+    memcpy(buf, line, len);
+    texts[0] = (HlText){buf, cut};
+    texts[1] = (HlText){buf + cut, len - cut};
+    if (r & 0x100000) {
+      texts[0] = (HlText){buf, len};
+      texts[1] = (HlText){piece, plen};
+    }
+    if (hl_set_lines(b, at, at + 1, texts, 2) != 0)
+      return -1;
+    return fold_set_lines(fx, b->text, b->off, at, at + 1, 2);
+  default: // delete the line, or join it with the next
+    if (at + 1 < b->nlines && (r & 0x100000)) {
+      size_t next = b->off[at + 2] - b->off[at + 1] - 1;
+      if (len + next > sizeof(buf))
+        next = sizeof(buf) - len;
+      memcpy(buf, line, len);
+      memcpy(buf + len, b->text + b->off[at + 1], next);
+      texts[0] = (HlText){buf, len + next};
+      if (hl_set_lines(b, at, at + 2, texts, 1) != 0)
+        return -1;
+      return fold_set_lines(fx, b->text, b->off, at, at + 2, 1);
+    }
+    if (hl_set_lines(b, at, at + 1, NULL, 0) != 0)
+      return -1;
+    return fold_set_lines(fx, b->text, b->off, at, at + 1, 0);
+  }
+}
+
+int main(int argc, char **argv) {
+  int edits = 2000, opt;
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    if (opt != 'n') {
+      fprintf(stderr, "Usage: %s [-n edits] file...\n", argv[0]);
+      return 2;
+    }
+    edits = atoi(optarg);
+  }
+
+  printf("%-24s %7s %6s %9s %9s %9s %12s\n", "file", "lines", "folds",
+         "lex", "pair", "edit+query", "worst");
+  int bad = 0;
+  unsigned seed = 1;
+  for (int i = optind; i < argc; i++) {
+    const FlexLang *lang = flex_lang_for_path(argv[i]);
+    if (!lang)
+      continue;
+    size_t len, n;
+    char *src = read_file(argv[i], &len);
+    HlText *lines = src ? split_lines(src, len, &n) : NULL;
+    if (!lines) {
+      perror(argv[i]);
+      free(src);
+      bad = 1;
+      continue;
+    }
+    HlBuffer b;
+    FoldIndex fx;
+    hl_init(&b, lang);
+    fold_init(&fx, lang);
+    const FoldRange *ranges;
+    long folds = -1;
+    double t0 = now_ms(), t1 = t0, t2 = t0;
+    if (hl_set_lines(&b, 0, 0, lines, n) == 0) {
+      t0 = now_ms();
+      if (fold_set_lines(&fx, b.text, b.off, 0, 0, b.nlines) == 0) {
+        t1 = now_ms();
+        folds = fold_ranges(&fx, &ranges);
+        t2 = now_ms();
+      }
+    }
+    free(lines);
+    free(src);
+    if (folds < 0) {
+      fprintf(stderr, "%s: out of memory\n", argv[i]);
+      bad = 1;
+      hl_free(&b);
+      fold_free(&fx);
+      continue;
+    }
+
+    double total = 0, worst = 0;
+    int ok = 1;
+    for (int e = 0; e < edits && ok && b.nlines > 1; e++) {
+      unsigned r = (seed = seed * 1103515245u + 12345u) >> 4;
+      size_t at = (seed >> 8) % b.nlines;
+      double s = now_ms();
+      ok = edit(&b, &fx, at, r) == 0 && fold_ranges(&fx, &ranges) >= 0;
+      double ms = now_ms() - s;
+      total += ms;
+      if (ms > worst)
+        worst = ms;
+      if (ok && (e % 50 == 49 || e == edits - 1))
+        ok = check(&b, &fx, argv[i]);
+    }
+    bad |= !ok;
+    const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+    printf("%-24.24s %7zu %6ld %6.2f ms %6.2f ms %6.3f ms %9.3f ms%s\n", name,
+           b.nlines, folds, t1 - t0, t2 - t1, edits ? total / edits : 0, worst,
+           ok ? "" : "  MISMATCH");
+    hl_free(&b);
+    fold_free(&fx);
+  }
+  return bad;
+}
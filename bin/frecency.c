@@ -0,0 +1,301 @@
+// Frecency-ranked file index backend speaking msgpack over stdio.
+//
+//   gcc -O2 -pthread -o frecency frecency.c -lm $(pkg-config --cflags --libs msgpack)
+//   ./frecency [-r root] [-d store]
+//
+// Walks `root` (default ".") once into a frecency.h index and merges the
+// access scores kept in a kvstore.h store (default ~/.frecency), keyed by
+// absolute path so one store serves every project. Requests on stdin are
+// msgpack arrays:
+//
+//   ["top", prefix, n]   -> {"files": [[path, score], ...]}   best first
+//   ["touch", path]      -> {"ok": true|false}   (false: not in the tree;
+//                                                 the access is still kept)
+//   ["rescan"]           -> {"ok": true, "count": files and dirs}
+//
+// Paths are relative to the root. Replies are written in request order, all
+// requests already buffered with one write.
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <msgpack.h>
+#include <signal.h>
+
+#define KVSTORE_IMPLEMENTATION
+#include "kvstore.h"
+#define FRECENCY_IMPLEMENTATION
+#include "frecency.h"
+
+#define READ_CHUNK (64 * 1024)
+#define MAX_TOP 1000
+
+static KvStore store;
+static FrIndex idx;
+static char root[PATH_MAX];
+static size_t root_len;
+static msgpack_sbuffer out_buf;
+static msgpack_packer out_pk;
+
+// Stored value: score as of `stamp`, see fr_score().
+typedef struct {
+    double score;
+    int64_t stamp;
+} Access;
+
+static int write_all(const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void pack_str(msgpack_packer *pk, const char *s) {
+    size_t len = strlen(s);
+    msgpack_pack_str(pk, len);
+    msgpack_pack_str_body(pk, s, len);
+}
+
+static void reply_error(const char *msg) {
+    msgpack_pack_map(&out_pk, 1);
+    pack_str(&out_pk, "error");
+    pack_str(&out_pk, msg);
+}
+
+// Applies one stored score if its key lies under the root.
+static int load_access(void *ud, const void *key, uint32_t klen, const void *val, uint32_t vlen) {
+    (void)ud;
+    Access a;
+    if (vlen != sizeof(a) || klen <= root_len + 1 || memcmp(key, root, root_len) != 0 ||
+        ((const char *)key)[root_len] != '/') {
+        return 0;
+    }
+    uint32_t id = fr_find(&idx, (const char *)key + root_len + 1, klen - root_len - 1);
+    if (id != FR_NONE) {
+        memcpy(&a, val, sizeof(a));
+        fr_set_score(&idx, id, a.score, a.stamp);
+    }
+    return 0;
+}
+
+static int rescan(void) {
+    if (fr_walk(&idx, root) != 0) {
+        return -1;
+    }
+    kv_foreach(&store, load_access, NULL);
+    return 0;
+}
+
+static void handle_touch(const char *path, uint32_t len) {
+    char key[PATH_MAX * 2];
+    if (root_len + 1 + len > sizeof(key)) {
+        reply_error("path too long");
+        return;
+    }
+    memcpy(key, root, root_len);
+    key[root_len] = '/';
+    uint32_t id = fr_find(&idx, path, len);
+    if (id != FR_NONE) {
+        // The index spelling, so "./a//b" and "a/b" share one key.
+        size_t cap = sizeof(key) - root_len - 1;
+        size_t n = fr_path(&idx, id, key + root_len + 1, cap);
+        if (n >= cap) {
+            reply_error("path too long");
+            return;
+        }
+        len = (uint32_t)n;
+    } else {
+        memcpy(key + root_len + 1, path, len);
+    }
+    uint32_t klen = (uint32_t)(root_len + 1 + len);
+
+    int64_t now = (int64_t)time(NULL);
+    Access a = {0, now};
+    if (id != FR_NONE) {
+        fr_touch(&idx, id, now);
+        a.score = idx.score[id];
+    } else {
+        // Not walked (yet): decay the stored score the same way.
+        uint32_t vlen;
+        const void *v = kv_get(&store, key, klen, &vlen);
+        Access old = {0, now};
+        if (v && vlen == sizeof(old)) {
+            memcpy(&old, v, sizeof(old));
+        }
+        a.score = fr_decay(old.score, old.stamp, now) + 1;
+    }
+    if (kv_put(&store, key, klen, &a, sizeof(a)) != 0) {
+        reply_error(strerror(errno));
+        return;
+    }
+    msgpack_pack_map(&out_pk, 1);
+    pack_str(&out_pk, "ok");
+    if (id != FR_NONE) {
+        msgpack_pack_true(&out_pk);
+    } else {
+        msgpack_pack_false(&out_pk);
+    }
+}
+
+static void handle_top(const msgpack_object_str *prefix, uint64_t n) {
+    static FrHit hits[MAX_TOP];
+    char pre[PATH_MAX];
+    if (prefix->size >= sizeof(pre)) {
+        reply_error("prefix too long");
+        return;
+    }
+    memcpy(pre, prefix->ptr, prefix->size);
+    pre[prefix->size] = '\0';
+    size_t count = fr_top(&idx, pre, (int64_t)time(NULL), hits, n < MAX_TOP ? n : MAX_TOP);
+
+    msgpack_pack_map(&out_pk, 1);
+    pack_str(&out_pk, "files");
+    msgpack_pack_array(&out_pk, count);
+    for (size_t i = 0; i < count; i++) {
+        char path[PATH_MAX];
+        size_t len = fr_path(&idx, hits[i].id, path, sizeof(path));
+        msgpack_pack_array(&out_pk, 2);
+        msgpack_pack_str(&out_pk, len < sizeof(path) ? len : 0);
+        msgpack_pack_str_body(&out_pk, path, len < sizeof(path) ? len : 0);
+        msgpack_pack_double(&out_pk, hits[i].score);
+    }
+}
+
+static void handle_request(const msgpack_object *req) {
+    if (req->type != MSGPACK_OBJECT_ARRAY || req->via.array.size == 0 ||
+        req->via.array.ptr[0].type != MSGPACK_OBJECT_STR) {
+        reply_error("request must be [command, args...]");
+        return;
+    }
+    const msgpack_object *args = req->via.array.ptr + 1;
+    uint32_t nargs = req->via.array.size - 1;
+    const msgpack_object_str *cmd = &req->via.array.ptr[0].via.str;
+
+#define IS(name) (cmd->size == sizeof(name) - 1 && memcmp(cmd->ptr, name, cmd->size) == 0)
+    if (IS("top") && nargs == 2 && args[0].type == MSGPACK_OBJECT_STR &&
+        args[1].type == MSGPACK_OBJECT_POSITIVE_INTEGER) {
+        handle_top(&args[0].via.str, args[1].via.u64);
+    } else if (IS("touch") && nargs == 1 && args[0].type == MSGPACK_OBJECT_STR) {
+        handle_touch(args[0].via.str.ptr, args[0].via.str.size);
+    } else if (IS("rescan") && nargs == 0) {
+        if (rescan() != 0) {
+            reply_error(strerror(errno));
+        } else {
+            msgpack_pack_map(&out_pk, 2);
+            pack_str(&out_pk, "ok");
+            msgpack_pack_true(&out_pk);
+            pack_str(&out_pk, "count");
+            msgpack_pack_uint64(&out_pk, idx.count - 1);
+        }
+    } else {
+        reply_error("unknown command or bad arguments");
+    }
+#undef IS
+}
+
+int main(int argc, char **argv) {
+    const char *root_arg = ".", *store_dir = NULL;
+    char default_store[PATH_MAX];
+    int opt;
+    while ((opt = getopt(argc, argv, "r:d:")) != -1) {
+        switch (opt) {
+        case 'r':
+            root_arg = optarg;
+            break;
+        case 'd':
+            store_dir = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-r root] [-d store]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!store_dir) {
+        const char *home = getenv("HOME");
+        snprintf(default_store, sizeof(default_store), "%s/.frecency", home ? home : ".");
+        store_dir = default_store;
+    }
+
+    if (!realpath(root_arg, root)) {
+        fprintf(stderr, "frecency: %s: %s\n", root_arg, strerror(errno));
+        return 1;
+    }
+    root_len = strlen(root);
+    if (root_len == 1) {
+        root_len = 0; // "/": keys are "/" + path
+    }
+    if (kv_open(&store, store_dir) != 0) {
+        fprintf(stderr, "frecency: %s: %s\n", store_dir, strerror(errno));
+        return 1;
+    }
+    fr_index_init(&idx);
+    if (rescan() != 0) {
+        fprintf(stderr, "frecency: %s: %s\n", root, strerror(errno));
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    msgpack_sbuffer_init(&out_buf);
+    msgpack_packer_init(&out_pk, &out_buf, msgpack_sbuffer_write);
+
+    msgpack_unpacker unpacker;
+    msgpack_unpacked req;
+    if (!msgpack_unpacker_init(&unpacker, READ_CHUNK)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    msgpack_unpacked_init(&req);
+
+    int rc = 0;
+    for (;;) {
+        if (!msgpack_unpacker_reserve_buffer(&unpacker, READ_CHUNK)) {
+            fprintf(stderr, "Out of memory\n");
+            rc = 1;
+            break;
+        }
+        ssize_t n = read(STDIN_FILENO, msgpack_unpacker_buffer(&unpacker), READ_CHUNK);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        msgpack_unpacker_buffer_consumed(&unpacker, (size_t)n);
+
+        msgpack_unpack_return ret;
+        while ((ret = msgpack_unpacker_next(&unpacker, &req)) == MSGPACK_UNPACK_SUCCESS) {
+            handle_request(&req.data);
+        }
+        if (ret == MSGPACK_UNPACK_PARSE_ERROR) {
+            reply_error("malformed msgpack");
+        }
+        int failed = out_buf.size && write_all(out_buf.data, out_buf.size) != 0;
+        msgpack_sbuffer_clear(&out_buf);
+        kv_poll(&store);
+        if (failed || ret == MSGPACK_UNPACK_PARSE_ERROR) {
+            rc = failed ? 1 : rc;
+            break;
+        }
+    }
+
+    msgpack_unpacked_destroy(&req);
+    msgpack_unpacker_destroy(&unpacker);
+    msgpack_sbuffer_destroy(&out_buf);
+    fr_index_free(&idx);
+    if (kv_close(&store) != 0) {
+        fprintf(stderr, "frecency: %s: %s\n", store_dir, strerror(errno));
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,486 @@
+/* frecency.h - file tree index ranked by frecency (single-header, C11 + POSIX)
+
+   The walked tree is stored as parent-pointer nodes whose names are
+   interned into one string pool, so "init.lua" or "node_modules" is stored
+   once however often it occurs. Nodes are numbered in depth-first order and
+   every directory records where its subtree ends, so "everything under
+   lua/plugins/" is one contiguous id range and a prefix query never has to
+   build or compare full paths.
+
+   Each node can carry a frecency score: every access adds 1, and scores
+   decay exponentially with a configurable half-life (FR_HALF_LIFE, one week
+   by default). A score is stored with the time it was last updated and
+   decayed on read, so scores never need a periodic sweep. Persisting scores
+   is left to the caller (see frecency.c, which keeps them in kvstore.h).
+
+   Usage:
+
+     #define FRECENCY_IMPLEMENTATION
+     #include "frecency.h"
+
+     FrIndex idx;
+     fr_index_init(&idx);
+     fr_walk(&idx, ".");
+     fr_touch(&idx, fr_find(&idx, "lua/init.lua", 12), time(NULL));
+     FrHit top[20];
+     size_t n = fr_top(&idx, "lua/", time(NULL), top, 20);
+     char path[4096];
+     fr_path(&idx, top[0].id, path, sizeof(path));
+*/
+
+#ifndef FRECENCY_H
+#define FRECENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FR_NONE UINT32_MAX
+
+#ifndef FR_HALF_LIFE
+#define FR_HALF_LIFE (7 * 24 * 3600.0) // seconds
+#endif
+
+typedef struct {
+  uint32_t parent;   // FR_NONE for the root
+  uint32_t name;     // offset of the NUL-terminated name in the pool
+  uint32_t end;      // directories: one past the last node of the subtree
+  uint16_t name_len;
+  uint8_t is_dir;
+} FrNode;
+
+typedef struct {
+  FrNode *nodes;      // nodes[0] is the root (empty name)
+  double *score;      // score as of stamp[i]; 0 = never accessed
+  int64_t *stamp;
+  size_t count, cap;
+
+  char *pool;         // interned names
+  size_t pool_len, pool_cap;
+  uint32_t *names;    // intern set: pool offset + 1, 0 = empty
+  size_t names_count, names_cap;
+  uint32_t *children; // (parent, name) -> node id + 1, 0 = empty
+  size_t children_cap;
+} FrIndex;
+
+typedef struct {
+  uint32_t id;
+  double score;
+} FrHit;
+
+void fr_index_init(FrIndex *idx);
+void fr_index_free(FrIndex *idx);
+// Adds a node under `parent` (FR_NONE only for the root). Children must be
+// added while their parent's subtree is open, i.e. in depth-first order,
+// and fr_close_dir() called when a directory is done. Returns the node id,
+// or FR_NONE if out of memory.
+uint32_t fr_add(FrIndex *idx, uint32_t parent, const char *name, size_t len,
+                int is_dir);
+static inline void fr_close_dir(FrIndex *idx, uint32_t dir) {
+  idx->nodes[dir].end = (uint32_t)idx->count;
+}
+// Replaces the index contents with the tree under `root` (directories and
+// regular files; symlinks are not followed). Returns 0, or -1 with errno
+// set if `root` cannot be opened or memory runs out; unreadable
+// subdirectories are skipped.
+int fr_walk(FrIndex *idx, const char *root);
+
+// Node for a '/'-separated path relative to the root, or FR_NONE.
+uint32_t fr_find(const FrIndex *idx, const char *path, size_t len);
+// Writes the node's path relative to the root; returns its length, or the
+// length it would need if `cap` is too small (like snprintf).
+size_t fr_path(const FrIndex *idx, uint32_t id, char *buf, size_t cap);
+
+// `score` as of `stamp`, decayed to `now`.
+double fr_decay(double score, int64_t stamp, int64_t now);
+double fr_score(const FrIndex *idx, uint32_t id, int64_t now);
+// Records one access at `now`.
+void fr_touch(FrIndex *idx, uint32_t id, int64_t now);
+static inline void fr_set_score(FrIndex *idx, uint32_t id, double score,
+                                int64_t stamp) {
+  idx->score[id] = score;
+  idx->stamp[id] = stamp;
+}
+
+// Best `n` files whose path starts with `prefix`, highest score first.
+// Files never accessed rank last, in tree order. Returns the number found.
+size_t fr_top(const FrIndex *idx, const char *prefix, int64_t now, FrHit *out,
+              size_t n);
+
+#ifdef FRECENCY_IMPLEMENTATION
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t fr_hash(const char *s, size_t len) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < len; i++)
+    h = (h ^ (unsigned char)s[i]) * 0x100000001b3ull;
+  return h ^ (h >> 29);
+}
+
+void fr_index_init(FrIndex *idx) { memset(idx, 0, sizeof(*idx)); }
+
+void fr_index_free(FrIndex *idx) {
+  free(idx->nodes);
+  free(idx->score);
+  free(idx->stamp);
+  free(idx->pool);
+  free(idx->names);
+  free(idx->children);
+  memset(idx, 0, sizeof(*idx));
+}
+
+// --- Interning ---
+
+static int fr_names_grow(FrIndex *idx) {
+  size_t cap = idx->names_cap ? idx->names_cap * 2 : 1024;
+  uint32_t *names = calloc(cap, sizeof(*names));
+  if (!names)
+    return -1;
+  for (size_t i = 0; i < idx->names_cap; i++) {
+    uint32_t v = idx->names[i];
+    if (!v)
+      continue;
+    const char *s = idx->pool + v - 1;
+    size_t j = fr_hash(s, strlen(s)) & (cap - 1);
+    while (names[j])
+      j = (j + 1) & (cap - 1);
+    names[j] = v;
+  }
+  free(idx->names);
+  idx->names = names;
+  idx->names_cap = cap;
+  return 0;
+}
+
+// Intern-set slot holding `s`, or the empty slot where it would go.
+static size_t fr_name_slot(const FrIndex *idx, const char *s, size_t len) {
+  size_t mask = idx->names_cap - 1;
+  size_t i = fr_hash(s, len) & mask;
+  for (; idx->names[i]; i = (i + 1) & mask) {
+    const char *p = idx->pool + idx->names[i] - 1;
+    if (strncmp(p, s, len) == 0 && p[len] == '\0')
+      break;
+  }
+  return i;
+}
+
+// Pool offset of `s`, adding it if new; UINT32_MAX if out of memory.
+static uint32_t fr_intern(FrIndex *idx, const char *s, size_t len) {
+  if ((idx->names_count + 1) * 2 > idx->names_cap && fr_names_grow(idx) != 0)
+    return UINT32_MAX;
+  size_t i = fr_name_slot(idx, s, len);
+  if (idx->names[i])
+    return idx->names[i] - 1;
+  if (idx->pool_len + len + 1 > idx->pool_cap) {
+    size_t cap = idx->pool_cap ? idx->pool_cap : 64 * 1024;
+    while (idx->pool_len + len + 1 > cap)
+      cap *= 2;
+    if (cap > UINT32_MAX)
+      return UINT32_MAX;
+    char *pool = realloc(idx->pool, cap);
+    if (!pool)
+      return UINT32_MAX;
+    idx->pool = pool;
+    idx->pool_cap = cap;
+  }
+  uint32_t off = (uint32_t)idx->pool_len;
+  memcpy(idx->pool + off, s, len);
+  idx->pool[off + len] = '\0';
+  idx->pool_len += len + 1;
+  idx->names[i] = off + 1;
+  idx->names_count++;
+  return off;
+}
+
+// --- Nodes ---
+
+static size_t fr_child_slot(const FrIndex *idx, uint32_t parent,
+                            uint32_t name) {
+  uint64_t h = ((uint64_t)parent << 32 | name) * 0x9e3779b97f4a7c15ull;
+  return (size_t)(h >> 17) & (idx->children_cap - 1);
+}
+
+static int fr_children_grow(FrIndex *idx) {
+  size_t cap = idx->children_cap ? idx->children_cap * 2 : 1024;
+  uint32_t *children = calloc(cap, sizeof(*children));
+  if (!children)
+    return -1;
+  free(idx->children);
+  idx->children = children;
+  idx->children_cap = cap;
+  for (size_t id = 1; id < idx->count; id++) {
+    const FrNode *nd = &idx->nodes[id];
+    size_t j = fr_child_slot(idx, nd->parent, nd->name);
+    while (children[j])
+      j = (j + 1) & (cap - 1);
+    children[j] = (uint32_t)id + 1;
+  }
+  return 0;
+}
+
+uint32_t fr_add(FrIndex *idx, uint32_t parent, const char *name, size_t len,
+                int is_dir) {
+  if (len > UINT16_MAX || idx->count >= FR_NONE - 1)
+    return FR_NONE;
+  if (idx->count == idx->cap) {
+    size_t cap = idx->cap ? idx->cap * 2 : 1024;
+    FrNode *nodes = realloc(idx->nodes, cap * sizeof(*nodes));
+    if (nodes)
+      idx->nodes = nodes;
+    double *score = realloc(idx->score, cap * sizeof(*score));
+    if (score)
+      idx->score = score;
+    int64_t *stamp = realloc(idx->stamp, cap * sizeof(*stamp));
+    if (stamp)
+      idx->stamp = stamp;
+    if (!nodes || !score || !stamp)
+      return FR_NONE;
+    idx->cap = cap;
+  }
+  if ((idx->count + 1) * 2 > idx->children_cap && fr_children_grow(idx) != 0)
+    return FR_NONE;
+  uint32_t off = fr_intern(idx, name, len);
+  if (off == UINT32_MAX)
+    return FR_NONE;
+
+  uint32_t id = (uint32_t)idx->count++;
+  idx->nodes[id] = (FrNode){parent, off, id + 1, (uint16_t)len, is_dir != 0};
+  idx->score[id] = 0;
+  idx->stamp[id] = 0;
+  if (parent != FR_NONE) {
+    size_t j = fr_child_slot(idx, parent, off);
+    while (idx->children[j])
+      j = (j + 1) & (idx->children_cap - 1);
+    idx->children[j] = id + 1;
+  }
+  return id;
+}
+
+static uint32_t fr_child(const FrIndex *idx, uint32_t parent,
+                         const char *name, size_t len) {
+  if (!idx->children_cap)
+    return FR_NONE;
+  // Names are interned, so look the name up once and compare offsets.
+  size_t i = fr_name_slot(idx, name, len);
+  if (!idx->names[i])
+    return FR_NONE;
+  uint32_t off = idx->names[i] - 1;
+  for (size_t j = fr_child_slot(idx, parent, off); idx->children[j];
+       j = (j + 1) & (idx->children_cap - 1)) {
+    const FrNode *nd = &idx->nodes[idx->children[j] - 1];
+    if (nd->parent == parent && nd->name == off)
+      return idx->children[j] - 1;
+  }
+  return FR_NONE;
+}
+
+uint32_t fr_find(const FrIndex *idx, const char *path, size_t len) {
+  if (idx->count == 0)
+    return FR_NONE;
+  uint32_t id = 0;
+  size_t i = 0;
+  while (i < len) {
+    size_t j = i;
+    while (j < len && path[j] != '/')
+      j++;
+    if (j > i && !(j - i == 1 && path[i] == '.')) {
+      id = fr_child(idx, id, path + i, j - i);
+      if (id == FR_NONE)
+        return FR_NONE;
+    }
+    i = j + 1;
+  }
+  return id;
+}
+
+size_t fr_path(const FrIndex *idx, uint32_t id, char *buf, size_t cap) {
+  size_t len = 0;
+  for (uint32_t n = id; n != 0 && n != FR_NONE; n = idx->nodes[n].parent)
+    len += idx->nodes[n].name_len + (len ? 1 : 0);
+  if (len < cap) {
+    buf[len] = '\0';
+    size_t end = len;
+    for (uint32_t n = id; n != 0 && n != FR_NONE; n = idx->nodes[n].parent) {
+      const FrNode *nd = &idx->nodes[n];
+      if (end < len)
+        buf[end] = '/';
+      end -= nd->name_len;
+      memcpy(buf + end, idx->pool + nd->name, nd->name_len);
+      end--;
+    }
+  } else if (cap) {
+    buf[0] = '\0';
+  }
+  return len;
+}
+
+// --- Walking ---
+
+static int fr_walk_dir(FrIndex *idx, int fd, uint32_t dir) {
+  DIR *d = fdopendir(fd);
+  if (!d) {
+    close(fd);
+    return 0;
+  }
+  struct dirent *e;
+  int rc = 0;
+  while (rc == 0 && (e = readdir(d)) != NULL) {
+    const char *name = e->d_name;
+    if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+      continue;
+    int type = e->d_type;
+    if (type == DT_UNKNOWN) {
+      struct stat st;
+      if (fstatat(dirfd(d), name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        continue;
+      type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : 0;
+    }
+    if (type != DT_DIR && type != DT_REG)
+      continue;
+    uint32_t id = fr_add(idx, dir, name, strlen(name), type == DT_DIR);
+    if (id == FR_NONE) {
+      rc = -1;
+      break;
+    }
+    if (type == DT_DIR) {
+      int sub = openat(dirfd(d), name,
+                       O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (sub >= 0)
+        rc = fr_walk_dir(idx, sub, id);
+      fr_close_dir(idx, id);
+    }
+  }
+  closedir(d);
+  if (rc != 0)
+    errno = ENOMEM;
+  return rc;
+}
+
+int fr_walk(FrIndex *idx, const char *root) {
+  idx->count = idx->pool_len = idx->names_count = 0;
+  if (idx->names)
+    memset(idx->names, 0, idx->names_cap * sizeof(*idx->names));
+  if (idx->children)
+    memset(idx->children, 0, idx->children_cap * sizeof(*idx->children));
+  int fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  if (fr_add(idx, FR_NONE, "", 0, 1) == FR_NONE) {
+    close(fd);
+    errno = ENOMEM;
+    return -1;
+  }
+  int rc = fr_walk_dir(idx, fd, 0);
+  fr_close_dir(idx, 0);
+  return rc;
+}
+
+// --- Scores ---
+
+double fr_decay(double score, int64_t stamp, int64_t now) {
+  if (score == 0)
+    return 0;
+  return score * exp2((double)(stamp - now) / FR_HALF_LIFE);
+}
+
+double fr_score(const FrIndex *idx, uint32_t id, int64_t now) {
+  return fr_decay(idx->score[id], idx->stamp[id], now);
+}
+
+void fr_touch(FrIndex *idx, uint32_t id, int64_t now) {
+  idx->score[id] = fr_score(idx, id, now) + 1;
+  idx->stamp[id] = now;
+}
+
+// --- Queries ---
+
+// Min-heap on (score, -id): the root is the weakest hit kept so far.
+static int fr_weaker(FrHit a, FrHit b) {
+  return a.score < b.score || (a.score == b.score && a.id > b.id);
+}
+
+static void fr_heap_push(FrHit *heap, size_t *len, size_t cap, FrHit h) {
+  size_t i;
+  if (*len < cap) {
+    i = (*len)++;
+    while (i > 0 && fr_weaker(h, heap[(i - 1) / 2])) {
+      heap[i] = heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    heap[i] = h;
+    return;
+  }
+  if (!fr_weaker(heap[0], h))
+    return;
+  i = 0;
+  for (;;) {
+    size_t c = 2 * i + 1;
+    if (c >= *len)
+      break;
+    if (c + 1 < *len && fr_weaker(heap[c + 1], heap[c]))
+      c++;
+    if (!fr_weaker(heap[c], h))
+      break;
+    heap[i] = heap[c];
+    i = c;
+  }
+  heap[i] = h;
+}
+
+static void fr_rank_range(const FrIndex *idx, uint32_t lo, uint32_t hi,
+                          int64_t now, FrHit *heap, size_t *len, size_t n) {
+  for (uint32_t id = lo; id < hi; id++) {
+    if (idx->nodes[id].is_dir)
+      continue;
+    FrHit h = {id, fr_score(idx, id, now)};
+    fr_heap_push(heap, len, n, h);
+  }
+}
+
+size_t fr_top(const FrIndex *idx, const char *prefix, int64_t now, FrHit *out,
+              size_t n) {
+  if (n == 0 || idx->count == 0)
+    return 0;
+  // Split "lua/plu" into the directory "lua" and the partial name "plu".
+  const char *slash = strrchr(prefix, '/');
+  size_t dlen = slash ? (size_t)(slash - prefix) : 0;
+  const char *tail = slash ? slash + 1 : prefix;
+  size_t tlen = strlen(tail);
+  uint32_t dir = fr_find(idx, prefix, dlen);
+  if (dir == FR_NONE || !idx->nodes[dir].is_dir)
+    return 0;
+
+  size_t len = 0;
+  if (tlen == 0) {
+    fr_rank_range(idx, dir + 1, idx->nodes[dir].end, now, out, &len, n);
+  } else {
+    // Subtrees of the matching children are contiguous; skip the rest.
+    uint32_t id = dir + 1;
+    while (id < idx->nodes[dir].end) {
+      const FrNode *nd = &idx->nodes[id];
+      uint32_t next = nd->end;
+      if (nd->name_len >= tlen && memcmp(idx->pool + nd->name, tail, tlen) == 0)
+        fr_rank_range(idx, id, next, now, out, &len, n);
+      id = next;
+    }
+  }
+
+  // Heap sort: repeatedly move the weakest hit to the end.
+  for (size_t end = len; end > 1; end--) {
+    FrHit weakest = out[0];
+    size_t m = end - 1;
+    fr_heap_push(out, &m, m, out[end - 1]);
+    out[end - 1] = weakest;
+  }
+  return len;
+}
+
+#endif // FRECENCY_IMPLEMENTATION
+#endif // FRECENCY_H
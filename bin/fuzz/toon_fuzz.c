@@ -0,0 +1,103 @@
+// libFuzzer harness for toon_format.h / toon_msgpack.h.
+//
+//   clang -g -O1 -fsanitize=fuzzer,address,undefined -I.. -o toon_fuzz toon_fuzz.c
+//   ./toon_fuzz -max_len=4096 toon_corpus/
+//
+// Without libFuzzer, build with -DTOON_FUZZ_MAIN to replay files:
+//
+//   gcc -g -fsanitize=address,undefined -DTOON_FUZZ_MAIN -I.. -o toon_fuzz toon_fuzz.c
+//   ./toon_fuzz toon_corpus/*
+//
+// Every input is fed to the text parser, the msgpack decoder and the binary
+// view. Documents that parse must survive text -> binary -> tree -> msgpack
+// unchanged; any difference aborts.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TOON_IMPLEMENTATION
+#include "toon_format.h"
+#include "toon_msgpack.h"
+
+static void check_round_trip(const ToonValue *root) {
+  ToonMpBuf a = {0}, b = {0};
+  size_t bin_size;
+  void *bin_data = toon_encode_binary(root, &bin_size);
+  ToonBin bin;
+  if (!bin_data || toon_bin_open(&bin, bin_data, bin_size) != 0)
+    abort();
+  ToonValue *copy = toon_bin_to_value(&bin, toon_bin_root(&bin));
+  if (!copy || toon_to_msgpack(root, &a) || toon_to_msgpack(copy, &b) ||
+      a.size != b.size || memcmp(a.data, b.data, a.size) != 0)
+    abort();
+
+  size_t used;
+  ToonValue *back = toon_from_msgpack(a.data, a.size, &used);
+  if (!back || used != a.size)
+    abort();
+
+  toon_free(back);
+  toon_free(copy);
+  toon_mpbuf_free(&a);
+  toon_mpbuf_free(&b);
+  free(bin_data);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  char *text = malloc(size + 1);
+  if (!text)
+    return 0;
+  memcpy(text, data, size);
+  text[size] = '\0';
+
+  // Small limits keep each run cheap and exercise the limit paths.
+  ToonParseOptions opts = {0};
+  opts.max_depth = 16;
+  opts.max_columns = 64;
+  opts.max_items = 4096;
+  ToonError err;
+
+  toon_free(toon_parse(text));
+  opts.flags = TOON_PARSE_INFER | TOON_PARSE_STRICT;
+  ToonValue *root = toon_parse_opts(text, &opts, &err);
+  if (root)
+    check_round_trip(root);
+  else if (err.line < 1 || err.col < 1 || !err.msg[0])
+    abort(); // every rejection must say where and why
+  toon_free(root);
+  free(text);
+
+  toon_free(toon_from_msgpack(data, size, NULL));
+
+  ToonBin bin;
+  if (toon_bin_open(&bin, data, size) == 0) {
+    toon_free(toon_bin_to_value(&bin, toon_bin_root(&bin)));
+    ToonMpBuf mp = {0};
+    toon_bin_to_msgpack(&bin, toon_bin_root(&bin), &mp);
+    toon_mpbuf_free(&mp);
+  }
+  return 0;
+}
+
+#ifdef TOON_FUZZ_MAIN
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    FILE *f = fopen(argv[i], "rb");
+    if (!f) {
+      perror(argv[i]);
+      continue;
+    }
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(n > 0 ? (size_t)n : 1);
+    size_t got = fread(buf, 1, (size_t)(n > 0 ? n : 0), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(buf, got);
+    free(buf);
+    printf("ok  %s\n", argv[i]);
+  }
+  return 0;
+}
+#endif
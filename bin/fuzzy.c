@@ -0,0 +1,223 @@
+// Fuzzy file finder over a candidate list.
+//
+//   gcc -O2 -pthread -o fuzzy fuzzy.c
+//   ./dirwalk | ./fuzzy [-k 20] [-j threads] query
+//   ./dirwalk > files; ./fuzzy -i files -s
+//
+// Candidates are read one per line from stdin (or -i file). dirwalk's
+// "[FILE]: " / "[DIR]: " prefixes and a leading "./" are stripped; binary
+// `dirwalk -b` output is detected and decoded as well. Prints the
+// best k matches as "score<TAB>candidate", best first.
+//
+// With -s (picker session) the query comes from stdin instead, one line per
+// keystroke state; each answer is followed by an empty line. Consecutive
+// queries reuse the previous survivors (see FzSession).
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FUZZY_IMPLEMENTATION
+#include "fuzzy.h"
+
+// Strips dirwalk's prefixes and adds one text line; -1 if out of memory.
+static int add_line(FzIndex *idx, char *s, ssize_t n) {
+  if (n > 0 && s[n - 1] == '\n')
+    s[--n] = '\0';
+  if (strncmp(s, "[FILE]: ", 8) == 0) {
+    s += 8;
+    n -= 8;
+  } else if (strncmp(s, "[DIR]: ", 7) == 0) {
+    s += 7;
+    n -= 7;
+  }
+  if (strncmp(s, "./", 2) == 0) {
+    s += 2;
+    n -= 2;
+  }
+  return n > 0 && fz_index_add(idx, s, (size_t)n) < 0 ? -1 : 0;
+}
+
+static int read_varint(FILE *f, uint64_t *v) {
+  int c, shift = 0;
+  *v = 0;
+  do {
+    if ((c = getc(f)) == EOF || shift > 63)
+      return -1;
+    *v |= (uint64_t)(c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+  return 0;
+}
+
+// Reads `dirwalk -b` records (after the magic line), rebuilding each path
+// from its directory's path. Returns -1 if out of memory.
+static int load_binary(FzIndex *idx, FILE *f) {
+  char path[4096];
+  size_t *dirs = malloc(1024 * sizeof(*dirs)); // dir id -> candidate number
+  size_t ndirs = 1, cap = 1024;
+  int rc = 0, kind;
+  if (!dirs)
+    return -1;
+  dirs[0] = SIZE_MAX; // the start directory, ""
+  while ((kind = getc(f)) != EOF) {
+    uint64_t parent, len;
+    size_t plen = 0;
+    if (read_varint(f, &parent) != 0 || read_varint(f, &len) != 0 ||
+        parent >= ndirs)
+      break;
+    if (dirs[parent] != SIZE_MAX) {
+      const char *p = fz_index_get(idx, dirs[parent], &plen);
+      if (plen + 1 + len >= sizeof(path))
+        break;
+      memcpy(path, p, plen);
+      path[plen++] = '/';
+    }
+    if (plen + len >= sizeof(path) || fread(path + plen, 1, len, f) != len)
+      break;
+    long id = fz_index_add(idx, path, plen + len);
+    if (id < 0) {
+      rc = -1;
+      break;
+    }
+    if (kind == 1) {
+      if (ndirs == cap) {
+        size_t *bigger = realloc(dirs, 2 * cap * sizeof(*dirs));
+        if (!bigger) {
+          rc = -1;
+          break;
+        }
+        dirs = bigger;
+        cap *= 2;
+      }
+      dirs[ndirs++] = (size_t)id;
+    }
+  }
+  free(dirs);
+  return rc;
+}
+
+// Appends every line of `f` (or every `dirwalk -b` record) to the index;
+// returns -1 if out of memory.
+static int load_candidates(FzIndex *idx, FILE *f) {
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t n;
+  int first = 1, rc = 0;
+  while (rc == 0 && (n = getline(&line, &cap, f)) > 0) {
+    if (first && strcmp(line, "DWB1\n") == 0) {
+      rc = load_binary(idx, f);
+      break;
+    }
+    first = 0;
+    rc = add_line(idx, line, n);
+  }
+  free(line);
+  return rc;
+}
+
+static double elapsed_ms(const struct timespec *t0) {
+  struct timespec t1;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) * 1e3 + (t1.tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+static void print_matches(const FzIndex *idx, const FzMatch *top, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    printf("%d\t%s\n", top[i].score, fz_index_get(idx, top[i].index, NULL));
+}
+
+// Answers one query per stdin line until EOF.
+static void run_session(const FzIndex *idx, FzMatch *top, size_t k,
+                        int nthreads) {
+  FzSession session;
+  fz_session_init(&session, idx, nthreads);
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  while ((len = getline(&line, &cap, stdin)) >= 0) {
+    if (len > 0 && line[len - 1] == '\n')
+      line[len - 1] = '\0';
+    struct timespec t0;
+    size_t matched;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t n = fz_session_search(&session, line, top, k, &matched);
+    double ms = elapsed_ms(&t0);
+    print_matches(idx, top, n);
+    printf("\n");
+    fflush(stdout);
+    fprintf(stderr, "%-20s %8zu matches, %.3f ms\n", line, matched, ms);
+  }
+  free(line);
+  fz_session_free(&session);
+}
+
+int main(int argc, char **argv) {
+  size_t k = 20;
+  int nthreads = 0, session = 0, bad = 0;
+  const char *input = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "k:j:i:s")) != -1) {
+    switch (opt) {
+    case 'k':
+      k = (size_t)atol(optarg);
+      break;
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+    case 'i':
+      input = optarg;
+      break;
+    case 's':
+      session = 1;
+      break;
+    default:
+      bad = 1;
+      break;
+    }
+  }
+  if (bad || k == 0 || (session ? !input || optind != argc : optind != argc - 1)) {
+    fprintf(stderr,
+            "Usage: %s [-k n] [-j threads] [-i list] query\n"
+            "       %s [-k n] [-j threads] -i list -s < queries\n",
+            argv[0], argv[0]);
+    return 2;
+  }
+
+  FILE *in = input ? fopen(input, "r") : stdin;
+  if (!in) {
+    perror(input);
+    return 1;
+  }
+  FzIndex idx;
+  fz_index_init(&idx);
+  if (load_candidates(&idx, in) != 0) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  if (in != stdin)
+    fclose(in);
+
+  FzMatch *top = malloc(k * sizeof(*top));
+  if (!top) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  if (session) {
+    run_session(&idx, top, k, nthreads);
+  } else {
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t n = fz_search(&idx, argv[optind], top, k, nthreads);
+    double ms = elapsed_ms(&t0);
+    print_matches(&idx, top, n);
+    fprintf(stderr, "%zu candidates, %.2f ms\n", idx.count, ms);
+  }
+
+  free(top);
+  fz_index_free(&idx);
+  return 0;
+}
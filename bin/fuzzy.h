@@ -0,0 +1,828 @@
+/* fuzzy.h - fzf-style fuzzy matcher (single-header, C11 + pthreads)
+
+   Candidates (typically file paths) are appended to an index that keeps
+   them in one text arena next to a lowercase copy and a 64-bit "which
+   characters occur" mask per candidate. A search then runs in three stages:
+
+     1. mask prefilter: (query_mask & ~candidate_mask) != 0 rejects most of
+        the corpus with one AND per candidate, eight candidates per step;
+     2. subsequence scan with memchr() that also narrows the window between
+        the first possible start and the last possible end;
+     3. Smith-Waterman-like scoring over that window with fzf's constants:
+        +16 per matched char, -3 to open a gap, -1 to extend it, bonuses for
+        matches after separators ('/', '_', ' ', ...), at camelCase and
+        digit boundaries, for consecutive runs, and x2 for the first char.
+
+   The corpus is split into shards matched on separate threads; each keeps a
+   bounded min-heap of its best `k` matches, and only the merged k results
+   are sorted. Matching is smart-case: case-insensitive unless the query has
+   an uppercase letter.
+
+   Usage:
+
+     #define FUZZY_IMPLEMENTATION
+     #include "fuzzy.h"
+
+     FzIndex idx;
+     fz_index_init(&idx);
+     fz_index_add(&idx, "lua/plugins/telescope.lua", 25);
+     FzMatch top[20];
+     size_t n = fz_search(&idx, "telsc", top, 20, 0);   // 0 = all cores
+     // top[i].index is the candidate number, top[i].score its score
+*/
+
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FZ_NO_MATCH INT32_MIN
+#define FZ_MAX_QUERY 64
+
+typedef struct {
+  char *text;     // original bytes, NUL-separated
+  char *lower;    // ASCII-lowercased copy of `text`
+  uint32_t *off;  // start of candidate i in text/lower
+  uint32_t *len;  // length of candidate i
+  uint64_t *mask; // characters present in candidate i (see fz_char_bit)
+  size_t count, cap;
+  size_t text_len, text_cap;
+} FzIndex;
+
+typedef struct {
+  uint32_t index; // candidate number in the index
+  int32_t score;
+} FzMatch;
+
+void fz_index_init(FzIndex *idx);
+void fz_index_free(FzIndex *idx);
+// Returns the candidate number, or -1 if out of memory.
+long fz_index_add(FzIndex *idx, const char *s, size_t len);
+static inline const char *fz_index_get(const FzIndex *idx, size_t i,
+                                       size_t *len) {
+  if (len)
+    *len = idx->len[i];
+  return idx->text + idx->off[i];
+}
+
+// Best `k` matches, best first (ties go to the shorter candidate, then the
+// earlier one). nthreads <= 0 uses every online CPU. An empty query matches
+// everything with score 0.
+size_t fz_search(const FzIndex *idx, const char *query, FzMatch *out,
+                 size_t k, int nthreads);
+
+// Incremental search for a picker. Each query that extends a previous one
+// only rescans that query's surviving candidates, and deleting characters
+// falls back to the cached survivors of the shorter prefix, so per-keystroke
+// cost follows the number of remaining matches rather than the corpus.
+// Sessions read the index without copying it; call fz_session_reset() after
+// adding candidates.
+typedef struct {
+  char query[FZ_MAX_QUERY + 1];
+  uint32_t *ids; // candidates matching `query`, ascending
+  size_t count;
+  FzMatch *top; // last answer for `query`, replayed on backspace
+  size_t ntop, k;
+} FzLevel;
+
+typedef struct {
+  const FzIndex *idx;
+  int nthreads;
+  int depth; // levels[0..depth) are cached, each a prefix of the next
+  FzLevel levels[FZ_MAX_QUERY + 1];
+} FzSession;
+
+void fz_session_init(FzSession *s, const FzIndex *idx, int nthreads);
+void fz_session_reset(FzSession *s);
+void fz_session_free(FzSession *s);
+// Like fz_search; `matched` (may be NULL) receives the total match count.
+size_t fz_session_search(FzSession *s, const char *query, FzMatch *out,
+                         size_t k, size_t *matched);
+
+// Scores one string. When `positions` is non-NULL it receives the byte
+// offset of every matched query char (strlen(query) entries), for
+// highlighting. Returns FZ_NO_MATCH if `query` is not a subsequence.
+int32_t fz_score(const char *text, size_t len, const char *query,
+                 uint32_t *positions);
+
+#ifdef FUZZY_IMPLEMENTATION
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum {
+  FZ_SCORE_MATCH = 16,
+  FZ_GAP_START = 3,
+  FZ_GAP_EXTENSION = 1,
+  FZ_BONUS_BOUNDARY = FZ_SCORE_MATCH / 2,
+  FZ_BONUS_WHITE = FZ_BONUS_BOUNDARY + 2,
+  FZ_BONUS_DELIMITER = FZ_BONUS_BOUNDARY + 1,
+  FZ_BONUS_CAMEL = FZ_BONUS_BOUNDARY - FZ_GAP_EXTENSION,
+  FZ_BONUS_CONSECUTIVE = FZ_GAP_START + FZ_GAP_EXTENSION,
+  FZ_FIRST_CHAR_MULTIPLIER = 2,
+};
+
+// Longest window the DP scores exactly; longer ones fall back to the
+// greedy alignment found by the subsequence scan.
+#define FZ_MAX_WINDOW 1024
+
+enum { FZ_WHITE, FZ_DELIM, FZ_NONWORD, FZ_LOWER, FZ_UPPER, FZ_DIGIT };
+
+static unsigned char fz_class(unsigned char c) {
+  if (c >= 'a' && c <= 'z')
+    return FZ_LOWER;
+  if (c >= 'A' && c <= 'Z')
+    return FZ_UPPER;
+  if (c >= '0' && c <= '9')
+    return FZ_DIGIT;
+  if (c == ' ' || c == '\t' || c == '\n')
+    return FZ_WHITE;
+  if (c == '/' || c == ',' || c == ':' || c == ';' || c == '|')
+    return FZ_DELIM;
+  return c >= 0x80 ? FZ_LOWER : FZ_NONWORD;
+}
+
+// Bonus for matching a char of class `cur` right after one of class `prev`.
+static int fz_bonus(unsigned char prev, unsigned char cur) {
+  if (cur >= FZ_LOWER) {
+    if (prev == FZ_WHITE)
+      return FZ_BONUS_WHITE;
+    if (prev == FZ_DELIM)
+      return FZ_BONUS_DELIMITER;
+    if (prev == FZ_NONWORD)
+      return FZ_BONUS_BOUNDARY;
+  }
+  if ((prev == FZ_LOWER && cur == FZ_UPPER) ||
+      (prev != FZ_DIGIT && cur == FZ_DIGIT))
+    return FZ_BONUS_CAMEL;
+  if (cur == FZ_WHITE)
+    return FZ_BONUS_WHITE;
+  if (cur == FZ_NONWORD || cur == FZ_DELIM)
+    return FZ_BONUS_BOUNDARY;
+  return 0;
+}
+
+static inline unsigned char fz_lower(unsigned char c) {
+  return c >= 'A' && c <= 'Z' ? c + 32 : c;
+}
+
+// a-z and 0-9 get their own bit, a few path characters too, and the rest
+// share the remaining bits.
+static inline uint64_t fz_char_bit(unsigned char c) {
+  if (c >= 'a' && c <= 'z')
+    return 1ull << (c - 'a');
+  if (c >= '0' && c <= '9')
+    return 1ull << (26 + c - '0');
+  switch (c) {
+  case '.':
+    return 1ull << 36;
+  case '/':
+    return 1ull << 37;
+  case '_':
+    return 1ull << 38;
+  case '-':
+    return 1ull << 39;
+  default:
+    return 1ull << (40 + c % 24);
+  }
+}
+
+static uint64_t fz_mask(const char *lower, size_t len) {
+  uint64_t m = 0;
+  for (size_t i = 0; i < len; i++)
+    m |= fz_char_bit((unsigned char)lower[i]);
+  return m;
+}
+
+void fz_index_init(FzIndex *idx) { memset(idx, 0, sizeof(*idx)); }
+
+void fz_index_free(FzIndex *idx) {
+  free(idx->text);
+  free(idx->lower);
+  free(idx->off);
+  free(idx->len);
+  free(idx->mask);
+  memset(idx, 0, sizeof(*idx));
+}
+
+long fz_index_add(FzIndex *idx, const char *s, size_t len) {
+  if (idx->text_len + len + 1 > UINT32_MAX)
+    return -1;
+  if (idx->count == idx->cap) {
+    size_t cap = idx->cap ? idx->cap * 2 : 1024;
+    uint32_t *off = realloc(idx->off, cap * sizeof(*off));
+    if (off)
+      idx->off = off;
+    uint32_t *lens = realloc(idx->len, cap * sizeof(*lens));
+    if (lens)
+      idx->len = lens;
+    uint64_t *mask = realloc(idx->mask, cap * sizeof(*mask));
+    if (mask)
+      idx->mask = mask;
+    if (!off || !lens || !mask)
+      return -1;
+    idx->cap = cap;
+  }
+  if (idx->text_len + len + 1 > idx->text_cap) {
+    size_t cap = idx->text_cap ? idx->text_cap : 64 * 1024;
+    while (cap < idx->text_len + len + 1)
+      cap *= 2;
+    char *text = realloc(idx->text, cap);
+    if (text)
+      idx->text = text;
+    char *lower = realloc(idx->lower, cap);
+    if (lower)
+      idx->lower = lower;
+    if (!text || !lower)
+      return -1;
+    idx->text_cap = cap;
+  }
+
+  char *t = idx->text + idx->text_len, *l = idx->lower + idx->text_len;
+  memcpy(t, s, len);
+  for (size_t i = 0; i < len; i++)
+    l[i] = (char)fz_lower((unsigned char)s[i]);
+  t[len] = l[len] = '\0';
+
+  idx->off[idx->count] = (uint32_t)idx->text_len;
+  idx->len[idx->count] = (uint32_t)len;
+  idx->mask[idx->count] = fz_mask(l, len);
+  idx->text_len += len + 1;
+  return (long)idx->count++;
+}
+
+// --- Scoring ---
+
+typedef struct {
+  char q[FZ_MAX_QUERY]; // query, lowercased unless case-sensitive
+  size_t qlen;
+  int case_sensitive;
+  uint64_t mask;
+} FzQuery;
+
+static void fz_query_init(FzQuery *q, const char *query) {
+  size_t n = strlen(query);
+  if (n > FZ_MAX_QUERY)
+    n = FZ_MAX_QUERY;
+  q->case_sensitive = 0;
+  for (size_t i = 0; i < n; i++)
+    if (query[i] >= 'A' && query[i] <= 'Z')
+      q->case_sensitive = 1;
+  q->qlen = n;
+  q->mask = 0;
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = (unsigned char)query[i];
+    q->q[i] = q->case_sensitive ? (char)c : (char)fz_lower(c);
+    q->mask |= fz_char_bit(fz_lower(c));
+  }
+}
+
+// Per-thread scratch for the DP. Row i only covers [lo[i], hi[i]], the
+// positions (relative to the window) where query char i can take part in
+// an alignment; bonus[] is filled in lazily at matching positions. Score
+// rows are offset by two so that the cells just before a band can hold
+// sentinels.
+typedef struct {
+  uint32_t lo[FZ_MAX_QUERY], hi[FZ_MAX_QUERY];
+  int16_t h[FZ_MAX_QUERY][FZ_MAX_WINDOW + 2];
+  uint8_t run[FZ_MAX_QUERY][FZ_MAX_WINDOW];  // consecutive matches ending here
+  int8_t first[FZ_MAX_QUERY][FZ_MAX_WINDOW]; // bonus the run carries
+  int16_t bonus[FZ_MAX_WINDOW];
+} FzScratch;
+
+// Leftmost alignment: stores where each query char first fits and returns
+// 0 if the query is not a subsequence of `hay`.
+static int fz_forward(const char *hay, size_t len, const FzQuery *q,
+                      uint32_t *first) {
+  const char *p = hay, *end = hay + len;
+  for (size_t i = 0; i < q->qlen; i++) {
+    p = memchr(p, q->q[i], (size_t)(end - p));
+    if (!p)
+      return 0;
+    first[i] = (uint32_t)(p - hay);
+    p++;
+  }
+  return 1;
+}
+
+// Rightmost alignment, scanning back from the end: derives the window
+// [first[0], return value) and every row's band relative to it. Row i starts
+// right after row i-1's first cell so that the gap recurrence sees every
+// predecessor.
+static size_t fz_backward(const char *hay, size_t len, const FzQuery *q,
+                          const uint32_t *first, uint32_t *lo, uint32_t *hi) {
+  size_t from = first[0], to = 0, j = len, i = q->qlen;
+  while (i > 0) {
+    j--;
+    if (hay[j] == q->q[i - 1]) {
+      i--;
+      if (i == q->qlen - 1)
+        to = j + 1;
+      hi[i] = (uint32_t)(j - from);
+      lo[i] = (uint32_t)((i ? first[i - 1] + 1 : from) - from);
+    }
+  }
+  return to;
+}
+
+// Bonus of a char that extends a consecutive run whose bonus is `*first`:
+// the run keeps the bonus of its first char, or of a later boundary char if
+// that is higher, and never less than FZ_BONUS_CONSECUTIVE.
+static inline int fz_run_bonus(int b, int *first) {
+  if (b >= FZ_BONUS_BOUNDARY && b > *first)
+    *first = b;
+  if (b < *first)
+    b = *first;
+  return b < FZ_BONUS_CONSECUTIVE ? FZ_BONUS_CONSECUTIVE : b;
+}
+
+// Greedy fallback for windows too long to score exactly: first occurrence
+// of every char, gaps and bonuses scored as in the DP.
+static int32_t fz_score_greedy(const char *text, const char *hay,
+                               size_t from, const FzQuery *q,
+                               uint32_t *positions) {
+  int32_t score = 0;
+  size_t j = from, prev = 0;
+  int first = 0;
+  for (size_t i = 0; i < q->qlen; i++, j++) {
+    while (hay[j] != q->q[i])
+      j++;
+    unsigned char pc = j ? fz_class((unsigned char)text[j - 1]) : FZ_WHITE;
+    int b = fz_bonus(pc, fz_class((unsigned char)text[j]));
+    if (i > 0 && j == prev + 1) {
+      b = fz_run_bonus(b, &first);
+    } else {
+      if (i > 0)
+        score -= FZ_GAP_START + (int32_t)(j - prev - 2) * FZ_GAP_EXTENSION;
+      first = b;
+    }
+    score += FZ_SCORE_MATCH + (i == 0 ? b * FZ_FIRST_CHAR_MULTIPLIER : b);
+    if (positions)
+      positions[i] = (uint32_t)j;
+    prev = j;
+  }
+  return score;
+}
+
+#define FZ_NEG (INT16_MIN / 2)
+
+static int32_t fz_score_window(FzScratch *s, const char *text,
+                               const char *hay, size_t from,
+                               const FzQuery *q, uint32_t *positions) {
+  size_t m = q->qlen;
+  const char *t = text + from, *h = hay + from;
+
+  for (size_t i = 0; i < m; i++) {
+    int16_t *row = s->h[i] + 2, *up = i ? s->h[i - 1] + 2 : NULL;
+    uint8_t *run = s->run[i];
+    long lo = s->lo[i], hi = s->hi[i];
+    char qc = q->q[i];
+    row[lo - 1] = row[lo - 2] = FZ_NEG;
+    if (up) {
+      // Row i reads row i-1 up to hi-1, past the end of its band.
+      for (long x = s->hi[i - 1] + 1; x < hi; x++)
+        up[x] = FZ_NEG;
+    }
+    int gap = FZ_NEG; // best H[i-1][j'] for j' < j-1, minus gap penalties
+    for (long j = lo; j <= hi; j++) {
+      if (up) {
+        int open = up[j - 2] - FZ_GAP_START;
+        gap = gap - FZ_GAP_EXTENSION > open ? gap - FZ_GAP_EXTENSION : open;
+      }
+      row[j] = FZ_NEG;
+      run[j] = 0;
+      if (h[j] != qc)
+        continue;
+
+      unsigned char pc = from + (size_t)j
+                             ? fz_class((unsigned char)t[j - 1])
+                             : FZ_WHITE;
+      int b = fz_bonus(pc, fz_class((unsigned char)t[j]));
+      s->bonus[j] = (int16_t)b;
+      if (!up) {
+        row[j] = (int16_t)(FZ_SCORE_MATCH + b * FZ_FIRST_CHAR_MULTIPLIER);
+        run[j] = 1;
+        s->first[i][j] = (int8_t)b;
+        continue;
+      }
+      int best = FZ_NEG, best_run = 0, best_first = b;
+      if (up[j - 1] > FZ_NEG) {
+        int first = s->first[i - 1][j - 1];
+        best = up[j - 1] + FZ_SCORE_MATCH + fz_run_bonus(b, &first);
+        best_run = s->run[i - 1][j - 1] + 1;
+        best_first = first;
+      }
+      if (gap > FZ_NEG / 2 && gap + FZ_SCORE_MATCH + b > best) {
+        best = gap + FZ_SCORE_MATCH + b;
+        best_run = 1;
+        best_first = b;
+      }
+      if (best > FZ_NEG) {
+        row[j] = (int16_t)best;
+        run[j] = (uint8_t)(best_run > 255 ? 255 : best_run);
+        s->first[i][j] = (int8_t)best_first;
+      }
+    }
+  }
+
+  int32_t best = FZ_NO_MATCH;
+  long best_j = 0;
+  const int16_t *last = s->h[m - 1] + 2;
+  for (long j = s->lo[m - 1]; j <= (long)s->hi[m - 1]; j++)
+    if (last[j] > FZ_NEG && last[j] > best) {
+      best = last[j];
+      best_j = j;
+    }
+  if (positions && best != FZ_NO_MATCH) {
+    // Walk back: a char continues a run if its run length says so, else it
+    // came from the best gapped predecessor.
+    long j = best_j;
+    for (size_t i = m; i-- > 0;) {
+      positions[i] = (uint32_t)(from + (size_t)j);
+      if (i == 0)
+        break;
+      if (s->run[i][j] > 1) {
+        j--;
+        continue;
+      }
+      const int16_t *up = s->h[i - 1] + 2;
+      int target = s->h[i][j + 2] - FZ_SCORE_MATCH - s->bonus[j];
+      long k = j - 1;
+      for (long jj = j - 2; jj >= (long)s->lo[i - 1]; jj--) {
+        if (up[jj] > FZ_NEG &&
+            up[jj] - FZ_GAP_START - (j - jj - 2) * FZ_GAP_EXTENSION ==
+                target) {
+          k = jj;
+          break;
+        }
+      }
+      j = k;
+    }
+  }
+  return best;
+}
+
+static int32_t fz_score_prepared(FzScratch *s, const char *text,
+                                 const char *lower, size_t len,
+                                 const FzQuery *q, uint32_t *positions) {
+  if (q->qlen == 0)
+    return 0;
+  const char *hay = q->case_sensitive ? text : lower;
+  uint32_t first[FZ_MAX_QUERY];
+  if (!fz_forward(hay, len, q, first))
+    return FZ_NO_MATCH;
+  size_t from = first[0], to = fz_backward(hay, len, q, first, s->lo, s->hi);
+  if (to - from > FZ_MAX_WINDOW)
+    return fz_score_greedy(text, hay, from, q, positions);
+  return fz_score_window(s, text, hay, from, q, positions);
+}
+
+int32_t fz_score(const char *text, size_t len, const char *query,
+                 uint32_t *positions) {
+  FzQuery q;
+  fz_query_init(&q, query);
+  FzScratch *s = malloc(sizeof(*s));
+  char *lower = malloc(len + 1);
+  int32_t score = FZ_NO_MATCH;
+  if (s && lower) {
+    for (size_t i = 0; i < len; i++)
+      lower[i] = (char)fz_lower((unsigned char)text[i]);
+    lower[len] = '\0';
+    score = fz_score_prepared(s, text, lower, len, &q, positions);
+  }
+  free(lower);
+  free(s);
+  return score;
+}
+
+// --- Top-K selection ---
+
+// `a` ranks before `b`.
+static inline int fz_better(const FzIndex *idx, FzMatch a, FzMatch b) {
+  if (a.score != b.score)
+    return a.score > b.score;
+  if (idx->len[a.index] != idx->len[b.index])
+    return idx->len[a.index] < idx->len[b.index];
+  return a.index < b.index;
+}
+
+// Bounded heap whose root is the worst kept match.
+typedef struct {
+  FzMatch *items;
+  size_t n, k;
+} FzHeap;
+
+static void fz_heap_push(const FzIndex *idx, FzHeap *hp, FzMatch m) {
+  size_t i;
+  if (hp->n < hp->k) {
+    i = hp->n++;
+    while (i > 0 && fz_better(idx, hp->items[(i - 1) / 2], m)) {
+      hp->items[i] = hp->items[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    hp->items[i] = m;
+    return;
+  }
+  if (hp->k == 0 || !fz_better(idx, m, hp->items[0]))
+    return;
+  i = 0;
+  for (;;) {
+    size_t c = 2 * i + 1;
+    if (c >= hp->n)
+      break;
+    if (c + 1 < hp->n && fz_better(idx, hp->items[c], hp->items[c + 1]))
+      c++;
+    if (!fz_better(idx, m, hp->items[c]))
+      break;
+    hp->items[i] = hp->items[c];
+    i = c;
+  }
+  hp->items[i] = m;
+}
+
+// --- Sharded search ---
+
+typedef struct {
+  const FzIndex *idx;
+  const FzQuery *q;
+  const uint32_t *ids; // candidates to consider, or NULL for [begin, end)
+  size_t begin, end;
+  FzHeap heap;
+  size_t matched;
+  uint32_t *survivors; // optional: every matching id, in order
+  FzScratch *scratch;
+  int spawned;
+} FzShard;
+
+static void fz_consider(FzShard *sh, uint32_t c) {
+  const FzIndex *idx = sh->idx;
+  const FzQuery *q = sh->q;
+  const char *text = idx->text + idx->off[c];
+  const char *hay = q->case_sensitive ? text : idx->lower + idx->off[c];
+  FzScratch *s = sh->scratch;
+  uint32_t first[FZ_MAX_QUERY];
+
+  if (q->qlen != 0 && !fz_forward(hay, idx->len[c], q, first))
+    return;
+  if (sh->survivors)
+    sh->survivors[sh->matched] = c;
+  sh->matched++;
+  if (q->qlen == 0) {
+    fz_heap_push(idx, &sh->heap, (FzMatch){c, 0});
+    return;
+  }
+
+  // Once the heap is full, skip the DP when even a perfect score (every
+  // char on the best boundary) could not displace the worst kept match.
+  // Candidates arrive in index order, so an equal score and length loses.
+  const FzHeap *hp = &sh->heap;
+  if (hp->n == hp->k && hp->k > 0) {
+    FzMatch worst = hp->items[0];
+    int32_t bound = (int32_t)(q->qlen * FZ_SCORE_MATCH +
+                              (q->qlen + 1) * FZ_BONUS_WHITE);
+    if (bound < worst.score ||
+        (bound == worst.score && idx->len[c] >= idx->len[worst.index]))
+      return;
+  }
+
+  size_t from = first[0];
+  size_t to = fz_backward(hay, idx->len[c], q, first, s->lo, s->hi);
+  int32_t score = to - from > FZ_MAX_WINDOW
+                      ? fz_score_greedy(text, hay, from, q, NULL)
+                      : fz_score_window(s, text, hay, from, q, NULL);
+  fz_heap_push(idx, &sh->heap, (FzMatch){c, score});
+}
+
+static void *fz_shard_run(void *arg) {
+  FzShard *sh = arg;
+  const uint64_t *mask = sh->idx->mask;
+  uint64_t qm = sh->q->mask;
+
+  if (sh->ids) {
+    for (size_t i = sh->begin; i < sh->end; i++)
+      if ((qm & ~mask[sh->ids[i]]) == 0)
+        fz_consider(sh, sh->ids[i]);
+    return NULL;
+  }
+
+  // Prefilter eight masks per step into a survivor byte; the inner loop
+  // has no branches so the compiler vectorizes it.
+  size_t i = sh->begin;
+  for (; i + 8 <= sh->end; i += 8) {
+    unsigned hits = 0;
+    for (unsigned b = 0; b < 8; b++)
+      hits |= (unsigned)((qm & ~mask[i + b]) == 0) << b;
+    while (hits) {
+      unsigned b = (unsigned)__builtin_ctz(hits);
+      hits &= hits - 1;
+      fz_consider(sh, (uint32_t)(i + b));
+    }
+  }
+  for (; i < sh->end; i++)
+    if ((qm & ~mask[i]) == 0)
+      fz_consider(sh, (uint32_t)i);
+  return NULL;
+}
+
+// Searches `ids` (or the whole index when NULL) and merges the shard heaps
+// into `out`. `*n` receives the number of results. When `survivors` is
+// non-NULL (room for `count` ids) it receives every matching candidate in
+// input order, and `*matched` their number. Returns -1 if out of memory.
+static int fz_search_ids(const FzIndex *idx, const FzQuery *q,
+                         const uint32_t *ids, size_t count, FzMatch *out,
+                         size_t k, int nthreads, size_t *n,
+                         uint32_t *survivors, size_t *matched) {
+  if (nthreads <= 0)
+    nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (nthreads < 1)
+    nthreads = 1;
+  // Below ~16k candidates a thread costs more than it saves.
+  if ((size_t)nthreads > count / 16384 + 1)
+    nthreads = (int)(count / 16384 + 1);
+
+  FzShard *shards = calloc((size_t)nthreads, sizeof(*shards));
+  FzMatch *heaps = malloc((size_t)nthreads * (k ? k : 1) * sizeof(FzMatch));
+  pthread_t *tids = malloc((size_t)nthreads * sizeof(pthread_t));
+  int rc = -1;
+  *n = 0;
+  if (!shards || !heaps || !tids)
+    goto done;
+  for (int t = 0; t < nthreads; t++) {
+    FzShard *sh = &shards[t];
+    sh->idx = idx;
+    sh->q = q;
+    sh->ids = ids;
+    sh->begin = count * (size_t)t / (size_t)nthreads;
+    sh->end = count * (size_t)(t + 1) / (size_t)nthreads;
+    sh->heap = (FzHeap){heaps + (size_t)t * k, 0, k};
+    sh->survivors = survivors ? survivors + sh->begin : NULL;
+    sh->scratch = malloc(sizeof(FzScratch));
+    if (!sh->scratch)
+      goto done;
+  }
+
+  // The last shard, and any whose thread fails to start, runs here.
+  for (int t = 0; t < nthreads; t++) {
+    FzShard *sh = &shards[t];
+    sh->spawned = t < nthreads - 1 &&
+                  pthread_create(&tids[t], NULL, fz_shard_run, sh) == 0;
+    if (!sh->spawned)
+      fz_shard_run(sh);
+  }
+  for (int t = 0; t < nthreads; t++)
+    if (shards[t].spawned)
+      pthread_join(tids[t], NULL);
+
+  // Each shard wrote its survivors at its own offset; close the gaps.
+  size_t total = 0;
+  FzHeap all = {out, 0, k};
+  for (int t = 0; t < nthreads; t++) {
+    if (survivors)
+      memmove(survivors + total, shards[t].survivors,
+              shards[t].matched * sizeof(uint32_t));
+    total += shards[t].matched;
+    for (size_t i = 0; i < shards[t].heap.n; i++)
+      fz_heap_push(idx, &all, shards[t].heap.items[i]);
+  }
+  if (matched)
+    *matched = total;
+
+  // Heap sort: popping the worst repeatedly fills `out` from the back.
+  *n = all.n;
+  while (all.n > 0) {
+    FzMatch worst = all.items[0];
+    FzMatch last = all.items[--all.n];
+    size_t i = 0;
+    for (;;) {
+      size_t c = 2 * i + 1;
+      if (c >= all.n)
+        break;
+      if (c + 1 < all.n && fz_better(idx, all.items[c], all.items[c + 1]))
+        c++;
+      if (!fz_better(idx, last, all.items[c]))
+        break;
+      all.items[i] = all.items[c];
+      i = c;
+    }
+    if (all.n > 0)
+      all.items[i] = last;
+    out[all.n] = worst;
+  }
+  rc = 0;
+
+done:
+  for (int t = 0; shards && t < nthreads; t++)
+    free(shards[t].scratch);
+  free(tids);
+  free(heaps);
+  free(shards);
+  return rc;
+}
+
+size_t fz_search(const FzIndex *idx, const char *query, FzMatch *out,
+                 size_t k, int nthreads) {
+  FzQuery q;
+  size_t n;
+  fz_query_init(&q, query);
+  fz_search_ids(idx, &q, NULL, idx->count, out, k, nthreads, &n, NULL, NULL);
+  return n;
+}
+
+// --- Sessions ---
+
+void fz_session_init(FzSession *s, const FzIndex *idx, int nthreads) {
+  memset(s, 0, sizeof(*s));
+  s->idx = idx;
+  s->nthreads = nthreads;
+}
+
+static void fz_level_free(FzLevel *lv) {
+  free(lv->ids);
+  free(lv->top);
+  memset(lv, 0, sizeof(*lv));
+}
+
+void fz_session_reset(FzSession *s) {
+  while (s->depth > 0)
+    fz_level_free(&s->levels[--s->depth]);
+}
+
+void fz_session_free(FzSession *s) { fz_session_reset(s); }
+
+size_t fz_session_search(FzSession *s, const char *query, FzMatch *out,
+                         size_t k, size_t *matched) {
+  FzQuery q;
+  fz_query_init(&q, query);
+  size_t qlen = q.qlen, n;
+
+  // Drop cached levels that are not a prefix of the new query (backspace,
+  // edits in the middle, a different query altogether).
+  while (s->depth > 0) {
+    const FzLevel *top = &s->levels[s->depth - 1];
+    size_t len = strlen(top->query);
+    if (len <= qlen && memcmp(top->query, query, len) == 0)
+      break;
+    fz_level_free(&s->levels[--s->depth]);
+  }
+
+  const uint32_t *ids = NULL;
+  size_t count = s->idx->count;
+  if (s->depth > 0) {
+    const FzLevel *top = &s->levels[s->depth - 1];
+    ids = top->ids;
+    count = top->count;
+    if (strlen(top->query) == qlen) {
+      // Same query again (typically after a backspace): replay the answer,
+      // or rescore the known survivors if a different k is asked for.
+      if (top->top && top->k == k) {
+        memcpy(out, top->top, top->ntop * sizeof(FzMatch));
+        n = top->ntop;
+      } else {
+        fz_search_ids(s->idx, &q, ids, count, out, k, s->nthreads, &n, NULL,
+                      NULL);
+      }
+      if (matched)
+        *matched = count;
+      return n;
+    }
+  }
+  if (qlen == 0 || s->depth == FZ_MAX_QUERY + 1) {
+    fz_search_ids(s->idx, &q, ids, count, out, k, s->nthreads, &n, NULL,
+                  matched);
+    return n;
+  }
+
+  FzLevel *lv = &s->levels[s->depth];
+  lv->ids = malloc((count ? count : 1) * sizeof(uint32_t));
+  if (!lv->ids ||
+      fz_search_ids(s->idx, &q, ids, count, out, k, s->nthreads, &n,
+                    lv->ids, &lv->count) != 0) {
+    fz_level_free(lv);
+    if (matched)
+      *matched = 0;
+    return 0;
+  }
+  lv->top = malloc((n ? n : 1) * sizeof(FzMatch));
+  if (lv->top) {
+    memcpy(lv->top, out, n * sizeof(FzMatch));
+    lv->ntop = n;
+    lv->k = k;
+  }
+  memcpy(lv->query, query, qlen);
+  lv->query[qlen] = '\0';
+  s->depth++;
+  // Trim the allocation to what survived.
+  uint32_t *shrunk = realloc(lv->ids, (lv->count ? lv->count : 1) *
+                                          sizeof(uint32_t));
+  if (shrunk)
+    lv->ids = shrunk;
+  if (matched)
+    *matched = lv->count;
+  return n;
+}
+
+#endif // FUZZY_IMPLEMENTATION
+#endif // FUZZY_H
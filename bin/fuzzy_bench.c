@@ -0,0 +1,130 @@
+// Fuzzy matcher benchmark over a synthetic 1M-path corpus.
+//
+//   gcc -O2 -pthread -o fuzzy_bench fuzzy_bench.c
+//   ./fuzzy_bench [-n paths] [-j threads] [-k top]
+//
+// Paths look like a plugin tree: a few directory levels drawn from a word
+// list and a file name with an extension. Each query is timed as the best of
+// several runs; the target is well under 50 ms per query at 1M paths. A
+// second table types a query one key at a time (then deletes it again)
+// through an FzSession and compares it with a full search per keystroke.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FUZZY_IMPLEMENTATION
+#include "fuzzy.h"
+
+static const char *const words[] = {
+    "lua",       "plugins",  "core",    "config",     "utils",  "lsp",
+    "telescope", "archives", "lazy",    "treesitter", "ui",     "keymaps",
+    "snippets",  "after",    "ftplugin", "colors",    "src",    "test",
+    "node_modules", "vendor", "build",  "docs",       "autoload", "syntax",
+    "statusline", "git",     "diagnostics", "completion", "cmp", "mason",
+};
+#define NWORDS (sizeof(words) / sizeof(words[0]))
+
+static const char *const exts[] = {".lua", ".c", ".h", ".md", ".vim", ".json"};
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv) {
+  size_t npaths = 1000000, k = 50;
+  int nthreads = 0, opt;
+  while ((opt = getopt(argc, argv, "n:j:k:")) != -1) {
+    switch (opt) {
+    case 'n':
+      npaths = (size_t)atol(optarg);
+      break;
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+    case 'k':
+      k = (size_t)atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-n paths] [-j threads] [-k top]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  FzIndex idx;
+  fz_index_init(&idx);
+  srand(42);
+  double t0 = now_ms();
+  for (size_t i = 0; i < npaths; i++) {
+    char path[512];
+    int len = 0, depth = 2 + rand() % 5;
+    for (int d = 0; d < depth; d++)
+      len += snprintf(path + len, sizeof(path) - len, "%s/",
+                      words[rand() % NWORDS]);
+    len += snprintf(path + len, sizeof(path) - len, "%s_%zu%s",
+                    words[rand() % NWORDS], i,
+                    exts[rand() % (sizeof(exts) / sizeof(exts[0]))]);
+    if (fz_index_add(&idx, path, (size_t)len) < 0) {
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+    }
+  }
+  printf("indexed %zu paths (%.1f MB) in %.1f ms\n", idx.count,
+         idx.text_len / (1024.0 * 1024.0), now_ms() - t0);
+
+  static const char *const queries[] = {
+      "l",       "lsp",        "telsc",   "plugcfg",       "Utils",
+      "tsfoo",   "mason.lua",  "srccore", "statuslinegit", "zzzq",
+  };
+  FzMatch *top = malloc(k * sizeof(*top));
+  printf("%-14s %10s %10s  %s\n", "query", "ms", "matches", "best");
+  for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+    double best = 1e30;
+    size_t n = 0;
+    for (int rep = 0; rep < 3; rep++) {
+      double t = now_ms();
+      n = fz_search(&idx, queries[q], top, k, nthreads);
+      t = now_ms() - t;
+      if (t < best)
+        best = t;
+    }
+    printf("%-14s %10.2f %10zu  %s\n", queries[q], best, n,
+           n ? fz_index_get(&idx, top[0].index, NULL) : "-");
+  }
+
+  // Keystroke replay: "statuslinegit" typed, then backspaced to "stat".
+  const char *typed = "statuslinegit";
+  FzSession session;
+  fz_session_init(&session, &idx, nthreads);
+  double full_total = 0, session_total = 0;
+  printf("\n%-14s %10s %10s %10s\n", "keystroke", "full ms", "session ms",
+         "matches");
+  size_t tlen = strlen(typed);
+  for (size_t step = 1; step < 2 * tlen - 3; step++) {
+    char q[64];
+    size_t len = step <= tlen ? step : 2 * tlen - step;
+    memcpy(q, typed, len);
+    q[len] = '\0';
+    double t = now_ms();
+    fz_search(&idx, q, top, k, nthreads);
+    double full = now_ms() - t;
+    size_t matched;
+    t = now_ms();
+    fz_session_search(&session, q, top, k, &matched);
+    double inc = now_ms() - t;
+    full_total += full;
+    session_total += inc;
+    printf("%-14s %10.2f %10.2f %10zu\n", q, full, inc, matched);
+  }
+  printf("%-14s %10.2f %10.2f\n", "total", full_total, session_total);
+  fz_session_free(&session);
+
+  free(top);
+  fz_index_free(&idx);
+  return 0;
+}
@@ -0,0 +1,349 @@
+/* highlight.h - Viewport syntax highlighting from flexer.h tokens (single-header)
+
+   Keeps a copy of a buffer's lines and, per line, the highlight ranges
+   (col_start, col_end, group) of the tokens on it, computed only when a
+   viewport asks for that line and reused until an edit touches it. Columns
+   are 0-based bytes with an exclusive end, as nvim_buf_set_extmark() takes
+   them; a token spanning lines (long string, block comment) gets one range
+   per line.
+
+   Every line also records its anchor: the line lexing has to start from
+   for this line to come out right, i.e. the first line of a multi-line
+   token that runs into it, or the line itself. A viewport lexes from the
+   anchor of its first stale line, so its cost is the size of the viewport
+   (plus at most one token above it), not of the file. hl_set_lines()
+   re-lexes from the edit until line starts agree with the previous state
+   again; typing "--[[" in line 10 re-anchors everything below, typing in
+   a normal line touches that line only.
+
+   Usage:
+
+     #define HIGHLIGHT_IMPLEMENTATION
+     #include "highlight.h"
+
+     HlBuffer b;
+     hl_init(&b, flex_lang_find("lua"));
+     hl_set_lines(&b, 0, 0, lines, n);         // open: insert every line
+     hl_set_lines(&b, first, last, new, m);    // on_lines: replace [first,last)
+     hl_viewport(&b, top, bottom);             // make [top,bottom) current
+     for (size_t l = top; l < bottom; l++)
+       for (each r in hl_line(&b, l, &count))
+         ... l, r.col_start, r.col_end, hl_group_name(r.group) ...
+     hl_free(&b);
+*/
+
+#ifndef HIGHLIGHT_H
+#define HIGHLIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flexer_langs.h"
+
+typedef enum {
+  HL_NONE, // identifiers: left to the default colour
+  HL_COMMENT,
+  HL_STRING,
+  HL_NUMBER,
+  HL_KEYWORD,
+  HL_TYPE,
+  HL_CONSTANT,
+  HL_OPERATOR,
+  HL_DELIMITER,
+  HL_PREPROC,
+  HL_ERROR,
+  HL_GROUP_COUNT
+} HlGroup;
+
+typedef struct {
+  uint32_t col_start, col_end;
+  uint32_t group; // HlGroup
+} HlRange;
+
+typedef struct {
+  uint32_t anchor;
+  uint32_t count, cap;
+  int valid; // ranges are current
+  HlRange *ranges;
+} HlLine;
+
+// A line of new text, without its '\n'.
+typedef struct {
+  const char *ptr;
+  size_t len;
+} HlText;
+
+typedef struct {
+  const FlexLang *lang;
+  char *text; // every line followed by '\n'
+  size_t len, cap;
+  size_t *off; // off[i] = start of line i; off[nlines] = len
+  size_t off_cap;
+  HlLine *lines;
+  size_t nlines, lines_cap;
+} HlBuffer;
+
+// Neovim's default highlight group for a group ("Comment", ...), NULL for
+// HL_NONE.
+const char *hl_group_name(int group);
+void hl_init(HlBuffer *b, const FlexLang *lang);
+void hl_free(HlBuffer *b);
+// Replaces lines [first, last) with `n` new ones (first == last inserts).
+// Returns 0, or -1 if out of memory or the range is outside the buffer.
+int hl_set_lines(HlBuffer *b, size_t first, size_t last, const HlText *lines,
+                 size_t n);
+// Brings the ranges of lines [top, bottom) up to date (bottom is clamped to
+// the line count). Returns the number of ranges in them, or -1 if out of
+// memory.
+long hl_viewport(HlBuffer *b, size_t top, size_t bottom);
+// The ranges of one line, as of the last hl_viewport() covering it.
+const HlRange *hl_line(const HlBuffer *b, size_t line, size_t *count);
+
+#ifdef HIGHLIGHT_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+const char *hl_group_name(int group) {
+  static const char *const names[HL_GROUP_COUNT] = {
+      NULL,       "Comment",  "String",    "Number",  "Keyword", "Type",
+      "Constant", "Operator", "Delimiter", "PreProc", "Error"};
+  return group > 0 && group < HL_GROUP_COUNT ? names[group] : NULL;
+}
+
+static int hl_group_of(int type) {
+  switch (type) {
+  case TOK_COMMENT:
+    return HL_COMMENT;
+  case TOK_STRING:
+    return HL_STRING;
+  case TOK_NUMBER:
+    return HL_NUMBER;
+  case TOK_INVALID:
+    return HL_ERROR;
+  case FL_KEYWORD:
+    return HL_KEYWORD;
+  case FL_TYPE:
+    return HL_TYPE;
+  case FL_CONSTANT:
+    return HL_CONSTANT;
+  case FL_OPERATOR:
+    return HL_OPERATOR;
+  case FL_PUNCT:
+    return HL_DELIMITER;
+  case FL_PREPROC:
+    return HL_PREPROC;
+  }
+  return HL_NONE;
+}
+
+void hl_init(HlBuffer *b, const FlexLang *lang) {
+  memset(b, 0, sizeof(*b));
+  b->lang = lang;
+}
+
+void hl_free(HlBuffer *b) {
+  for (size_t i = 0; i < b->nlines; i++)
+    free(b->lines[i].ranges);
+  free(b->lines);
+  free(b->off);
+  free(b->text);
+  memset(b, 0, sizeof(*b));
+}
+
+const HlRange *hl_line(const HlBuffer *b, size_t line, size_t *count) {
+  if (line >= b->nlines || !b->lines[line].valid) {
+    *count = 0;
+    return NULL;
+  }
+  *count = b->lines[line].count;
+  return b->lines[line].ranges;
+}
+
+static int hl_reserve(void **p, size_t *cap, size_t need, size_t size) {
+  if (need <= *cap)
+    return 0;
+  size_t n = *cap ? *cap : 64;
+  while (n < need)
+    n *= 2;
+  void *q = realloc(*p, n * size);
+  if (!q)
+    return -1;
+  *p = q;
+  *cap = n;
+  return 0;
+}
+
+static void hl_lexer(const HlBuffer *b, size_t from, Flexer *f) {
+  flex_init(f, b->text + b->off[from], b->len - b->off[from]);
+  flex_lang_apply(f, b->lang);
+  f->keep_comments = true;
+}
+
+// Last line of token t lexed from line `from`.
+static size_t hl_token_end(size_t line, const Token *t) {
+  for (size_t i = 0; i + 1 < t->text.len; i++)
+    line += t->text.start[i] == '\n';
+  return line;
+}
+
+// Recomputes anchors from line `from` (which must start clean) until a
+// line at or after `stable` starts clean both before and after, i.e. the
+// rest of the buffer lexes as it did. Lines passed over lose their ranges.
+static void hl_reanchor(HlBuffer *b, size_t from, size_t stable) {
+  Flexer f;
+  hl_lexer(b, from, &f);
+  HlLine *lines = b->lines;
+  size_t next = from; // first line whose anchor is not yet settled
+  for (Token t; (t = flex_next(&f)).type != TOK_EOF;) {
+    size_t first = from + (size_t)t.line - 1;
+    for (; next <= first; next++) {
+      if (next >= stable && next > from && lines[next].anchor == next)
+        return;
+      lines[next].anchor = (uint32_t)next;
+      lines[next].valid = 0;
+    }
+    size_t last = hl_token_end(first, &t);
+    for (size_t l = first + 1; l <= last && l < b->nlines; l++) {
+      lines[l].anchor = lines[first].anchor;
+      lines[l].valid = 0;
+    }
+    if (last + 1 > next)
+      next = last + 1;
+  }
+  for (; next < b->nlines; next++) {
+    lines[next].anchor = (uint32_t)next;
+    lines[next].valid = 0;
+  }
+}
+
+int hl_set_lines(HlBuffer *b, size_t first, size_t last, const HlText *lines,
+                 size_t n) {
+  if (first > last || last > b->nlines)
+    return -1;
+  size_t add = 0;
+  for (size_t i = 0; i < n; i++)
+    add += lines[i].len + 1;
+  size_t cut = b->off ? b->off[last] - b->off[first] : 0;
+  size_t nlines = b->nlines - (last - first) + n;
+  if (hl_reserve((void **)&b->text, &b->cap, b->len - cut + add, 1) ||
+      hl_reserve((void **)&b->lines, &b->lines_cap, nlines, sizeof(HlLine)) ||
+      hl_reserve((void **)&b->off, &b->off_cap, nlines + 1, sizeof(size_t)))
+    return -1;
+  if (!b->nlines)
+    b->off[0] = 0;
+
+  // Where lexing has to restart: the anchor of the line before the edit,
+  // since a token ending right at its newline (a C directive ending in a
+  // backslash) runs on into whatever the first changed line now holds.
+  size_t from = 0;
+  if (first > 0)
+    from = b->lines[first - 1].anchor;
+
+  // Text.
+  size_t at = b->off[first];
+  memmove(b->text + at + add, b->text + at + cut, b->len - at - cut);
+  char *w = b->text + at;
+  for (size_t i = 0; i < n; i++) {
+    memcpy(w, lines[i].ptr, lines[i].len);
+    w[lines[i].len] = '\n';
+    w += lines[i].len + 1;
+  }
+  b->len = b->len - cut + add;
+
+  // Lines and offsets; the lines after the edit keep their old anchors
+  // (shifted) so hl_reanchor() can tell when the state matches again.
+  for (size_t i = first; i < last; i++)
+    free(b->lines[i].ranges);
+  memmove(b->lines + first + n, b->lines + last,
+          (b->nlines - last) * sizeof(HlLine));
+  memmove(b->off + first + n, b->off + last,
+          (b->nlines - last + 1) * sizeof(size_t));
+  for (size_t i = first + n; i <= nlines; i++)
+    b->off[i] = b->off[i] - cut + add;
+  for (size_t i = first + n; i < nlines; i++) {
+    uint32_t *anchor = &b->lines[i].anchor;
+    if (*anchor >= last)
+      *anchor = (uint32_t)(*anchor - last + first + n);
+    else if (*anchor >= first) // inside a token that began in removed text
+      *anchor = UINT32_MAX;
+  }
+  for (size_t i = 0; i < n; i++) {
+    b->lines[first + i] = (HlLine){(uint32_t)(first + i), 0, 0, 0, NULL};
+    b->off[first + i + 1] = b->off[first + i] + lines[i].len + 1;
+  }
+  b->nlines = nlines;
+  if (nlines)
+    hl_reanchor(b, from, first + n);
+  return 0;
+}
+
+// Appends one range to a line being filled.
+static int hl_push(HlLine *line, uint32_t start, uint32_t end, int group) {
+  if (line->count == line->cap) {
+    size_t cap = line->cap;
+    if (hl_reserve((void **)&line->ranges, &cap, line->count + 1,
+                   sizeof(HlRange)))
+      return -1;
+    line->cap = (uint32_t)cap;
+  }
+  line->ranges[line->count++] = (HlRange){start, end, (uint32_t)group};
+  return 0;
+}
+
+// Fills the stale lines from `from` (a clean line) up to `bottom`.
+static int hl_fill(HlBuffer *b, size_t from, size_t bottom) {
+  Flexer f;
+  hl_lexer(b, from, &f);
+  HlLine *lines = b->lines;
+  int rc = 0;
+  // Stale lines are marked 2 while being filled and 1 once done.
+  size_t next = from;
+  for (Token t; rc == 0 && (t = flex_next(&f)).type != TOK_EOF;) {
+    size_t first = from + (size_t)t.line - 1;
+    if (first >= bottom)
+      break;
+    size_t last = hl_token_end(first, &t);
+    for (; next <= last && next < bottom; next++)
+      if (!lines[next].valid) {
+        lines[next].count = 0;
+        lines[next].valid = 2;
+      }
+    int group = hl_group_of(t.type);
+    if (group == HL_NONE)
+      continue;
+    const char *p = t.text.start, *end = p + t.text.len;
+    for (size_t l = first; l <= last && l < b->nlines && rc == 0; l++) {
+      const char *ls = b->text + b->off[l];
+      const char *le = b->text + b->off[l + 1] - 1; // the '\n'
+      const char *s = p > ls ? p : ls, *e = end < le ? end : le;
+      if (lines[l].valid == 2 && e > s)
+        rc = hl_push(&lines[l], (uint32_t)(s - ls), (uint32_t)(e - ls), group);
+    }
+  }
+  // Lines with no token start in [next, bottom) are empty or blank.
+  for (; next < bottom; next++)
+    if (!lines[next].valid) {
+      lines[next].count = 0;
+      lines[next].valid = 2;
+    }
+  for (size_t l = from; l < bottom; l++)
+    if (lines[l].valid == 2)
+      lines[l].valid = rc == 0 ? 1 : 0;
+  return rc;
+}
+
+long hl_viewport(HlBuffer *b, size_t top, size_t bottom) {
+  if (bottom > b->nlines)
+    bottom = b->nlines;
+  long total = 0;
+  for (size_t l = top; l < bottom; l++) {
+    if (!b->lines[l].valid && hl_fill(b, b->lines[l].anchor, bottom) != 0)
+      return -1;
+    total += b->lines[l].count;
+  }
+  return total;
+}
+
+#endif // HIGHLIGHT_IMPLEMENTATION
+#endif // HIGHLIGHT_H
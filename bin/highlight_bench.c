@@ -0,0 +1,252 @@
+// Viewport highlighting cost, and incremental re-lexing checked against
+// rebuilds.
+//
+//   gcc -O2 -o highlight_bench highlight_bench.c
+//   ./highlight_bench [-n edits] [-l lines] [-v height] file...
+//
+// Each file (by extension, see flexer_langs.h) is loaded into an HlBuffer
+// as backend.c would on hl_open, repeated until it has at least `-l` lines
+// (default: as is), and the first viewport of `-v` lines (default 60) is
+// highlighted. Then `-n` random edits (default 2000) are made inside a
+// viewport that jumps somewhere else every 20 edits, each followed by
+// hl_viewport() on it as a redraw would; the edits insert comment and
+// string openers and closers, split, join and delete lines. "scroll" is a
+// jump to a viewport that was never drawn; "edit" (hl_set_lines(), which
+// re-anchors as far as the edit changes lexing) and "view" (the redraw)
+// are averages, "worst" the slowest edit plus redraw. Every 50th edit, and
+// after the last one, a buffer built from scratch over the same lines must
+// have the same anchor on every line and the same ranges on every line the
+// incremental one has current; any difference is printed and makes the
+// exit status 1.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HIGHLIGHT_IMPLEMENTATION
+#include "highlight.h"
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *path, size_t *len) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  char *buf = malloc((size_t)st.st_size + 1);
+  ssize_t n = buf ? read(fd, buf, (size_t)st.st_size) : -1;
+  close(fd);
+  if (n < 0) {
+    free(buf);
+    return NULL;
+  }
+  *len = (size_t)n;
+  return buf;
+}
+
+// Splits src into lines, as nvim_buf_get_lines() would return them, and
+// repeats them until there are at least `min` (if the file has any).
+static HlText *split_lines(const char *src, size_t len, size_t min,
+                           size_t *n) {
+  size_t count = 1;
+  for (size_t i = 0; i < len; i++)
+    count += src[i] == '\n';
+  HlText *lines = malloc(count * sizeof(*lines));
+  if (!lines)
+    return NULL;
+  *n = 0;
+  const char *p = src, *end = src + len;
+  while (p <= end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    if (!nl)
+      nl = end;
+    lines[(*n)++] = (HlText){p, (size_t)(nl - p)};
+    p = nl + 1;
+  }
+  if (*n > 1 && lines[*n - 1].len == 0) // the file's final '\n'
+    (*n)--;
+  size_t once = *n;
+  if (once >= min)
+    return lines;
+  HlText *more = realloc(lines, (min + once) * sizeof(*lines));
+  if (!more) {
+    free(lines);
+    return NULL;
+  }
+  for (lines = more; *n < min; *n += once)
+    memcpy(lines + *n, lines, once * sizeof(*lines));
+  return lines;
+}
+
+// Compares b with a buffer built from its current text: every anchor, and
+// the ranges of every line b has current.
+static int check(HlBuffer *b, const char *name) {
+  size_t n;
+  HlText *lines = split_lines(b->text, b->len, 0, &n);
+  HlBuffer fresh;
+  hl_init(&fresh, b->lang);
+  int ok = lines && hl_set_lines(&fresh, 0, 0, lines, n) == 0 &&
+           hl_viewport(&fresh, 0, fresh.nlines) >= 0;
+  free(lines);
+  if (!ok) {
+    fprintf(stderr, "%s: out of memory\n", name);
+  } else if (fresh.nlines != b->nlines) {
+    fprintf(stderr, "%s: %zu lines incrementally, %zu rebuilt\n", name,
+            b->nlines, fresh.nlines);
+    ok = 0;
+  }
+  for (size_t l = 0; ok && l < b->nlines; l++) {
+    const HlLine *x = &b->lines[l], *y = &fresh.lines[l];
+    if (x->anchor != y->anchor) {
+      fprintf(stderr, "%s: line %zu anchored at %u incrementally, %u rebuilt\n",
+              name, l + 1, x->anchor + 1, y->anchor + 1);
+      ok = 0;
+    } else if (x->valid &&
+               (x->count != y->count ||
+                (x->count &&
+                 memcmp(x->ranges, y->ranges, x->count * sizeof(HlRange))))) {
+      fprintf(stderr, "%s: line %zu has %u ranges incrementally, %u rebuilt\n",
+              name, l + 1, x->count, y->count);
+      ok = 0;
+    }
+  }
+  hl_free(&fresh);
+  return ok;
+}
+
+// Applies one random edit to line `at`; returns 0 or -1.
+static int edit(HlBuffer *b, size_t at, unsigned r) {
+  static const char *const pieces[] = {
+      "--[[", "]]", "[==[", "]==]", "/*", "*/", "\"", "'", "-- ", "//",
+      "\\", "#define X \\", " x = 1 ", " local ", " return ", "",
+  };
+  const size_t npieces = sizeof(pieces) / sizeof(pieces[0]);
+  char buf[4096];
+  const char *line = b->text + b->off[at];
+  size_t len = b->off[at + 1] - b->off[at] - 1;
+  if (len > sizeof(buf) / 2)
+    len = sizeof(buf) / 2;
+  size_t cut = len ? (r >> 4) % (len + 1) : 0;
+  const char *piece = pieces[(r >> 12) % npieces];
+  size_t plen = strlen(piece);
+  HlText texts[2];
+  switch (r % 4) {
+  case 0: // insert a piece into the line
+  case 1:
+    memcpy(buf, line, cut);
+    memcpy(buf + cut, piece, plen);
+    memcpy(buf + cut + plen, line + cut, len - cut);
+    texts[0] = (HlText){buf, len + plen};
+    return hl_set_lines(b, at, at + 1, texts, 1);
+  case 2: // split the line
+    memcpy(buf, line, len);
+    texts[0] = (HlText){buf, cut};
+    texts[1] = (HlText){buf + cut, len - cut};
+    return hl_set_lines(b, at, at + 1, texts, 2);
+  default: // delete the line, or join it with the next
+    if (at + 1 < b->nlines && (r & 0x100000)) {
+      size_t next = b->off[at + 2] - b->off[at + 1] - 1;
+      if (len + next > sizeof(buf))
+        next = sizeof(buf) - len;
+      memcpy(buf, line, len);
+      memcpy(buf + len, b->text + b->off[at + 1], next);
+      texts[0] = (HlText){buf, len + next};
+      return hl_set_lines(b, at, at + 2, texts, 1);
+    }
+    return hl_set_lines(b, at, at + 1, NULL, 0);
+  }
+}
+
+int main(int argc, char **argv) {
+  int edits = 2000, opt;
+  size_t min_lines = 0, height = 60;
+  while ((opt = getopt(argc, argv, "n:l:v:")) != -1) {
+    if (opt == 'n') {
+      edits = atoi(optarg);
+    } else if (opt == 'l') {
+      min_lines = (size_t)atol(optarg);
+    } else if (opt == 'v' && atol(optarg) > 0) {
+      height = (size_t)atol(optarg);
+    } else {
+      fprintf(stderr, "Usage: %s [-n edits] [-l lines] [-v height] file...\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  printf("%-24s %7s %9s %9s %9s %9s %9s %9s\n", "file", "lines", "open",
+         "first", "scroll", "edit", "view", "worst");
+  int bad = 0;
+  unsigned seed = 1;
+  for (int i = optind; i < argc; i++) {
+    const FlexLang *lang = flex_lang_for_path(argv[i]);
+    if (!lang)
+      continue;
+    size_t len, n;
+    char *src = read_file(argv[i], &len);
+    HlText *lines = src ? split_lines(src, len, min_lines, &n) : NULL;
+    if (!lines) {
+      perror(argv[i]);
+      free(src);
+      bad = 1;
+      continue;
+    }
+    HlBuffer b;
+    hl_init(&b, lang);
+    double t0 = now_ms();
+    int ok = hl_set_lines(&b, 0, 0, lines, n) == 0;
+    double t1 = now_ms();
+    ok = ok && hl_viewport(&b, 0, height) >= 0;
+    double t2 = now_ms();
+    free(lines);
+    free(src);
+
+    double edit_ms = 0, view_ms = 0, worst = 0, scroll = 0;
+    int jumps = 0;
+    size_t top = 0;
+    for (int e = 0; e < edits && ok && b.nlines > 1; e++) {
+      unsigned r = (seed = seed * 1103515245u + 12345u) >> 4;
+      if (e % 20 == 0) {
+        top = (seed >> 8) % b.nlines;
+        double s = now_ms();
+        ok = hl_viewport(&b, top, top + height) >= 0;
+        scroll += now_ms() - s;
+        jumps++;
+      }
+      size_t at = top + (seed >> 16) % height;
+      if (at >= b.nlines)
+        at = b.nlines - 1;
+      double s = now_ms();
+      ok = ok && edit(&b, at, r) == 0;
+      double m = now_ms();
+      ok = ok && hl_viewport(&b, top, top + height) >= 0;
+      double end = now_ms();
+      edit_ms += m - s;
+      view_ms += end - m;
+      if (end - s > worst)
+        worst = end - s;
+      if (ok && (e % 50 == 49 || e == edits - 1))
+        ok = check(&b, argv[i]);
+    }
+    bad |= !ok;
+    const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+    printf("%-24.24s %7zu %6.2f ms %6.3f ms %6.3f ms %6.3f ms %6.3f ms %6.2f ms"
+           "%s\n",
+           name, b.nlines, t1 - t0, t2 - t1, jumps ? scroll / jumps : 0,
+           edits ? edit_ms / edits : 0, edits ? view_ms / edits : 0, worst,
+           ok ? "" : "  MISMATCH");
+    hl_free(&b);
+  }
+  return bad;
+}
@@ -0,0 +1,511 @@
+/* ignore.h - .gitignore / .ignore matching for tree walks (single-header, C11)
+
+   Each ignore file is compiled once into three kinds of rules:
+
+     literal   "build/", "node_modules", "Makefile"     hash set of names
+     suffix    "*.o", "*.min.js"                        hash set of suffixes
+     glob      "src/gen_*", "[Bb]uild?", "a?c.txt"     backtracking matcher
+
+   so the common patterns cost one hash lookup per entry (plus one per '.'
+   in the name for suffixes) no matter how many of them there are, and only
+   the remaining globs are tried one by one.
+
+   Semantics follow gitignore(5): blank lines and '#' comments are skipped,
+   '!' re-includes, a trailing '/' matches directories only, a pattern with
+   a '/' anywhere but the end is anchored to the directory of its ignore
+   file (otherwise it matches the name at any depth), '*' and '?' do not
+   match '/', and "**" matches across directories. The last matching rule
+   wins, and rules from a deeper directory beat those of its parents.
+
+   A walker keeps an IgStack: it pushes the rules of each directory it
+   enters (ig_push_dir reads .gitignore and .ignore there), asks
+   ig_ignored() about every entry before descending into it, and pops on
+   the way out. Ignored directories are never opened.
+
+   Usage:
+
+     #define IGNORE_IMPLEMENTATION
+     #include "ignore.h"
+
+     IgStack ig;
+     ig_stack_init(&ig);
+     int pushed = ig_push_dir(&ig, "./src");         // rules for ./src/...
+     if (!ig_ignored(&ig, "./src/a.o", 9, 0)) ...    // 0 = not a directory
+     if (pushed)
+       ig_pop(&ig);
+     ig_stack_free(&ig);
+*/
+
+#ifndef IGNORE_H
+#define IGNORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+  IG_NEGATE = 1,   // "!pattern"
+  IG_DIR_ONLY = 2, // "pattern/"
+  IG_ANCHORED = 4, // matched against the path relative to the ignore file
+};
+
+typedef struct {
+  uint32_t off, len; // pattern text in the arena
+  uint32_t flags;
+} IgGlob;
+
+typedef struct {
+  uint64_t hash; // 0 = empty
+  uint32_t off, len;
+  int32_t rule;  // highest rule number with this key
+} IgKey;
+
+typedef struct {
+  IgKey *slots;
+  size_t cap, count;
+} IgSet;
+
+// The compiled rules of one directory. Rule numbers give file order;
+// `negate` tells whether rule i re-includes.
+typedef struct {
+  char *text;
+  size_t text_len, text_cap;
+  uint8_t *negate;
+  size_t nrules, rules_cap;
+  IgSet names, dir_names;       // literal basenames (any / directory only)
+  IgSet suffixes, dir_suffixes; // "*literal" basenames
+  IgGlob *globs;                // everything else, in rule order
+  int32_t *glob_rule;
+  size_t nglobs, globs_cap;
+} IgRules;
+
+typedef struct {
+  IgRules rules;
+  size_t base_len; // length of the directory's path, e.g. 5 for "./src"
+} IgLevel;
+
+typedef struct {
+  IgLevel *levels;
+  size_t depth, cap;
+} IgStack;
+
+void ig_rules_init(IgRules *r);
+void ig_rules_free(IgRules *r);
+// Compiles the lines of an ignore file, appending to `r` (later files
+// override earlier ones). Returns 0, or -1 if out of memory.
+int ig_rules_parse(IgRules *r, const char *text, size_t len);
+// Matches `rel` (path relative to the rules' directory; `name` is its last
+// component). Returns 1 ignored, -1 re-included by a '!' rule, 0 no match.
+int ig_rules_match(const IgRules *r, const char *rel, size_t rel_len,
+                   size_t name_off, int is_dir);
+
+void ig_stack_init(IgStack *s);
+void ig_stack_free(IgStack *s);
+// Reads the ignore files of directory `dir` (plus .git/info/exclude for the
+// first directory pushed) and pushes their rules. Returns 1 if a level was
+// pushed (pop it when leaving `dir`), 0 if there were no rules, -1 if out
+// of memory.
+int ig_push_dir(IgStack *s, const char *dir);
+void ig_pop(IgStack *s);
+// Whether `path` (which starts with the path of the first pushed directory)
+// is ignored. ".git" directories always are.
+int ig_ignored(const IgStack *s, const char *path, size_t len, int is_dir);
+
+// gitignore-style glob match; '*' and '?' never match '/'.
+int ig_glob(const char *pat, size_t plen, const char *str, size_t slen);
+
+#ifdef IGNORE_IMPLEMENTATION
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define IG_MAX_FILE (1 << 20)
+
+// --- Glob matching ---
+
+// Matches a bracket expression at p (just after '['); returns 1/0, or -1 if
+// the class is unterminated (then '[' is literal). *end receives the byte
+// after ']'.
+static int ig_class(const char *p, const char *pe, char c, const char **end) {
+  int negate = 0, found = 0;
+  if (p < pe && (*p == '!' || *p == '^')) {
+    negate = 1;
+    p++;
+  }
+  const char *first = p;
+  while (p < pe && (*p != ']' || p == first)) {
+    unsigned char lo = (unsigned char)*p, hi;
+    if (lo == '\\' && p + 1 < pe)
+      lo = (unsigned char)*++p;
+    p++;
+    hi = lo;
+    if (p + 1 < pe && *p == '-' && p[1] != ']') {
+      p++;
+      if (*p == '\\' && p + 1 < pe)
+        p++;
+      hi = (unsigned char)*p++;
+    }
+    if ((unsigned char)c >= lo && (unsigned char)c <= hi)
+      found = 1;
+  }
+  if (p >= pe)
+    return -1;
+  *end = p + 1;
+  return found != negate;
+}
+
+static int ig_match(const char *ps, const char *p, const char *pe,
+                    const char *s, const char *se) {
+  while (p < pe) {
+    char c = *p;
+    if (c == '*') {
+      if (p + 1 < pe && p[1] == '*' && (p == ps || p[-1] == '/') &&
+          (p + 2 == pe || p[2] == '/')) {
+        // "**" as a whole component: zero or more directories.
+        if (p + 2 == pe)
+          return 1;
+        p += 3;
+        for (;;) {
+          if (ig_match(ps, p, pe, s, se))
+            return 1;
+          const char *slash = memchr(s, '/', (size_t)(se - s));
+          if (!slash)
+            return 0;
+          s = slash + 1;
+        }
+      }
+      while (p < pe && *p == '*')
+        p++;
+      if (p == pe)
+        return memchr(s, '/', (size_t)(se - s)) == NULL;
+      for (;; s++) {
+        if (ig_match(ps, p, pe, s, se))
+          return 1;
+        if (s == se || *s == '/')
+          return 0;
+      }
+    }
+    if (s == se)
+      return 0;
+    if (c == '?') {
+      if (*s == '/')
+        return 0;
+    } else if (c == '[') {
+      const char *end;
+      int m = *s == '/' ? 0 : ig_class(p + 1, pe, *s, &end);
+      if (m == 0)
+        return 0;
+      if (m == 1) {
+        p = end;
+        s++;
+        continue;
+      }
+      if (*s != '[') // unterminated: a literal '['
+        return 0;
+    } else {
+      if (c == '\\' && p + 1 < pe)
+        c = *++p;
+      if (*s != c)
+        return 0;
+    }
+    p++;
+    s++;
+  }
+  return s == se;
+}
+
+int ig_glob(const char *pat, size_t plen, const char *str, size_t slen) {
+  return ig_match(pat, pat, pat + plen, str, str + slen);
+}
+
+// --- Key sets ---
+
+static uint64_t ig_hash(const char *s, size_t len) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < len; i++)
+    h = (h ^ (unsigned char)s[i]) * 0x100000001b3ull;
+  return h ? h : 1;
+}
+
+static IgKey *ig_set_find(const IgSet *set, const char *text, uint64_t h,
+                          const char *key, size_t len) {
+  size_t mask = set->cap - 1;
+  for (size_t i = h & mask;; i = (i + 1) & mask) {
+    IgKey *k = &set->slots[i];
+    if (k->hash == 0 ||
+        (k->hash == h && k->len == len && memcmp(text + k->off, key, len) == 0))
+      return k;
+  }
+}
+
+static int ig_set_put(IgSet *set, const char *text, uint32_t off,
+                      uint32_t len, int32_t rule) {
+  if ((set->count + 1) * 2 > set->cap) {
+    IgSet bigger = {calloc(set->cap ? set->cap * 2 : 16, sizeof(IgKey)),
+                    set->cap ? set->cap * 2 : 16, set->count};
+    if (!bigger.slots)
+      return -1;
+    for (size_t i = 0; i < set->cap; i++) {
+      IgKey *k = &set->slots[i];
+      if (k->hash)
+        *ig_set_find(&bigger, text, k->hash, text + k->off, k->len) = *k;
+    }
+    free(set->slots);
+    *set = bigger;
+  }
+  uint64_t h = ig_hash(text + off, len);
+  IgKey *k = ig_set_find(set, text, h, text + off, len);
+  if (!k->hash)
+    set->count++;
+  *k = (IgKey){h, off, len, rule};
+  return 0;
+}
+
+static int32_t ig_set_get(const IgSet *set, const char *text, const char *key,
+                          size_t len) {
+  if (!set->count)
+    return -1;
+  IgKey *k = ig_set_find(set, text, ig_hash(key, len), key, len);
+  return k->hash ? k->rule : -1;
+}
+
+// --- Compiling ---
+
+void ig_rules_init(IgRules *r) { memset(r, 0, sizeof(*r)); }
+
+void ig_rules_free(IgRules *r) {
+  free(r->text);
+  free(r->negate);
+  free(r->names.slots);
+  free(r->dir_names.slots);
+  free(r->suffixes.slots);
+  free(r->dir_suffixes.slots);
+  free(r->globs);
+  free(r->glob_rule);
+  memset(r, 0, sizeof(*r));
+}
+
+static int ig_has_meta(const char *s, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    if (s[i] == '*' || s[i] == '?' || s[i] == '[' || s[i] == '\\')
+      return 1;
+  return 0;
+}
+
+static int ig_add_rule(IgRules *r, const char *p, size_t len, int flags) {
+  if (r->nrules == r->rules_cap) {
+    size_t cap = r->rules_cap ? r->rules_cap * 2 : 32;
+    uint8_t *negate = realloc(r->negate, cap);
+    if (!negate)
+      return -1;
+    r->negate = negate;
+    r->rules_cap = cap;
+  }
+  if (r->text_len + len > r->text_cap) {
+    size_t cap = r->text_cap ? r->text_cap : 1024;
+    while (r->text_len + len > cap)
+      cap *= 2;
+    char *text = realloc(r->text, cap);
+    if (!text)
+      return -1;
+    r->text = text;
+    r->text_cap = cap;
+  }
+  int32_t rule = (int32_t)r->nrules;
+  uint32_t off = (uint32_t)r->text_len;
+  memcpy(r->text + off, p, len);
+  r->text_len += len;
+  r->negate[r->nrules++] = (flags & IG_NEGATE) != 0;
+
+  int dir_only = flags & IG_DIR_ONLY;
+  if (!(flags & IG_ANCHORED) && !ig_has_meta(p, len))
+    return ig_set_put(dir_only ? &r->dir_names : &r->names, r->text, off,
+                      (uint32_t)len, rule);
+  if (!(flags & IG_ANCHORED) && len > 1 && p[0] == '*' &&
+      !ig_has_meta(p + 1, len - 1))
+    return ig_set_put(dir_only ? &r->dir_suffixes : &r->suffixes, r->text,
+                      off + 1, (uint32_t)len - 1, rule);
+
+  if (r->nglobs == r->globs_cap) {
+    size_t cap = r->globs_cap ? r->globs_cap * 2 : 16;
+    IgGlob *globs = realloc(r->globs, cap * sizeof(*globs));
+    if (globs)
+      r->globs = globs;
+    int32_t *glob_rule = realloc(r->glob_rule, cap * sizeof(*glob_rule));
+    if (glob_rule)
+      r->glob_rule = glob_rule;
+    if (!globs || !glob_rule)
+      return -1;
+    r->globs_cap = cap;
+  }
+  r->globs[r->nglobs] = (IgGlob){off, (uint32_t)len, (uint32_t)flags};
+  r->glob_rule[r->nglobs++] = rule;
+  return 0;
+}
+
+int ig_rules_parse(IgRules *r, const char *text, size_t len) {
+  const char *end = text + len;
+  while (text < end) {
+    const char *nl = memchr(text, '\n', (size_t)(end - text));
+    const char *p = text, *pe = nl ? nl : end;
+    text = nl ? nl + 1 : end;
+    if (pe > p && pe[-1] == '\r')
+      pe--;
+    // Trailing spaces are dropped unless escaped.
+    while (pe > p && pe[-1] == ' ' && !(pe - 1 > p && pe[-2] == '\\'))
+      pe--;
+    if (p == pe || *p == '#')
+      continue;
+
+    int flags = 0;
+    if (*p == '!') {
+      flags |= IG_NEGATE;
+      p++;
+    } else if (*p == '\\' && pe - p > 1 && (p[1] == '!' || p[1] == '#')) {
+      p++;
+    }
+    if (pe > p && pe[-1] == '/') {
+      flags |= IG_DIR_ONLY;
+      pe--;
+    }
+    if (p == pe)
+      continue;
+    if (memchr(p, '/', (size_t)(pe - p)))
+      flags |= IG_ANCHORED;
+    if (*p == '/')
+      p++;
+    // "**/name" is just "name" at any depth.
+    if (pe - p > 3 && memcmp(p, "**/", 3) == 0 &&
+        !memchr(p + 3, '/', (size_t)(pe - p - 3))) {
+      p += 3;
+      flags &= ~IG_ANCHORED;
+    }
+    if (p < pe && ig_add_rule(r, p, (size_t)(pe - p), flags) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+int ig_rules_match(const IgRules *r, const char *rel, size_t rel_len,
+                   size_t name_off, int is_dir) {
+  const char *name = rel + name_off;
+  size_t nlen = rel_len - name_off;
+  int32_t best = ig_set_get(&r->names, r->text, name, nlen), k;
+  if (is_dir && (k = ig_set_get(&r->dir_names, r->text, name, nlen)) > best)
+    best = k;
+  if (r->suffixes.count || (is_dir && r->dir_suffixes.count)) {
+    // Every suffix of the name is a candidate key; most names are short.
+    for (size_t i = 0; i < nlen; i++) {
+      if ((k = ig_set_get(&r->suffixes, r->text, name + i, nlen - i)) > best)
+        best = k;
+      if (is_dir &&
+          (k = ig_set_get(&r->dir_suffixes, r->text, name + i, nlen - i)) >
+              best)
+        best = k;
+    }
+  }
+  // Globs in reverse rule order: the first hit is the last matching glob.
+  for (size_t g = r->nglobs; g-- > 0 && r->glob_rule[g] > best;) {
+    const IgGlob *gl = &r->globs[g];
+    if ((gl->flags & IG_DIR_ONLY) && !is_dir)
+      continue;
+    int m = gl->flags & IG_ANCHORED
+                ? ig_glob(r->text + gl->off, gl->len, rel, rel_len)
+                : ig_glob(r->text + gl->off, gl->len, name, nlen);
+    if (m) {
+      best = r->glob_rule[g];
+      break;
+    }
+  }
+  if (best < 0)
+    return 0;
+  return r->negate[best] ? -1 : 1;
+}
+
+// --- Directory stack ---
+
+void ig_stack_init(IgStack *s) { memset(s, 0, sizeof(*s)); }
+
+void ig_stack_free(IgStack *s) {
+  while (s->depth)
+    ig_pop(s);
+  free(s->levels);
+  memset(s, 0, sizeof(*s));
+}
+
+void ig_pop(IgStack *s) { ig_rules_free(&s->levels[--s->depth].rules); }
+
+// Appends the rules of `dir`/`name`, if that file exists and is readable.
+static int ig_load(IgRules *r, const char *dir, const char *name) {
+  char path[4096];
+  if ((size_t)snprintf(path, sizeof(path), "%s/%s", dir, name) >= sizeof(path))
+    return 0;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  char *buf = NULL;
+  int rc = 0;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+      st.st_size <= IG_MAX_FILE) {
+    buf = malloc((size_t)st.st_size);
+    ssize_t n = buf ? read(fd, buf, (size_t)st.st_size) : -1;
+    if (!buf)
+      rc = -1;
+    else if (n > 0)
+      rc = ig_rules_parse(r, buf, (size_t)n);
+  }
+  free(buf);
+  close(fd);
+  return rc;
+}
+
+int ig_push_dir(IgStack *s, const char *dir) {
+  IgRules r;
+  ig_rules_init(&r);
+  if ((s->depth == 0 && ig_load(&r, dir, ".git/info/exclude") != 0) ||
+      ig_load(&r, dir, ".gitignore") != 0 || ig_load(&r, dir, ".ignore") != 0) {
+    ig_rules_free(&r);
+    return -1;
+  }
+  if (r.nrules == 0) {
+    ig_rules_free(&r);
+    return 0;
+  }
+  if (s->depth == s->cap) {
+    size_t cap = s->cap ? s->cap * 2 : 16;
+    IgLevel *levels = realloc(s->levels, cap * sizeof(*levels));
+    if (!levels) {
+      ig_rules_free(&r);
+      return -1;
+    }
+    s->levels = levels;
+    s->cap = cap;
+  }
+  s->levels[s->depth++] = (IgLevel){r, strlen(dir)};
+  return 1;
+}
+
+int ig_ignored(const IgStack *s, const char *path, size_t len, int is_dir) {
+  size_t name_off = len;
+  while (name_off > 0 && path[name_off - 1] != '/')
+    name_off--;
+  if (is_dir && len - name_off == 4 && memcmp(path + name_off, ".git", 4) == 0)
+    return 1;
+  for (size_t d = s->depth; d-- > 0;) {
+    const IgLevel *lv = &s->levels[d];
+    if (lv->base_len + 1 > name_off)
+      continue;
+    const char *rel = path + lv->base_len + 1;
+    int m = ig_rules_match(&lv->rules, rel, len - lv->base_len - 1,
+                           name_off - lv->base_len - 1, is_dir);
+    if (m)
+      return m > 0;
+  }
+  return 0;
+}
+
+#endif // IGNORE_IMPLEMENTATION
+#endif // IGNORE_H
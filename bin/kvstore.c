@@ -0,0 +1,251 @@
+// Key-value store backend speaking msgpack over stdio.
+//
+//   gcc -O2 -pthread -o kvstore kvstore.c $(pkg-config --cflags --libs msgpack)
+//   ./kvstore [-d dir]
+//
+// Each request on stdin is a msgpack array; keys and values are str or bin:
+//
+//   ["get", key]         -> {"value": bin}  or {"value": nil}
+//   ["put", key, value]  -> {"ok": true}
+//   ["del", key]         -> {"ok": true|false}   (false: key did not exist)
+//   ["keys", prefix]     -> {"keys": [bin, ...]}
+//   ["sync"]             -> {"ok": true}   fsync + snapshot
+//   ["compact"]          -> {"ok": true}   starts a background compaction
+//
+// Replies are written in request order; a malformed request gets
+// {"error": message}. All requests already buffered are answered with one
+// write. The store is closed (and its snapshot written) on EOF.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <msgpack.h>
+#include <signal.h>
+
+#define KVSTORE_IMPLEMENTATION
+#include "kvstore.h"
+
+#define READ_CHUNK (64 * 1024)
+
+static KvStore store;
+static msgpack_sbuffer out_buf;
+static msgpack_packer out_pk;
+
+static int write_all(const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void pack_str(msgpack_packer *pk, const char *s) {
+    size_t len = strlen(s);
+    msgpack_pack_str(pk, len);
+    msgpack_pack_str_body(pk, s, len);
+}
+
+static void reply_error(const char *msg) {
+    msgpack_pack_map(&out_pk, 1);
+    pack_str(&out_pk, "error");
+    pack_str(&out_pk, msg);
+}
+
+static void reply_ok(int ok) {
+    msgpack_pack_map(&out_pk, 1);
+    pack_str(&out_pk, "ok");
+    if (ok) {
+        msgpack_pack_true(&out_pk);
+    } else {
+        msgpack_pack_false(&out_pk);
+    }
+}
+
+// Key or value bytes of a str/bin object; returns -1 for any other type.
+static int object_bytes(const msgpack_object *o, const char **data, uint32_t *len) {
+    if (o->type == MSGPACK_OBJECT_STR) {
+        *data = o->via.str.ptr;
+        *len = o->via.str.size;
+    } else if (o->type == MSGPACK_OBJECT_BIN) {
+        *data = o->via.bin.ptr;
+        *len = o->via.bin.size;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    const char *prefix;
+    uint32_t len;
+    size_t count;
+    int pack; // second pass: pack the matches
+} KeyScan;
+
+static int scan_key(void *ud, const void *key, uint32_t klen, const void *val, uint32_t vlen) {
+    KeyScan *scan = ud;
+    (void)val;
+    (void)vlen;
+    if (klen < scan->len || memcmp(key, scan->prefix, scan->len) != 0) {
+        return 0;
+    }
+    if (scan->pack) {
+        msgpack_pack_bin(&out_pk, klen);
+        msgpack_pack_bin_body(&out_pk, key, klen);
+    }
+    scan->count++;
+    return 0;
+}
+
+static void handle_request(const msgpack_object *req) {
+    if (req->type != MSGPACK_OBJECT_ARRAY || req->via.array.size == 0 ||
+        req->via.array.ptr[0].type != MSGPACK_OBJECT_STR) {
+        reply_error("request must be [command, args...]");
+        return;
+    }
+    const msgpack_object *args = req->via.array.ptr + 1;
+    uint32_t nargs = req->via.array.size - 1;
+    const msgpack_object_str *cmd = &req->via.array.ptr[0].via.str;
+    const char *key = NULL, *val = NULL;
+    uint32_t klen = 0, vlen = 0;
+    if (nargs >= 1 && object_bytes(&args[0], &key, &klen) != 0) {
+        reply_error("key must be str or bin");
+        return;
+    }
+
+#define IS(name) (cmd->size == sizeof(name) - 1 && memcmp(cmd->ptr, name, cmd->size) == 0)
+    if (IS("get") && nargs == 1) {
+        const void *v = kv_get(&store, key, klen, &vlen);
+        msgpack_pack_map(&out_pk, 1);
+        pack_str(&out_pk, "value");
+        if (v) {
+            msgpack_pack_bin(&out_pk, vlen);
+            msgpack_pack_bin_body(&out_pk, v, vlen);
+        } else {
+            msgpack_pack_nil(&out_pk);
+        }
+    } else if (IS("put") && nargs == 2) {
+        if (object_bytes(&args[1], &val, &vlen) != 0) {
+            reply_error("value must be str or bin");
+        } else if (kv_put(&store, key, klen, val, vlen) != 0) {
+            reply_error(strerror(errno));
+        } else {
+            reply_ok(1);
+        }
+    } else if (IS("del") && nargs == 1) {
+        int rc = kv_del(&store, key, klen);
+        if (rc < 0) {
+            reply_error(strerror(errno));
+        } else {
+            reply_ok(rc);
+        }
+    } else if (IS("keys") && nargs <= 1) {
+        KeyScan scan = {key, klen, 0, 0};
+        kv_foreach(&store, scan_key, &scan);
+        msgpack_pack_map(&out_pk, 1);
+        pack_str(&out_pk, "keys");
+        msgpack_pack_array(&out_pk, scan.count);
+        scan.pack = 1;
+        kv_foreach(&store, scan_key, &scan);
+    } else if (IS("sync") && nargs == 0) {
+        if (kv_sync(&store) != 0) {
+            reply_error(strerror(errno));
+        } else {
+            reply_ok(1);
+        }
+    } else if (IS("compact") && nargs == 0) {
+        if (kv_compact(&store) != 0) {
+            reply_error(strerror(errno));
+        } else {
+            reply_ok(1);
+        }
+    } else {
+        reply_error("unknown command or wrong number of arguments");
+    }
+#undef IS
+}
+
+int main(int argc, char **argv) {
+    const char *dir = ".kvstore";
+    int opt;
+    while ((opt = getopt(argc, argv, "d:")) != -1) {
+        switch (opt) {
+        case 'd':
+            dir = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-d dir]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (kv_open(&store, dir) != 0) {
+        fprintf(stderr, "kvstore: %s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    msgpack_sbuffer_init(&out_buf);
+    msgpack_packer_init(&out_pk, &out_buf, msgpack_sbuffer_write);
+
+    msgpack_unpacker unpacker;
+    msgpack_unpacked req;
+    if (!msgpack_unpacker_init(&unpacker, READ_CHUNK)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    msgpack_unpacked_init(&req);
+
+    int rc = 0;
+    for (;;) {
+        if (!msgpack_unpacker_reserve_buffer(&unpacker, READ_CHUNK)) {
+            fprintf(stderr, "Out of memory\n");
+            rc = 1;
+            break;
+        }
+        ssize_t n = read(STDIN_FILENO, msgpack_unpacker_buffer(&unpacker), READ_CHUNK);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        msgpack_unpacker_buffer_consumed(&unpacker, (size_t)n);
+
+        msgpack_unpack_return ret;
+        while ((ret = msgpack_unpacker_next(&unpacker, &req)) == MSGPACK_UNPACK_SUCCESS) {
+            handle_request(&req.data);
+        }
+        if (ret == MSGPACK_UNPACK_PARSE_ERROR) {
+            reply_error("malformed msgpack");
+        }
+        // Between batches: finalize a finished compaction, or start one
+        // when most of the log is garbage.
+        int failed = out_buf.size && write_all(out_buf.data, out_buf.size) != 0;
+        msgpack_sbuffer_clear(&out_buf);
+        if (kv_poll(&store) != 0) {
+            fprintf(stderr, "kvstore: compaction failed: %s\n", strerror(errno));
+        }
+        if (failed || ret == MSGPACK_UNPACK_PARSE_ERROR) {
+            rc = failed ? 1 : rc;
+            break;
+        }
+    }
+
+    msgpack_unpacked_destroy(&req);
+    msgpack_unpacker_destroy(&unpacker);
+    msgpack_sbuffer_destroy(&out_buf);
+    if (kv_close(&store) != 0) {
+        fprintf(stderr, "kvstore: %s: %s\n", dir, strerror(errno));
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,759 @@
+/* kvstore.h - embedded key-value store (single-header, C11 + POSIX)
+
+   A store is a directory holding two files:
+
+     log       append-only records, read back through a shared mmap
+     snapshot  the in-memory hash index as of some log offset
+
+   Every put/del appends one record:
+
+     u32 crc   CRC-32 of everything after it
+     u32 klen
+     u32 vlen  KV_TOMBSTONE for a delete
+     key bytes, value bytes
+
+   The index is an open-addressing table (linear probing, backward-shift
+   deletion) of {hash, offset, klen, vlen}; a lookup hashes the key, probes,
+   and compares the key bytes in the mapping, so a hit is one table probe
+   and one memcmp. Opening loads the snapshot into the table with a single
+   read and replays only the log written after it, so startup depends on
+   the number of live keys, not on how much history the log holds. A torn
+   record at the end of the log (crash mid-append) is cut off on open.
+
+   Compaction rewrites only the live records into a new log on a
+   background thread while the store keeps serving reads and writes; writes
+   made in the meantime are copied over when kv_poll() finalizes it. The
+   new log is fsync'd and then renamed over the old one, and the snapshot
+   is rewritten last. A crash at any point leaves either the old log or the
+   complete new one, and a snapshot that does not match the log's
+   generation is ignored.
+
+   Writes are not fsync'd individually; call kv_sync() for durability.
+   Pointers returned by kv_get() stay valid until the next call that
+   modifies the store (kv_put, kv_del, kv_poll, kv_compact, kv_close).
+
+   Usage:
+
+     #define KVSTORE_IMPLEMENTATION
+     #include "kvstore.h"
+
+     KvStore kv;
+     if (kv_open(&kv, "state/mru") != 0) ...
+     kv_put(&kv, "last", 4, "init.lua", 8);
+     uint32_t len;
+     const char *v = kv_get(&kv, "last", 4, &len);
+     kv_close(&kv);
+*/
+
+#ifndef KVSTORE_H
+#define KVSTORE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define KV_TOMBSTONE UINT32_MAX
+#define KV_MAX_KEY (64u * 1024)
+#define KV_MAX_VALUE (256u * 1024 * 1024)
+
+typedef struct {
+  uint64_t hash; // 0 = empty slot
+  uint64_t off;  // record offset in the log
+  uint32_t klen, vlen;
+} KvSlot;
+
+typedef struct {
+  KvSlot *slots;
+  size_t cap; // power of two
+  size_t count;
+} KvTable;
+
+typedef struct KvCompaction KvCompaction;
+
+typedef struct {
+  char *dir;
+  int fd;                // log, opened for append
+  uint64_t generation;   // bumped by every compaction
+  const uint8_t *map;    // shared read-only mapping of the log
+  size_t map_len;        // bytes mapped (may exceed log_len)
+  size_t log_len;        // bytes of valid records, header included
+  size_t dead_bytes;     // overwritten or deleted records in the log
+  KvTable table;
+  KvCompaction *compaction; // running background compaction, if any
+} KvStore;
+
+// Returns 0, or -1 with errno set.
+int kv_open(KvStore *kv, const char *dir);
+// Finishes any compaction, writes the snapshot and releases everything.
+int kv_close(KvStore *kv);
+
+const void *kv_get(KvStore *kv, const void *key, uint32_t klen,
+                   uint32_t *vlen);
+int kv_put(KvStore *kv, const void *key, uint32_t klen, const void *val,
+           uint32_t vlen);
+// Returns 1 if the key existed, 0 if not, -1 on error.
+int kv_del(KvStore *kv, const void *key, uint32_t klen);
+
+// Calls fn for every live key/value (in table order); stop early by
+// returning non-zero.
+void kv_foreach(KvStore *kv,
+                int (*fn)(void *ud, const void *key, uint32_t klen,
+                          const void *val, uint32_t vlen),
+                void *ud);
+
+// fsyncs the log and rewrites the snapshot.
+int kv_sync(KvStore *kv);
+// Starts a background compaction (no-op if one is running).
+int kv_compact(KvStore *kv);
+// Starts a compaction when more than half of the log is dead, and
+// finalizes a finished one. Cheap; call it between requests.
+int kv_poll(KvStore *kv);
+
+#ifdef KVSTORE_IMPLEMENTATION
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define KV_LOG_MAGIC "KVLOG001"
+#define KV_SNAP_MAGIC "KVSNAP01"
+#define KV_LOG_HEADER 16 // magic + u64 generation
+#define KV_REC_HEADER 12
+#define KV_MIN_MAP (1u << 20)
+#define KV_COMPACT_MIN (1u << 20)
+
+struct KvCompaction {
+  pthread_t thread;
+  atomic_int done;
+  int err;
+  int src_fd;      // the old log, read through its own mapping
+  size_t upto;     // old log bytes covered by `table`
+  int dst_fd;      // the new log
+  size_t dst_len;
+  uint64_t generation;
+  KvTable table;   // copy of the index, offsets rewritten for the new log
+  char *dst_path;
+};
+
+// --- Helpers ---
+
+static uint32_t kv_crc_table[256];
+static pthread_once_t kv_crc_once = PTHREAD_ONCE_INIT;
+
+static void kv_crc_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++)
+      c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    kv_crc_table[i] = c;
+  }
+}
+
+static uint32_t kv_crc(uint32_t crc, const void *data, size_t len) {
+  const uint8_t *p = data;
+  crc = ~crc;
+  while (len--)
+    crc = kv_crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+// FNV-1a with a final avalanche; never returns 0 (the empty-slot marker).
+static uint64_t kv_hash(const void *key, uint32_t len) {
+  const uint8_t *p = key;
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (uint32_t i = 0; i < len; i++)
+    h = (h ^ p[i]) * 0x100000001b3ull;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return h ? h : 1;
+}
+
+static char *kv_path(const char *dir, const char *name) {
+  size_t n = strlen(dir) + strlen(name) + 2;
+  char *p = malloc(n);
+  if (p)
+    snprintf(p, n, "%s/%s", dir, name);
+  return p;
+}
+
+static size_t kv_rec_size(uint32_t klen, uint32_t vlen) {
+  return KV_REC_HEADER + klen + (vlen == KV_TOMBSTONE ? 0 : vlen);
+}
+
+static int kv_write_full(int fd, const void *buf, size_t len, off_t off) {
+  const uint8_t *p = buf;
+  while (len > 0) {
+    ssize_t n = pwrite(fd, p, len, off);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    p += n;
+    off += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+// --- Hash table ---
+
+static int kv_table_init(KvTable *t, size_t cap) {
+  t->slots = calloc(cap, sizeof(KvSlot));
+  t->cap = cap;
+  t->count = 0;
+  return t->slots ? 0 : -1;
+}
+
+// Slot holding `key`, or the empty slot where it would go.
+static KvSlot *kv_table_find(const KvTable *t, const uint8_t *log,
+                             uint64_t h, const void *key, uint32_t klen) {
+  size_t mask = t->cap - 1;
+  for (size_t i = h & mask;; i = (i + 1) & mask) {
+    KvSlot *s = &t->slots[i];
+    if (s->hash == 0)
+      return s;
+    if (s->hash == h && s->klen == klen &&
+        memcmp(log + s->off + KV_REC_HEADER, key, klen) == 0)
+      return s;
+  }
+}
+
+static int kv_table_grow(KvTable *t) {
+  KvTable bigger;
+  if (kv_table_init(&bigger, t->cap * 2) != 0)
+    return -1;
+  size_t mask = bigger.cap - 1;
+  for (size_t i = 0; i < t->cap; i++) {
+    KvSlot *s = &t->slots[i];
+    if (s->hash == 0)
+      continue;
+    size_t j = s->hash & mask;
+    while (bigger.slots[j].hash != 0)
+      j = (j + 1) & mask;
+    bigger.slots[j] = *s;
+  }
+  bigger.count = t->count;
+  free(t->slots);
+  *t = bigger;
+  return 0;
+}
+
+// Empties `s` and shifts later members of its probe run back so lookups
+// never need tombstones.
+static void kv_table_remove(KvTable *t, KvSlot *s) {
+  size_t mask = t->cap - 1;
+  size_t i = (size_t)(s - t->slots), j = i;
+  for (;;) {
+    t->slots[i].hash = 0;
+    for (;;) {
+      j = (j + 1) & mask;
+      if (t->slots[j].hash == 0) {
+        t->count--;
+        return;
+      }
+      size_t home = t->slots[j].hash & mask;
+      // Move j into the hole at i unless its home lies in (i, j].
+      if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+        break;
+    }
+    t->slots[i] = t->slots[j];
+    i = j;
+  }
+}
+
+// Records that the record at `off` sets (or, as a tombstone, deletes) its
+// key. `log` must already contain the record. Returns the size of the record
+// it supersedes (0 if none), or -1 if out of memory.
+static long kv_table_apply(KvTable *t, const uint8_t *log, uint64_t off) {
+  const uint8_t *rec = log + off;
+  uint32_t klen, vlen;
+  memcpy(&klen, rec + 4, 4);
+  memcpy(&vlen, rec + 8, 4);
+  uint64_t h = kv_hash(rec + KV_REC_HEADER, klen);
+
+  if ((t->count + 1) * 10 > t->cap * 7 && kv_table_grow(t) != 0)
+    return -1;
+  KvSlot *s = kv_table_find(t, log, h, rec + KV_REC_HEADER, klen);
+  long old = s->hash ? (long)kv_rec_size(s->klen, s->vlen) : 0;
+  if (vlen == KV_TOMBSTONE) {
+    if (s->hash)
+      kv_table_remove(t, s);
+    return old;
+  }
+  if (!s->hash)
+    t->count++;
+  *s = (KvSlot){h, off, klen, vlen};
+  return old;
+}
+
+// --- Log ---
+
+// Makes sure the mapping covers [0, need).
+static int kv_map(KvStore *kv, size_t need) {
+  if (kv->map && need <= kv->map_len)
+    return 0;
+  size_t len = kv->map_len ? kv->map_len : KV_MIN_MAP;
+  while (len < need)
+    len *= 2;
+  void *m = mmap(NULL, len, PROT_READ, MAP_SHARED, kv->fd, 0);
+  if (m == MAP_FAILED)
+    return -1;
+  if (kv->map)
+    munmap((void *)kv->map, kv->map_len);
+  kv->map = m;
+  kv->map_len = len;
+  return 0;
+}
+
+// Size of the well-formed record at `off` in a log of `len` bytes, or 0.
+static size_t kv_rec_check(const uint8_t *log, size_t len, size_t off) {
+  if (len - off < KV_REC_HEADER)
+    return 0;
+  uint32_t crc, klen, vlen;
+  memcpy(&crc, log + off, 4);
+  memcpy(&klen, log + off + 4, 4);
+  memcpy(&vlen, log + off + 8, 4);
+  if (klen > KV_MAX_KEY || (vlen != KV_TOMBSTONE && vlen > KV_MAX_VALUE))
+    return 0;
+  size_t size = kv_rec_size(klen, vlen);
+  if (len - off < size || kv_crc(0, log + off + 4, size - 4) != crc)
+    return 0;
+  return size;
+}
+
+// Replays records from `from` to the end of the file into the table and
+// truncates a torn tail.
+static int kv_replay(KvStore *kv, size_t from, size_t file_len) {
+  if (kv_map(kv, file_len) != 0)
+    return -1;
+  size_t off = from, size;
+  while (off < file_len && (size = kv_rec_check(kv->map, file_len, off))) {
+    long old = kv_table_apply(&kv->table, kv->map, off);
+    if (old < 0)
+      return -1;
+    kv->dead_bytes += (size_t)old;
+    uint32_t vlen;
+    memcpy(&vlen, kv->map + off + 8, 4);
+    if (vlen == KV_TOMBSTONE)
+      kv->dead_bytes += size;
+    off += size;
+  }
+  if (off < file_len && ftruncate(kv->fd, (off_t)off) != 0)
+    return -1;
+  kv->log_len = off;
+  return 0;
+}
+
+// --- Snapshot ---
+//
+//   magic[8] u64 generation u64 log_len u64 dead_bytes u64 cap u64 count
+//   KvSlot slots[cap]   u32 crc (of the slots)
+
+static int kv_snapshot_write(KvStore *kv) {
+  char *path = kv_path(kv->dir, "snapshot"), *tmp = kv_path(kv->dir, "snapshot.tmp");
+  int rc = -1, fd = -1;
+  if (!path || !tmp)
+    goto done;
+  fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    goto done;
+  uint64_t head[5] = {kv->generation, kv->log_len, kv->dead_bytes,
+                      kv->table.cap, kv->table.count};
+  size_t slots_len = kv->table.cap * sizeof(KvSlot);
+  uint32_t crc = kv_crc(0, kv->table.slots, slots_len);
+  if (kv_write_full(fd, KV_SNAP_MAGIC, 8, 0) != 0 ||
+      kv_write_full(fd, head, sizeof(head), 8) != 0 ||
+      kv_write_full(fd, kv->table.slots, slots_len, 48) != 0 ||
+      kv_write_full(fd, &crc, 4, (off_t)(48 + slots_len)) != 0 ||
+      fsync(fd) != 0 || rename(tmp, path) != 0)
+    goto done;
+  rc = 0;
+done:
+  if (fd >= 0)
+    close(fd);
+  if (rc != 0 && tmp)
+    unlink(tmp);
+  free(path);
+  free(tmp);
+  return rc;
+}
+
+// Loads the snapshot if it matches the log; returns the log offset it
+// covers, or 0 if there is no usable snapshot.
+static size_t kv_snapshot_load(KvStore *kv, size_t file_len) {
+  char *path = kv_path(kv->dir, "snapshot");
+  int fd = path ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+  free(path);
+  if (fd < 0)
+    return 0;
+
+  char magic[8];
+  uint64_t head[5];
+  size_t covered = 0;
+  KvTable t = {0};
+  if (pread(fd, magic, 8, 0) != 8 || memcmp(magic, KV_SNAP_MAGIC, 8) != 0 ||
+      pread(fd, head, sizeof(head), 8) != (ssize_t)sizeof(head) ||
+      head[0] != kv->generation || head[1] > file_len ||
+      head[1] < KV_LOG_HEADER || head[3] == 0 ||
+      (head[3] & (head[3] - 1)) != 0 || head[4] >= head[3])
+    goto done;
+  size_t slots_len = head[3] * sizeof(KvSlot);
+  uint32_t crc;
+  t.slots = malloc(slots_len);
+  if (!t.slots ||
+      pread(fd, t.slots, slots_len, 48) != (ssize_t)slots_len ||
+      pread(fd, &crc, 4, (off_t)(48 + slots_len)) != 4 ||
+      kv_crc(0, t.slots, slots_len) != crc)
+    goto done;
+  t.cap = head[3];
+  t.count = head[4];
+  free(kv->table.slots);
+  kv->table = t;
+  t.slots = NULL;
+  kv->dead_bytes = head[2];
+  covered = head[1];
+done:
+  free(t.slots);
+  close(fd);
+  return covered;
+}
+
+// --- Open / close ---
+
+int kv_open(KvStore *kv, const char *dir) {
+  pthread_once(&kv_crc_once, kv_crc_init);
+  memset(kv, 0, sizeof(*kv));
+  kv->fd = -1;
+  kv->dir = strdup(dir);
+  char *path = kv->dir ? kv_path(dir, "log") : NULL;
+  char *stale = kv->dir ? kv_path(dir, "log.compact") : NULL;
+  struct stat st;
+  int saved;
+
+  if (!path || !stale || (mkdir(dir, 0755) != 0 && errno != EEXIST))
+    goto fail;
+  unlink(stale); // an unfinished compaction
+  kv->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (kv->fd < 0 || fstat(kv->fd, &st) != 0)
+    goto fail;
+
+  uint8_t head[KV_LOG_HEADER];
+  if (st.st_size < KV_LOG_HEADER) {
+    kv->generation = 1;
+    memcpy(head, KV_LOG_MAGIC, 8);
+    memcpy(head + 8, &kv->generation, 8);
+    if (ftruncate(kv->fd, 0) != 0 ||
+        kv_write_full(kv->fd, head, sizeof(head), 0) != 0)
+      goto fail;
+    st.st_size = KV_LOG_HEADER;
+  } else if (pread(kv->fd, head, sizeof(head), 0) != sizeof(head) ||
+             memcmp(head, KV_LOG_MAGIC, 8) != 0) {
+    errno = EINVAL;
+    goto fail;
+  } else {
+    memcpy(&kv->generation, head + 8, 8);
+  }
+
+  if (kv_table_init(&kv->table, 1024) != 0)
+    goto fail;
+  size_t from = kv_snapshot_load(kv, (size_t)st.st_size);
+  if (kv_replay(kv, from ? from : KV_LOG_HEADER, (size_t)st.st_size) != 0)
+    goto fail;
+  free(path);
+  free(stale);
+  return 0;
+
+fail:
+  saved = errno;
+  free(path);
+  free(stale);
+  if (kv->map)
+    munmap((void *)kv->map, kv->map_len);
+  if (kv->fd >= 0)
+    close(kv->fd);
+  free(kv->table.slots);
+  free(kv->dir);
+  memset(kv, 0, sizeof(*kv));
+  errno = saved;
+  return -1;
+}
+
+static int kv_compact_finish(KvStore *kv);
+
+int kv_close(KvStore *kv) {
+  int rc = 0;
+  if (kv->compaction && kv_compact_finish(kv) != 0)
+    rc = -1;
+  if (kv_sync(kv) != 0)
+    rc = -1;
+  munmap((void *)kv->map, kv->map_len);
+  close(kv->fd);
+  free(kv->table.slots);
+  free(kv->dir);
+  memset(kv, 0, sizeof(*kv));
+  return rc;
+}
+
+// --- Operations ---
+
+const void *kv_get(KvStore *kv, const void *key, uint32_t klen,
+                   uint32_t *vlen) {
+  KvSlot *s = kv_table_find(&kv->table, kv->map, kv_hash(key, klen), key,
+                            klen);
+  if (!s->hash)
+    return NULL;
+  if (vlen)
+    *vlen = s->vlen;
+  return kv->map + s->off + KV_REC_HEADER + s->klen;
+}
+
+static int kv_append(KvStore *kv, const void *key, uint32_t klen,
+                     const void *val, uint32_t vlen) {
+  if (klen > KV_MAX_KEY || (vlen != KV_TOMBSTONE && vlen > KV_MAX_VALUE)) {
+    errno = EINVAL;
+    return -1;
+  }
+  uint32_t head[3] = {0, klen, vlen};
+  uint32_t vbytes = vlen == KV_TOMBSTONE ? 0 : vlen;
+  head[0] = kv_crc(kv_crc(kv_crc(0, &head[1], 8), key, klen), val, vbytes);
+
+  struct iovec iov[3] = {{head, sizeof(head)},
+                         {(void *)key, klen},
+                         {(void *)val, vbytes}};
+  size_t size = kv_rec_size(klen, vlen), done = 0;
+  while (done < size) {
+    ssize_t n = pwritev(kv->fd, iov, 3, (off_t)(kv->log_len + done));
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    done += (size_t)n;
+    // Skip what was written (short writes are rare but legal).
+    size_t skip = (size_t)n;
+    for (int i = 0; i < 3; i++) {
+      size_t take = skip < iov[i].iov_len ? skip : iov[i].iov_len;
+      iov[i].iov_base = (char *)iov[i].iov_base + take;
+      iov[i].iov_len -= take;
+      skip -= take;
+    }
+  }
+  if (kv_map(kv, kv->log_len + size) != 0)
+    return -1;
+  long old = kv_table_apply(&kv->table, kv->map, kv->log_len);
+  if (old < 0)
+    return -1;
+  kv->dead_bytes += (size_t)old + (vlen == KV_TOMBSTONE ? size : 0);
+  kv->log_len += size;
+  return 0;
+}
+
+int kv_put(KvStore *kv, const void *key, uint32_t klen, const void *val,
+           uint32_t vlen) {
+  return kv_append(kv, key, klen, val, vlen);
+}
+
+int kv_del(KvStore *kv, const void *key, uint32_t klen) {
+  if (!kv_get(kv, key, klen, NULL))
+    return 0;
+  return kv_append(kv, key, klen, "", KV_TOMBSTONE) == 0 ? 1 : -1;
+}
+
+void kv_foreach(KvStore *kv,
+                int (*fn)(void *ud, const void *key, uint32_t klen,
+                          const void *val, uint32_t vlen),
+                void *ud) {
+  for (size_t i = 0; i < kv->table.cap; i++) {
+    const KvSlot *s = &kv->table.slots[i];
+    if (!s->hash)
+      continue;
+    const uint8_t *key = kv->map + s->off + KV_REC_HEADER;
+    if (fn(ud, key, s->klen, key + s->klen, s->vlen))
+      return;
+  }
+}
+
+int kv_sync(KvStore *kv) {
+  if (fsync(kv->fd) != 0)
+    return -1;
+  return kv_snapshot_write(kv);
+}
+
+// --- Compaction ---
+
+// Background thread: copies the records the table points at into the new
+// log, through a private mapping of the old log's first `upto` bytes.
+static void *kv_compact_run(void *arg) {
+  KvCompaction *c = arg;
+  const uint8_t *src = mmap(NULL, c->upto, PROT_READ, MAP_SHARED, c->src_fd, 0);
+  uint8_t *buf = malloc(1 << 20);
+  size_t used = 0;
+  if (src == MAP_FAILED || !buf) {
+    c->err = -1;
+    goto done;
+  }
+
+  memcpy(buf, KV_LOG_MAGIC, 8);
+  memcpy(buf + 8, &c->generation, 8);
+  used = KV_LOG_HEADER;
+  c->dst_len = 0;
+  for (size_t i = 0; i < c->table.cap && !c->err; i++) {
+    KvSlot *s = &c->table.slots[i];
+    if (!s->hash)
+      continue;
+    size_t size = kv_rec_size(s->klen, s->vlen);
+    if (used + size > (1 << 20)) {
+      if (kv_write_full(c->dst_fd, buf, used, (off_t)c->dst_len) != 0)
+        c->err = -1;
+      c->dst_len += used;
+      used = 0;
+    }
+    uint64_t off = c->dst_len + used;
+    if (size > (1 << 20)) {
+      if (kv_write_full(c->dst_fd, src + s->off, size, (off_t)off) != 0)
+        c->err = -1;
+      c->dst_len += size;
+    } else {
+      memcpy(buf + used, src + s->off, size);
+      used += size;
+    }
+    s->off = off;
+  }
+  if (!c->err && used &&
+      kv_write_full(c->dst_fd, buf, used, (off_t)c->dst_len) != 0)
+    c->err = -1;
+  c->dst_len += used;
+  if (!c->err && fsync(c->dst_fd) != 0)
+    c->err = -1;
+done:
+  if (src != MAP_FAILED)
+    munmap((void *)src, c->upto);
+  free(buf);
+  atomic_store(&c->done, 1);
+  return NULL;
+}
+
+static void kv_compaction_free(KvCompaction *c) {
+  if (c->dst_fd >= 0)
+    close(c->dst_fd);
+  if (c->src_fd >= 0)
+    close(c->src_fd);
+  free(c->table.slots);
+  free(c->dst_path);
+  free(c);
+}
+
+int kv_compact(KvStore *kv) {
+  if (kv->compaction)
+    return 0;
+  KvCompaction *c = calloc(1, sizeof(*c));
+  if (!c)
+    return -1;
+  c->src_fd = dup(kv->fd);
+  c->dst_fd = -1;
+  c->upto = kv->log_len;
+  c->generation = kv->generation + 1;
+  c->dst_path = kv_path(kv->dir, "log.compact");
+  c->table = kv->table;
+  c->table.slots = malloc(kv->table.cap * sizeof(KvSlot));
+  if (c->src_fd < 0 || !c->dst_path || !c->table.slots)
+    goto fail;
+  memcpy(c->table.slots, kv->table.slots, kv->table.cap * sizeof(KvSlot));
+  c->dst_fd = open(c->dst_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (c->dst_fd < 0 || pthread_create(&c->thread, NULL, kv_compact_run, c) != 0)
+    goto fail;
+  kv->compaction = c;
+  return 0;
+fail:
+  if (c->dst_path && c->dst_fd >= 0)
+    unlink(c->dst_path);
+  kv_compaction_free(c);
+  return -1;
+}
+
+// Joins the compaction thread, carries over what was written since it
+// started, and swaps the new log in.
+static int kv_compact_finish(KvStore *kv) {
+  KvCompaction *c = kv->compaction;
+  kv->compaction = NULL;
+  pthread_join(c->thread, NULL);
+
+  KvStore next = *kv;
+  next.fd = c->dst_fd;
+  next.generation = c->generation;
+  next.map = NULL;
+  next.map_len = 0;
+  next.table = c->table;
+  next.log_len = c->dst_len;
+  next.dead_bytes = 0;
+  int rc = c->err;
+
+  // Records appended after the copy started go over verbatim.
+  size_t off = c->upto;
+  while (rc == 0 && off < kv->log_len) {
+    size_t size = kv_rec_check(kv->map, kv->log_len, off);
+    if (size == 0 ||
+        kv_write_full(next.fd, kv->map + off, size, (off_t)next.log_len) != 0 ||
+        kv_map(&next, next.log_len + size) != 0) {
+      rc = -1;
+      break;
+    }
+    long old = kv_table_apply(&next.table, next.map, next.log_len);
+    if (old < 0) {
+      rc = -1;
+      break;
+    }
+    uint32_t vlen;
+    memcpy(&vlen, kv->map + off + 8, 4);
+    next.dead_bytes += (size_t)old + (vlen == KV_TOMBSTONE ? size : 0);
+    next.log_len += size;
+    off += size;
+  }
+
+  char *path = kv_path(kv->dir, "log");
+  if (rc == 0 && (!path || kv_map(&next, next.log_len) != 0 ||
+                  fsync(next.fd) != 0 || rename(c->dst_path, path) != 0))
+    rc = -1;
+  free(path);
+  if (rc != 0) {
+    // Keep the old log; the partial new one is discarded. next.table owns
+    // the slots now (kv_table_apply() may have grown them away from
+    // c->table's).
+    if (next.map)
+      munmap((void *)next.map, next.map_len);
+    unlink(c->dst_path);
+    free(next.table.slots);
+    c->table.slots = NULL;
+    kv_compaction_free(c);
+    return -1;
+  }
+
+  munmap((void *)kv->map, kv->map_len);
+  close(kv->fd);
+  free(kv->table.slots);
+  *kv = next;
+  c->dst_fd = -1;
+  c->table.slots = NULL;
+  kv_compaction_free(c);
+  return kv_snapshot_write(kv);
+}
+
+int kv_poll(KvStore *kv) {
+  if (kv->compaction)
+    return atomic_load(&kv->compaction->done) ? kv_compact_finish(kv) : 0;
+  if (kv->dead_bytes > KV_COMPACT_MIN && kv->dead_bytes * 2 > kv->log_len)
+    return kv_compact(kv);
+  return 0;
+}
+
+#endif // KVSTORE_IMPLEMENTATION
+#endif // KVSTORE_H
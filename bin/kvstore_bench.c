@@ -0,0 +1,127 @@
+// Key-value store benchmark.
+//
+//   gcc -O2 -pthread -o kvstore_bench kvstore_bench.c
+//   ./kvstore_bench [-n keys] [-u updates] [-d dir]
+//
+// Loads n keys, then overwrites random keys u times so the log carries a
+// long history. Reports put and get cost per operation, and reopen time with
+// the snapshot (index load + tail replay) against a full log replay.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KVSTORE_IMPLEMENTATION
+#include "kvstore.h"
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int make_key(char *buf, size_t i) {
+  return snprintf(buf, 32, "session/%zu", i);
+}
+
+static double reopen_ms(const char *dir) {
+  KvStore kv;
+  double t = now_ms();
+  if (kv_open(&kv, dir) != 0) {
+    perror(dir);
+    exit(1);
+  }
+  t = now_ms() - t;
+  kv_close(&kv);
+  return t;
+}
+
+int main(int argc, char **argv) {
+  size_t nkeys = 1000000, nupdates = 4000000;
+  const char *dir = "/tmp/kvstore_bench";
+  int opt;
+  while ((opt = getopt(argc, argv, "n:u:d:")) != -1) {
+    switch (opt) {
+    case 'n':
+      nkeys = (size_t)atol(optarg);
+      break;
+    case 'u':
+      nupdates = (size_t)atol(optarg);
+      break;
+    case 'd':
+      dir = optarg;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-n keys] [-u updates] [-d dir]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (nkeys == 0)
+    nkeys = 1;
+
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/log", dir);
+  unlink(path);
+  snprintf(path, sizeof(path), "%s/snapshot", dir);
+  unlink(path);
+
+  KvStore kv;
+  if (kv_open(&kv, dir) != 0) {
+    perror(dir);
+    return 1;
+  }
+  char key[32], val[64];
+  memset(val, 'v', sizeof(val));
+  srand(42);
+
+  double t = now_ms();
+  for (size_t i = 0; i < nkeys + nupdates; i++) {
+    size_t k = i < nkeys ? i : (size_t)rand() % nkeys;
+    int klen = make_key(key, k);
+    if (kv_put(&kv, key, (uint32_t)klen, val, 16 + (uint32_t)(i % 48)) != 0) {
+      perror("put");
+      return 1;
+    }
+  }
+  t = now_ms() - t;
+  printf("put      %8.1f ns/op  (%zu ops, log %.1f MB)\n",
+         t * 1e6 / (double)(nkeys + nupdates), nkeys + nupdates,
+         kv.log_len / (1024.0 * 1024.0));
+
+  size_t lookups = 4000000, hits = 0;
+  int *klens = malloc(lookups * sizeof(*klens));
+  char (*keys)[32] = malloc(lookups * sizeof(*keys));
+  for (size_t i = 0; i < lookups; i++)
+    klens[i] = make_key(keys[i], (size_t)rand() % nkeys);
+  t = now_ms();
+  for (size_t i = 0; i < lookups; i++) {
+    uint32_t vlen;
+    if (kv_get(&kv, keys[i], (uint32_t)klens[i], &vlen))
+      hits++;
+  }
+  t = now_ms() - t;
+  printf("get      %8.1f ns/op  (%zu hits)\n", t * 1e6 / (double)lookups, hits);
+  free(klens);
+  free(keys);
+
+  kv_close(&kv); // writes the snapshot
+  printf("reopen   %8.1f ms     (snapshot)\n", reopen_ms(dir));
+  unlink(path);
+  printf("reopen   %8.1f ms     (full log replay)\n", reopen_ms(dir));
+
+  if (kv_open(&kv, dir) != 0)
+    return 1;
+  t = now_ms();
+  kv_compact(&kv);
+  while (kv.compaction) {
+    usleep(1000);
+    kv_poll(&kv);
+  }
+  printf("compact  %8.1f ms     (log %.1f MB)\n", now_ms() - t,
+         kv.log_len / (1024.0 * 1024.0));
+  kv_close(&kv);
+  printf("reopen   %8.1f ms     (compacted, snapshot)\n", reopen_ms(dir));
+  return 0;
+}
@@ -0,0 +1,433 @@
+// libc11.so: the API of libc11.h on top of the single-header backends.
+//
+//   gcc -O2 -shared -fPIC -o libc11.so libc11.c
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "libc11.h"
+
+#define IGNORE_IMPLEMENTATION
+#include "ignore.h"
+#define TOON_IMPLEMENTATION
+#include "toon_format.h"
+#include "flexer_langs.h"
+#include "luatoken.h"
+
+int c11_abi_version(void) { return C11_ABI_VERSION; }
+
+// --- Directory walking ---
+
+#define C11_WALK_MAX_DEPTH 256
+
+typedef struct {
+  DIR *dir;
+  size_t path_len; // of this directory's path in c11_walk.path
+  int pushed;      // has a level in the ignore stack
+} WalkLevel;
+
+struct c11_walk {
+  int flags;
+  size_t root_len;
+  char path[PATH_MAX]; // root + "/" + the entry being looked at
+  WalkLevel levels[C11_WALK_MAX_DEPTH];
+  size_t depth;
+  IgStack ignores;
+  char pending[PATH_MAX + 2]; // a line that did not fit the caller's buffer
+  size_t pending_len;
+};
+
+static int walk_enter(c11_walk *w, size_t path_len) {
+  if (w->depth == C11_WALK_MAX_DEPTH)
+    return -1;
+  w->path[path_len] = '\0';
+  DIR *dir = opendir(w->path);
+  if (!dir)
+    return -1;
+  int pushed = 0;
+  if (!(w->flags & C11_WALK_NO_IGNORE))
+    pushed = ig_push_dir(&w->ignores, w->path) > 0;
+  w->levels[w->depth++] = (WalkLevel){dir, path_len, pushed};
+  return 0;
+}
+
+static void walk_leave(c11_walk *w) {
+  WalkLevel *lv = &w->levels[--w->depth];
+  if (lv->pushed)
+    ig_pop(&w->ignores);
+  closedir(lv->dir);
+}
+
+c11_walk *c11_walk_open(const char *root, int flags) {
+  size_t len = strlen(root);
+  while (len > 1 && root[len - 1] == '/')
+    len--;
+  if (len + 2 > PATH_MAX) {
+    errno = ENAMETOOLONG;
+    return NULL;
+  }
+  c11_walk *w = calloc(1, sizeof(*w));
+  if (!w)
+    return NULL;
+  w->flags = flags;
+  memcpy(w->path, root, len);
+  w->root_len = len;
+  ig_stack_init(&w->ignores);
+  if (walk_enter(w, len) != 0) {
+    int err = errno;
+    ig_stack_free(&w->ignores);
+    free(w);
+    errno = err;
+    return NULL;
+  }
+  return w;
+}
+
+// Appends `line` to buf, or parks it in w->pending when it does not fit.
+static void walk_put(c11_walk *w, char *buf, size_t cap, size_t *used,
+                     const char *line, size_t len) {
+  if (w->pending_len == 0 && len <= cap - *used) {
+    memcpy(buf + *used, line, len);
+    *used += len;
+  } else {
+    memcpy(w->pending, line, len);
+    w->pending_len = len;
+  }
+}
+
+int64_t c11_walk_next(c11_walk *w, char *buf, size_t cap) {
+  size_t used = 0;
+  if (w->pending_len) {
+    if (w->pending_len > cap) {
+      errno = ERANGE;
+      return -1;
+    }
+    memcpy(buf, w->pending, w->pending_len);
+    used = w->pending_len;
+    w->pending_len = 0;
+  }
+
+  while (w->depth > 0 && w->pending_len == 0) {
+    WalkLevel *lv = &w->levels[w->depth - 1];
+    struct dirent *e = readdir(lv->dir);
+    if (!e) {
+      walk_leave(w);
+      continue;
+    }
+    const char *name = e->d_name;
+    if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+      continue;
+    size_t name_len = strlen(name);
+    size_t len = lv->path_len + 1 + name_len;
+    if (len + 2 > sizeof(w->path))
+      continue;
+    w->path[lv->path_len] = '/';
+    memcpy(w->path + lv->path_len + 1, name, name_len + 1);
+
+    int is_dir = e->d_type == DT_DIR, is_file = e->d_type == DT_REG;
+    int follow = 0; // a real directory, not a symlink to one
+    if (e->d_type == DT_UNKNOWN || e->d_type == DT_LNK) {
+      struct stat st;
+      if (stat(w->path, &st) != 0)
+        continue;
+      is_dir = S_ISDIR(st.st_mode);
+      is_file = S_ISREG(st.st_mode);
+      if (e->d_type == DT_UNKNOWN && is_dir)
+        follow = lstat(w->path, &st) == 0 && S_ISDIR(st.st_mode);
+    } else {
+      follow = is_dir;
+    }
+    if (!is_dir && !is_file)
+      continue;
+    if (!(w->flags & C11_WALK_NO_IGNORE) &&
+        ig_ignored(&w->ignores, w->path, len, is_dir))
+      continue;
+
+    if (!(w->flags & (is_dir ? C11_WALK_NO_DIRS : C11_WALK_NO_FILES))) {
+      // Relative to the root: "<root>/a/b" -> "a/b".
+      char *rel = w->path + w->root_len + 1;
+      size_t rel_len = len - w->root_len - 1;
+      if (is_dir)
+        rel[rel_len++] = '/';
+      rel[rel_len++] = '\n';
+      walk_put(w, buf, cap, &used, rel, rel_len);
+    }
+    if (is_dir && follow && !(w->flags & C11_WALK_SHALLOW))
+      walk_enter(w, len); // unreadable directories are skipped
+  }
+
+  if (used == 0 && w->pending_len) {
+    errno = ERANGE;
+    return -1;
+  }
+  return (int64_t)used;
+}
+
+void c11_walk_close(c11_walk *w) {
+  if (!w)
+    return;
+  while (w->depth > 0)
+    walk_leave(w);
+  ig_stack_free(&w->ignores);
+  free(w);
+}
+
+static int64_t dir_size_at(int dfd) {
+  DIR *dir = fdopendir(dfd);
+  if (!dir) {
+    close(dfd);
+    return 0;
+  }
+  int64_t size = 0;
+  struct dirent *e;
+  while ((e = readdir(dir)) != NULL) {
+    const char *name = e->d_name;
+    if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+      continue;
+    struct stat st;
+    if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode)) {
+      int fd = openat(dirfd(dir), name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (fd >= 0)
+        size += dir_size_at(fd);
+    } else if (S_ISLNK(st.st_mode)) {
+      // dirscan counts what a file symlink points to.
+      if (fstatat(dirfd(dir), name, &st, 0) == 0 && S_ISREG(st.st_mode))
+        size += st.st_size;
+    } else {
+      size += st.st_size;
+    }
+  }
+  closedir(dir);
+  return size;
+}
+
+int64_t c11_dir_size(const char *path) {
+  int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  return fd < 0 ? -1 : dir_size_at(fd);
+}
+
+// --- Lexing ---
+
+struct c11_lexer {
+  const FlexLang *lang; // NULL: luatoken.h
+  Flexer flex;
+  ltok_state lt;
+  char *copy; // luatoken.h wants a NUL-terminated source
+  size_t len;
+};
+
+c11_lexer *c11_lexer_new(const char *lang) {
+  const FlexLang *fl = NULL;
+  if (strcmp(lang, "luatoken") != 0 && !(fl = flex_lang_find(lang))) {
+    errno = ENOENT;
+    return NULL;
+  }
+  c11_lexer *lx = calloc(1, sizeof(*lx));
+  if (!lx)
+    return NULL;
+  lx->lang = fl;
+  if (c11_lexer_reset(lx, "", 0) != 0) {
+    c11_lexer_free(lx);
+    return NULL;
+  }
+  return lx;
+}
+
+int c11_lexer_reset(c11_lexer *lx, const char *src, size_t len) {
+  if (len > UINT32_MAX) {
+    errno = EFBIG;
+    return -1;
+  }
+  lx->len = len;
+  if (lx->lang) {
+    flex_init(&lx->flex, src, len);
+    flex_lang_apply(&lx->flex, lx->lang);
+    return 0;
+  }
+  char *copy = realloc(lx->copy, len + 1);
+  if (!copy)
+    return -1;
+  memcpy(copy, src, len);
+  copy[len] = '\0';
+  lx->copy = copy;
+  ltok_init_len(&lx->lt, copy, len);
+  return 0;
+}
+
+static int64_t lt_next(c11_lexer *lx, c11_token *out, size_t cap) {
+  size_t n = 0;
+  while (n < cap) {
+    ltok_next(&lx->lt);
+    ltoken t = lx->lt.tok;
+    if (t.kind == LTOK_EOF)
+      break;
+    out[n++] = (c11_token){(int32_t)t.kind, (uint32_t)(t.start - lx->copy),
+                           (uint32_t)t.len, t.line, t.col};
+  }
+  return (int64_t)n;
+}
+
+int64_t c11_lexer_next(c11_lexer *lx, c11_token *out, size_t cap) {
+  if (!lx->lang)
+    return lt_next(lx, out, cap);
+  size_t n = 0;
+  while (n < cap) {
+    Token t = flex_next(&lx->flex);
+    if (t.type == TOK_EOF)
+      break;
+    out[n++] = (c11_token){t.type, (uint32_t)(t.text.start - lx->flex.src),
+                           (uint32_t)t.text.len, t.line, t.col};
+  }
+  return (int64_t)n;
+}
+
+const char *c11_lexer_kind_name(const c11_lexer *lx, int32_t type) {
+  return lx->lang ? flex_kind_name(type) : ltok_name((ltok_kind)type);
+}
+
+void c11_lexer_free(c11_lexer *lx) {
+  if (!lx)
+    return;
+  free(lx->copy);
+  free(lx);
+}
+
+// --- TOON documents ---
+
+struct c11_toon {
+  void *data; // toon_encode_binary() buffer
+  ToonBin bin;
+};
+
+static c11_toon *toon_adopt(void *data, size_t size) {
+  c11_toon *t = malloc(sizeof(*t));
+  if (!t || toon_bin_open(&t->bin, data, size) != 0) {
+    errno = t ? EINVAL : ENOMEM;
+    free(t);
+    free(data);
+    return NULL;
+  }
+  t->data = data;
+  return t;
+}
+
+c11_toon *c11_toon_parse(const char *text, size_t len, unsigned flags,
+                         char *err, size_t err_cap) {
+  char *src = malloc(len + 1);
+  if (!src)
+    return NULL;
+  memcpy(src, text, len);
+  src[len] = '\0';
+  ToonParseOptions opts = {0};
+  opts.flags = flags;
+  ToonError e;
+  ToonValue *v = toon_parse_opts(src, &opts, &e);
+  free(src);
+  if (!v) {
+    if (err && err_cap)
+      snprintf(err, err_cap, "%d:%d: %s", e.line, e.col, e.msg);
+    errno = EINVAL;
+    return NULL;
+  }
+  size_t size;
+  void *data = toon_encode_binary(v, &size);
+  toon_free(v);
+  return data ? toon_adopt(data, size) : NULL;
+}
+
+c11_toon *c11_toon_load(const void *data, size_t size) {
+  void *copy = malloc(size ? size : 1);
+  if (!copy)
+    return NULL;
+  memcpy(copy, data, size);
+  return toon_adopt(copy, size);
+}
+
+void c11_toon_free(c11_toon *t) {
+  if (!t)
+    return;
+  free(t->data);
+  free(t);
+}
+
+uint32_t c11_toon_root(const c11_toon *t) { return toon_bin_root(&t->bin); }
+
+int c11_toon_type(const c11_toon *t, uint32_t ref) {
+  return (int)toon_bin_type(&t->bin, ref);
+}
+
+size_t c11_toon_len(const c11_toon *t, uint32_t ref) {
+  return toon_bin_len(&t->bin, ref);
+}
+
+const char *c11_toon_str(const c11_toon *t, uint32_t ref) {
+  return toon_bin_str(&t->bin, ref);
+}
+
+int c11_toon_bool(const c11_toon *t, uint32_t ref) {
+  return toon_bin_bool(&t->bin, ref);
+}
+
+int64_t c11_toon_int(const c11_toon *t, uint32_t ref) {
+  return toon_bin_int(&t->bin, ref);
+}
+
+double c11_toon_float(const c11_toon *t, uint32_t ref) {
+  return toon_bin_float(&t->bin, ref);
+}
+
+uint32_t c11_toon_at(const c11_toon *t, uint32_t array, size_t index) {
+  return toon_bin_at(&t->bin, array, index);
+}
+
+const char *c11_toon_key(const c11_toon *t, uint32_t object, size_t index) {
+  return toon_bin_key(&t->bin, object, index);
+}
+
+uint32_t c11_toon_value(const c11_toon *t, uint32_t object, size_t index) {
+  return toon_bin_value(&t->bin, object, index);
+}
+
+uint32_t c11_toon_get(const c11_toon *t, uint32_t object, const char *key) {
+  return toon_bin_get(&t->bin, object, key);
+}
+
+const void *c11_toon_binary(const c11_toon *t, size_t *size) {
+  *size = t->bin.size;
+  return t->data;
+}
+
+int64_t c11_toon_write(const c11_toon *t, char *buf, size_t cap) {
+  ToonValue *v = toon_bin_to_value(&t->bin, toon_bin_root(&t->bin));
+  if (!v)
+    return -1;
+  // toon_write() wants a FILE; keep it on this side of the ABI.
+  char *text = NULL;
+  size_t len = 0;
+  FILE *out = open_memstream(&text, &len);
+  int rc = out ? toon_write(out, v) : -1;
+  if (out && fclose(out) != 0)
+    rc = -1;
+  toon_free(v);
+  if (rc != 0) {
+    free(text);
+    errno = EINVAL;
+    return -1;
+  }
+  if (cap > 0) {
+    size_t n = len < cap ? len : cap - 1;
+    memcpy(buf, text, n);
+    buf[n] = '\0';
+  }
+  free(text);
+  return (int64_t)len;
+}
@@ -0,0 +1,129 @@
+/* libc11.h - In-process API of libc11.so for LuaJIT's FFI
+ *
+ * The backends that Neovim otherwise reaches by spawning dirwalk/dirscan
+ * and re-parsing their output, plus the flexer.h / luatoken.h lexers and
+ * toon_format.h, behind one flat C ABI:
+ *
+ *   - opaque handles, created by *_new/_open/_parse and released by
+ *     *_free/_close;
+ *   - results go into buffers the caller owns (a Lua string is never built
+ *     on the C side); pointers a function does return are borrowed from
+ *     the handle and valid until it is freed;
+ *   - plain integer/pointer types only, no stdio, no callbacks;
+ *   - failures return NULL or -1 with errno set (ffi.errno()).
+ *
+ * The declarations below are valid ffi.cdef() input; libc11.lua carries a
+ * copy of them, so keep the two in sync and bump C11_ABI_VERSION on
+ * any incompatible change.
+ *
+ * Build:
+ *   gcc -O2 -shared -fPIC -o libc11.so libc11.c
+ *
+ * Usage (Lua):
+ *   local c11 = require("libc11")
+ *   for path in c11.walk(".") do print(path) end
+ */
+
+#ifndef LIBC11_H
+#define LIBC11_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum { C11_ABI_VERSION = 1 };
+
+int c11_abi_version(void);
+
+// --- Directory walking (dirwalk / dirscan) ---
+
+enum {
+  C11_WALK_NO_IGNORE = 1, // don't read .gitignore/.ignore, walk into .git
+  C11_WALK_NO_DIRS = 2,   // list regular files only
+  C11_WALK_NO_FILES = 4,  // list directories only
+  C11_WALK_SHALLOW = 8,   // don't descend below `root`
+};
+
+typedef struct c11_walk c11_walk;
+
+// Starts a walk of `root`. Paths are reported relative to it, directories
+// with a trailing '/'. Symlinks to directories are listed but not followed.
+c11_walk *c11_walk_open(const char *root, int flags);
+// Fills `buf` with whole "path\n" lines. Returns the number of bytes
+// written, 0 once the walk is done, or -1 (errno ERANGE if one path does
+// not fit an empty `buf`; 4096 bytes is always enough).
+int64_t c11_walk_next(c11_walk *w, char *buf, size_t cap);
+void c11_walk_close(c11_walk *w);
+
+// Total size in bytes of the files below `path` (dirscan's "folder_size"),
+// or -1. Symlinked directories are not followed.
+int64_t c11_dir_size(const char *path);
+
+// --- Lexing (flexer.h tables from flexer_langs.h, and luatoken.h) ---
+
+typedef struct c11_lexer c11_lexer;
+
+typedef struct {
+  int32_t type;    // see c11_lexer_kind_name()
+  uint32_t offset; // byte offset of the token in the source
+  uint32_t len;
+  int32_t line;    // 1-based
+  int32_t col;     // 1-based, in bytes
+} c11_token;
+
+// `lang` is "lua" or "c" (flexer.h) or "luatoken" (luatoken.h). NULL with
+// errno ENOENT if unknown.
+c11_lexer *c11_lexer_new(const char *lang);
+// Starts over on `src`, which must stay alive and unchanged until the next
+// reset or free (except for "luatoken", which copies it).
+int c11_lexer_reset(c11_lexer *lx, const char *src, size_t len);
+// Writes up to `cap` tokens to `out`; returns how many, 0 at the end.
+// Comments and whitespace are not reported.
+int64_t c11_lexer_next(c11_lexer *lx, c11_token *out, size_t cap);
+// "keyword", "identifier", "string", ... for a token type of this lexer.
+const char *c11_lexer_kind_name(const c11_lexer *lx, int32_t type);
+void c11_lexer_free(c11_lexer *lx);
+
+// --- TOON documents (toon_format.h) ---
+
+// Node types, same values as ToonType.
+enum {
+  C11_TOON_NULL,
+  C11_TOON_STRING,
+  C11_TOON_OBJECT,
+  C11_TOON_ARRAY,
+  C11_TOON_BOOL,
+  C11_TOON_INT,
+  C11_TOON_FLOAT
+};
+
+typedef struct c11_toon c11_toon;
+
+// Parses `len` bytes of TOON text (`flags` as for toon_parse_ex). On
+// failure returns NULL and, if `err` is given, writes "line:col: message".
+c11_toon *c11_toon_parse(const char *text, size_t len, unsigned flags,
+                         char *err, size_t err_cap);
+// Adopts a copy of a toon_encode_binary() buffer.
+c11_toon *c11_toon_load(const void *data, size_t size);
+void c11_toon_free(c11_toon *t);
+
+// Nodes are addressed by 32-bit refs; 0 is "no node".
+uint32_t c11_toon_root(const c11_toon *t);
+int c11_toon_type(const c11_toon *t, uint32_t ref);
+// Bytes of a string, items of an array, entries of an object.
+size_t c11_toon_len(const c11_toon *t, uint32_t ref);
+const char *c11_toon_str(const c11_toon *t, uint32_t ref);
+int c11_toon_bool(const c11_toon *t, uint32_t ref);
+int64_t c11_toon_int(const c11_toon *t, uint32_t ref);
+double c11_toon_float(const c11_toon *t, uint32_t ref);
+uint32_t c11_toon_at(const c11_toon *t, uint32_t array, size_t index);
+const char *c11_toon_key(const c11_toon *t, uint32_t object, size_t index);
+uint32_t c11_toon_value(const c11_toon *t, uint32_t object, size_t index);
+uint32_t c11_toon_get(const c11_toon *t, uint32_t object, const char *key);
+
+// The binary encoding (borrowed, `*size` receives its length).
+const void *c11_toon_binary(const c11_toon *t, size_t *size);
+// Writes the document as NUL-terminated TOON text. Returns its length; a
+// result >= `cap` means it was cut short (as with snprintf). -1 on error.
+int64_t c11_toon_write(const c11_toon *t, char *buf, size_t cap);
+
+#endif // LIBC11_H
@@ -0,0 +1,219 @@
+-- LuaJIT FFI binding for libc11.so (see libc11.h).
+--
+--   local c11 = require("libc11")         -- or dofile(".../bin/libc11.lua")
+--   for path in c11.walk(root) do ... end  -- directories end in "/"
+--   c11.dir_size(path)                     -- bytes, or nil + error
+--   for kind, text, line, col in c11.tokens("lua", src) do ... end
+--   c11.toon_decode(text)                  -- Lua table, or nil + error
+--
+-- The library is looked up next to this file first, then on the loader's
+-- search path. c11.C is the raw ffi namespace for anything not wrapped here.
+
+local ffi = require("ffi")
+
+-- Keep in sync with libc11.h.
+ffi.cdef([[
+char *strerror(int errnum);
+
+int c11_abi_version(void);
+
+enum {
+    C11_WALK_NO_IGNORE = 1,
+    C11_WALK_NO_DIRS = 2,
+    C11_WALK_NO_FILES = 4,
+    C11_WALK_SHALLOW = 8,
+};
+typedef struct c11_walk c11_walk;
+c11_walk *c11_walk_open(const char *root, int flags);
+int64_t c11_walk_next(c11_walk *w, char *buf, size_t cap);
+void c11_walk_close(c11_walk *w);
+int64_t c11_dir_size(const char *path);
+
+typedef struct c11_lexer c11_lexer;
+typedef struct {
+    int32_t type;
+    uint32_t offset;
+    uint32_t len;
+    int32_t line;
+    int32_t col;
+} c11_token;
+c11_lexer *c11_lexer_new(const char *lang);
+int c11_lexer_reset(c11_lexer *lx, const char *src, size_t len);
+int64_t c11_lexer_next(c11_lexer *lx, c11_token *out, size_t cap);
+const char *c11_lexer_kind_name(const c11_lexer *lx, int32_t type);
+void c11_lexer_free(c11_lexer *lx);
+
+enum {
+    C11_TOON_NULL,
+    C11_TOON_STRING,
+    C11_TOON_OBJECT,
+    C11_TOON_ARRAY,
+    C11_TOON_BOOL,
+    C11_TOON_INT,
+    C11_TOON_FLOAT
+};
+typedef struct c11_toon c11_toon;
+c11_toon *c11_toon_parse(const char *text, size_t len, unsigned flags,
+                         char *err, size_t err_cap);
+c11_toon *c11_toon_load(const void *data, size_t size);
+void c11_toon_free(c11_toon *t);
+uint32_t c11_toon_root(const c11_toon *t);
+int c11_toon_type(const c11_toon *t, uint32_t ref);
+size_t c11_toon_len(const c11_toon *t, uint32_t ref);
+const char *c11_toon_str(const c11_toon *t, uint32_t ref);
+int c11_toon_bool(const c11_toon *t, uint32_t ref);
+int64_t c11_toon_int(const c11_toon *t, uint32_t ref);
+double c11_toon_float(const c11_toon *t, uint32_t ref);
+uint32_t c11_toon_at(const c11_toon *t, uint32_t array, size_t index);
+const char *c11_toon_key(const c11_toon *t, uint32_t object, size_t index);
+uint32_t c11_toon_value(const c11_toon *t, uint32_t object, size_t index);
+uint32_t c11_toon_get(const c11_toon *t, uint32_t object, const char *key);
+const void *c11_toon_binary(const c11_toon *t, size_t *size);
+int64_t c11_toon_write(const c11_toon *t, char *buf, size_t cap);
+]])
+
+local ABI_VERSION = 1
+local WALK_BUF = 64 * 1024
+local TOKEN_BATCH = 256
+
+local function load_library()
+    local here = debug.getinfo(1, "S").source:match("^@(.*/)") or "./"
+    local ok, lib = pcall(ffi.load, here .. "libc11.so")
+    if not ok then
+        lib = ffi.load("c11")
+    end
+    assert(lib.c11_abi_version() == ABI_VERSION, "libc11.so ABI mismatch")
+    return lib
+end
+
+local C = load_library()
+local M = { C = C }
+
+local function errno_message()
+    return ffi.string(ffi.C.strerror(ffi.errno()))
+end
+
+--- Iterates over the paths below `root` (relative to it). `opts` may set
+--- no_ignore, files_only, dirs_only and shallow.
+function M.walk(root, opts)
+    opts = opts or {}
+    local flags = 0
+    if opts.no_ignore then flags = flags + C.C11_WALK_NO_IGNORE end
+    if opts.files_only then flags = flags + C.C11_WALK_NO_DIRS end
+    if opts.dirs_only then flags = flags + C.C11_WALK_NO_FILES end
+    if opts.shallow then flags = flags + C.C11_WALK_SHALLOW end
+
+    local w = C.c11_walk_open(root, flags)
+    if w == nil then
+        error(root .. ": " .. errno_message())
+    end
+    w = ffi.gc(w, C.c11_walk_close)
+    local buf = ffi.new("char[?]", WALK_BUF)
+    local chunk, pos = "", 1
+
+    return function()
+        while true do
+            local nl = chunk:find("\n", pos, true)
+            if nl then
+                local path = chunk:sub(pos, nl - 1)
+                pos = nl + 1
+                return path
+            end
+            if w == nil then
+                return nil
+            end
+            local n = tonumber(C.c11_walk_next(w, buf, WALK_BUF))
+            if n <= 0 then
+                C.c11_walk_close(ffi.gc(w, nil))
+                w = nil
+                if n < 0 then
+                    error(root .. ": " .. errno_message())
+                end
+                return nil
+            end
+            chunk, pos = ffi.string(buf, n), 1
+        end
+    end
+end
+
+function M.dir_size(path)
+    local size = C.c11_dir_size(path)
+    if size < 0 then
+        return nil, errno_message()
+    end
+    return tonumber(size)
+end
+
+--- Iterates over the tokens of `src`: kind name, text, line, col.
+--- `lang` is "lua", "c" or "luatoken".
+function M.tokens(lang, src)
+    local lx = C.c11_lexer_new(lang)
+    if lx == nil then
+        error("libc11: unknown language " .. lang)
+    end
+    lx = ffi.gc(lx, C.c11_lexer_free)
+    C.c11_lexer_reset(lx, src, #src)
+    local toks = ffi.new("c11_token[?]", TOKEN_BATCH)
+    local names = {}
+    local n, i = 0, 0
+
+    return function()
+        if i == n then
+            n, i = tonumber(C.c11_lexer_next(lx, toks, TOKEN_BATCH)), 0
+            if n == 0 then
+                return nil
+            end
+        end
+        local t = toks[i]
+        i = i + 1
+        local name = names[t.type]
+        if not name then
+            name = ffi.string(C.c11_lexer_kind_name(lx, t.type))
+            names[t.type] = name
+        end
+        -- `src` is an upvalue, so the lexer's view of it stays valid.
+        return name, src:sub(t.offset + 1, t.offset + t.len), t.line, t.col
+    end
+end
+
+local function toon_to_lua(t, ref)
+    local ty = C.c11_toon_type(t, ref)
+    if ty == C.C11_TOON_STRING then
+        return ffi.string(C.c11_toon_str(t, ref), C.c11_toon_len(t, ref))
+    elseif ty == C.C11_TOON_INT then
+        return tonumber(C.c11_toon_int(t, ref))
+    elseif ty == C.C11_TOON_FLOAT then
+        return C.c11_toon_float(t, ref)
+    elseif ty == C.C11_TOON_BOOL then
+        return C.c11_toon_bool(t, ref) ~= 0
+    elseif ty == C.C11_TOON_ARRAY then
+        local out = {}
+        for i = 0, tonumber(C.c11_toon_len(t, ref)) - 1 do
+            out[i + 1] = toon_to_lua(t, C.c11_toon_at(t, ref, i))
+        end
+        return out
+    elseif ty == C.C11_TOON_OBJECT then
+        local out = {}
+        for i = 0, tonumber(C.c11_toon_len(t, ref)) - 1 do
+            out[ffi.string(C.c11_toon_key(t, ref, i))] = toon_to_lua(t, C.c11_toon_value(t, ref, i))
+        end
+        return out
+    end
+    return nil
+end
+
+--- Parses TOON text into Lua tables (numbers, booleans and nulls inferred
+--- unless `raw` is set). Returns nil and "line:col: message" on error.
+function M.toon_decode(text, raw)
+    local err = ffi.new("char[128]")
+    local t = C.c11_toon_parse(text, #text, raw and 0 or 1, err, 128)
+    if t == nil then
+        return nil, ffi.string(err)
+    end
+    t = ffi.gc(t, C.c11_toon_free)
+    local value = toon_to_lua(t, C.c11_toon_root(t))
+    C.c11_toon_free(ffi.gc(t, nil))
+    return value
+end
+
+return M
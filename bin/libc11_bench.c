@@ -0,0 +1,164 @@
+// Spawned-process vs in-process (libc11.so) call latency.
+//
+//   gcc -O2 -shared -fPIC -o libc11.so libc11.c
+//   gcc -O2 -o libc11_bench libc11_bench.c -L. -lc11 -Wl,-rpath,'$ORIGIN'
+//   ./libc11_bench [dir]
+//
+// Compares what runner.lua does today -- popen() a tool and read all of its
+// output -- with the same work done through the FFI-level API, on `dir`
+// (default ".") and on an empty directory, where the process path is pure
+// fork/exec/pipe overhead. Run it from bin/ so ./dirwalk and ./dirscan are
+// the freshly built tools.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libc11.h"
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Runs `cmd` and reads its whole output; returns the number of bytes.
+static size_t spawn(const char *cmd) {
+  static char buf[1 << 16];
+  FILE *p = popen(cmd, "r");
+  if (!p) {
+    perror("popen");
+    exit(1);
+  }
+  size_t total = 0, n;
+  while ((n = fread(buf, 1, sizeof(buf), p)) > 0)
+    total += n;
+  // A tool that failed to run would be timed as if it were the spawn cost.
+  int status = pclose(p);
+  if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "%s: failed (status %d)\n", cmd, status);
+    exit(1);
+  }
+  return total;
+}
+
+static size_t walk(const char *dir, int flags) {
+  static char buf[1 << 16];
+  c11_walk *w = c11_walk_open(dir, flags);
+  if (!w) {
+    perror(dir);
+    exit(1);
+  }
+  size_t total = 0;
+  int64_t n;
+  while ((n = c11_walk_next(w, buf, sizeof(buf))) > 0)
+    total += (size_t)n;
+  c11_walk_close(w);
+  return total;
+}
+
+// dirscan's work: the size of every directory directly below `dir`.
+static size_t scan(const char *dir) {
+  char buf[1 << 16], path[PATH_MAX];
+  c11_walk *w = c11_walk_open(dir, C11_WALK_NO_FILES | C11_WALK_SHALLOW);
+  int64_t n;
+  size_t count = 0;
+  while (w && (n = c11_walk_next(w, buf, sizeof(buf))) > 0) {
+    for (char *line = buf, *nl; (nl = memchr(line, '\n', buf + n - line));
+         line = nl + 1) {
+      size_t dir_len = strlen(dir), len = (size_t)(nl - line);
+      if (dir_len + 1 + len >= sizeof(path))
+        continue;
+      memcpy(path, dir, dir_len);
+      path[dir_len] = '/';
+      memcpy(path + dir_len + 1, line, len);
+      path[dir_len + 1 + len] = '\0';
+      count += c11_dir_size(path) >= 0;
+    }
+  }
+  c11_walk_close(w);
+  return count;
+}
+
+static const char lua_src[] = "local function fib(n)\n"
+                              "  if n < 2 then return n end\n"
+                              "  return fib(n - 1) + fib(n - 2)\n"
+                              "end\n";
+
+static size_t lex(void) {
+  static c11_lexer *lx;
+  c11_token toks[64];
+  if (!lx)
+    lx = c11_lexer_new("lua");
+  c11_lexer_reset(lx, lua_src, sizeof(lua_src) - 1);
+  size_t count = 0;
+  int64_t n;
+  while ((n = c11_lexer_next(lx, toks, 64)) > 0)
+    count += (size_t)n;
+  return count;
+}
+
+typedef struct {
+  const char *name;
+  double spawn_us, lib_us; // per call; spawn_us 0 = no tool to compare with
+} Row;
+
+static volatile size_t sink;
+
+#define TIME(out, reps, expr)                                                  \
+  do {                                                                         \
+    double t0_ = now_us();                                                     \
+    for (int i_ = 0; i_ < (reps); i_++)                                        \
+      sink += (size_t)(expr);                                                  \
+    (out) = (now_us() - t0_) / (reps);                                         \
+  } while (0)
+
+int main(int argc, char **argv) {
+  const char *dir = argc > 1 ? argv[1] : ".";
+  char tools[PATH_MAX], root[PATH_MAX], cmd[3 * PATH_MAX];
+  char empty[] = "/tmp/libc11_bench.XXXXXX";
+  if (!getcwd(tools, sizeof(tools)) || !realpath(dir, root) ||
+      !mkdtemp(empty)) {
+    perror("libc11_bench");
+    return 1;
+  }
+  Row rows[5] = {{"dir size, empty dir", 0, 0}, {"walk, empty dir", 0, 0},
+                 {"walk, dir", 0, 0},           {"dirscan, dir", 0, 0},
+                 {"lex 4 lines of Lua", 0, 0}};
+  int nrows = 5;
+
+  snprintf(cmd, sizeof(cmd), "cd '%s' && '%s/dirscan' .", empty, tools);
+  TIME(rows[0].spawn_us, 200, spawn(cmd));
+  TIME(rows[0].lib_us, 200000, c11_dir_size(empty));
+
+  snprintf(cmd, sizeof(cmd), "cd '%s' && '%s/dirwalk' -u", empty, tools);
+  TIME(rows[1].spawn_us, 200, spawn(cmd));
+  TIME(rows[1].lib_us, 200000, walk(empty, C11_WALK_NO_IGNORE));
+
+  snprintf(cmd, sizeof(cmd), "cd '%s' && '%s/dirwalk'", root, tools);
+  TIME(rows[2].spawn_us, 20, spawn(cmd));
+  TIME(rows[2].lib_us, 20, walk(root, 0));
+
+  snprintf(cmd, sizeof(cmd), "'%s/dirscan' '%s'", tools, root);
+  TIME(rows[3].spawn_us, 20, spawn(cmd));
+  TIME(rows[3].lib_us, 20, scan(root));
+
+  // There is no lexer tool to spawn; this is the in-process cost alone.
+  TIME(rows[4].lib_us, 200000, lex());
+
+  printf("%-22s %14s %14s %9s\n", "case", "spawn (us)", "libc11 (us)", "speedup");
+  for (int i = 0; i < nrows; i++) {
+    Row *r = &rows[i];
+    if (r->spawn_us > 0)
+      printf("%-22s %14.1f %14.2f %8.0fx\n", r->name, r->spawn_us, r->lib_us,
+             r->spawn_us / r->lib_us);
+    else
+      printf("%-22s %14s %14.2f %9s\n", r->name, "-", r->lib_us, "-");
+  }
+  rmdir(empty);
+  return 0;
+}
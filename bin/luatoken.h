@@ -1,20 +1,36 @@
 
+#include <stddef.h>
 #include <string.h>
 
 #ifndef LUATOKEN_H
 #define LUATOKEN_H
 
 /*
-    luatoken.h — Minimal Lua-like tokenizer (single-header)
-
-    Features:
-      - Identifiers
-      - Keywords: if, then, end, function, local, return
-      - Numbers (integer only)
-      - Strings: "text" or 'text'
-      - Operators: = + - * / ( ) { } , .
-      - Comments: -- line comment
-      - Whitespace skipping
+    luatoken.h — Lua 5.4 tokenizer (single-header)
+
+    Features (the whole lexical grammar of Lua 5.4, as llex.c reads it):
+      - Identifiers and all 22 keywords
+      - Numbers: decimal and hex, integer and float (10, 0xff, 3.0, .5e-3,
+        0x1p4, 0xA.8p0)
+      - Strings: "text" or 'text' with every escape (\n, \\, \z, \x41, \65,
+        \u{20AC}, backslash-newline); long strings [[...]], [==[...]==]
+      - Operators and punctuation, longest match: + - * / // % ^ # & ~ |
+        << >> == ~= <= >= < > = ( ) { } [ ] :: ; : , . .. ...
+      - Comments: -- line comments, --[[ long ]] and --[==[ ]==] comments
+      - Whitespace skipping, line and column of every token
+
+    A 256-entry table gives the class of every byte; ltok_next() switches on
+    the class of the token's first byte, and names and whitespace run over
+    the same table. Tokens are slices of the source, nothing is copied.
+
+    The source must be NUL-terminated: ltok_init() takes a C string,
+    ltok_init_len() a buffer of `len` bytes plus a NUL at src[len] (NULs
+    before that are lexed like any other byte).
+
+    Lua stops at the first lexical error; here the offending text (an
+    unfinished string or long bracket, a bad escape, a malformed number, a
+    stray byte) comes back as one LTOK_UNKNOWN token and lexing goes on
+    after it.
 */
 
 #ifdef __cplusplus
@@ -38,7 +54,7 @@ typedef enum {
   LTOK_KW_LOCAL,
   LTOK_KW_RETURN,
 
-  LTOK_EQ,
+  LTOK_EQ, /* = */
   LTOK_PLUS,
   LTOK_MINUS,
   LTOK_STAR,
@@ -50,12 +66,55 @@ typedef enum {
   LTOK_COMMA,
   LTOK_DOT,
 
+  LTOK_KW_AND,
+  LTOK_KW_BREAK,
+  LTOK_KW_DO,
+  LTOK_KW_ELSE,
+  LTOK_KW_ELSEIF,
+  LTOK_KW_FALSE,
+  LTOK_KW_FOR,
+  LTOK_KW_GOTO,
+  LTOK_KW_IN,
+  LTOK_KW_NIL,
+  LTOK_KW_NOT,
+  LTOK_KW_OR,
+  LTOK_KW_REPEAT,
+  LTOK_KW_TRUE,
+  LTOK_KW_UNTIL,
+  LTOK_KW_WHILE,
+
+  LTOK_IDIV,     /* // */
+  LTOK_PERCENT,  /* % */
+  LTOK_CARET,    /* ^ */
+  LTOK_HASH,     /* # */
+  LTOK_AMP,      /* & */
+  LTOK_TILDE,    /* ~ */
+  LTOK_PIPE,     /* | */
+  LTOK_SHL,      /* << */
+  LTOK_SHR,      /* >> */
+  LTOK_EQEQ,     /* == */
+  LTOK_NE,       /* ~= */
+  LTOK_LE,       /* <= */
+  LTOK_GE,       /* >= */
+  LTOK_LT,       /* < */
+  LTOK_GT,       /* > */
+  LTOK_LBRACKET, /* [ */
+  LTOK_RBRACKET, /* ] */
+  LTOK_DBCOLON,  /* :: */
+  LTOK_SEMI,     /* ; */
+  LTOK_COLON,    /* : */
+  LTOK_CONCAT,   /* .. */
+  LTOK_DOTS,     /* ... */
+
   LTOK_UNKNOWN
 } ltok_kind;
 
 typedef struct {
   ltok_kind kind;
-  char text[128];
+  const char *start; /* the token's text, inside the source */
+  size_t len;
+  int line; /* 1-based */
+  int col;  /* 1-based, in bytes */
 } ltoken;
 
 /* ================
@@ -65,6 +124,9 @@ typedef struct {
 typedef struct {
   const char *src;
   const char *cur;
+  const char *end; /* the terminating NUL */
+  const char *line_start;
+  int line;
   ltoken tok;
 } ltok_state;
 
@@ -72,163 +134,417 @@ typedef struct {
       INTERNAL HELPERS
    ============================ */
 
-static int lt_is_ident_start(char c) {
-  return (c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'));
+/*
+   Byte classes, one character per byte value:
+     a  letter or _          b  digit            _  space, \t \r \f \v
+     n  \n                   z  NUL              p  .
+     q  " or '               m  -                k  [
+     o  / < > = ~ :  (may start a two-byte operator)
+     s  any other single-byte token              x  not valid in Lua
+*/
+static const char lt_class[257] =
+    "zxxxxxxxx_n___xxxxxxxxxxxxxxxxxx" /* 00-1f */
+    "_xqsxssqsssssmpobbbbbbbbbbosooox" /* 20-3f */
+    "xaaaaaaaaaaaaaaaaaaaaaaaaaakxssa" /* 40-5f */
+    "xaaaaaaaaaaaaaaaaaaaaaaaaaasssox" /* 60-7f */
+    "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" /* 80-9f */
+    "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" /* a0-bf */
+    "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" /* c0-df */
+    "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" /* e0-ff */;
+
+#define LT_CLASS(c) (lt_class[(unsigned char)(c)])
+#define LT_IS_NAME(c) ((unsigned char)(LT_CLASS(c) - 'a') < 2) /* a or b */
+#define LT_IS_DIGIT(c) ((unsigned char)((c) - '0') < 10)
+#define LT_IS_XDIGIT(c)                                                        \
+  (LT_IS_DIGIT(c) || (unsigned char)(((c) | 32) - 'a') < 6)
+
+/* The tokens of class s. */
+static const unsigned char lt_single[256] = {
+    ['+'] = LTOK_PLUS,   ['*'] = LTOK_STAR,     ['%'] = LTOK_PERCENT,
+    ['^'] = LTOK_CARET,  ['#'] = LTOK_HASH,     ['&'] = LTOK_AMP,
+    ['|'] = LTOK_PIPE,   ['('] = LTOK_LPAREN,   [')'] = LTOK_RPAREN,
+    ['{'] = LTOK_LBRACE, ['}'] = LTOK_RBRACE,   [']'] = LTOK_RBRACKET,
+    [';'] = LTOK_SEMI,   [','] = LTOK_COMMA,
+};
+
+static const struct {
+  const char *word;
+  ltok_kind kind;
+} lt_keywords[] = {
+    /* by length, see lt_keyword_at */
+    {"do", LTOK_KW_DO},         {"if", LTOK_KW_IF},
+    {"in", LTOK_KW_IN},         {"or", LTOK_KW_OR},
+    {"and", LTOK_KW_AND},       {"end", LTOK_KW_END},
+    {"for", LTOK_KW_FOR},       {"nil", LTOK_KW_NIL},
+    {"not", LTOK_KW_NOT},       {"else", LTOK_KW_ELSE},
+    {"goto", LTOK_KW_GOTO},     {"then", LTOK_KW_THEN},
+    {"true", LTOK_KW_TRUE},     {"break", LTOK_KW_BREAK},
+    {"false", LTOK_KW_FALSE},   {"local", LTOK_KW_LOCAL},
+    {"until", LTOK_KW_UNTIL},   {"while", LTOK_KW_WHILE},
+    {"elseif", LTOK_KW_ELSEIF}, {"repeat", LTOK_KW_REPEAT},
+    {"return", LTOK_KW_RETURN}, {"function", LTOK_KW_FUNCTION},
+};
+
+/* The keywords of length n are lt_keywords[lt_keyword_at[n] ..
+   lt_keyword_at[n + 1]). */
+static const unsigned char lt_keyword_at[10] = {0,  0,  0,  4,  9,
+                                                13, 18, 21, 21, 22};
+
+static inline ltok_kind lt_name_kind(const char *s, size_t len) {
+  if (len < 2 || len > 8)
+    return LTOK_IDENT;
+  for (unsigned i = lt_keyword_at[len]; i < lt_keyword_at[len + 1]; i++) {
+    const char *w = lt_keywords[i].word;
+    size_t j = 0;
+    while (j < len && w[j] == s[j]) /* short enough not to call memcmp */
+      j++;
+    if (j == len)
+      return lt_keywords[i].kind;
+  }
+  return LTOK_IDENT;
 }
 
-static int lt_is_ident_char(char c) {
-  return lt_is_ident_start(c) || (c >= '0' && c <= '9');
+/* At a '[': the level of the long bracket "[" "="*level "[" that starts
+   here, -1 if this is a plain '[', or -2 for '[' and '='s not followed by
+   '[' (an error in Lua). */
+static inline int lt_long_open(const char *c) {
+  int level = 0;
+  for (c++; *c == '='; c++)
+    level++;
+  return *c == '[' ? level : level ? -2 : -1;
 }
 
-/* ============================
-      INITIALIZE
-   ============================ */
-
-static void ltok_init(ltok_state *S, const char *source) {
-  S->src = source;
-  S->cur = source;
-  S->tok.kind = LTOK_UNKNOWN;
-  S->tok.text[0] = 0;
+/* Skips to just past the "]" "="*level "]" closing a long bracket whose
+   opener ends at c. Returns NULL, with S->cur at the end, if there is
+   none. */
+static inline const char *lt_long_close(ltok_state *S, const char *c, int level) {
+  for (;; c++) {
+    switch (*c) {
+    case '\n':
+      S->line++;
+      S->line_start = c + 1;
+      break;
+    case ']': {
+      const char *p = c + 1;
+      int eqs = 0;
+      while (*p == '=')
+        p++, eqs++;
+      if (eqs == level && *p == ']')
+        return p + 1;
+      c = p - 1;
+      break;
+    }
+    case '\0':
+      if (c == S->end) {
+        S->cur = c;
+        return NULL;
+      }
+      break;
+    }
+  }
 }
 
-/* ============================
-      MAIN TOKENIZER
-   ============================ */
-
-static void ltok_next(ltok_state *S) {
-  const char *c = S->cur;
-
-again:
-  /* skip whitespace */
-  while (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r')
+/* After the opening quote: skips to just past the closing one. Sets *bad
+   for an escape Lua would reject, and stops (returning NULL, with S->cur at
+   the stop) at an unescaped line break or the end of input. */
+static inline const char *lt_short_string(ltok_state *S, const char *c, char quote,
+                                   int *bad) {
+  for (;;) {
+    char ch = *c;
+    if (ch == quote)
+      return c + 1;
+    if (ch == '\n' || ch == '\r' || (ch == '\0' && c == S->end)) {
+      S->cur = c;
+      return NULL;
+    }
     c++;
-
-  /* EOF */
-  if (*c == '\0') {
-    S->tok.kind = LTOK_EOF;
-    S->tok.text[0] = 0;
-    S->cur = c;
-    return;
+    if (ch != '\\')
+      continue;
+    switch (*c) {
+    case 'a':
+    case 'b':
+    case 'f':
+    case 'n':
+    case 'r':
+    case 't':
+    case 'v':
+    case '\\':
+    case '"':
+    case '\'':
+      c++;
+      break;
+    case '\r':
+    case '\n': { /* an escaped line break, \r\n and \n\r count once */
+      char first = *c++;
+      if ((*c == '\n' || *c == '\r') && *c != first)
+        c++;
+      S->line++;
+      S->line_start = c;
+      break;
+    }
+    case 'x':
+      if (LT_IS_XDIGIT(c[1]) && LT_IS_XDIGIT(c[2]))
+        c += 3;
+      else
+        *bad = 1;
+      break;
+    case 'z': /* skips the following whitespace, line breaks included */
+      for (c++; LT_CLASS(*c) == '_' || *c == '\n'; c++)
+        if (*c == '\n') {
+          S->line++;
+          S->line_start = c + 1;
+        }
+      break;
+    case 'u': {
+      unsigned long cp = 0;
+      const char *p = c + 2;
+      if (c[1] != '{' || !LT_IS_XDIGIT(*p)) {
+        *bad = 1;
+        break;
+      }
+      for (; LT_IS_XDIGIT(*p); p++) {
+        cp = cp * 16 + (unsigned)(LT_IS_DIGIT(*p) ? *p - '0'
+                                                  : (*p | 32) - 'a' + 10);
+        if (cp > 0x7FFFFFFFul) { /* Lua allows up to 2^31 - 1 */
+          *bad = 1;
+          cp = 0x80000000ul;
+        }
+      }
+      if (*p == '}')
+        p++;
+      else
+        *bad = 1;
+      c = p;
+      break;
+    }
+    default:
+      if (LT_IS_DIGIT(*c)) { /* \ddd, at most 255 */
+        int value = 0, n = 0;
+        while (n < 3 && LT_IS_DIGIT(*c))
+          value = value * 10 + (*c++ - '0'), n++;
+        if (value > 255)
+          *bad = 1;
+      } else {
+        *bad = 1; /* the loop handles what follows, even a line break */
+      }
+      break;
+    }
   }
+}
 
-  /* comments */
-  if (c[0] == '-' && c[1] == '-') {
-    c += 2;
-    while (*c && *c != '\n')
-      c++;
-    goto again;
+/* Whether s[0..len) is a well-formed Lua numeral. */
+static inline int lt_numeral_ok(const char *s, const char *e) {
+  int hex = s[0] == '0' && (s[1] | 32) == 'x', digits = 0;
+  if (hex)
+    s += 2;
+  for (; s < e && (hex ? LT_IS_XDIGIT(*s) : LT_IS_DIGIT(*s)); s++)
+    digits++;
+  if (s < e && *s == '.')
+    for (s++; s < e && (hex ? LT_IS_XDIGIT(*s) : LT_IS_DIGIT(*s)); s++)
+      digits++;
+  if (!digits)
+    return 0;
+  if (s < e && (*s | 32) == (hex ? 'p' : 'e')) {
+    s++;
+    if (s < e && (*s == '+' || *s == '-'))
+      s++;
+    if (s == e || !LT_IS_DIGIT(*s))
+      return 0;
+    while (s < e && LT_IS_DIGIT(*s))
+      s++;
   }
+  return s == e;
+}
 
-  /* identifier / keyword */
-  if (lt_is_ident_start(*c)) {
-    char buf[128];
-    int i = 0;
-
-    while (lt_is_ident_char(*c) && i < 127)
-      buf[i++] = *c++;
-    buf[i] = 0;
-
-    /* keywords */
-    if (!strcmp(buf, "if")) {
-      S->tok.kind = LTOK_KW_IF;
-    } else if (!strcmp(buf, "then")) {
-      S->tok.kind = LTOK_KW_THEN;
-    } else if (!strcmp(buf, "end")) {
-      S->tok.kind = LTOK_KW_END;
-    } else if (!strcmp(buf, "function")) {
-      S->tok.kind = LTOK_KW_FUNCTION;
-    } else if (!strcmp(buf, "local")) {
-      S->tok.kind = LTOK_KW_LOCAL;
-    } else if (!strcmp(buf, "return")) {
-      S->tok.kind = LTOK_KW_RETURN;
+/* Reads a numeral the way llex.c does (digits, '.', exponents with their
+   sign), then the rest of any name it runs into, so "3x" is one malformed
+   number rather than 3 followed by x. */
+static inline const char *lt_number(const char *c, ltok_kind *kind) {
+  const char *start = c;
+  char expo = 'e';
+  if (c[0] == '0' && (c[1] | 32) == 'x')
+    c += 2, expo = 'p';
+  for (;;) {
+    if ((*c | 32) == expo) {
+      c++;
+      if (*c == '+' || *c == '-')
+        c++;
+    } else if (LT_IS_XDIGIT(*c) || *c == '.') {
+      c++;
     } else {
-      S->tok.kind = LTOK_IDENT;
-      strcpy(S->tok.text, buf);
+      break;
     }
-
-    S->cur = c;
-    return;
   }
+  while (LT_IS_NAME(*c))
+    c++;
+  *kind = lt_numeral_ok(start, c) ? LTOK_NUMBER : LTOK_UNKNOWN;
+  return c;
+}
 
-  /* number (integer only) */
-  if (*c >= '0' && *c <= '9') {
-    char buf[128];
-    int i = 0;
+/* ============================
+      INITIALIZE
+   ============================ */
 
-    while (*c >= '0' && *c <= '9' && i < 127)
-      buf[i++] = *c++;
-    buf[i] = 0;
+/* `source` must stay alive while tokens are in use; source[len] == '\0'. */
+static inline void ltok_init_len(ltok_state *S, const char *source, size_t len) {
+  S->src = S->cur = S->line_start = source;
+  S->end = source + len;
+  S->line = 1;
+  S->tok = (ltoken){LTOK_UNKNOWN, source, 0, 1, 1};
+}
 
-    S->tok.kind = LTOK_NUMBER;
-    strcpy(S->tok.text, buf);
-    S->cur = c;
-    return;
-  }
+static inline void ltok_init(ltok_state *S, const char *source) {
+  ltok_init_len(S, source, strlen(source));
+}
+
+/* ============================
+      MAIN TOKENIZER
+   ============================ */
 
-  /* string (no escape sequences) */
-  if (*c == '"' || *c == '\'') {
-    char quote = *c++;
-    char buf[128];
-    int i = 0;
+static inline void ltok_next(ltok_state *S) {
+  const char *c = S->cur, *start;
+  ltok_kind k;
 
-    while (*c && *c != quote && i < 127)
-      buf[i++] = *c++;
-    if (*c == quote)
+  for (;;) {
+    /* Blanks between tokens are the common case: skip them before the
+       switch rather than through it. */
+    while (LT_CLASS(*c) == '_')
+      c++;
+    start = c;
+    switch (LT_CLASS(*c)) {
+    case 'n':
+      S->line++;
+      S->line_start = ++c;
+      continue;
+
+    case 'z':
+      if (c == S->end) {
+        k = LTOK_EOF;
+        goto done;
+      }
+      k = LTOK_UNKNOWN; /* a NUL inside the source */
       c++;
-    buf[i] = 0;
+      goto done;
+
+    case 'a':
+      while (LT_IS_NAME(*++c))
+        ;
+      k = lt_name_kind(start, (size_t)(c - start));
+      goto done;
+
+    case 'b':
+      c = lt_number(c, &k);
+      goto done;
+
+    case 'p':
+      if (LT_IS_DIGIT(c[1])) {
+        c = lt_number(c, &k);
+      } else if (c[1] != '.') {
+        k = LTOK_DOT, c++;
+      } else if (c[2] != '.') {
+        k = LTOK_CONCAT, c += 2;
+      } else {
+        k = LTOK_DOTS, c += 3;
+      }
+      goto done;
+
+    case 'q': { /* may span lines through escapes: keep where it started */
+      int bad = 0, line = S->line;
+      const char *line_start = S->line_start;
+      const char *e = lt_short_string(S, c + 1, *c, &bad);
+      c = e ? e : S->cur;
+      S->tok = (ltoken){e && !bad ? LTOK_STRING : LTOK_UNKNOWN, start,
+                        (size_t)(c - start), line,
+                        (int)(start - line_start) + 1};
+      S->cur = c;
+      return;
+    }
 
-    S->tok.kind = LTOK_STRING;
-    strcpy(S->tok.text, buf);
-    S->cur = c;
-    return;
-  }
+    case 'm':
+      if (c[1] != '-') {
+        k = LTOK_MINUS, c++;
+        goto done;
+      }
+      c += 2;
+      if (*c == '[') {
+        int level = lt_long_open(c);
+        if (level >= 0) {
+          int line = S->line;
+          const char *line_start = S->line_start;
+          const char *e = lt_long_close(S, c + level + 2, level);
+          if (!e) { /* unfinished long comment */
+            S->tok = (ltoken){LTOK_UNKNOWN, start, (size_t)(S->cur - start),
+                              line, (int)(start - line_start) + 1};
+            return;
+          }
+          c = e;
+          continue;
+        }
+      }
+      c = memchr(c, '\n', (size_t)(S->end - c));
+      if (!c)
+        c = S->end;
+      continue;
+
+    case 'k': {
+      int level = lt_long_open(c);
+      if (level == -1) {
+        k = LTOK_LBRACKET, c++;
+        goto done;
+      }
+      if (level == -2) { /* "[=" without the second '[' */
+        for (c++; *c == '='; c++)
+          ;
+        k = LTOK_UNKNOWN;
+        goto done;
+      }
+      int line = S->line;
+      const char *line_start = S->line_start;
+      const char *e = lt_long_close(S, c + level + 2, level);
+      S->tok = (ltoken){e ? LTOK_STRING : LTOK_UNKNOWN, start,
+                        (size_t)((e ? e : S->cur) - start), line,
+                        (int)(start - line_start) + 1};
+      if (e)
+        S->cur = e;
+      return;
+    }
 
-  /* single-char operators */
-  char ch = *c++;
-  ltok_kind k = LTOK_UNKNOWN;
-
-  switch (ch) {
-  case '=':
-    k = LTOK_EQ;
-    break;
-  case '+':
-    k = LTOK_PLUS;
-    break;
-  case '-':
-    k = LTOK_MINUS;
-    break;
-  case '*':
-    k = LTOK_STAR;
-    break;
-  case '/':
-    k = LTOK_SLASH;
-    break;
-  case '(':
-    k = LTOK_LPAREN;
-    break;
-  case ')':
-    k = LTOK_RPAREN;
-    break;
-  case '{':
-    k = LTOK_LBRACE;
-    break;
-  case '}':
-    k = LTOK_RBRACE;
-    break;
-  case ',':
-    k = LTOK_COMMA;
-    break;
-  case '.':
-    k = LTOK_DOT;
-    break;
-  default:
-    k = LTOK_UNKNOWN;
-    break;
+    case 'o':
+      switch (*c++) {
+      case '/':
+        k = *c == '/' ? (c++, LTOK_IDIV) : LTOK_SLASH;
+        break;
+      case '<':
+        k = *c == '<' ? (c++, LTOK_SHL) : *c == '=' ? (c++, LTOK_LE) : LTOK_LT;
+        break;
+      case '>':
+        k = *c == '>' ? (c++, LTOK_SHR) : *c == '=' ? (c++, LTOK_GE) : LTOK_GT;
+        break;
+      case '=':
+        k = *c == '=' ? (c++, LTOK_EQEQ) : LTOK_EQ;
+        break;
+      case '~':
+        k = *c == '=' ? (c++, LTOK_NE) : LTOK_TILDE;
+        break;
+      default: /* ':' */
+        k = *c == ':' ? (c++, LTOK_DBCOLON) : LTOK_COLON;
+        break;
+      }
+      goto done;
+
+    case 's':
+      k = (ltok_kind)lt_single[(unsigned char)*c++];
+      goto done;
+
+    default: /* 'x' */
+      k = LTOK_UNKNOWN, c++;
+      goto done;
+    }
   }
 
-  S->tok.kind = k;
-  S->tok.text[0] = ch;
-  S->tok.text[1] = 0;
+done:
+  S->tok = (ltoken){k, start, (size_t)(c - start), S->line,
+                    (int)(start - S->line_start) + 1};
   S->cur = c;
 }
 
@@ -239,59 +555,30 @@ again:
 #ifndef LUATOKEN_NO_PRINT
 #include <stdio.h>
 
-static const char *ltok_name(ltok_kind k) {
-  switch (k) {
-  case LTOK_EOF:
-    return "EOF";
-  case LTOK_IDENT:
-    return "IDENT";
-  case LTOK_NUMBER:
-    return "NUMBER";
-  case LTOK_STRING:
-    return "STRING";
-  case LTOK_KW_IF:
-    return "KW_IF";
-  case LTOK_KW_THEN:
-    return "KW_THEN";
-  case LTOK_KW_END:
-    return "KW_END";
-  case LTOK_KW_FUNCTION:
-    return "KW_FUNCTION";
-  case LTOK_KW_LOCAL:
-    return "KW_LOCAL";
-  case LTOK_KW_RETURN:
-    return "KW_RETURN";
-  case LTOK_EQ:
-    return "EQ";
-  case LTOK_PLUS:
-    return "PLUS";
-  case LTOK_MINUS:
-    return "MINUS";
-  case LTOK_STAR:
-    return "STAR";
-  case LTOK_SLASH:
-    return "SLASH";
-  case LTOK_LPAREN:
-    return "LPAREN";
-  case LTOK_RPAREN:
-    return "RPAREN";
-  case LTOK_LBRACE:
-    return "LBRACE";
-  case LTOK_RBRACE:
-    return "RBRACE";
-  case LTOK_COMMA:
-    return "COMMA";
-  case LTOK_DOT:
-    return "DOT";
-  default:
-    return "UNKNOWN";
-  }
+static inline const char *ltok_name(ltok_kind k) {
+  static const char *const names[] = {
+      "EOF",       "IDENT",     "NUMBER",    "STRING",    "KW_IF",
+      "KW_THEN",   "KW_END",    "KW_FUNCTION", "KW_LOCAL", "KW_RETURN",
+      "EQ",        "PLUS",      "MINUS",     "STAR",      "SLASH",
+      "LPAREN",    "RPAREN",    "LBRACE",    "RBRACE",    "COMMA",
+      "DOT",       "KW_AND",    "KW_BREAK",  "KW_DO",     "KW_ELSE",
+      "KW_ELSEIF", "KW_FALSE",  "KW_FOR",    "KW_GOTO",   "KW_IN",
+      "KW_NIL",    "KW_NOT",    "KW_OR",     "KW_REPEAT", "KW_TRUE",
+      "KW_UNTIL",  "KW_WHILE",  "IDIV",      "PERCENT",   "CARET",
+      "HASH",      "AMP",       "TILDE",     "PIPE",      "SHL",
+      "SHR",       "EQEQ",      "NE",        "LE",        "GE",
+      "LT",        "GT",        "LBRACKET",  "RBRACKET",  "DBCOLON",
+      "SEMI",      "COLON",     "CONCAT",    "DOTS",
+  };
+  if ((unsigned)k < sizeof(names) / sizeof(names[0]))
+    return names[k];
+  return "UNKNOWN";
 }
 
-static void ltok_print(const ltoken *t) {
+static inline void ltok_print(const ltoken *t) {
   if (t->kind == LTOK_IDENT || t->kind == LTOK_NUMBER ||
       t->kind == LTOK_STRING || t->kind == LTOK_UNKNOWN) {
-    printf("%s('%s')\n", ltok_name(t->kind), t->text);
+    printf("%s('%.*s')\n", ltok_name(t->kind), (int)t->len, t->start);
   } else {
     printf("%s\n", ltok_name(t->kind));
   }
@@ -8,7 +8,10 @@ int main() {
                      "  return a + b\n"
                      "end\n"
                      "-- comment test\n"
-                     "if x then x = x + 1 end\n";
+                     "if x then x = x + 1 end\n"
+                     "--[==[ long\n comment ]==]\n"
+                     "local s = [[\nlong string]] .. 'tab\\t' // 0x1p4\n"
+                     "goto continue ::continue:: t[#t] = 3.5e-2 ~= 1 >> 2\n";
 
   ltok_state S;
   ltok_init(&S, code);
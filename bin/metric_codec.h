@@ -0,0 +1,214 @@
+/* metric_codec.h - compact delta encoding of metric samples (single-header)
+
+   A schema fixes the column order and the type of every column once; each
+   sample is then a short bit string holding only what changed since the
+   previous sample of the same stream:
+
+     MC_INT    zig-zag varint of (value - previous), LEB128 groups of 7 bits
+     MC_FLOAT  Gorilla XOR against the previous value's bits:
+                 '0'                          identical
+                 '10' + bits                  fits the previous window
+                 '11' + 5b lead + 6b (len-1) + len bits   new window
+
+   Bits are written MSB first, and the last byte is zero-padded. Both sides
+   start from 0 / +0.0 with no window, so the first sample after a reset
+   carries full values. Encoder and decoder must see the same sequence of
+   samples; resend the schema (and reset both ends) whenever it changes.
+
+   Usage:
+
+     #define METRIC_CODEC_IMPLEMENTATION
+     #include "metric_codec.h"
+
+     McStream enc;
+     mc_reset(&enc, 3, (const uint8_t[]){MC_INT, MC_FLOAT, MC_FLOAT});
+     uint64_t vals[3] = {ts, mc_f2u(cpu), mc_f2u(load)};
+     uint8_t out[MC_MAX_FRAME];
+     size_t n = mc_encode(&enc, vals, out);
+*/
+
+#ifndef METRIC_CODEC_H
+#define METRIC_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef MC_MAX_COLS
+#define MC_MAX_COLS 272
+#endif
+
+// Worst case per column is a 10-byte varint or 2+5+6+64 bits.
+#define MC_MAX_FRAME (MC_MAX_COLS * 10 + 1)
+
+enum { MC_INT, MC_FLOAT };
+
+typedef struct {
+  int ncols;
+  uint8_t types[MC_MAX_COLS];
+  uint64_t prev[MC_MAX_COLS]; // previous value (int) or bit pattern (float)
+  uint8_t lead[MC_MAX_COLS];  // previous XOR window; lead+trail == 64
+  uint8_t trail[MC_MAX_COLS]; // means "no window yet"
+} McStream;
+
+static inline uint64_t mc_f2u(double d) {
+  uint64_t u;
+  memcpy(&u, &d, sizeof(u));
+  return u;
+}
+
+static inline double mc_u2f(uint64_t u) {
+  double d;
+  memcpy(&d, &u, sizeof(d));
+  return d;
+}
+
+// Returns 0, or -1 if ncols is out of range.
+int mc_reset(McStream *s, int ncols, const uint8_t *types);
+// Encodes one sample (ints as int64 bit patterns, floats via mc_f2u) into
+// `out`, which must hold MC_MAX_FRAME bytes. Returns the bytes written.
+size_t mc_encode(McStream *s, const uint64_t *vals, uint8_t *out);
+// Decodes one sample; returns 0, or -1 on truncated input.
+int mc_decode(McStream *s, const uint8_t *in, size_t len, uint64_t *vals);
+
+#ifdef METRIC_CODEC_IMPLEMENTATION
+
+typedef struct {
+  uint8_t *buf;
+  size_t bit;
+} McWriter;
+
+typedef struct {
+  const uint8_t *buf;
+  size_t bit, nbits;
+} McReader;
+
+static void mc_put(McWriter *w, uint64_t v, int nbits) {
+  while (nbits > 0) {
+    size_t byte = w->bit >> 3;
+    int room = 8 - (int)(w->bit & 7);
+    int take = nbits < room ? nbits : room;
+    uint8_t chunk = (uint8_t)((v >> (nbits - take)) & ((1u << take) - 1));
+    if ((w->bit & 7) == 0)
+      w->buf[byte] = 0;
+    w->buf[byte] |= (uint8_t)(chunk << (room - take));
+    w->bit += (size_t)take;
+    nbits -= take;
+  }
+}
+
+static int mc_get(McReader *r, int nbits, uint64_t *out) {
+  uint64_t v = 0;
+  if (r->bit + (size_t)nbits > r->nbits)
+    return -1;
+  while (nbits > 0) {
+    int room = 8 - (int)(r->bit & 7);
+    int take = nbits < room ? nbits : room;
+    uint8_t byte = r->buf[r->bit >> 3];
+    v = (v << take) | ((byte >> (room - take)) & ((1u << take) - 1));
+    r->bit += (size_t)take;
+    nbits -= take;
+  }
+  *out = v;
+  return 0;
+}
+
+int mc_reset(McStream *s, int ncols, const uint8_t *types) {
+  if (ncols < 0 || ncols > MC_MAX_COLS)
+    return -1;
+  s->ncols = ncols;
+  memcpy(s->types, types, (size_t)ncols);
+  memset(s->prev, 0, sizeof(s->prev));
+  memset(s->lead, 64, sizeof(s->lead));
+  memset(s->trail, 0, sizeof(s->trail));
+  return 0;
+}
+
+size_t mc_encode(McStream *s, const uint64_t *vals, uint8_t *out) {
+  McWriter w = {out, 0};
+  for (int c = 0; c < s->ncols; c++) {
+    uint64_t v = vals[c];
+    if (s->types[c] == MC_INT) {
+      int64_t d = (int64_t)(v - s->prev[c]);
+      uint64_t zz = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+      do {
+        mc_put(&w, (zz > 0x7f ? 0x80 : 0) | (zz & 0x7f), 8);
+        zz >>= 7;
+      } while (zz);
+    } else {
+      uint64_t x = v ^ s->prev[c];
+      if (x == 0) {
+        mc_put(&w, 0, 1);
+      } else {
+        int lead = __builtin_clzll(x), trail = __builtin_ctzll(x);
+        if (lead > 31)
+          lead = 31;
+        if (s->lead[c] + s->trail[c] < 64 && lead >= s->lead[c] &&
+            trail >= s->trail[c]) {
+          int len = 64 - s->lead[c] - s->trail[c];
+          mc_put(&w, 2, 2);
+          mc_put(&w, x >> s->trail[c], len);
+        } else {
+          int len = 64 - lead - trail;
+          mc_put(&w, 3, 2);
+          mc_put(&w, (uint64_t)lead, 5);
+          mc_put(&w, (uint64_t)(len - 1), 6);
+          mc_put(&w, x >> trail, len);
+          s->lead[c] = (uint8_t)lead;
+          s->trail[c] = (uint8_t)trail;
+        }
+      }
+    }
+    s->prev[c] = v;
+  }
+  return (w.bit + 7) >> 3;
+}
+
+int mc_decode(McStream *s, const uint8_t *in, size_t len, uint64_t *vals) {
+  McReader r = {in, 0, len * 8};
+  for (int c = 0; c < s->ncols; c++) {
+    uint64_t v, bits;
+    if (s->types[c] == MC_INT) {
+      uint64_t zz = 0;
+      int shift = 0;
+      do {
+        if (mc_get(&r, 8, &bits) != 0 || shift > 63)
+          return -1;
+        zz |= (bits & 0x7f) << shift;
+        shift += 7;
+      } while (bits & 0x80);
+      v = s->prev[c] + (uint64_t)((int64_t)(zz >> 1) ^ -(int64_t)(zz & 1));
+    } else {
+      if (mc_get(&r, 1, &bits) != 0)
+        return -1;
+      if (bits == 0) {
+        v = s->prev[c];
+      } else {
+        uint64_t fresh, lead, len, x;
+        if (mc_get(&r, 1, &fresh) != 0)
+          return -1;
+        if (fresh) {
+          if (mc_get(&r, 5, &lead) != 0 || mc_get(&r, 6, &len) != 0)
+            return -1;
+          len++;
+          if (lead + len > 64)
+            return -1;
+          s->lead[c] = (uint8_t)lead;
+          s->trail[c] = (uint8_t)(64 - lead - len);
+        } else if (s->lead[c] + s->trail[c] >= 64) {
+          return -1; // window reuse before any window was set
+        }
+        len = 64 - s->lead[c] - s->trail[c];
+        if (mc_get(&r, (int)len, &x) != 0)
+          return -1;
+        v = s->prev[c] ^ (x << s->trail[c]);
+      }
+    }
+    s->prev[c] = v;
+    vals[c] = v;
+  }
+  return 0;
+}
+
+#endif // METRIC_CODEC_IMPLEMENTATION
+#endif // METRIC_CODEC_H
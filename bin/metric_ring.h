@@ -0,0 +1,225 @@
+/* metric_ring.h - lock-free metric history with rollups (single-header, C11)
+
+   Keeps recent samples at full resolution plus min/max/avg rollups at 1s,
+   10s and 60s granularity, each in its own fixed-size ring. One thread
+   records samples; any number of threads may read concurrently without
+   locks or allocation.
+
+   Every ring slot carries a sequence number (a per-slot seqlock): the writer
+   marks the slot odd while copying a record in and publishes the record's
+   position when done, so a reader that races with an overwrite sees a
+   mismatch and skips the slot instead of returning a torn record.
+
+   Usage:
+
+     #define METRIC_RING_IMPLEMENTATION
+     #include "metric_ring.h"
+
+     MetricHistory h;
+     mh_init(&h, 2, 4096);                       // 2 fields, 4096 raw points
+     mh_record(&h, now_ms, (double[]){cpu, mem}); // producer thread
+     MrRecord out[60];
+     size_t n = mh_query(&h, MR_LEVEL_10S, out, 60); // any thread
+*/
+
+#ifndef METRIC_RING_H
+#define METRIC_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MR_MAX_FIELDS
+#define MR_MAX_FIELDS 4
+#endif
+
+typedef struct {
+  uint64_t t_ms;  // sample time, or bucket start for rollups
+  uint32_t count; // samples aggregated (1 for raw points)
+  double min[MR_MAX_FIELDS];
+  double max[MR_MAX_FIELDS];
+  double avg[MR_MAX_FIELDS]; // the value itself for raw points
+} MrRecord;
+
+typedef struct {
+  _Atomic uint64_t seq; // 2*pos+1 while writing, 2*pos+2 once published
+  MrRecord rec;
+} MrSlot;
+
+typedef struct {
+  _Atomic uint64_t head; // records ever pushed
+  uint64_t mask;         // capacity - 1 (capacity is a power of two)
+  MrSlot *slots;
+} MrRing;
+
+typedef enum {
+  MR_LEVEL_RAW,
+  MR_LEVEL_1S,
+  MR_LEVEL_10S,
+  MR_LEVEL_60S,
+  MR_LEVEL_COUNT
+} MrLevel;
+
+typedef struct {
+  int nfields;
+  MrRing rings[MR_LEVEL_COUNT];
+  MrRecord open[MR_LEVEL_COUNT]; // producer-private partial buckets
+} MetricHistory;
+
+// Capacities are rounded up to powers of two. Returns 0 or -1 (no memory).
+int mr_ring_init(MrRing *ring, size_t capacity);
+void mr_ring_free(MrRing *ring);
+void mr_ring_push(MrRing *ring, const MrRecord *rec); // single producer only
+// Copies up to `max` of the newest records, oldest first.
+size_t mr_ring_read(MrRing *ring, MrRecord *out, size_t max);
+
+// Rollup rings keep 1 hour of 1s, 6 hours of 10s and 24 hours of 60s buckets.
+int mh_init(MetricHistory *h, int nfields, size_t raw_capacity);
+void mh_free(MetricHistory *h);
+void mh_record(MetricHistory *h, uint64_t t_ms, const double *values);
+size_t mh_query(MetricHistory *h, MrLevel level, MrRecord *out, size_t max);
+
+// "raw", "1s", "10s", "60s" <-> MrLevel; mr_level_parse returns -1 if unknown.
+const char *mr_level_name(MrLevel level);
+int mr_level_parse(const char *name);
+
+#ifdef METRIC_RING_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+static const uint64_t mr_level_ms[MR_LEVEL_COUNT] = {0, 1000, 10000, 60000};
+static const size_t mr_level_cap[MR_LEVEL_COUNT] = {0, 3600, 2160, 1440};
+static const char *const mr_level_names[MR_LEVEL_COUNT] = {"raw", "1s", "10s",
+                                                           "60s"};
+
+int mr_ring_init(MrRing *ring, size_t capacity) {
+  size_t cap = 1;
+  while (cap < capacity)
+    cap <<= 1;
+  ring->slots = calloc(cap, sizeof(MrSlot));
+  if (!ring->slots)
+    return -1;
+  ring->mask = cap - 1;
+  atomic_init(&ring->head, 0);
+  for (size_t i = 0; i < cap; i++)
+    atomic_init(&ring->slots[i].seq, 0);
+  return 0;
+}
+
+void mr_ring_free(MrRing *ring) {
+  free(ring->slots);
+  ring->slots = NULL;
+}
+
+void mr_ring_push(MrRing *ring, const MrRecord *rec) {
+  uint64_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  MrSlot *slot = &ring->slots[pos & ring->mask];
+  atomic_store_explicit(&slot->seq, 2 * pos + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  memcpy(&slot->rec, rec, sizeof(*rec));
+  atomic_store_explicit(&slot->seq, 2 * pos + 2, memory_order_release);
+  atomic_store_explicit(&ring->head, pos + 1, memory_order_release);
+}
+
+size_t mr_ring_read(MrRing *ring, MrRecord *out, size_t max) {
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  uint64_t cap = ring->mask + 1;
+  uint64_t avail = head < cap ? head : cap;
+  if (max > avail)
+    max = (size_t)avail;
+
+  size_t n = 0;
+  for (uint64_t pos = head - max; pos < head; pos++) {
+    MrSlot *slot = &ring->slots[pos & ring->mask];
+    uint64_t want = 2 * pos + 2;
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != want)
+      continue; // already overwritten by a newer record
+    memcpy(&out[n], &slot->rec, sizeof(MrRecord));
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == want)
+      n++; // otherwise torn: drop it
+  }
+  return n;
+}
+
+int mh_init(MetricHistory *h, int nfields, size_t raw_capacity) {
+  memset(h, 0, sizeof(*h));
+  if (nfields < 1 || nfields > MR_MAX_FIELDS)
+    return -1;
+  h->nfields = nfields;
+  for (int l = 0; l < MR_LEVEL_COUNT; l++) {
+    size_t cap = l == MR_LEVEL_RAW ? raw_capacity : mr_level_cap[l];
+    if (mr_ring_init(&h->rings[l], cap) != 0) {
+      mh_free(h);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void mh_free(MetricHistory *h) {
+  for (int l = 0; l < MR_LEVEL_COUNT; l++)
+    mr_ring_free(&h->rings[l]);
+}
+
+static void mh_close_bucket(MetricHistory *h, int level) {
+  MrRecord *b = &h->open[level];
+  if (b->count == 0)
+    return;
+  for (int f = 0; f < h->nfields; f++)
+    b->avg[f] /= b->count; // avg held the running sum
+  mr_ring_push(&h->rings[level], b);
+  b->count = 0;
+}
+
+void mh_record(MetricHistory *h, uint64_t t_ms, const double *values) {
+  MrRecord raw = {0};
+  raw.t_ms = t_ms;
+  raw.count = 1;
+  for (int f = 0; f < h->nfields; f++)
+    raw.min[f] = raw.max[f] = raw.avg[f] = values[f];
+  mr_ring_push(&h->rings[MR_LEVEL_RAW], &raw);
+
+  // Buckets are aligned to multiples of their period and published once a
+  // sample lands past their end; the partial bucket is not visible yet.
+  for (int l = MR_LEVEL_1S; l < MR_LEVEL_COUNT; l++) {
+    MrRecord *b = &h->open[l];
+    uint64_t start = t_ms - t_ms % mr_level_ms[l];
+    if (b->count && b->t_ms != start)
+      mh_close_bucket(h, l);
+    if (b->count == 0) {
+      *b = raw;
+      b->t_ms = start;
+      continue;
+    }
+    b->count++;
+    for (int f = 0; f < h->nfields; f++) {
+      if (values[f] < b->min[f])
+        b->min[f] = values[f];
+      if (values[f] > b->max[f])
+        b->max[f] = values[f];
+      b->avg[f] += values[f];
+    }
+  }
+}
+
+size_t mh_query(MetricHistory *h, MrLevel level, MrRecord *out, size_t max) {
+  if ((unsigned)level >= MR_LEVEL_COUNT)
+    return 0;
+  return mr_ring_read(&h->rings[level], out, max);
+}
+
+const char *mr_level_name(MrLevel level) {
+  return (unsigned)level < MR_LEVEL_COUNT ? mr_level_names[level] : "?";
+}
+
+int mr_level_parse(const char *name) {
+  for (int l = 0; l < MR_LEVEL_COUNT; l++)
+    if (strcmp(name, mr_level_names[l]) == 0)
+      return l;
+  return -1;
+}
+
+#endif // METRIC_RING_IMPLEMENTATION
+#endif // METRIC_RING_H
@@ -0,0 +1,409 @@
+/* piece.h - Line-addressed piece table for mirroring editor buffers (single-header)
+
+   A buffer is a sequence of pieces, each a run of whole lines ('\n'
+   included) in an append-only arena. The pieces sit in a treap ordered by
+   position, every node carrying the line and byte totals of its subtree,
+   so finding a line, splitting at it and joining are O(log n). Replacing
+   lines [first, last), as nvim_buf_attach()'s on_lines reports them,
+   splits twice, drops the pieces in between and appends the new text as
+   new pieces: O(log n + changed lines), never touching the rest of the
+   text. Pieces hold at most PT_PIECE_BYTES (unless a single line is
+   longer), which bounds the scan for a line inside one. Replaced text
+   stays in the arena until it is more than half garbage, and edits leave
+   ever smaller pieces behind; when either gets out of hand the live text
+   is copied into a fresh arena in full-size pieces. An edit cuts at most
+   two pieces besides those of its new text, and PT_PIECE_SLACK are
+   allowed beyond twice the minimum, so that O(n) pass comes at most every
+   PT_PIECE_SLACK / 3 or so edits.
+
+   Readers get the text as chunks: pt_chunk() returns the contiguous run
+   from the start of a line to the end of its piece, so chunks always hold
+   whole lines and can go straight to a line-oriented consumer such as
+   sr_search() (add the chunk's first line to its line numbers). A lexer
+   that needs one contiguous window (a viewport) gets it from pt_copy().
+
+   Usage:
+
+     #define PIECE_IMPLEMENTATION
+     #include "piece.h"
+
+     PieceTable pt;
+     pt_init(&pt);
+     pt_set_lines(&pt, 0, 0, lines, n);         // attach: every line
+     pt_set_lines(&pt, first, last, new, m);    // on_lines: replace [first,last)
+     PtChunk c;
+     for (size_t l = 0; pt_chunk(&pt, l, &c); l += c.lines)
+       ... c.ptr, c.len: lines c.line .. c.line + c.lines - 1 ...
+     pt_free(&pt);
+*/
+
+#ifndef PIECE_H
+#define PIECE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PT_PIECE_BYTES 16384
+#define PT_PIECE_SLACK 2048
+
+// A line of new text, without its '\n'.
+typedef struct {
+  const char *ptr;
+  size_t len;
+} PtText;
+
+typedef struct {
+  uint32_t left, right; // node indexes, 0 = none
+  uint32_t prio;
+  uint32_t lines;       // in this piece
+  size_t off, len;      // its bytes in the arena
+  size_t sub_lines, sub_len; // of the whole subtree
+} PtNode;
+
+typedef struct {
+  char *text; // the arena
+  size_t text_len, text_cap;
+  size_t live; // arena bytes still in some piece
+  PtNode *nodes; // nodes[0] is the empty tree
+  size_t nodes_len, nodes_cap;
+  uint32_t free_node; // chained through .left
+  size_t pieces;
+  uint32_t root;
+  uint32_t seed;
+} PieceTable;
+
+typedef struct {
+  const char *ptr; // whole lines, each ending in '\n'
+  size_t len;
+  size_t line, lines; // 0-based first line, line count
+} PtChunk;
+
+void pt_init(PieceTable *pt);
+void pt_free(PieceTable *pt);
+size_t pt_line_count(const PieceTable *pt);
+// Bytes, counting one '\n' per line.
+size_t pt_length(const PieceTable *pt);
+// Replaces lines [first, last) with `n` new ones (first == last inserts).
+// Returns 0, or -1 if out of memory or the range is outside the buffer; on
+// failure the table is unchanged.
+int pt_set_lines(PieceTable *pt, size_t first, size_t last,
+                 const PtText *lines, size_t n);
+// The text from the start of `line` to the end of the piece holding it.
+// Returns 0 past the last line. Valid until the next pt_set_lines().
+int pt_chunk(const PieceTable *pt, size_t line, PtChunk *out);
+// Line `line` without its '\n', NULL past the last line.
+const char *pt_line(const PieceTable *pt, size_t line, size_t *len);
+// A malloc'd copy of lines [first, last) ('\n' after each, then a NUL not
+// counted in *len), or NULL if out of memory. `last` is clamped.
+char *pt_copy(const PieceTable *pt, size_t first, size_t last, size_t *len);
+
+#ifdef PIECE_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+void pt_init(PieceTable *pt) {
+  memset(pt, 0, sizeof(*pt));
+  pt->seed = 2463534242u;
+}
+
+void pt_free(PieceTable *pt) {
+  free(pt->text);
+  free(pt->nodes);
+  memset(pt, 0, sizeof(*pt));
+}
+
+size_t pt_line_count(const PieceTable *pt) {
+  return pt->root ? pt->nodes[pt->root].sub_lines : 0;
+}
+
+size_t pt_length(const PieceTable *pt) {
+  return pt->root ? pt->nodes[pt->root].sub_len : 0;
+}
+
+static int pt_reserve(void **p, size_t *cap, size_t need, size_t size) {
+  if (need <= *cap)
+    return 0;
+  size_t n = *cap ? *cap : 64;
+  while (n < need)
+    n *= 2;
+  void *q = realloc(*p, n * size);
+  if (!q)
+    return -1;
+  *p = q;
+  *cap = n;
+  return 0;
+}
+
+static void pt_update(PieceTable *pt, uint32_t t) {
+  PtNode *n = &pt->nodes[t];
+  const PtNode *l = &pt->nodes[n->left], *r = &pt->nodes[n->right];
+  n->sub_lines = l->sub_lines + n->lines + r->sub_lines;
+  n->sub_len = l->sub_len + n->len + r->sub_len;
+}
+
+// Takes a node from the free list or the reserved tail; the caller has
+// made room, so this never moves `nodes`.
+static uint32_t pt_node(PieceTable *pt, size_t off, size_t len,
+                        uint32_t lines) {
+  uint32_t t = pt->free_node;
+  if (t)
+    pt->free_node = pt->nodes[t].left;
+  else
+    t = (uint32_t)pt->nodes_len++;
+  pt->pieces++;
+  uint32_t x = pt->seed; // xorshift32
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  pt->seed = x;
+  pt->nodes[t] = (PtNode){0, 0, x, lines, off, len, lines, len};
+  return t;
+}
+
+// Makes room for `count` more nodes.
+static int pt_reserve_nodes(PieceTable *pt, size_t count) {
+  if (!pt->nodes_len)
+    count++; // nodes[0]
+  if (pt_reserve((void **)&pt->nodes, &pt->nodes_cap, pt->nodes_len + count,
+                 sizeof(PtNode)))
+    return -1;
+  if (!pt->nodes_len) {
+    memset(&pt->nodes[0], 0, sizeof(PtNode));
+    pt->nodes_len = 1;
+  }
+  return 0;
+}
+
+static uint32_t pt_merge(PieceTable *pt, uint32_t a, uint32_t b) {
+  if (!a || !b)
+    return a ? a : b;
+  if (pt->nodes[a].prio > pt->nodes[b].prio) {
+    pt->nodes[a].right = pt_merge(pt, pt->nodes[a].right, b);
+    pt_update(pt, a);
+    return a;
+  }
+  pt->nodes[b].left = pt_merge(pt, a, pt->nodes[b].left);
+  pt_update(pt, b);
+  return b;
+}
+
+// Byte offset of line `k` (0 <= k <= lines) inside a piece.
+static size_t pt_skip_lines(const char *p, size_t len, size_t k) {
+  const char *s = p;
+  while (k--) {
+    const char *nl = memchr(s, '\n', len - (size_t)(s - p));
+    s = nl + 1;
+  }
+  return (size_t)(s - p);
+}
+
+// Splits tree t into its first k lines (*l) and the rest (*r), cutting a
+// piece in two if needed (one new node, reserved by the caller).
+static void pt_split(PieceTable *pt, uint32_t t, size_t k, uint32_t *l,
+                     uint32_t *r) {
+  if (!t) {
+    *l = *r = 0;
+    return;
+  }
+  PtNode *n = &pt->nodes[t];
+  size_t before = pt->nodes[n->left].sub_lines;
+  if (k <= before) {
+    pt_split(pt, n->left, k, l, &n->left);
+    *r = t;
+  } else if (k >= before + n->lines) {
+    pt_split(pt, n->right, k - before - n->lines, &n->right, r);
+    *l = t;
+  } else {
+    size_t cut = k - before;
+    size_t bytes = pt_skip_lines(pt->text + n->off, n->len, cut);
+    uint32_t m = pt_node(pt, n->off + bytes, n->len - bytes,
+                         (uint32_t)(n->lines - cut));
+    n = &pt->nodes[t];
+    pt->nodes[m].prio = n->prio; // may take t's place under its parent
+    n->len = bytes;
+    n->lines = (uint32_t)cut;
+    uint32_t right = n->right;
+    n->right = 0;
+    *l = t;
+    *r = pt_merge(pt, m, right);
+  }
+  pt_update(pt, t);
+}
+
+static void pt_release(PieceTable *pt, uint32_t t) {
+  while (t) {
+    PtNode *n = &pt->nodes[t];
+    pt_release(pt, n->left);
+    uint32_t right = n->right;
+    pt->live -= n->len;
+    pt->pieces--;
+    n->left = pt->free_node;
+    pt->free_node = t;
+    t = right;
+  }
+}
+
+// Appends the new lines to the arena and returns them as a tree of pieces
+// of at most PT_PIECE_BYTES each (or one long line).
+static uint32_t pt_build(PieceTable *pt, const PtText *lines, size_t n) {
+  uint32_t tree = 0;
+  size_t i = 0;
+  while (i < n) {
+    size_t off = pt->text_len, len = 0, j = i;
+    do {
+      if (lines[j].len)
+        memcpy(pt->text + pt->text_len, lines[j].ptr, lines[j].len);
+      pt->text_len += lines[j].len;
+      pt->text[pt->text_len++] = '\n';
+      len += lines[j].len + 1;
+      j++;
+    } while (j < n && len + lines[j].len + 1 <= PT_PIECE_BYTES);
+    tree = pt_merge(pt, tree, pt_node(pt, off, len, (uint32_t)(j - i)));
+    i = j;
+  }
+  return tree;
+}
+
+// Upper bound on the pieces pt_build() makes for these lines.
+static size_t pt_piece_bound(const PtText *lines, size_t n, size_t *bytes) {
+  size_t pieces = 0, len = 0;
+  *bytes = 0;
+  for (size_t i = 0; i < n; i++) {
+    *bytes += lines[i].len + 1;
+    if (!pieces || len + lines[i].len + 1 > PT_PIECE_BYTES) {
+      pieces++;
+      len = 0;
+    }
+    len += lines[i].len + 1;
+  }
+  return pieces;
+}
+
+// Copies the live text into a fresh arena and rebuilds the tree from it;
+// on failure nothing changes.
+static int pt_compact(PieceTable *pt) {
+  size_t nlines = pt_line_count(pt), len = pt_length(pt);
+  char *text = malloc(len ? len : 1);
+  PtText *lines = malloc((nlines ? nlines : 1) * sizeof(PtText));
+  if (!text || !lines) {
+    free(text);
+    free(lines);
+    return -1;
+  }
+  PtChunk c;
+  size_t at = 0, i = 0;
+  for (size_t l = 0; pt_chunk(pt, l, &c); l += c.lines) {
+    memcpy(text + at, c.ptr, c.len);
+    for (const char *p = text + at, *end = p + c.len; p < end;) {
+      const char *nl = memchr(p, '\n', (size_t)(end - p));
+      lines[i++] = (PtText){p, (size_t)(nl - p)};
+      p = nl + 1;
+    }
+    at += c.len;
+  }
+  size_t cap = pt_piece_bound(lines, nlines, &len) + 1;
+  PtNode *nodes = malloc(cap * sizeof(PtNode));
+  if (!nodes) {
+    free(text);
+    free(lines);
+    return -1;
+  }
+  free(pt->nodes);
+  memset(&nodes[0], 0, sizeof(PtNode));
+  pt->nodes = nodes;
+  pt->nodes_len = 1;
+  pt->nodes_cap = cap;
+  pt->free_node = 0;
+  pt->pieces = 0;
+  pt->text_len = 0; // the old arena is at least `len` long
+  pt->root = pt_build(pt, lines, nlines);
+  pt->live = pt->text_len;
+  free(lines);
+  free(text);
+  return 0;
+}
+
+int pt_set_lines(PieceTable *pt, size_t first, size_t last,
+                 const PtText *lines, size_t n) {
+  if (first > last || last > pt_line_count(pt))
+    return -1;
+  size_t bytes;
+  size_t pieces = pt_piece_bound(lines, n, &bytes);
+  if (pt_reserve_nodes(pt, pieces + 2) ||
+      pt_reserve((void **)&pt->text, &pt->text_cap, pt->text_len + bytes, 1))
+    return -1;
+
+  uint32_t a, b, mid, c;
+  pt_split(pt, pt->root, first, &a, &b);
+  pt_split(pt, b, last - first, &mid, &c);
+  pt_release(pt, mid);
+  size_t start = pt->text_len;
+  mid = pt_build(pt, lines, n);
+  pt->live += pt->text_len - start;
+  pt->root = pt_merge(pt, pt_merge(pt, a, mid), c);
+
+  if (pt->text_len > 2 * pt->live + (1 << 20) ||
+      pt->pieces > 2 * (pt->live / PT_PIECE_BYTES) + PT_PIECE_SLACK)
+    pt_compact(pt); // only reclaims space; failing is harmless
+  return 0;
+}
+
+int pt_chunk(const PieceTable *pt, size_t line, PtChunk *out) {
+  uint32_t t = pt->root;
+  size_t k = line;
+  while (t) {
+    const PtNode *n = &pt->nodes[t];
+    size_t before = pt->nodes[n->left].sub_lines;
+    if (k < before) {
+      t = n->left;
+    } else if (k < before + n->lines) {
+      size_t skip = pt_skip_lines(pt->text + n->off, n->len, k - before);
+      *out = (PtChunk){pt->text + n->off + skip, n->len - skip, line,
+                       n->lines - (k - before)};
+      return 1;
+    } else {
+      k -= before + n->lines;
+      t = n->right;
+    }
+  }
+  return 0;
+}
+
+const char *pt_line(const PieceTable *pt, size_t line, size_t *len) {
+  PtChunk c;
+  if (!pt_chunk(pt, line, &c))
+    return NULL;
+  *len = (size_t)((const char *)memchr(c.ptr, '\n', c.len) - c.ptr);
+  return c.ptr;
+}
+
+char *pt_copy(const PieceTable *pt, size_t first, size_t last, size_t *len) {
+  size_t nlines = pt_line_count(pt);
+  if (last > nlines)
+    last = nlines;
+  size_t cap = 0;
+  PtChunk c;
+  // Sizes first, so the copy is one allocation.
+  for (size_t l = first; l < last && pt_chunk(pt, l, &c); l += c.lines) {
+    if (l + c.lines > last)
+      c.len = pt_skip_lines(c.ptr, c.len, last - l);
+    cap += c.len;
+  }
+  char *out = malloc(cap + 1);
+  if (!out)
+    return NULL;
+  size_t at = 0;
+  for (size_t l = first; l < last && pt_chunk(pt, l, &c); l += c.lines) {
+    if (l + c.lines > last)
+      c.len = pt_skip_lines(c.ptr, c.len, last - l);
+    memcpy(out + at, c.ptr, c.len);
+    at += c.len;
+  }
+  out[at] = '\0';
+  *len = at;
+  return out;
+}
+
+#endif // PIECE_IMPLEMENTATION
+#endif // PIECE_H
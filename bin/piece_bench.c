@@ -0,0 +1,305 @@
+// Piece table edits vs one contiguous copy of the buffer, checked.
+//
+//   gcc -O2 -o piece_bench piece_bench.c
+//   ./piece_bench [-n edits] [-p pattern]... file...
+//
+// Each file is loaded both into a PieceTable and into one contiguous text
+// plus line offsets that every edit memmoves, as highlight.h keeps its
+// copy (without the lexing). The same `-n` random line edits (default
+// 20000: type a character, split, join, delete, paste a block) are applied
+// to both and timed separately; "worst" is the slowest piece table edit,
+// which is one that compacts. Every 500th edit, and after the last one,
+// pt_copy() of the whole table must equal the flat text. Then each `-p`
+// pattern (default "function", "^$" and "^\s*end$", which can match at a
+// chunk's edges) is searched with sr_search() over the flat text and over
+// the table's chunks, one row each, and the matches (line, column, text)
+// must agree. Any difference makes the exit status 1.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PIECE_IMPLEMENTATION
+#include "piece.h"
+#define SEARCH_IMPLEMENTATION
+#include "search.h"
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *path, size_t *len) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  char *buf = malloc((size_t)st.st_size + 1);
+  ssize_t n = buf ? read(fd, buf, (size_t)st.st_size) : -1;
+  close(fd);
+  if (n < 0) {
+    free(buf);
+    return NULL;
+  }
+  *len = (size_t)n;
+  return buf;
+}
+
+// Splits src into lines, as nvim_buf_get_lines() would return them.
+static PtText *split_lines(const char *src, size_t len, size_t *n) {
+  size_t count = 1;
+  for (size_t i = 0; i < len; i++)
+    count += src[i] == '\n';
+  PtText *lines = malloc(count * sizeof(*lines));
+  if (!lines)
+    return NULL;
+  *n = 0;
+  const char *p = src, *end = src + len;
+  while (p <= end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    if (!nl)
+      nl = end;
+    lines[(*n)++] = (PtText){p, (size_t)(nl - p)};
+    p = nl + 1;
+  }
+  if (*n > 1 && lines[*n - 1].len == 0) // the file's final '\n'
+    (*n)--;
+  return lines;
+}
+
+// The contiguous baseline: every line followed by '\n', off[nlines] = len.
+typedef struct {
+  char *text;
+  size_t len, cap;
+  size_t *off;
+  size_t nlines, off_cap;
+} Flat;
+
+static int flat_set_lines(Flat *f, size_t first, size_t last,
+                          const PtText *lines, size_t n) {
+  size_t add = 0;
+  for (size_t i = 0; i < n; i++)
+    add += lines[i].len + 1;
+  size_t cut = f->off ? f->off[last] - f->off[first] : 0;
+  size_t nlines = f->nlines - (last - first) + n;
+  if (pt_reserve((void **)&f->text, &f->cap, f->len - cut + add, 1) ||
+      pt_reserve((void **)&f->off, &f->off_cap, nlines + 1, sizeof(size_t)))
+    return -1;
+  if (!f->nlines)
+    f->off[0] = 0;
+  size_t at = f->off[first];
+  memmove(f->text + at + add, f->text + at + cut, f->len - at - cut);
+  char *w = f->text + at;
+  for (size_t i = 0; i < n; i++) {
+    memcpy(w, lines[i].ptr, lines[i].len);
+    w[lines[i].len] = '\n';
+    w += lines[i].len + 1;
+  }
+  f->len = f->len - cut + add;
+  memmove(f->off + first + n, f->off + last,
+          (f->nlines - last + 1) * sizeof(size_t));
+  for (size_t i = first + n; i <= nlines; i++)
+    f->off[i] = f->off[i] - cut + add;
+  for (size_t i = 0; i < n; i++)
+    f->off[first + i + 1] = f->off[first + i] + lines[i].len + 1;
+  f->nlines = nlines;
+  return 0;
+}
+
+typedef struct {
+  size_t first, last, n;
+  PtText lines[64];
+  char buf[8192];
+} Edit;
+
+// A random edit of the buffer b, with its new text in e->buf.
+static void make_edit(const Flat *b, unsigned r, unsigned r2, Edit *e) {
+  size_t at = r2 % b->nlines;
+  const char *line = b->text + b->off[at];
+  size_t len = b->off[at + 1] - b->off[at] - 1;
+  if (len > sizeof(e->buf) / 4)
+    len = sizeof(e->buf) / 4;
+  size_t cut = len ? (r >> 4) % (len + 1) : 0;
+  e->first = at;
+  e->last = at + 1;
+  switch (r % 8) {
+  case 0: // split
+    memcpy(e->buf, line, len);
+    e->lines[0] = (PtText){e->buf, cut};
+    e->lines[1] = (PtText){e->buf + cut, len - cut};
+    e->n = 2;
+    break;
+  case 1: // join with the next line, or delete the last one
+    if (at + 1 < b->nlines) {
+      size_t next = b->off[at + 2] - b->off[at + 1] - 1;
+      if (next > sizeof(e->buf) / 4)
+        next = sizeof(e->buf) / 4;
+      memcpy(e->buf, line, len);
+      memcpy(e->buf + len, b->text + b->off[at + 1], next);
+      e->lines[0] = (PtText){e->buf, len + next};
+      e->last = at + 2;
+      e->n = 1;
+    } else {
+      e->n = 0;
+    }
+    break;
+  case 2: // delete a few lines
+    e->last = at + 1 + (r >> 8) % 8;
+    if (e->last > b->nlines)
+      e->last = b->nlines;
+    e->n = 0;
+    break;
+  case 3: // paste a block of copies of this line
+    e->n = 1 + (r >> 8) % 64;
+    memcpy(e->buf, line, len);
+    for (size_t i = 0; i < e->n; i++)
+      e->lines[i] = (PtText){e->buf, len};
+    e->last = at;
+    break;
+  default: // type a character
+    memcpy(e->buf, line, cut);
+    e->buf[cut] = (char)('a' + (r >> 8) % 26);
+    memcpy(e->buf + cut + 1, line + cut, len - cut);
+    e->lines[0] = (PtText){e->buf, len + 1};
+    e->n = 1;
+    break;
+  }
+}
+
+typedef struct {
+  size_t base, count;
+  unsigned long long sum; // of line, col and the text's bytes
+} Matches;
+
+static int on_match(void *ud, size_t line_no, size_t col, const char *line,
+                    size_t len) {
+  Matches *m = ud;
+  m->count++;
+  m->sum = m->sum * 31 + m->base + line_no;
+  m->sum = m->sum * 31 + col;
+  for (size_t i = 0; i < len; i++)
+    m->sum = m->sum * 31 + (unsigned char)line[i];
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  static const char *defaults[] = {"function", "^$", "^\\s*end$"};
+  const char *patterns[16];
+  size_t npat = 0;
+  int edits = 20000, opt;
+  while ((opt = getopt(argc, argv, "n:p:")) != -1) {
+    if (opt == 'n') {
+      edits = atoi(optarg);
+    } else if (opt == 'p' && npat < sizeof(patterns) / sizeof(patterns[0])) {
+      patterns[npat++] = optarg;
+    } else {
+      fprintf(stderr, "Usage: %s [-n edits] [-p pattern]... file...\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (!npat)
+    for (; npat < sizeof(defaults) / sizeof(defaults[0]); npat++)
+      patterns[npat] = defaults[npat];
+  SrPattern pats[16];
+  for (size_t k = 0; k < npat; k++) {
+    char err[128];
+    if (sr_compile(&pats[k], patterns[k], 0, err, sizeof(err)) != 0) {
+      fprintf(stderr, "%s: %s\n", patterns[k], err);
+      return 2;
+    }
+  }
+
+  printf("%-20s %8s %7s %10s %9s %10s  %-12s %9s %9s %7s\n", "file", "lines",
+         "pieces", "pt/edit", "worst", "flat/edit", "pattern", "search",
+         "chunked", "matches");
+  int bad = 0;
+  unsigned seed = 1;
+  for (int i = optind; i < argc; i++) {
+    size_t len, n;
+    char *src = read_file(argv[i], &len);
+    PtText *lines = src ? split_lines(src, len, &n) : NULL;
+    if (!lines) {
+      perror(argv[i]);
+      free(src);
+      bad = 1;
+      continue;
+    }
+    PieceTable pt;
+    Flat b = {NULL, 0, 0, NULL, 0, 0};
+    pt_init(&pt);
+    int ok = pt_set_lines(&pt, 0, 0, lines, n) == 0 &&
+             flat_set_lines(&b, 0, 0, lines, n) == 0;
+    free(lines);
+    free(src);
+
+    static Edit e;
+    double pt_ms = 0, worst = 0, flat_ms = 0;
+    for (int k = 0; k < edits && ok && b.nlines > 1; k++) {
+      unsigned r = (seed = seed * 1103515245u + 12345u) >> 4;
+      unsigned r2 = (seed = seed * 1103515245u + 12345u) >> 4;
+      make_edit(&b, r, r2, &e);
+      double t0 = now_ms();
+      ok = pt_set_lines(&pt, e.first, e.last, e.lines, e.n) == 0;
+      double t1 = now_ms();
+      ok = ok && flat_set_lines(&b, e.first, e.last, e.lines, e.n) == 0;
+      double t2 = now_ms();
+      pt_ms += t1 - t0;
+      if (t1 - t0 > worst)
+        worst = t1 - t0;
+      flat_ms += t2 - t1;
+      if (ok && (k % 500 == 499 || k == edits - 1)) {
+        size_t copy_len;
+        char *copy = pt_copy(&pt, 0, pt_line_count(&pt), &copy_len);
+        ok = copy && copy_len == b.len && memcmp(copy, b.text, b.len) == 0 &&
+             pt_line_count(&pt) == b.nlines;
+        free(copy);
+        if (!ok)
+          fprintf(stderr, "%s: contents differ after edit %d\n", argv[i], k);
+      }
+    }
+
+    const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+    for (size_t k = 0; k < npat; k++) {
+      Matches whole = {0, 0, 0}, chunked = {0, 0, 0};
+      double t0 = now_ms();
+      sr_search(&pats[k], b.text, b.len, on_match, &whole);
+      double t1 = now_ms();
+      PtChunk c;
+      size_t pieces = 0;
+      for (size_t l = 0; pt_chunk(&pt, l, &c); l += c.lines, pieces++) {
+        chunked.base = c.line;
+        sr_search(&pats[k], c.ptr, c.len, on_match, &chunked);
+      }
+      double t2 = now_ms();
+      int same = whole.count == chunked.count && whole.sum == chunked.sum;
+      if (!same)
+        fprintf(stderr, "%s: %zu matches of %s in the text, %zu in chunks\n",
+                argv[i], whole.count, patterns[k], chunked.count);
+      ok = ok && same;
+      if (k == 0)
+        printf("%-20.20s %8zu %7zu %7.2f us %6.2f ms %7.2f us", name, b.nlines,
+               pieces, edits ? pt_ms * 1e3 / edits : 0, worst,
+               edits ? flat_ms * 1e3 / edits : 0);
+      else
+        printf("%-20s %8s %7s %10s %9s %10s", "", "", "", "", "", "");
+      printf("  %-12.12s %6.2f ms %6.2f ms %7zu%s\n", patterns[k], t1 - t0,
+             t2 - t1, whole.count, same ? "" : "  MISMATCH");
+    }
+    bad |= !ok;
+    pt_free(&pt);
+    free(b.text);
+    free(b.off);
+  }
+  for (size_t k = 0; k < npat; k++)
+    sr_free(&pats[k]);
+  return bad;
+}
@@ -0,0 +1,340 @@
+// Parallel content search over a directory tree (a grep stage).
+//
+//   gcc -O2 -pthread -o search search.c libc11.c
+//   ./search [-i] [-F] [-l] [-u] [-j threads] pattern [root]
+//
+// Files come from the libc11 walker (so .gitignore/.ignore apply unless -u)
+// and are searched by a pool of threads while the walk is still running:
+// small files are read with one pread() into a per-thread buffer, large
+// ones are mmap'd. Files with a NUL in their first 8 KiB are skipped as
+// binary. Matches are printed as "path:line:col:text" (rg --vimgrep), or
+// just the path with -l, grouped per file and in walk order, whichever
+// thread finished first. See search.h for the matching itself.
+//
+// Exit status as grep: 0 if a line matched, 1 if none did, 2 on errors.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "libc11.h"
+#define SEARCH_IMPLEMENTATION
+#include "search.h"
+
+#define MAX_THREADS 64
+#define WALK_BUF (64 * 1024)
+// Files at least this big are mmap'd instead of read.
+#define MMAP_MIN (1 << 20)
+#ifndef MAP_POPULATE // Linux only: fault the whole mapping in up front
+#define MAP_POPULATE 0
+#endif
+
+typedef struct {
+  char *path;  // as printed: relative to the cwd, like the root argument
+  char *out;   // this file's output, NULL if nothing matched
+  size_t len;
+  int done;
+} Entry;
+
+typedef struct {
+  char *data;
+  size_t len, cap;
+} Buf;
+
+static SrPattern pattern;
+static int list_files = 0;
+
+// Files found so far by the walk. Workers claim them in order; the main
+// thread prints finished ones as soon as every earlier one is done.
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static Entry *entries;
+static size_t entry_count, entry_cap;
+static size_t next_entry; // first entry no worker has claimed
+static int walk_done = 0;
+static int had_error = 0;
+
+static int buf_put(Buf *b, const char *data, size_t len) {
+  if (b->len + len > b->cap) {
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + len)
+      cap *= 2;
+    char *p = realloc(b->data, cap);
+    if (!p)
+      return -1;
+    b->data = p;
+    b->cap = cap;
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+  return 0;
+}
+
+typedef struct {
+  Buf *out;
+  const char *path;
+  int oom;
+} MatchCtx;
+
+static int on_match(void *ud, size_t line_no, size_t col, const char *line,
+                    size_t len) {
+  MatchCtx *m = ud;
+  if (list_files) {
+    if (buf_put(m->out, m->path, strlen(m->path)) || buf_put(m->out, "\n", 1))
+      m->oom = 1;
+    return 1; // one line is enough
+  }
+  char num[48];
+  int n = snprintf(num, sizeof(num), ":%zu:%zu:", line_no, col);
+  if (buf_put(m->out, m->path, strlen(m->path)) ||
+      buf_put(m->out, num, (size_t)n) || buf_put(m->out, line, len) ||
+      buf_put(m->out, "\n", 1))
+    return m->oom = 1;
+  return 0;
+}
+
+// Searches one file, appending its output to `out`. `scratch` is the
+// thread's read buffer.
+static void search_file(const char *path, Buf *out, Buf *scratch) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    // Gone since the walk listed it, or unreadable: not worth failing for.
+    if (fd >= 0)
+      close(fd);
+    return;
+  }
+  size_t size = (size_t)st.st_size;
+  const char *data = NULL;
+  void *map = NULL;
+  if (size == 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return;
+  }
+  if (size >= MMAP_MIN) {
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (map == MAP_FAILED) {
+      close(fd);
+      return;
+    }
+    data = map;
+  } else {
+    if (scratch->cap < size) {
+      char *p = realloc(scratch->data, MMAP_MIN);
+      if (!p) {
+        close(fd);
+        return;
+      }
+      scratch->data = p;
+      scratch->cap = MMAP_MIN;
+    }
+    size_t got = 0;
+    while (got < size) {
+      ssize_t n = pread(fd, scratch->data + got, size - got, (off_t)got);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      got += (size_t)n;
+    }
+    size = got;
+    data = scratch->data;
+  }
+  close(fd);
+
+  if (!sr_is_binary(data, size)) {
+    MatchCtx m = {out, path, 0};
+    sr_search(&pattern, data, size, on_match, &m);
+    if (m.oom) {
+      fprintf(stderr, "Out of memory\n");
+      exit(2);
+    }
+  }
+  if (map)
+    munmap(map, size);
+}
+
+static void *worker_main(void *arg) {
+  (void)arg;
+  Buf scratch = {0};
+  for (;;) {
+    pthread_mutex_lock(&lock);
+    while (next_entry == entry_count && !walk_done)
+      pthread_cond_wait(&work_cond, &lock);
+    if (next_entry == entry_count) {
+      pthread_mutex_unlock(&lock);
+      break;
+    }
+    size_t i = next_entry++;
+    const char *path = entries[i].path; // the string itself never moves
+    pthread_mutex_unlock(&lock);
+
+    Buf out = {0};
+    search_file(path, &out, &scratch);
+
+    pthread_mutex_lock(&lock);
+    entries[i].out = out.data;
+    entries[i].len = out.len;
+    entries[i].done = 1;
+    pthread_cond_signal(&done_cond);
+    pthread_mutex_unlock(&lock);
+  }
+  free(scratch.data);
+  return NULL;
+}
+
+// Prints the finished entries from *printed on, in order; with `wait`, until
+// all of them are. Returns whether anything matched. Called with `lock` held.
+static int print_ready(size_t *printed, int wait) {
+  int matched = 0;
+  for (;;) {
+    while (*printed < entry_count && entries[*printed].done) {
+      Entry *e = &entries[(*printed)++];
+      if (e->out) {
+        fwrite(e->out, 1, e->len, stdout);
+        matched = 1;
+      }
+      free(e->out);
+      free(e->path);
+      e->out = e->path = NULL;
+    }
+    if (!wait || (*printed == entry_count && walk_done))
+      return matched;
+    pthread_cond_wait(&done_cond, &lock);
+  }
+}
+
+// Adds the "path\n" lines in buf[0..n) to the entries. Called with `lock`
+// held.
+static int add_entries(const char *root, const char *buf, size_t n) {
+  size_t root_len = strcmp(root, ".") == 0 ? 0 : strlen(root);
+  if (root_len > 1 && root[root_len - 1] == '/')
+    root_len--;
+  for (const char *line = buf, *nl; (nl = memchr(line, '\n', buf + n - line));
+       line = nl + 1) {
+    size_t len = (size_t)(nl - line);
+    if (entry_count == entry_cap) {
+      size_t cap = entry_cap ? entry_cap * 2 : 1024;
+      Entry *p = realloc(entries, cap * sizeof(*p));
+      if (!p)
+        return -1;
+      entries = p;
+      entry_cap = cap;
+    }
+    char *path = malloc(root_len + 1 + len + 1);
+    if (!path)
+      return -1;
+    char *w = path;
+    if (root_len) {
+      memcpy(w, root, root_len);
+      w[root_len] = '/';
+      w += root_len + 1;
+    }
+    memcpy(w, line, len);
+    w[len] = '\0';
+    entries[entry_count++] = (Entry){path, NULL, 0, 0};
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  int flags = 0, walk_flags = C11_WALK_NO_DIRS, nthreads = 0, bad = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "iFluj:")) != -1) {
+    switch (opt) {
+    case 'i':
+      flags |= SR_ICASE;
+      break;
+    case 'F':
+      flags |= SR_FIXED;
+      break;
+    case 'l':
+      list_files = 1;
+      break;
+    case 'u':
+      walk_flags |= C11_WALK_NO_IGNORE;
+      break;
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+    default:
+      bad = 1;
+      break;
+    }
+  }
+  if (bad || optind >= argc || argc - optind > 2) {
+    fprintf(stderr, "Usage: %s [-i] [-F] [-l] [-u] [-j threads] pattern [root]\n",
+            argv[0]);
+    return 2;
+  }
+  const char *root = optind + 1 < argc ? argv[optind + 1] : ".";
+
+  char err[256];
+  if (sr_compile(&pattern, argv[optind], flags, err, sizeof(err)) != 0) {
+    fprintf(stderr, "%s: %s\n", argv[optind], err);
+    return 2;
+  }
+  c11_walk *w = c11_walk_open(root, walk_flags);
+  if (!w) {
+    perror(root);
+    return 2;
+  }
+
+  if (nthreads <= 0) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = n > 0 ? (int)n : 1;
+  }
+  if (nthreads > MAX_THREADS)
+    nthreads = MAX_THREADS;
+  pthread_t threads[MAX_THREADS];
+  int started = 0;
+  while (started < nthreads &&
+         pthread_create(&threads[started], NULL, worker_main, NULL) == 0)
+    started++;
+  if (started == 0) {
+    fprintf(stderr, "Could not start a search thread\n");
+    return 2;
+  }
+
+  static char walk_buf[WALK_BUF];
+  static char out_buf[1 << 16];
+  setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+  size_t printed = 0;
+  int matched = 0;
+  int64_t n;
+  while ((n = c11_walk_next(w, walk_buf, sizeof(walk_buf))) > 0) {
+    pthread_mutex_lock(&lock);
+    if (add_entries(root, walk_buf, (size_t)n) != 0) {
+      fprintf(stderr, "Out of memory\n");
+      exit(2);
+    }
+    pthread_cond_broadcast(&work_cond);
+    matched |= print_ready(&printed, 0);
+    pthread_mutex_unlock(&lock);
+  }
+  if (n < 0) {
+    perror(root);
+    had_error = 1;
+  }
+  c11_walk_close(w);
+
+  pthread_mutex_lock(&lock);
+  walk_done = 1;
+  pthread_cond_broadcast(&work_cond);
+  matched |= print_ready(&printed, 1);
+  pthread_mutex_unlock(&lock);
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+
+  fflush(stdout);
+  free(entries);
+  sr_free(&pattern);
+  return had_error ? 2 : matched ? 0 : 1;
+}
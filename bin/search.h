@@ -0,0 +1,413 @@
+/* search.h - Line-oriented content search for a grep stage (single-header)
+
+   A pattern is compiled once into an optional POSIX extended regex plus
+   the longest literal that every match must contain (for -F patterns, the
+   pattern itself). Searching a buffer then never runs the regex on lines
+   that cannot match:
+
+     1. find the next occurrence of the literal (SSE2: compare its two
+        rarest bytes, by a source-code byte frequency guess, at 16
+        positions at once and verify candidates with memcmp; memchr for
+        one-byte needles);
+     2. widen the hit to its line and run regexec() on that line only;
+     3. continue after the line.
+
+   With no usable literal (e.g. "a|b", "[0-9]+") regexec() scans the buffer
+   directly, in windows of whole lines: glibc's regexec() does work in
+   proportion to its whole input on every call, so the window starts at
+   SR_WINDOW_MIN bytes after each match and doubles up to SR_WINDOW_MAX
+   while nothing matches. Buffers need no NUL terminator (REG_STARTEND), so
+   they can be mmap'd files.
+
+   Usage:
+
+     #define SEARCH_IMPLEMENTATION
+     #include "search.h"
+
+     SrPattern p;
+     char err[128];
+     if (sr_compile(&p, "fn_[a-z]+\\(", SR_ICASE, err, sizeof(err)) != 0) ...
+     if (!sr_is_binary(buf, len))
+       sr_search(&p, buf, len, on_line, ud); // on_line(ud, line_no, col, ...)
+     sr_free(&p);
+*/
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <regex.h>
+#include <stddef.h>
+
+enum {
+  SR_ICASE = 1, // case-insensitive (ASCII for the literal prefilter)
+  SR_FIXED = 2, // the pattern is a plain string, not a regex
+};
+
+// Bytes looked at by sr_is_binary(), as in git and grep.
+#define SR_BINARY_PEEK 8192
+// regexec() window bounds for patterns without a literal (see above).
+#define SR_WINDOW_MIN 256
+#define SR_WINDOW_MAX (1 << 20)
+
+typedef struct {
+  int flags;
+  int has_regex;
+  regex_t re;
+  char *lit; // required literal, NULL if none
+  size_t lit_len;
+  size_t rare1, rare2; // offsets in lit of its two least common bytes
+} SrPattern;
+
+// Called for each matching line (without its '\n'); line_no and col are
+// 1-based, col is the byte column of the first match. Return nonzero to
+// stop the search.
+typedef int (*SrEmit)(void *ud, size_t line_no, size_t col, const char *line,
+                      size_t len);
+
+// Returns 0, or -1 with a message in err.
+int sr_compile(SrPattern *p, const char *pattern, int flags, char *err,
+               size_t err_cap);
+void sr_free(SrPattern *p);
+// Number of matching lines reported.
+size_t sr_search(const SrPattern *p, const char *buf, size_t len, SrEmit emit,
+                 void *ud);
+// A NUL in the first SR_BINARY_PEEK bytes.
+int sr_is_binary(const char *buf, size_t len);
+
+#ifdef SEARCH_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static int sr_lower(int c) { return c >= 'A' && c <= 'Z' ? c + 32 : c; }
+
+static int sr_eq(const char *a, const char *b, size_t n, int icase) {
+  if (!icase)
+    return memcmp(a, b, n) == 0;
+  for (size_t i = 0; i < n; i++)
+    if (sr_lower((unsigned char)a[i]) != sr_lower((unsigned char)b[i]))
+      return 0;
+  return 1;
+}
+
+// Bytes roughly from most to least common in source code and prose; any
+// byte not listed counts as rarer than all of them.
+static const char sr_common_bytes[] =
+    " etaoinsrlhdcu\n_mpf(),.;g=b\"/*y-v:k{}0x1w#>[]<2&'\t+!|3\\";
+
+static int sr_byte_rank(unsigned char c) {
+  const char *at = c ? strchr(sr_common_bytes, sr_lower(c)) : NULL;
+  return at ? (int)(at - sr_common_bytes) : (int)sizeof(sr_common_bytes);
+}
+
+// The offsets of the two least common bytes of lit (m >= 2), rare1 < rare2.
+static void sr_pick_rare(const char *lit, size_t m, size_t *rare1,
+                         size_t *rare2) {
+  size_t a = 0, b = 1;
+  if (sr_byte_rank((unsigned char)lit[b]) > sr_byte_rank((unsigned char)lit[a])) {
+    a = 1;
+    b = 0;
+  }
+  for (size_t i = 2; i < m; i++) {
+    int r = sr_byte_rank((unsigned char)lit[i]);
+    if (r > sr_byte_rank((unsigned char)lit[a])) {
+      b = a;
+      a = i;
+    } else if (r > sr_byte_rank((unsigned char)lit[b])) {
+      b = i;
+    }
+  }
+  *rare1 = a < b ? a : b;
+  *rare2 = a < b ? b : a;
+}
+
+// First occurrence of p's literal in h[0..n), or NULL. For icase the
+// literal is lowercase.
+static const char *sr_find(const SrPattern *p, const char *h, size_t n) {
+  const char *needle = p->lit;
+  size_t m = p->lit_len;
+  int icase = (p->flags & SR_ICASE) != 0;
+  if (m > n)
+    return NULL;
+  size_t i = 0;
+  if (m == 1 && !icase)
+    return memchr(h, needle[0], n);
+#ifdef __SSE2__
+  if (m >= 2) {
+    size_t o1 = p->rare1, o2 = p->rare2;
+    unsigned char c1 = (unsigned char)needle[o1], c2 = (unsigned char)needle[o2];
+    const __m128i v1 = _mm_set1_epi8((char)c1), v2 = _mm_set1_epi8((char)c2);
+    // For icase, letters also match their uppercase form.
+    const __m128i v1_up = _mm_set1_epi8((char)(c1 ^ 0x20));
+    const __m128i v2_up = _mm_set1_epi8((char)(c2 ^ 0x20));
+    int alpha1 = icase && c1 >= 'a' && c1 <= 'z';
+    int alpha2 = icase && c2 >= 'a' && c2 <= 'z';
+    for (; i + m + 15 <= n; i += 16) {
+      __m128i b1 = _mm_loadu_si128((const __m128i *)(h + i + o1));
+      __m128i b2 = _mm_loadu_si128((const __m128i *)(h + i + o2));
+      __m128i e1 = _mm_cmpeq_epi8(b1, v1), e2 = _mm_cmpeq_epi8(b2, v2);
+      if (alpha1)
+        e1 = _mm_or_si128(e1, _mm_cmpeq_epi8(b1, v1_up));
+      if (alpha2)
+        e2 = _mm_or_si128(e2, _mm_cmpeq_epi8(b2, v2_up));
+      unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(e1, e2));
+      while (mask) {
+        unsigned bit = (unsigned)__builtin_ctz(mask);
+        if (sr_eq(h + i + bit, needle, m, icase))
+          return h + i + bit;
+        mask &= mask - 1;
+      }
+    }
+  }
+#endif
+  for (; i + m <= n; i++) {
+    int c = icase ? sr_lower((unsigned char)h[i]) : (unsigned char)h[i];
+    if (c == (unsigned char)needle[0] && sr_eq(h + i, needle, m, icase))
+      return h + i;
+  }
+  return NULL;
+}
+
+// The longest run of literal characters that every match of the ERE
+// `pat` must contain, or 0 if none is known: top-level alternation gives
+// up, and groups, classes, escapes like \w and anchors end a run. A
+// character followed by ?, * or {..} is optional and dropped; one followed
+// by + ends the run after it. `out` and `cur` (the run being built) need
+// strlen(pat) bytes each.
+static size_t sr_required_literal(const char *pat, char *out, char *cur) {
+  size_t best = 0, run = 0;
+  int depth = 0;
+  for (const char *p = pat; *p; p++)
+    if (*p == '|')
+      return 0;
+    else if (*p == '\\' && p[1])
+      p++;
+
+#define SR_END_RUN()                                                           \
+  do {                                                                         \
+    if (run > best) {                                                          \
+      memcpy(out, cur, run);                                                   \
+      best = run;                                                              \
+    }                                                                          \
+    run = 0;                                                                   \
+  } while (0)
+
+  for (const char *p = pat; *p; p++) {
+    char c = *p;
+    int literal = 0;
+    if (c == '\\' && p[1]) {
+      c = *++p;
+      literal = !strchr("wWsSbB<>`'0123456789", c);
+    } else if (c == '[') {
+      // Skip the class: "[]...]" and "[^]...]" start with a literal ']',
+      // and "[:digit:]", "[=e=]" and "[.-.]" inside it hold their own.
+      p++;
+      if (*p == '^')
+        p++;
+      if (*p == ']')
+        p++;
+      while (*p && *p != ']') {
+        if (p[0] == '[' && p[1] && strchr(":=.", p[1])) {
+          char delim = p[1];
+          p += 2;
+          while (*p && !(p[0] == delim && p[1] == ']'))
+            p++;
+          if (!*p)
+            break;
+          p++;
+        }
+        p++;
+      }
+      if (!*p)
+        break;
+      SR_END_RUN();
+      continue;
+    } else if (c == '{') {
+      // An interval's bounds are not text.
+      while (*p && *p != '}')
+        p++;
+      if (!*p)
+        break;
+      SR_END_RUN();
+      continue;
+    } else if (c == '(') {
+      depth++;
+    } else if (c == ')') {
+      depth = depth ? depth - 1 : 0;
+    } else {
+      literal = !strchr(".*+?{}^$", c);
+    }
+    if (!literal || depth > 0) {
+      SR_END_RUN();
+      continue;
+    }
+    char q = p[1];
+    if (q == '?' || q == '*' || q == '{') {
+      SR_END_RUN();
+      continue;
+    }
+    cur[run++] = c;
+    if (q == '+')
+      SR_END_RUN();
+  }
+  SR_END_RUN();
+#undef SR_END_RUN
+  return best;
+}
+
+int sr_compile(SrPattern *p, const char *pattern, int flags, char *err,
+               size_t err_cap) {
+  memset(p, 0, sizeof(*p));
+  size_t plen = strlen(pattern);
+  p->lit = malloc(plen + 1);
+  if (!p->lit) {
+    snprintf(err, err_cap, "out of memory");
+    return -1;
+  }
+  // A pattern without metacharacters is its own literal; regexec() would
+  // only repeat what the prefilter already proved.
+  if (!strpbrk(pattern, "\\.[]()*+?{}|^$"))
+    flags |= SR_FIXED;
+  p->flags = flags;
+  if (flags & SR_FIXED) {
+    memcpy(p->lit, pattern, plen);
+    p->lit_len = plen;
+  } else {
+    int cflags = REG_EXTENDED | REG_NEWLINE | ((flags & SR_ICASE) ? REG_ICASE : 0);
+    int rc = regcomp(&p->re, pattern, cflags);
+    if (rc != 0) {
+      regerror(rc, &p->re, err, err_cap);
+      free(p->lit);
+      p->lit = NULL;
+      return -1;
+    }
+    p->has_regex = 1;
+    char *run = malloc(plen + 1);
+    p->lit_len = run ? sr_required_literal(pattern, p->lit, run) : 0;
+    free(run);
+  }
+  if (flags & SR_ICASE)
+    for (size_t i = 0; i < p->lit_len; i++)
+      p->lit[i] = (char)sr_lower((unsigned char)p->lit[i]);
+  if (p->lit_len >= 2)
+    sr_pick_rare(p->lit, p->lit_len, &p->rare1, &p->rare2);
+  if (p->lit_len == 0 && !p->has_regex) {
+    snprintf(err, err_cap, "empty pattern");
+    free(p->lit);
+    p->lit = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+void sr_free(SrPattern *p) {
+  if (p->has_regex)
+    regfree(&p->re);
+  free(p->lit);
+  p->lit = NULL;
+  p->has_regex = 0;
+}
+
+int sr_is_binary(const char *buf, size_t len) {
+  return memchr(buf, 0, len < SR_BINARY_PEEK ? len : SR_BINARY_PEEK) != NULL;
+}
+
+// Newlines in [p, end). Dense text has a newline every few dozen bytes,
+// where a memchr() call per line costs more than counting in bulk.
+static size_t sr_count_lines(const char *p, const char *end) {
+  size_t n = 0;
+#ifdef __SSE2__
+  const __m128i nl = _mm_set1_epi8('\n'), zero = _mm_setzero_si128();
+  while (end - p >= 16) {
+    // Per-byte counters (cmpeq gives -1 per hit), summed before they can
+    // wrap at 255 blocks.
+    __m128i acc = zero;
+    for (int k = 0; k < 255 && end - p >= 16; k++, p += 16)
+      acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), nl));
+    __m128i sum = _mm_sad_epu8(acc, zero);
+    n += (size_t)_mm_cvtsi128_si32(sum) +
+         (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+  }
+#endif
+  for (; p < end; p++)
+    n += *p == '\n';
+  return n;
+}
+
+// Runs the regex on buf[from, to); returns the match start or -1.
+static long sr_regexec(const SrPattern *p, const char *buf, size_t from,
+                       size_t to) {
+  regmatch_t m[1];
+  m[0].rm_so = (regoff_t)from;
+  m[0].rm_eo = (regoff_t)to;
+  if (regexec(&p->re, buf, 1, m, REG_STARTEND) != 0)
+    return -1;
+  return (long)m[0].rm_so;
+}
+
+size_t sr_search(const SrPattern *p, const char *buf, size_t len, SrEmit emit,
+                 void *ud) {
+  size_t pos = 0, line_no = 1, found = 0, window = SR_WINDOW_MIN;
+  const char *counted = buf; // newlines before here are in line_no
+
+  while (pos < len) {
+    size_t start, end, col;
+    if (p->lit_len) {
+      const char *hit = sr_find(p, buf + pos, len - pos);
+      if (!hit)
+        break;
+      start = (size_t)(hit - buf);
+      while (start > pos && buf[start - 1] != '\n')
+        start--;
+      const char *nl = memchr(hit, '\n', len - (size_t)(hit - buf));
+      end = nl ? (size_t)(nl - buf) : len;
+      col = (size_t)(hit - buf) - start;
+      if (p->has_regex) {
+        long at = sr_regexec(p, buf, start, end);
+        if (at < 0) {
+          pos = end + 1;
+          continue;
+        }
+        col = (size_t)at - start;
+      }
+    } else {
+      long at = -1;
+      for (size_t from = pos; at < 0 && from < len;) {
+        size_t to = len - from > window ? from + window : len;
+        const char *nl = to < len ? memchr(buf + to, '\n', len - to) : NULL;
+        if (to < len)
+          to = nl ? (size_t)(nl - buf) : len;
+        at = sr_regexec(p, buf, from, to);
+        if (at < 0) {
+          from = to + 1;
+          if (window < SR_WINDOW_MAX)
+            window *= 2;
+        }
+      }
+      // An empty match (as of "^$") after the final '\n' is not a line.
+      if (at < 0 || ((size_t)at == len && len && buf[len - 1] == '\n'))
+        break;
+      window = SR_WINDOW_MIN;
+      start = (size_t)at;
+      while (start > pos && buf[start - 1] != '\n')
+        start--;
+      const char *nl = memchr(buf + at, '\n', len - (size_t)at);
+      end = nl ? (size_t)(nl - buf) : len;
+      col = (size_t)at - start;
+    }
+    line_no += sr_count_lines(counted, buf + start);
+    counted = buf + start;
+    found++;
+    if (emit(ud, line_no, col + 1, buf + start, end - start))
+      break;
+    pos = end + 1;
+  }
+  return found;
+}
+
+#endif // SEARCH_IMPLEMENTATION
+#endif // SEARCH_H
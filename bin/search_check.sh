@@ -0,0 +1,73 @@
+#!/bin/sh
+# Parity check of ./search against grep -E: for every pattern below, the
+# "path:line" pairs that `search -u` reports under ROOT must be exactly the
+# ones `grep -rnIE` finds. Build search first (see build.sh).
+#
+#   ./search_check.sh [root]
+#
+# The patterns cover the required-literal prefilter (sr_required_literal()
+# in search.h): plain literals, optional and repeated characters, intervals,
+# groups, alternation, and bracket expressions including "[]..]" and the
+# "[:class:]", "[=e=]" and "[.c.]" forms that hold a ']' of their own,
+# and patterns that match the empty string ("^$", "x*").
+#
+# Each pattern is also timed, output to a file (grep stops at the first
+# match when writing to /dev/null): search -u, grep -rnIE
+# and, if it is installed, rg -uu -n (all three skip binary files and read
+# ignored ones). Times are wall clock milliseconds of one run each, so use
+# a tree big enough to matter (and warm the page cache first).
+
+ROOT="${1:-.}"
+SEARCH="$(dirname "$0")/search"
+TMP="${TMPDIR:-/tmp}/search_check.$$"
+trap 'rm -f "$TMP.a" "$TMP.b" "$TMP.t"' EXIT
+
+ms() {
+    start=$(date +%s%N)
+    "$@" > "$TMP.t" 2>&1
+    echo $(( ($(date +%s%N) - start) / 1000000 ))
+}
+
+printf '%-24s %8s %9s %9s %9s\n' pattern lines search grep rg
+fail=0
+while IFS= read -r pattern; do
+    [ -z "$pattern" ] && continue
+    "$SEARCH" -u "$pattern" "$ROOT" | cut -d: -f1,2 | sed "s|^\./||" | sort > "$TMP.a"
+    grep -rnIE -- "$pattern" "$ROOT" | cut -d: -f1,2 | sed "s|^\./||" | sort > "$TMP.b"
+    a=$(wc -l < "$TMP.a")
+    b=$(wc -l < "$TMP.b")
+    t_search=$(ms "$SEARCH" -u "$pattern" "$ROOT")
+    t_grep=$(ms grep -rnIE -- "$pattern" "$ROOT")
+    t_rg=-
+    if command -v rg > /dev/null; then
+        t_rg="$(ms rg -uu -n -e "$pattern" "$ROOT") ms"
+    fi
+    if cmp -s "$TMP.a" "$TMP.b"; then
+        printf '%-24s %8d %6d ms %6d ms %9s\n' "$pattern" "$a" "$t_search" \
+            "$t_grep" "$t_rg"
+    else
+        printf '%-24s %8d search, %d grep  MISMATCH\n' "$pattern" "$a" "$b"
+        fail=1
+    fi
+done <<'EOF'
+function
+static inline
+colou?r
+fo+ld_[a-z]+
+x{2,}
+(if|while) \(
+a|b
+[0-9]x
+[]a]b
+[^]a]b
+[[:digit:]]x
+[[:alpha:]_]+_t
+[^[:space:]]end
+[[.-.]]>
+[[=a=]]b
+^#include
+;$
+^$
+x*
+EOF
+exit $fail
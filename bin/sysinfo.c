@@ -1,113 +1,751 @@
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/sysinfo.h>
 #include <msgpack.h>
 #include <time.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
 
-void get_cpu_usage(double *usage) {
-    static unsigned long long prev_idle = 0, prev_total = 0;
-    FILE *fp = fopen("/proc/stat", "r");
-    
-    if (fp == NULL) {
-        *usage = 0.0;
-        return;
+#define PROC_SAMPLER_IMPLEMENTATION
+#include "proc_sampler.h"
+#define METRIC_RING_IMPLEMENTATION
+#include "metric_ring.h"
+#define METRIC_CODEC_IMPLEMENTATION
+#include "metric_codec.h"
+
+#define OUT_BUF_INITIAL (64 * 1024)
+
+static ProcSampler sampler;
+static int running = 1;
+
+// Top-level keys of a sample map. Clients pick a subset with "subscribe".
+enum {
+    F_CPU,
+    F_MEM,
+    F_UPTIME,
+    F_TIMESTAMP,
+    F_CPUS,
+    F_CTXT,
+    F_INTR,
+    F_PROCS,
+    F_COUNT
+};
+static const char *const field_names[F_COUNT] = {"cpu", "mem", "uptime", "timestamp", "cpus", "ctxt", "intr", "procs"};
+static unsigned subscribed = (1u << F_COUNT) - 1;
+#define WANT(f) (subscribed & (1u << (f)))
+
+// Processes whose children are re-scanned by the "children" collector.
+static int tree_pids[PS_MAX_PROCS];
+static int ntree = 0;
+
+// Recent history, queryable over stdin (see handle_command). Field order
+// matches history_fields.
+static MetricHistory history;
+static const char *const history_fields[] = {"cpu", "mem", "ctxt", "intr"};
+#define HISTORY_FIELDS 4
+#define HISTORY_RAW_POINTS 4096
+#define HISTORY_MAX_REPLY 4096
+
+// Output pipeline. Samples are packed into one long-lived buffer that is
+// cleared (not freed) after every write; `batch_size` samples go out as a
+// single msgpack array, and with `framed` each write is prefixed by its
+// payload length as a 4-byte big-endian integer so the reader can consume a
+// whole frame with one read.
+static msgpack_sbuffer out_buf;
+static msgpack_packer out_pk;
+static int batch_size = 1;
+static int batch_count = 0;
+static int framed = 0;
+
+// Compact mode (-z or "format compact"): a {"schema": [...], "types": [...]}
+// frame announces the columns, then each sample is a msgpack bin holding a
+// metric_codec.h delta frame over those columns instead of a map. The
+// schema follows the subscribed fields in F_* order, with "cpus" expanded
+// to "cpus.0".."cpus.N-1"; "procs" has no fixed layout and is only sent in
+// map mode. The schema is resent, and the delta state reset, whenever the
+// columns change.
+static int compact = 0;
+static int schema_sent = 0;
+static int schema_ncpus = 0;
+static McStream stream;
+
+static void output_init(void) {
+    msgpack_sbuffer_init(&out_buf);
+    out_buf.data = malloc(OUT_BUF_INITIAL);
+    out_buf.alloc = out_buf.data ? OUT_BUF_INITIAL : 0;
+    msgpack_packer_init(&out_pk, &out_buf, msgpack_sbuffer_write);
+}
+
+// writev() until everything is out; returns -1 on a write error.
+static int write_all(struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t n = writev(STDOUT_FILENO, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// One write: [length prefix if framed] [head] [body]. A failed write means
+// the reader is gone (EPIPE), which stops the event loop.
+static int send_frame(const void *head, size_t head_len, const void *body, size_t body_len) {
+    uint32_t payload = (uint32_t)(head_len + body_len);
+    unsigned char prefix[4] = {payload >> 24, payload >> 16, payload >> 8, payload};
+
+    struct iovec iov[3];
+    int iovcnt = 0;
+    if (framed) {
+        iov[iovcnt++] = (struct iovec){prefix, sizeof(prefix)};
+    }
+    if (head_len) {
+        iov[iovcnt++] = (struct iovec){(void *)head, head_len};
+    }
+    iov[iovcnt++] = (struct iovec){(void *)body, body_len};
+    if (write_all(iov, iovcnt) != 0) {
+        running = 0;
+        return -1;
     }
-    
-    char buffer[256];
-    fgets(buffer, sizeof(buffer), fp);
-    fclose(fp);
-    
-    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-    sscanf(buffer, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
-           &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-    
-    unsigned long long total = user + nice + system + idle + iowait + irq + softirq + steal;
-    unsigned long long total_idle = idle + iowait;
-    
-    if (prev_total != 0) {
-        unsigned long long total_diff = total - prev_total;
-        unsigned long long idle_diff = total_idle - prev_idle;
-        
-        if (total_diff > 0) {
-            *usage = (double)(total_diff - idle_diff) / total_diff;
+    return 0;
+}
+
+// Sends the pending samples as one frame: [length] [array header] samples.
+static int flush_batch(void) {
+    if (batch_count == 0) {
+        return 0;
+    }
+
+    unsigned char head[5];
+    size_t head_len = 0;
+    if (batch_size > 1) {
+        if (batch_count < 16) {
+            head[head_len++] = 0x90 | batch_count;
         } else {
-            *usage = 0.0;
+            head[head_len++] = 0xdc;
+            head[head_len++] = (unsigned char)(batch_count >> 8);
+            head[head_len++] = (unsigned char)batch_count;
         }
-    } else {
-        *usage = 0.0;
     }
-    
-    prev_idle = total_idle;
-    prev_total = total;
+
+    int rc = send_frame(head, head_len, out_buf.data, out_buf.size);
+    msgpack_sbuffer_clear(&out_buf);
+    batch_count = 0;
+    return rc;
 }
 
-void send_metrics() {
-    struct sysinfo info;
-    sysinfo(&info);
-    
-    double cpu_usage;
-    get_cpu_usage(&cpu_usage);
-    
-    // Get current timestamp
-    time_t now = time(NULL);
+// Human-readable log to stderr, at most once per wall-clock second so that
+// high sample rates do not flood the terminal (and localtime() is not called
+// on every tick).
+void log_metrics(const PsSample *s, double cpu_usage) {
+    static time_t last_logged = 0;
+    if (s->when.tv_sec == last_logged) {
+        return;
+    }
+    last_logged = s->when.tv_sec;
+
     char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    
-    // Print human-readable output to stderr
-    fprintf(stderr, "[%s] CPU: %.2f%% | Memory: %lu MB / %lu MB | Uptime: %ld seconds\n",
+    struct tm tm;
+    localtime_r(&s->when.tv_sec, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+    fprintf(stderr, "[%s] CPU: %.2f%% | Memory: %llu MB / %llu MB | Uptime: %.0f seconds\n",
             timestamp,
             cpu_usage * 100,
-            (info.totalram - info.freeram) / (1024 * 1024),
-            info.totalram / (1024 * 1024),
-            info.uptime);
-    
-    // Create MessagePack data
-    msgpack_sbuffer sbuf;
+            (unsigned long long)((s->mem_total - s->mem_free) / 1024),
+            (unsigned long long)(s->mem_total / 1024),
+            s->uptime);
+}
+
+static void pack_str(msgpack_packer *pk, const char *key) {
+    size_t len = strlen(key);
+    msgpack_pack_str(pk, len);
+    msgpack_pack_str_body(pk, key, len);
+}
+
+// Per-second rate of a monotonically increasing counter.
+static double counter_rate(uint64_t prev, uint64_t cur, double dt) {
+    return dt > 0 && cur >= prev ? (double)(cur - prev) / dt : 0.0;
+}
+
+static void pack_procs(msgpack_packer *pk) {
+    int alive = 0;
+    for (int i = 0; i < sampler.nprocs; i++) {
+        alive += sampler.procs[i].alive;
+    }
+    msgpack_pack_array(pk, alive);
+
+    double dt = ps_interval(&sampler);
+    for (int i = 0; i < sampler.nprocs; i++) {
+        const PsProc *pr = &sampler.procs[i];
+        if (!pr->alive) {
+            continue;
+        }
+        msgpack_pack_map(pk, 8);
+        pack_str(pk, "pid");
+        msgpack_pack_int64(pk, pr->pid);
+        pack_str(pk, "name");
+        pack_str(pk, pr->comm);
+        pack_str(pk, "cpu");
+        msgpack_pack_double(pk, ps_proc_cpu(&sampler, pr));
+        pack_str(pk, "core");
+        msgpack_pack_int64(pk, pr->cur.processor);
+        pack_str(pk, "rss");
+        msgpack_pack_uint64(pk, pr->cur.rss * (uint64_t)sampler.page_size);
+        pack_str(pk, "threads");
+        msgpack_pack_uint64(pk, pr->cur.num_threads);
+        pack_str(pk, "read");
+        msgpack_pack_double(pk, counter_rate(pr->prev.rchar, pr->cur.rchar, dt));
+        pack_str(pk, "write");
+        msgpack_pack_double(pk, counter_rate(pr->prev.wchar, pr->cur.wchar, dt));
+    }
+}
+
+static void send_schema(int ncpus) {
+    uint8_t types[MC_MAX_COLS];
+    int ncols = 0;
+    for (int f = 0; f < F_PROCS; f++) {
+        if (!WANT(f)) {
+            continue;
+        }
+        int n = f == F_CPUS ? ncpus : 1;
+        for (int i = 0; i < n; i++) {
+            types[ncols++] = f == F_MEM || f == F_UPTIME || f == F_TIMESTAMP ? MC_INT : MC_FLOAT;
+        }
+    }
+
+    msgpack_sbuffer buf;
     msgpack_packer pk;
-    msgpack_sbuffer_init(&sbuf);
-    msgpack_packer_init(&pk, &sbuf, msgpack_sbuffer_write);
-    
-    // Pack map with 4 fields
-    msgpack_pack_map(&pk, 4);
-    
+    msgpack_sbuffer_init(&buf);
+    msgpack_packer_init(&pk, &buf, msgpack_sbuffer_write);
+    msgpack_pack_map(&pk, 2);
+    pack_str(&pk, "schema");
+    msgpack_pack_array(&pk, ncols);
+    for (int f = 0; f < F_PROCS; f++) {
+        if (!WANT(f)) {
+            continue;
+        }
+        if (f != F_CPUS) {
+            pack_str(&pk, field_names[f]);
+            continue;
+        }
+        for (int i = 0; i < ncpus; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "cpus.%d", i);
+            pack_str(&pk, name);
+        }
+    }
+    pack_str(&pk, "types");
+    msgpack_pack_array(&pk, ncols);
+    for (int c = 0; c < ncols; c++) {
+        pack_str(&pk, types[c] == MC_INT ? "int" : "float");
+    }
+
+    // Batched samples belong to the previous schema.
+    flush_batch();
+    send_frame(NULL, 0, buf.data, buf.size);
+    msgpack_sbuffer_destroy(&buf);
+
+    mc_reset(&stream, ncols, types);
+    schema_sent = 1;
+    schema_ncpus = ncpus;
+}
+
+// Appends one compact sample (see `compact`) to the pending batch.
+static void pack_compact(msgpack_packer *pk, const PsSample *s, const PsSample *prev, int have_prev,
+                         double cpu_usage, double ctxt_rate, double intr_rate) {
+    if (!schema_sent || s->ncpus != schema_ncpus) {
+        send_schema(s->ncpus);
+    }
+
+    uint64_t vals[MC_MAX_COLS];
+    int n = 0;
+    if (WANT(F_CPU)) {
+        vals[n++] = mc_f2u(cpu_usage);
+    }
+    if (WANT(F_MEM)) {
+        vals[n++] = (s->mem_total - s->mem_free) * 1024;
+    }
+    if (WANT(F_UPTIME)) {
+        vals[n++] = (uint64_t)s->uptime;
+    }
+    if (WANT(F_TIMESTAMP)) {
+        vals[n++] = (uint64_t)s->when.tv_sec;
+    }
+    if (WANT(F_CPUS)) {
+        for (int i = 0; i < s->ncpus; i++) {
+            vals[n++] = mc_f2u(have_prev && i < prev->ncpus ? ps_cpu_usage(&prev->cpus[i], &s->cpus[i]) : 0.0);
+        }
+    }
+    if (WANT(F_CTXT)) {
+        vals[n++] = mc_f2u(ctxt_rate);
+    }
+    if (WANT(F_INTR)) {
+        vals[n++] = mc_f2u(intr_rate);
+    }
+
+    uint8_t frame[MC_MAX_FRAME];
+    size_t len = mc_encode(&stream, vals, frame);
+    msgpack_pack_bin(pk, len);
+    msgpack_pack_bin_body(pk, frame, len);
+}
+
+void send_metrics() {
+    if (ps_sample(&sampler) != 0) {
+        return;
+    }
+    const PsSample *s = sampler.cur, *prev = sampler.prev;
+    int have_prev = sampler.samples > 1;
+    double dt = ps_interval(&sampler);
+    double cpu_usage = have_prev ? ps_cpu_usage(&prev->cpu, &s->cpu) : 0.0;
+
+    log_metrics(s, cpu_usage);
+
+    double ctxt_rate = have_prev ? counter_rate(prev->ctxt, s->ctxt, dt) : 0.0;
+    double intr_rate = have_prev ? counter_rate(prev->intr, s->intr, dt) : 0.0;
+    double values[HISTORY_FIELDS] = {cpu_usage, (double)(s->mem_total - s->mem_free) * 1024, ctxt_rate, intr_rate};
+    mh_record(&history, (uint64_t)s->when.tv_sec * 1000 + s->when.tv_nsec / 1000000, values);
+
+    // Append this sample to the pending batch
+    msgpack_packer *pk = &out_pk;
+    if (compact) {
+        pack_compact(pk, s, prev, have_prev, cpu_usage, ctxt_rate, intr_rate);
+        if (++batch_count >= batch_size) {
+            flush_batch();
+        }
+        return;
+    }
+    msgpack_pack_map(pk, __builtin_popcount(subscribed));
+
     // CPU usage
-    msgpack_pack_str(&pk, 3);
-    msgpack_pack_str_body(&pk, "cpu", 3);
-    msgpack_pack_double(&pk, cpu_usage);
-    
-    // Memory used
-    msgpack_pack_str(&pk, 3);
-    msgpack_pack_str_body(&pk, "mem", 3);
-    msgpack_pack_uint64(&pk, info.totalram - info.freeram);
-    
+    if (WANT(F_CPU)) {
+        pack_str(pk, "cpu");
+        msgpack_pack_double(pk, cpu_usage);
+    }
+
+    // Memory used (bytes)
+    if (WANT(F_MEM)) {
+        pack_str(pk, "mem");
+        msgpack_pack_uint64(pk, (s->mem_total - s->mem_free) * 1024);
+    }
+
     // Uptime
-    msgpack_pack_str(&pk, 6);
-    msgpack_pack_str_body(&pk, "uptime", 6);
-    msgpack_pack_uint64(&pk, info.uptime);
-    
+    if (WANT(F_UPTIME)) {
+        pack_str(pk, "uptime");
+        msgpack_pack_uint64(pk, (uint64_t)s->uptime);
+    }
+
     // Timestamp
-    msgpack_pack_str(&pk, 9);
-    msgpack_pack_str_body(&pk, "timestamp", 9);
-    msgpack_pack_uint64(&pk, (uint64_t)now);
-    
-    // Write binary data to stdout
-    fwrite(sbuf.data, 1, sbuf.size, stdout);
-    fflush(stdout);
-    
-    msgpack_sbuffer_destroy(&sbuf);
-}
-
-int main() {
-    fprintf(stderr, "Starting system metrics monitor...\n");
-    fprintf(stderr, "Binary MessagePack data will be written to stdout\n");
-    fprintf(stderr, "Human-readable logs below:\n\n");
-    
-    while (1) {
-        send_metrics();
-        sleep(1);
+    if (WANT(F_TIMESTAMP)) {
+        pack_str(pk, "timestamp");
+        msgpack_pack_uint64(pk, (uint64_t)s->when.tv_sec);
     }
-    
+
+    // Per-core usage, indexed by core number
+    if (WANT(F_CPUS)) {
+        pack_str(pk, "cpus");
+        msgpack_pack_array(pk, s->ncpus);
+        for (int i = 0; i < s->ncpus; i++) {
+            msgpack_pack_double(pk, have_prev && i < prev->ncpus
+                                         ? ps_cpu_usage(&prev->cpus[i], &s->cpus[i])
+                                         : 0.0);
+        }
+    }
+
+    // Context switches and interrupts per second
+    if (WANT(F_CTXT)) {
+        pack_str(pk, "ctxt");
+        msgpack_pack_double(pk, ctxt_rate);
+    }
+    if (WANT(F_INTR)) {
+        pack_str(pk, "intr");
+        msgpack_pack_double(pk, intr_rate);
+    }
+
+    // Watched processes
+    if (WANT(F_PROCS)) {
+        pack_str(pk, "procs");
+        pack_procs(pk);
+    }
+
+    if (++batch_count >= batch_size) {
+        flush_batch();
+    }
+}
+
+static void pack_series(msgpack_packer *pk, const char *name, const MrRecord *recs, size_t n, const double *(*col)(const MrRecord *), int field) {
+    pack_str(pk, name);
+    msgpack_pack_array(pk, n);
+    for (size_t i = 0; i < n; i++) {
+        msgpack_pack_double(pk, col(&recs[i])[field]);
+    }
+}
+
+static const double *col_min(const MrRecord *r) { return r->min; }
+static const double *col_max(const MrRecord *r) { return r->max; }
+static const double *col_avg(const MrRecord *r) { return r->avg; }
+
+// Replies {key: msg} as its own frame, after any pending samples.
+static void send_reply(const char *key, const char *msg) {
+    msgpack_sbuffer buf;
+    msgpack_packer pk;
+    msgpack_sbuffer_init(&buf);
+    msgpack_packer_init(&pk, &buf, msgpack_sbuffer_write);
+    msgpack_pack_map(&pk, 1);
+    pack_str(&pk, key);
+    pack_str(&pk, msg);
+    flush_batch();
+    send_frame(NULL, 0, buf.data, buf.size);
+    msgpack_sbuffer_destroy(&buf);
+}
+
+static void send_error(const char *msg) {
+    send_reply("error", msg);
+}
+
+// "history <field> <level> <n>": replies with {"history": field, "level":
+// level, "t": [ms...], "min": [...], "max": [...], "avg": [...]} holding the
+// newest n points, oldest first.
+static void handle_history(const char *line) {
+    static MrRecord recs[HISTORY_MAX_REPLY];
+    char field[16], level_name[8];
+    int n;
+
+    if (sscanf(line, "history %15s %7s %d", field, level_name, &n) != 3) {
+        send_error("usage: history <cpu|mem|ctxt|intr> <raw|1s|10s|60s> <n>");
+        return;
+    }
+    int f = -1;
+    for (int i = 0; i < HISTORY_FIELDS; i++) {
+        if (strcmp(field, history_fields[i]) == 0) {
+            f = i;
+        }
+    }
+    int level = mr_level_parse(level_name);
+    if (f < 0 || level < 0 || n <= 0) {
+        send_error("usage: history <cpu|mem|ctxt|intr> <raw|1s|10s|60s> <n>");
+        return;
+    }
+    if (n > HISTORY_MAX_REPLY) {
+        n = HISTORY_MAX_REPLY;
+    }
+    size_t count = mh_query(&history, (MrLevel)level, recs, (size_t)n);
+
+    msgpack_sbuffer buf;
+    msgpack_packer pk;
+    msgpack_sbuffer_init(&buf);
+    msgpack_packer_init(&pk, &buf, msgpack_sbuffer_write);
+    msgpack_pack_map(&pk, 6);
+    pack_str(&pk, "history");
+    pack_str(&pk, history_fields[f]);
+    pack_str(&pk, "level");
+    pack_str(&pk, mr_level_name((MrLevel)level));
+    pack_str(&pk, "t");
+    msgpack_pack_array(&pk, count);
+    for (size_t i = 0; i < count; i++) {
+        msgpack_pack_uint64(&pk, recs[i].t_ms);
+    }
+    pack_series(&pk, "min", recs, count, col_min, f);
+    pack_series(&pk, "max", recs, count, col_max, f);
+    pack_series(&pk, "avg", recs, count, col_avg, f);
+
+    flush_batch();
+    send_frame(NULL, 0, buf.data, buf.size);
+    msgpack_sbuffer_destroy(&buf);
+}
+
+// --- Event loop ---
+//
+// Every collector owns a periodic CLOCK_MONOTONIC timerfd, so ticks are
+// scheduled by the kernel against absolute expirations and never drift by
+// the cost of the work done in between; collectors at different rates share
+// one epoll_wait(). A collector that overruns its period runs once for all
+// missed expirations instead of trying to catch up.
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+    long interval_ns;
+    int paused;
+    int fd;
+} Collector;
+
+static void rescan_children(void) {
+    for (int i = 0; i < ntree; i++) {
+        ps_watch_children(&sampler, tree_pids[i]);
+    }
+}
+
+enum { C_METRICS, C_CHILDREN, C_COUNT };
+static Collector collectors[C_COUNT] = {
+    [C_METRICS] = {"metrics", send_metrics, 1000000000L, 0, -1},
+    // Language servers come and go: pick up new children once a second.
+    [C_CHILDREN] = {"children", rescan_children, 1000000000L, 0, -1},
+};
+
+// (Re)arms a collector's timer; the first tick fires right away.
+static int collector_arm(Collector *c) {
+    struct itimerspec its = {0};
+    if (!c->paused) {
+        its.it_value.tv_nsec = 1;
+        its.it_interval.tv_sec = c->interval_ns / 1000000000L;
+        its.it_interval.tv_nsec = c->interval_ns % 1000000000L;
+    }
+    return timerfd_settime(c->fd, 0, &its, NULL);
+}
+
+// "subscribe <field,...|all>": restricts sample maps to the listed keys.
+static void handle_subscribe(const char *line) {
+    char list[256];
+    if (sscanf(line, "subscribe %255s", list) != 1) {
+        send_error("usage: subscribe <field,...|all>");
+        return;
+    }
+    unsigned mask = 0;
+    if (strcmp(list, "all") == 0) {
+        mask = (1u << F_COUNT) - 1;
+    } else {
+        for (char *save, *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+            int f = 0;
+            while (f < F_COUNT && strcmp(tok, field_names[f]) != 0) {
+                f++;
+            }
+            if (f == F_COUNT) {
+                send_error("unknown field");
+                return;
+            }
+            mask |= 1u << f;
+        }
+    }
+    // Samples already batched were packed with the old key set.
+    flush_batch();
+    subscribed = mask;
+    schema_sent = 0;
+    send_reply("ok", "subscribe");
+}
+
+// Command channel on stdin, one command per line. Every command is answered
+// with its own frame: {"ok": command}, {"error": message} or, for history,
+// the requested series. Pending batched samples are flushed first so replies
+// never interleave with a partial batch.
+//
+//   rate <hz>                       change the sample rate (max 1000)
+//   pause | resume                  stop / restart sampling
+//   subscribe <field,...|all>       fields: cpu mem uptime timestamp cpus
+//                                           ctxt intr procs
+//   format <map|compact>            sample encoding (see `compact`)
+//   history <field> <level> <n>     field: cpu mem ctxt intr
+//                                   level: raw 1s 10s 60s
+static void handle_command(const char *line) {
+    Collector *metrics = &collectors[C_METRICS];
+    double hz;
+    char word[16];
+
+    if (strncmp(line, "history", 7) == 0) {
+        handle_history(line);
+    } else if (strncmp(line, "subscribe", 9) == 0) {
+        handle_subscribe(line);
+    } else if (sscanf(line, "rate %lf", &hz) == 1) {
+        if (hz <= 0 || hz > 1000) {
+            send_error("rate must be in (0, 1000]");
+            return;
+        }
+        metrics->interval_ns = (long)(1e9 / hz);
+        collector_arm(metrics);
+        send_reply("ok", "rate");
+    } else if (sscanf(line, "format %15s", word) == 1) {
+        if (strcmp(word, "map") != 0 && strcmp(word, "compact") != 0) {
+            send_error("usage: format <map|compact>");
+            return;
+        }
+        flush_batch();
+        compact = word[0] == 'c';
+        schema_sent = 0;
+        send_reply("ok", "format");
+    } else if (strcmp(line, "pause") == 0 || strcmp(line, "resume") == 0) {
+        metrics->paused = line[0] == 'p';
+        if (metrics->paused) {
+            flush_batch();
+        }
+        collector_arm(metrics);
+        send_reply("ok", line);
+    } else if (line[0] != '\0') {
+        send_error("unknown command");
+    }
+}
+
+// Reads whatever is available on stdin and runs every complete line.
+// Returns -1 once stdin is closed.
+static int read_commands(void) {
+    static char line[512];
+    static size_t len = 0;
+
+    char chunk[512];
+    ssize_t n = read(STDIN_FILENO, chunk, sizeof(chunk));
+    if (n <= 0) {
+        return n < 0 && (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+    }
+    for (ssize_t i = 0; i < n; i++) {
+        if (chunk[i] == '\n') {
+            line[len] = '\0';
+            handle_command(line);
+            len = 0;
+        } else if (len < sizeof(line) - 1) {
+            line[len++] = chunk[i];
+        }
+    }
+    return 0;
+}
+
+// Runs collectors and serves stdin until the reader goes away: EOF on a
+// stdin pipe (Neovim closed the job) or a failed write (EPIPE).
+static int event_loop(void) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    for (int i = 0; i < C_COUNT; i++) {
+        Collector *c = &collectors[i];
+        if (i == C_CHILDREN && ntree == 0) {
+            continue;
+        }
+        c->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = c};
+        if (c->fd < 0 || collector_arm(c) != 0 || epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev) != 0) {
+            perror(c->name);
+            close(ep);
+            return -1;
+        }
+    }
+
+    // Only a pipe or socket on stdin is a control channel whose EOF means
+    // "exit"; a terminal is served too, anything else (/dev/null, files)
+    // is ignored.
+    struct stat st;
+    int stdin_is_pipe = fstat(STDIN_FILENO, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode));
+    if (stdin_is_pipe || isatty(STDIN_FILENO)) {
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+        epoll_ctl(ep, EPOLL_CTL_ADD, STDIN_FILENO, &ev);
+    }
+
+    while (running) {
+        struct epoll_event events[C_COUNT + 1];
+        int n = epoll_wait(ep, events, C_COUNT + 1, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n && running; i++) {
+            Collector *c = events[i].data.ptr;
+            if (c == NULL) {
+                if (read_commands() < 0) {
+                    if (stdin_is_pipe) {
+                        running = 0;
+                    }
+                    epoll_ctl(ep, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+                }
+                continue;
+            }
+            uint64_t expirations;
+            if (read(c->fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                c->run();
+            }
+        }
+    }
+
+    flush_batch();
+    for (int i = 0; i < C_COUNT; i++) {
+        if (collectors[i].fd >= 0) {
+            close(collectors[i].fd);
+        }
+    }
+    close(ep);
     return 0;
 }
+
+int main(int argc, char *argv[]) {
+    double rate_hz = 1.0;
+    int watch_pids[PS_MAX_PROCS];
+    int nwatch = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:p:c:b:fz")) != -1) {
+        if (opt == 'r' && atof(optarg) > 0 && atof(optarg) <= 1000) {
+            rate_hz = atof(optarg);
+        } else if (opt == 'b' && atoi(optarg) >= 1 && atoi(optarg) <= 1024) {
+            batch_size = atoi(optarg);
+        } else if (opt == 'f') {
+            framed = 1;
+        } else if (opt == 'z') {
+            compact = 1;
+        } else if (opt == 'p' && atoi(optarg) > 0 && nwatch < PS_MAX_PROCS) {
+            watch_pids[nwatch++] = atoi(optarg);
+        } else if (opt == 'c' && atoi(optarg) > 0 && ntree < PS_MAX_PROCS) {
+            tree_pids[ntree++] = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-r samples_per_second (max 1000)] [-b batch] [-f] [-z] [-p pid]... [-c pid]...\n"
+                            "  -b n    send n samples per write as one msgpack array (max 1024)\n"
+                            "  -f      prefix every write with its length (4-byte big-endian)\n"
+                            "  -z      compact delta-encoded samples after a schema frame\n"
+                            "  -p pid  report this process\n"
+                            "  -c pid  report this process and all of its children\n"
+                            "Commands on stdin: rate <hz>, pause, resume, subscribe <field,...|all>, format <map|compact>,\n"
+                            "history <field> <level> <n>. Exits when stdin (a pipe) is closed.\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (ps_open(&sampler) != 0) {
+        perror("Error opening /proc/stat");
+        return 1;
+    }
+    output_init();
+    if (mh_init(&history, HISTORY_FIELDS, HISTORY_RAW_POINTS) != 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < nwatch; i++) {
+        if (ps_watch(&sampler, watch_pids[i]) < 0) {
+            fprintf(stderr, "Cannot watch pid %d\n", watch_pids[i]);
+        }
+    }
+    for (int i = 0; i < ntree; i++) {
+        if (ps_watch(&sampler, tree_pids[i]) < 0) {
+            fprintf(stderr, "Cannot watch pid %d\n", tree_pids[i]);
+        }
+    }
+    // A closed stdout must surface as EPIPE from write(), not kill us.
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "Starting system metrics monitor (%.1f Hz)...\n", rate_hz);
+    fprintf(stderr, "Binary MessagePack data will be written to stdout\n");
+    fprintf(stderr, "Human-readable logs below:\n\n");
+
+    collectors[C_METRICS].interval_ns = (long)(1e9 / rate_hz);
+    int rc = event_loop();
+
+    mh_free(&history);
+    ps_close(&sampler);
+    return rc == 0 ? 0 : 1;
+}
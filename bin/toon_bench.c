@@ -0,0 +1,237 @@
+// Parse throughput / peak memory regression suite for toon_format.h.
+//
+//   gcc -O2 -o toon_bench toon_bench.c
+//   ./toon_bench [-o history.tsv] [-l label] [-t percent]
+//
+// Each case runs in its own child process so ru_maxrss is the peak RSS of
+// that case alone. With -o, results are appended to a TSV history file and
+// compared against the last recorded run of the same case; a throughput drop
+// of more than -t percent (default 10) makes the suite exit non-zero.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TOON_IMPLEMENTATION
+#include "toon_format.h"
+
+typedef struct {
+  char *buf;
+  size_t len, cap;
+} Text;
+
+static void text_printf(Text *t, const char *fmt, ...) {
+  va_list ap;
+  for (;;) {
+    va_start(ap, fmt);
+    int n = vsnprintf(t->buf + t->len, t->cap - t->len, fmt, ap);
+    va_end(ap);
+    if ((size_t)n < t->cap - t->len) {
+      t->len += (size_t)n;
+      return;
+    }
+    t->cap = t->cap ? t->cap * 2 : 4096;
+    t->buf = realloc(t->buf, t->cap);
+  }
+}
+
+// --- Documents ---
+
+static void gen_small_config(Text *t) {
+  text_printf(t, "editor:\n  tabstop: 4\n  shiftwidth: 4\n  wrap: false\n"
+                 "  theme: paperlike_day\nlsp:\n  lua_ls:\n    enabled: true\n"
+                 "    cmd: lua-language-server\n  clangd:\n    enabled: true\n"
+                 "    args[3]: --background-index,--clang-tidy,-j=4\n"
+                 "keymaps[4]{mode,lhs,rhs}:\n  n,<leader>ff,find_files\n"
+                 "  n,<leader>fg,live_grep\n  n,<leader>b,buffers\n"
+                 "  i,jk,<Esc>\n");
+}
+
+static void gen_wide_table(Text *t) {
+  const int cols = 256, rows = 2000;
+  text_printf(t, "metrics[%d]{", rows);
+  for (int c = 0; c < cols; c++)
+    text_printf(t, c ? ",c%d" : "c%d", c);
+  text_printf(t, "}:\n");
+  for (int r = 0; r < rows; r++) {
+    text_printf(t, "  ");
+    for (int c = 0; c < cols; c++)
+      text_printf(t, c ? ",%d" : "%d", r * cols + c);
+    text_printf(t, "\n");
+  }
+}
+
+static void gen_deep_nesting(Text *t) {
+  const int depth = 60, trees = 200;
+  for (int k = 0; k < trees; k++) {
+    for (int d = 0; d < depth; d++)
+      text_printf(t, "%*sn%d_%d:\n", d * 2, "", k, d);
+    text_printf(t, "%*sleaf: %d\n", depth * 2, "", k);
+  }
+}
+
+static void gen_big_table(Text *t) {
+  const int rows = 200000;
+  text_printf(t, "files[%d]{id,path,size,mtime,score,dirty}:\n", rows);
+  for (int i = 0; i < rows; i++)
+    text_printf(t, "  %d,lua/archives/lazy_%06d.lua,%d,%d,%.3f,%s\n", i, i,
+                (i * 7919) % 100000, 1700000000 + i, (i % 1000) / 7.0,
+                i % 3 ? "false" : "true");
+}
+
+typedef struct {
+  const char *name;
+  void (*gen)(Text *t);
+  int iters;
+} BenchCase;
+
+static const BenchCase cases[] = {
+    {"small_config", gen_small_config, 20000},
+    {"wide_table", gen_wide_table, 5},
+    {"deep_nesting", gen_deep_nesting, 20},
+    {"big_table", gen_big_table, 3},
+};
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Runs in the child; writes "bytes mbps rss_kb" to `fd`.
+static void run_case(const BenchCase *bc, int fd) {
+  Text t = {0};
+  bc->gen(&t);
+  ToonParseOptions opts = {0};
+  opts.flags = TOON_PARSE_INFER | TOON_PARSE_STRICT;
+  ToonError err;
+
+  double best = 1e30;
+  for (int i = 0; i < bc->iters; i++) {
+    double t0 = now_sec();
+    ToonValue *v = toon_parse_opts(t.buf, &opts, &err);
+    double dt = now_sec() - t0;
+    if (!v) {
+      fprintf(stderr, "%s: %d:%d: %s\n", bc->name, err.line, err.col,
+              err.msg);
+      _exit(1);
+    }
+    toon_free(v);
+    if (dt < best)
+      best = dt;
+  }
+
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  dprintf(fd, "%zu %.2f %ld\n", t.len, t.len / best / (1024.0 * 1024.0),
+          ru.ru_maxrss);
+  _exit(0);
+}
+
+// Last recorded throughput for `name` in the history file, or 0. Lines are
+// split on tabs (date, label, case, bytes, MB/s, rss), so labels and case
+// names may contain spaces.
+static double last_mbps(const char *path, const char *name) {
+  FILE *f = path ? fopen(path, "r") : NULL;
+  double last = 0;
+  char line[512];
+  if (!f)
+    return 0;
+  while (fgets(line, sizeof(line), f)) {
+    char *field[6];
+    char *p = line;
+    int n = 0;
+    for (; n < 6 && p; n++) {
+      field[n] = p;
+      if ((p = strchr(p, '\t')))
+        *p++ = '\0';
+    }
+    if (n == 6 && strcmp(field[2], name) == 0)
+      last = atof(field[4]);
+  }
+  fclose(f);
+  return last;
+}
+
+int main(int argc, char **argv) {
+  const char *history = NULL, *label = "-";
+  double threshold = 10.0;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:l:t:")) != -1) {
+    switch (opt) {
+    case 'o':
+      history = optarg;
+      break;
+    case 'l':
+      label = optarg;
+      break;
+    case 't':
+      threshold = atof(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-o history.tsv] [-l label] [-t percent]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  char date[32];
+  time_t now = time(NULL);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  int regressions = 0;
+  printf("%-14s %10s %10s %10s %8s\n", "case", "bytes", "MB/s", "rss KB",
+         "vs last");
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("pipe");
+      return 1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      run_case(&cases[i], fds[1]);
+    }
+    close(fds[1]);
+    char out[128] = {0};
+    ssize_t n = read(fds[0], out, sizeof(out) - 1);
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+
+    size_t bytes;
+    double mbps;
+    long rss;
+    if (n <= 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        sscanf(out, "%zu %lf %ld", &bytes, &mbps, &rss) != 3) {
+      printf("%-14s FAILED\n", cases[i].name);
+      regressions++;
+      continue;
+    }
+
+    double prev = last_mbps(history, cases[i].name);
+    double delta = prev > 0 ? (mbps - prev) * 100.0 / prev : 0;
+    char vs[16] = "n/a";
+    if (prev > 0)
+      snprintf(vs, sizeof(vs), "%+.1f%%", delta);
+    printf("%-14s %10zu %10.2f %10ld %8s%s\n", cases[i].name, bytes, mbps,
+           rss, vs, delta < -threshold ? "  REGRESSION" : "");
+    if (delta < -threshold)
+      regressions++;
+
+    if (history) {
+      FILE *f = fopen(history, "a");
+      if (f) {
+        fprintf(f, "%s\t%s\t%s\t%zu\t%.2f\t%ld\n", date, label,
+                cases[i].name, bytes, mbps, rss);
+        fclose(f);
+      }
+    }
+  }
+  return regressions ? 1 : 0;
+}
@@ -2,11 +2,54 @@
 #define TOON_FORMAT_H
 
 #include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-typedef enum { TOON_NULL, TOON_STRING, TOON_OBJECT, TOON_ARRAY } ToonType;
+typedef enum {
+  TOON_NULL,
+  TOON_STRING,
+  TOON_OBJECT,
+  TOON_ARRAY,
+  TOON_BOOL,
+  TOON_INT,
+  TOON_FLOAT
+} ToonType;
+
+// Parse flags for toon_parse_ex()
+enum {
+  TOON_PARSE_DEFAULT = 0,
+  // Turn unquoted scalars into TOON_INT/TOON_FLOAT/TOON_BOOL/TOON_NULL
+  // instead of keeping every value as a string.
+  TOON_PARSE_INFER = 1 << 0,
+  // Also reject documents whose declared [n] counts or table row widths do
+  // not match the data that follows.
+  TOON_PARSE_STRICT = 1 << 1
+};
+
+// Resource limits for toon_parse_opts(). A zero field means "use the
+// default"; input that exceeds a limit fails with an error instead of
+// allocating past it.
+typedef struct {
+  unsigned flags;
+  size_t max_input;   // bytes of source text      (default: unlimited)
+  size_t max_depth;   // nested object levels      (default: 64)
+  size_t max_columns; // columns per table header  (default: 1024)
+  size_t max_items;   // declared [n] of an array  (default: 16M)
+} ToonParseOptions;
+
+#define TOON_DEFAULT_MAX_DEPTH 64
+#define TOON_DEFAULT_MAX_COLUMNS 1024
+#define TOON_DEFAULT_MAX_ITEMS (1u << 24)
+
+typedef struct {
+  int line; // 1-based position of the offending input
+  int col;
+  char msg[96];
+} ToonError;
 
 typedef struct ToonValue ToonValue;
 
@@ -19,21 +62,90 @@ struct ToonValue {
   ToonType type;
   union {
     char *str_val;
+    int bool_val;
+    int64_t int_val;
+    double float_val;
     struct {
       ToonValue **items;
       size_t count;
+      size_t cap;
     } array;
     struct {
       ToonEntry *entries;
       size_t count;
+      size_t cap;
     } object;
   } data;
 };
 
+// All parse functions return NULL on malformed input or allocation failure.
 ToonValue *toon_parse(const char *input);
+ToonValue *toon_parse_ex(const char *input, unsigned flags);
+// `opts` and `err` may be NULL; on failure `err` says what and where.
+ToonValue *toon_parse_opts(const char *input, const ToonParseOptions *opts,
+                           ToonError *err);
 void toon_free(ToonValue *value);
 void toon_print(ToonValue *value, int indent);
 
+// Writes `root` (an object, as returned by toon_parse) back as TOON text.
+// Arrays of scalars become `key[n]: a,b`, arrays of flat objects with the
+// same keys become tables. Returns 0 on success, -1 if the value has a shape
+// the text syntax cannot express (e.g. nested arrays).
+int toon_write(FILE *out, const ToonValue *root);
+
+// --- Binary encoding ---
+//
+// Compact, position-independent form of a ToonValue tree. Every node lives at
+// an 8-byte aligned offset and refers to its children by offset, so a buffer
+// can be mmap'd and queried in place without building a tree.
+//
+//   header  : "TOON" | u32 version | u32 total size | u32 root offset
+//   node    : u32 type | u32 n | payload
+//     NULL   n = 0
+//     BOOL   n = 0/1
+//     INT    n = 0, i64
+//     FLOAT  n = 0, f64
+//     STRING n = byte length, bytes, NUL
+//     ARRAY  n = count, u32 item offsets[n]
+//     OBJECT n = count, {u32 key offset, u32 value offset}[n]
+//
+// All integers are stored in host byte order.
+
+#define TOON_BIN_VERSION 1
+
+typedef uint32_t ToonRef; // node offset; 0 means "no node"
+
+typedef struct {
+  const unsigned char *base;
+  size_t size;
+} ToonBin;
+
+// Returns a malloc'd buffer holding the encoded tree, or NULL on failure.
+void *toon_encode_binary(const ToonValue *value, size_t *out_size);
+
+// Attaches a view to an encoded buffer (O(1): only the header is checked).
+// Returns 0 on success, -1 if the buffer is not a TOON binary.
+int toon_bin_open(ToonBin *bin, const void *data, size_t size);
+
+ToonRef toon_bin_root(const ToonBin *bin);
+ToonType toon_bin_type(const ToonBin *bin, ToonRef ref);
+size_t toon_bin_len(const ToonBin *bin, ToonRef ref);
+const char *toon_bin_str(const ToonBin *bin, ToonRef ref);
+int toon_bin_bool(const ToonBin *bin, ToonRef ref);
+int64_t toon_bin_int(const ToonBin *bin, ToonRef ref);
+double toon_bin_float(const ToonBin *bin, ToonRef ref);
+ToonRef toon_bin_at(const ToonBin *bin, ToonRef array, size_t index);
+const char *toon_bin_key(const ToonBin *bin, ToonRef object, size_t index);
+ToonRef toon_bin_value(const ToonBin *bin, ToonRef object, size_t index);
+ToonRef toon_bin_get(const ToonBin *bin, ToonRef object, const char *key);
+
+// Materializes a node (and its children) back into a heap ToonValue tree.
+// Returns NULL if out of memory or the node is malformed, including nesting
+// deeper than TOON_BIN_MAX_DEPTH and nodes referenced more than once.
+ToonValue *toon_bin_to_value(const ToonBin *bin, ToonRef ref);
+
+#define TOON_BIN_MAX_DEPTH 512
+
 #ifdef TOON_IMPLEMENTATION
 
 // --- Helpers ---
@@ -53,7 +165,7 @@ static char *my_strndup(const char *s, size_t n) {
     return NULL;
   char *d = malloc(n + 1);
   if (d) {
-    strncpy(d, s, n);
+    memcpy(d, s, n);
     d[n] = '\0';
   }
   return d;
@@ -61,33 +173,68 @@ static char *my_strndup(const char *s, size_t n) {
 
 static ToonValue *tv_new(ToonType t) {
   ToonValue *v = calloc(1, sizeof(ToonValue));
-  v->type = t;
+  if (v)
+    v->type = t;
   return v;
 }
 
 static ToonValue *tv_str(char *s) {
+  if (!s)
+    return NULL;
   ToonValue *v = tv_new(TOON_STRING);
-  v->data.str_val = s;
+  if (v)
+    v->data.str_val = s;
+  else
+    free(s);
   return v;
 }
 
-static void tv_obj_add(ToonValue *obj, const char *key, ToonValue *val) {
-  if (obj->type != TOON_OBJECT)
-    return;
-  obj->data.object.entries =
-      realloc(obj->data.object.entries,
-              (obj->data.object.count + 1) * sizeof(ToonEntry));
-  obj->data.object.entries[obj->data.object.count].key = my_strdup(key);
+void toon_free(ToonValue *v);
+
+// Grows *buf (holding `count` elements of `size` bytes) so one more fits.
+// Capacity doubles, keeping long arrays and wide objects linear to build.
+static int tv_grow(void **buf, size_t *cap, size_t count, size_t size) {
+  if (count < *cap)
+    return 0;
+  size_t ncap = *cap ? *cap * 2 : 4;
+  void *nb = realloc(*buf, ncap * size);
+  if (!nb)
+    return -1;
+  *buf = nb;
+  *cap = ncap;
+  return 0;
+}
+
+// Both adders take ownership of `val` and free it if they fail.
+static int tv_obj_add_n(ToonValue *obj, const char *key, size_t key_len,
+                        ToonValue *val) {
+  char *k = NULL;
+  if (!val || obj->type != TOON_OBJECT ||
+      tv_grow((void **)&obj->data.object.entries, &obj->data.object.cap,
+              obj->data.object.count, sizeof(ToonEntry)) ||
+      !(k = my_strndup(key, key_len))) {
+    toon_free(val);
+    return -1;
+  }
+  obj->data.object.entries[obj->data.object.count].key = k;
   obj->data.object.entries[obj->data.object.count].value = val;
   obj->data.object.count++;
+  return 0;
 }
 
-static void tv_arr_push(ToonValue *arr, ToonValue *val) {
-  if (arr->type != TOON_ARRAY)
-    return;
-  arr->data.array.items = realloc(
-      arr->data.array.items, (arr->data.array.count + 1) * sizeof(ToonValue *));
+static int tv_obj_add(ToonValue *obj, const char *key, ToonValue *val) {
+  return tv_obj_add_n(obj, key, strlen(key), val);
+}
+
+static int tv_arr_push(ToonValue *arr, ToonValue *val) {
+  if (!val || arr->type != TOON_ARRAY ||
+      tv_grow((void **)&arr->data.array.items, &arr->data.array.cap,
+              arr->data.array.count, sizeof(ToonValue *))) {
+    toon_free(val);
+    return -1;
+  }
   arr->data.array.items[arr->data.array.count++] = val;
+  return 0;
 }
 
 void toon_free(ToonValue *v) {
@@ -110,13 +257,52 @@ void toon_free(ToonValue *v) {
   free(v);
 }
 
+static int tv_is_scalar(const ToonValue *v) {
+  return v->type != TOON_OBJECT && v->type != TOON_ARRAY;
+}
+
+// Shortest "%g" form that reads back as the same double, always carrying a
+// '.' or exponent so it is re-inferred as a float rather than an int.
+static void fmt_float(char *buf, size_t cap, double d) {
+  for (int prec = 15; prec <= 17; prec++) {
+    snprintf(buf, cap, "%.*g", prec, d);
+    if (strtod(buf, NULL) == d)
+      break;
+  }
+  if (!strpbrk(buf, ".eEn")) // n: inf/nan
+    strncat(buf, ".0", cap - strlen(buf) - 1);
+}
+
+static void tv_fprint_scalar(FILE *out, const ToonValue *v) {
+  char num[40];
+  switch (v->type) {
+  case TOON_STRING:
+    fputs(v->data.str_val, out);
+    break;
+  case TOON_BOOL:
+    fputs(v->data.bool_val ? "true" : "false", out);
+    break;
+  case TOON_INT:
+    fprintf(out, "%lld", (long long)v->data.int_val);
+    break;
+  case TOON_FLOAT:
+    fmt_float(num, sizeof(num), v->data.float_val);
+    fputs(num, out);
+    break;
+  default:
+    fputs("null", out);
+    break;
+  }
+}
+
 void toon_print(ToonValue *v, int indent) {
   if (!v)
     return;
   for (int i = 0; i < indent; i++)
     printf("  ");
-  if (v->type == TOON_STRING) {
-    printf("%s\n", v->data.str_val);
+  if (tv_is_scalar(v)) {
+    tv_fprint_scalar(stdout, v);
+    printf("\n");
   } else if (v->type == TOON_ARRAY) {
     printf("[\n");
     for (size_t i = 0; i < v->data.array.count; i++) {
@@ -131,8 +317,9 @@ void toon_print(ToonValue *v, int indent) {
       for (int j = 0; j < indent + 1; j++)
         printf("  ");
       printf("%s: ", v->data.object.entries[i].key);
-      if (v->data.object.entries[i].value->type == TOON_STRING) {
-        printf("%s\n", v->data.object.entries[i].value->data.str_val);
+      if (tv_is_scalar(v->data.object.entries[i].value)) {
+        tv_fprint_scalar(stdout, v->data.object.entries[i].value);
+        printf("\n");
       } else {
         printf("\n");
         toon_print(v->data.object.entries[i].value, indent + 1);
@@ -145,57 +332,360 @@ void toon_print(ToonValue *v, int indent) {
 }
 
 // --- Parser ---
+//
+// Single pass over the source with no backtracking beyond the current line.
+// Values are sliced out of the input as spans and copied once into their
+// node; every allocation is bounded by the input size and ToonParseOptions.
+
+typedef struct {
+  const char *s;
+  size_t n;
+} Span;
 
 typedef struct {
   const char *src;
   size_t pos;
+  unsigned flags;
+  ToonParseOptions lim;
+  ToonError *err;
+  int failed;
 } Parser;
 
-static void skip_ws(Parser *p) {
-  while (p->src[p->pos] && (p->src[p->pos] == ' ' || p->src[p->pos] == '\t'))
-    p->pos++;
+// Records the first error; line/column are only computed on this cold path.
+static void parse_fail(Parser *p, size_t at, const char *fmt, ...) {
+  if (p->failed)
+    return;
+  p->failed = 1;
+  if (!p->err)
+    return;
+  int line = 1;
+  size_t line_start = 0;
+  for (size_t i = 0; i < at && p->src[i]; i++) {
+    if (p->src[i] == '\n') {
+      line++;
+      line_start = i + 1;
+    }
+  }
+  p->err->line = line;
+  p->err->col = (int)(at - line_start) + 1;
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(p->err->msg, sizeof(p->err->msg), fmt, ap);
+  va_end(ap);
+}
+
+static void parse_oom(Parser *p) { parse_fail(p, p->pos, "out of memory"); }
+
+static Span span_trim(Span sp) {
+  while (sp.n && isspace((unsigned char)sp.s[0])) {
+    sp.s++;
+    sp.n--;
+  }
+  while (sp.n && isspace((unsigned char)sp.s[sp.n - 1]))
+    sp.n--;
+  return sp;
+}
+
+static int span_eq(Span sp, const char *lit) {
+  size_t n = strlen(lit);
+  return sp.n == n && memcmp(sp.s, lit, n) == 0;
 }
 
-static void skip_line(Parser *p) {
-  while (p->src[p->pos] && p->src[p->pos] != '\n')
+// Advances to the next byte from `delims` without leaving the current line.
+static Span scan_until(Parser *p, const char *delims) {
+  size_t start = p->pos;
+  while (p->src[p->pos] && p->src[p->pos] != '\n' &&
+         !strchr(delims, p->src[p->pos]))
     p->pos++;
+  return (Span){p->src + start, p->pos - start};
+}
+
+static void skip_newline(Parser *p) {
   if (p->src[p->pos] == '\n')
     p->pos++;
 }
 
-static char *parse_until(Parser *p, const char *delims) {
-  size_t start = p->pos;
-  while (p->src[p->pos] && !strchr(delims, p->src[p->pos]))
-    p->pos++;
-  return my_strndup(p->src + start, p->pos - start);
+// Splits `sp` at the next comma; returns 0 once `sp` is exhausted.
+static int next_field(Span *sp, Span *field, int *more) {
+  if (!*more)
+    return 0;
+  const char *comma = memchr(sp->s, ',', sp->n);
+  size_t n = comma ? (size_t)(comma - sp->s) : sp->n;
+  *field = span_trim((Span){sp->s, n});
+  *more = comma != NULL;
+  if (comma) {
+    sp->s += n + 1;
+    sp->n -= n + 1;
+  }
+  return 1;
 }
 
-static char *trim(char *s) {
-  if (!s)
+// Scalar inference (TOON_PARSE_INFER). Only canonical spellings are
+// converted: "007" or "1." stay strings so that toon_write() reproduces them.
+static int infer_number(Span sp, ToonValue *out) {
+  const char *p = sp.s, *end = sp.s + sp.n;
+  int is_float = 0;
+  char buf[64];
+  if (sp.n == 0 || sp.n >= sizeof(buf))
+    return 0;
+  if (*p == '-')
+    p++;
+  if (p == end || !isdigit((unsigned char)*p))
+    return 0;
+  if (*p == '0' && p + 1 < end && isdigit((unsigned char)p[1]))
+    return 0;
+  while (p < end && isdigit((unsigned char)*p))
+    p++;
+  if (p < end && *p == '.') {
+    is_float = 1;
+    p++;
+    if (p == end || !isdigit((unsigned char)*p))
+      return 0;
+    while (p < end && isdigit((unsigned char)*p))
+      p++;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    is_float = 1;
+    p++;
+    if (p < end && (*p == '+' || *p == '-'))
+      p++;
+    if (p == end || !isdigit((unsigned char)*p))
+      return 0;
+    while (p < end && isdigit((unsigned char)*p))
+      p++;
+  }
+  if (p != end)
+    return 0;
+
+  memcpy(buf, sp.s, sp.n);
+  buf[sp.n] = '\0';
+  if (!is_float) {
+    errno = 0;
+    long long ll = strtoll(buf, NULL, 10);
+    if (errno == 0) {
+      out->type = TOON_INT;
+      out->data.int_val = ll;
+      return 1;
+    }
+    // out of int64 range: fall through to float
+  }
+  out->type = TOON_FLOAT;
+  out->data.float_val = strtod(buf, NULL);
+  return 1;
+}
+
+// Builds a scalar node from trimmed text, inferring its type if requested.
+static ToonValue *tv_scalar(Parser *p, Span sp) {
+  ToonValue *v;
+  if (p->flags & TOON_PARSE_INFER) {
+    if (span_eq(sp, "null"))
+      return tv_new(TOON_NULL);
+    if (span_eq(sp, "true") || span_eq(sp, "false")) {
+      if ((v = tv_new(TOON_BOOL)))
+        v->data.bool_val = sp.s[0] == 't';
+      return v;
+    }
+    ToonValue num;
+    if (infer_number(sp, &num)) {
+      if ((v = tv_new(num.type)))
+        v->data = num.data;
+      return v;
+    }
+  }
+  return tv_str(my_strndup(sp.s, sp.n));
+}
+
+// Parses the "n" of "key[n]" as a bounded decimal count.
+static int parse_count(Parser *p, Span sp, size_t at, size_t *count) {
+  sp = span_trim(sp);
+  size_t v = 0;
+  if (sp.n == 0) {
+    parse_fail(p, at, "missing array length");
+    return -1;
+  }
+  for (size_t i = 0; i < sp.n; i++) {
+    if (!isdigit((unsigned char)sp.s[i])) {
+      parse_fail(p, at + i, "invalid array length");
+      return -1;
+    }
+    v = v * 10 + (size_t)(sp.s[i] - '0');
+    if (v > p->lim.max_items) {
+      parse_fail(p, at, "array length exceeds limit of %zu",
+                 p->lim.max_items);
+      return -1;
+    }
+  }
+  *count = v;
+  return 0;
+}
+
+// key[n]{col1,col2}:  followed by n indented rows. p->pos is just past '{'.
+static ToonValue *parse_table(Parser *p, size_t count, size_t indent) {
+  size_t cols_at = p->pos;
+  Span cols_str = scan_until(p, "}");
+  if (p->src[p->pos] != '}') {
+    parse_fail(p, cols_at, "unterminated column list");
+    return NULL;
+  }
+  p->pos++;
+  if (p->src[p->pos] != ':') {
+    parse_fail(p, p->pos, "expected ':' after column list");
+    return NULL;
+  }
+  p->pos++;
+  Span rest = span_trim(scan_until(p, ""));
+  if (rest.n) {
+    parse_fail(p, (size_t)(rest.s - p->src), "unexpected text after table "
+                                             "header");
+    return NULL;
+  }
+  skip_newline(p);
+
+  // Column names stay as spans into the source.
+  size_t col_count = 0, col_cap = 0;
+  Span *cols = NULL, field;
+  int more = 1;
+  while (next_field(&cols_str, &field, &more)) {
+    if (col_count >= p->lim.max_columns) {
+      parse_fail(p, cols_at, "table has more than %zu columns",
+                 p->lim.max_columns);
+      free(cols);
+      return NULL;
+    }
+    if (field.n == 0) {
+      parse_fail(p, (size_t)(field.s - p->src), "empty column name");
+      free(cols);
+      return NULL;
+    }
+    if (tv_grow((void **)&cols, &col_cap, col_count, sizeof(Span))) {
+      parse_oom(p);
+      free(cols);
+      return NULL;
+    }
+    cols[col_count++] = field;
+  }
+
+  ToonValue *arr = tv_new(TOON_ARRAY);
+  if (!arr) {
+    parse_oom(p);
+    free(cols);
     return NULL;
-  char *end = s + strlen(s) - 1;
-  while (end > s && isspace(*end))
-    *end-- = '\0';
-  char *start = s;
-  while (*start && isspace(*start))
-    start++;
-  return start;
+  }
+
+  size_t rows = 0;
+  for (; rows < count; rows++) {
+    size_t r_start = p->pos, r_indent = 0;
+    while (p->src[p->pos] == ' ') {
+      p->pos++;
+      r_indent++;
+    }
+    if (r_indent <= indent || p->src[p->pos] == '\n' || !p->src[p->pos]) {
+      p->pos = r_start; // rows must be indented below the header
+      break;
+    }
+
+    size_t line_at = p->pos;
+    Span line = scan_until(p, "");
+    skip_newline(p);
+
+    ToonValue *row = tv_new(TOON_OBJECT);
+    if (!row || tv_arr_push(arr, row)) {
+      parse_oom(p);
+      break;
+    }
+    size_t c_idx = 0;
+    int extra = 0;
+    more = 1;
+    while (next_field(&line, &field, &more)) {
+      if (c_idx >= col_count) {
+        extra = 1;
+        break;
+      }
+      if (tv_obj_add_n(row, cols[c_idx].s, cols[c_idx].n,
+                       tv_scalar(p, field))) {
+        parse_oom(p);
+        break;
+      }
+      c_idx++;
+    }
+    if (!p->failed && (p->flags & TOON_PARSE_STRICT) &&
+        (c_idx != col_count || extra))
+      parse_fail(p, line_at, "row has %s fields than the %zu columns",
+                 c_idx < col_count ? "fewer" : "more", col_count);
+    if (p->failed)
+      break;
+  }
+  free(cols);
+
+  if (!p->failed && (p->flags & TOON_PARSE_STRICT) && rows != count)
+    parse_fail(p, p->pos, "table declares %zu rows, found %zu", count, rows);
+  if (p->failed) {
+    toon_free(arr);
+    return NULL;
+  }
+  return arr;
+}
+
+// key[n]: v1,v2,...  on one line. p->pos is just past ']'.
+static ToonValue *parse_inline_array(Parser *p, size_t count) {
+  if (p->src[p->pos] != ':') {
+    parse_fail(p, p->pos, "expected ':' or '{' after ']'");
+    return NULL;
+  }
+  p->pos++;
+  size_t vals_at = p->pos;
+  Span vals = span_trim(scan_until(p, ""));
+  skip_newline(p);
+
+  ToonValue *arr = tv_new(TOON_ARRAY);
+  if (!arr) {
+    parse_oom(p);
+    return NULL;
+  }
+  Span field;
+  int more = vals.n > 0;
+  while (next_field(&vals, &field, &more)) {
+    if (arr->data.array.count >= p->lim.max_items) {
+      parse_fail(p, vals_at, "array exceeds limit of %zu items",
+                 p->lim.max_items);
+      break;
+    }
+    if (tv_arr_push(arr, tv_scalar(p, field))) {
+      parse_oom(p);
+      break;
+    }
+  }
+  if (!p->failed && (p->flags & TOON_PARSE_STRICT) &&
+      arr->data.array.count != count)
+    parse_fail(p, vals_at, "array declares %zu items, found %zu", count,
+               arr->data.array.count);
+  if (p->failed) {
+    toon_free(arr);
+    return NULL;
+  }
+  return arr;
 }
 
 // Recursive parser that consumes lines at >= min_indent
-static ToonValue *parse_block(Parser *p, int min_indent) {
+static ToonValue *parse_block(Parser *p, size_t min_indent, size_t depth) {
   ToonValue *obj = tv_new(TOON_OBJECT);
+  if (!obj) {
+    parse_oom(p);
+    return NULL;
+  }
 
-  while (p->src[p->pos]) {
+  while (p->src[p->pos] && !p->failed) {
     // Check indentation
     size_t line_start = p->pos;
-    int indent = 0;
+    size_t indent = 0;
     while (p->src[p->pos] == ' ') {
       p->pos++;
       indent++;
     }
 
-    if (p->src[p->pos] == '\n' || p->src[p->pos] == '\0') { // Empty line
+    if (p->src[p->pos] == '\0')
+      break;
+    if (p->src[p->pos] == '\n') { // Empty line
       p->pos++;
       continue;
     }
@@ -206,129 +696,549 @@ static ToonValue *parse_block(Parser *p, int min_indent) {
     }
 
     // Parse Key
-    char *key_part = parse_until(p, ":[");
-    char *key = my_strdup(trim(key_part));
-    free(key_part);
+    size_t key_at = p->pos;
+    Span key = span_trim(scan_until(p, ":["));
+    if (p->src[p->pos] != ':' && p->src[p->pos] != '[') {
+      parse_fail(p, p->pos, "expected ':' after key");
+      break;
+    }
+    if (key.n == 0) {
+      parse_fail(p, key_at, "empty key");
+      break;
+    }
 
+    ToonValue *val = NULL;
     if (p->src[p->pos] == '[') {
       // Array or Table: key[n]...
-      p->pos++; // skip [
-      char *count_str = parse_until(p, "]");
-      int count = atoi(count_str);
-      free(count_str);
-      if (p->src[p->pos] == ']')
-        p->pos++;
+      size_t count_at = ++p->pos;
+      Span count_str = scan_until(p, "]");
+      size_t count;
+      if (p->src[p->pos] != ']') {
+        parse_fail(p, count_at - 1, "unterminated '['");
+        break;
+      }
+      p->pos++;
+      if (parse_count(p, count_str, count_at, &count))
+        break;
 
       if (p->src[p->pos] == '{') {
-        // Table: key[n]{col1,col2}:
-        p->pos++; // skip {
-        char *cols_str = parse_until(p, "}");
-        if (p->src[p->pos] == '}')
-          p->pos++;
-        if (p->src[p->pos] == ':')
-          p->pos++;
-        skip_line(p); // Move to next line for data
-
-        ToonValue *arr = tv_new(TOON_ARRAY);
-
-        // Parse columns
-        int col_count = 0;
-        char **cols = malloc(32 * sizeof(char *)); // simplistic
-        char *c_ptr = cols_str;
-        char *tok = strtok(c_ptr, ",");
-        while (tok) {
-          cols[col_count++] = my_strdup(trim(tok));
-          tok = strtok(NULL, ",");
-        }
+        p->pos++;
+        val = parse_table(p, count, indent);
+      } else {
+        val = parse_inline_array(p, count);
+      }
+    } else {
+      p->pos++; // skip :
+      // Check if value is on same line or next block
+      Span inline_val = span_trim(scan_until(p, ""));
+      skip_newline(p);
 
-        // Parse rows
-        for (int i = 0; i < count; i++) {
-          // Check indent
-          size_t r_start = p->pos;
-          int r_indent = 0;
-          while (p->src[p->pos] == ' ') {
-            p->pos++;
-            r_indent++;
-          }
-          if (r_indent <= indent) { // Should be indented
-            p->pos = r_start;
-            break;
-          }
+      if (inline_val.n > 0) {
+        val = tv_scalar(p, inline_val);
+        if (!val)
+          parse_oom(p);
+      } else if (depth + 1 > p->lim.max_depth) {
+        parse_fail(p, key_at, "nesting deeper than %zu levels",
+                   p->lim.max_depth);
+      } else {
+        val = parse_block(p, indent + 1, depth + 1);
+      }
+    }
 
-          ToonValue *row_obj = tv_new(TOON_OBJECT);
-          char *line = parse_until(p, "\n");
-          if (p->src[p->pos] == '\n')
-            p->pos++;
-
-          char *l_ptr = line;
-          char *val_tok = strtok(l_ptr, ",");
-          int c_idx = 0;
-          while (val_tok && c_idx < col_count) {
-            tv_obj_add(row_obj, cols[c_idx], tv_str(my_strdup(trim(val_tok))));
-            val_tok = strtok(NULL, ",");
-            c_idx++;
-          }
-          tv_arr_push(arr, row_obj);
-          free(line);
-        }
+    if (!val)
+      break;
+    if (tv_obj_add_n(obj, key.s, key.n, val))
+      parse_oom(p);
+  }
+
+  if (p->failed) {
+    toon_free(obj);
+    return NULL;
+  }
+  return obj;
+}
 
-        tv_obj_add(obj, key, arr);
-        for (int k = 0; k < col_count; k++)
-          free(cols[k]);
-        free(cols);
-        free(cols_str);
+ToonValue *toon_parse(const char *input) {
+  return toon_parse_ex(input, TOON_PARSE_DEFAULT);
+}
 
+ToonValue *toon_parse_ex(const char *input, unsigned flags) {
+  ToonParseOptions opts = {0};
+  opts.flags = flags;
+  return toon_parse_opts(input, &opts, NULL);
+}
+
+ToonValue *toon_parse_opts(const char *input, const ToonParseOptions *opts,
+                           ToonError *err) {
+  Parser p = {0};
+  p.src = input;
+  p.err = err;
+  if (opts)
+    p.lim = *opts;
+  p.flags = p.lim.flags;
+  if (!p.lim.max_input)
+    p.lim.max_input = SIZE_MAX;
+  if (!p.lim.max_depth)
+    p.lim.max_depth = TOON_DEFAULT_MAX_DEPTH;
+  if (!p.lim.max_columns)
+    p.lim.max_columns = TOON_DEFAULT_MAX_COLUMNS;
+  if (!p.lim.max_items)
+    p.lim.max_items = TOON_DEFAULT_MAX_ITEMS;
+  if (err)
+    memset(err, 0, sizeof(*err));
+
+  if (!input) {
+    parse_fail(&p, 0, "no input");
+    return NULL;
+  }
+  if (p.lim.max_input != SIZE_MAX &&
+      strnlen(input, p.lim.max_input + 1) > p.lim.max_input) {
+    parse_fail(&p, p.lim.max_input, "input larger than %zu bytes",
+               p.lim.max_input);
+    return NULL;
+  }
+  return parse_block(&p, 0, 0);
+}
+
+// --- Text writer ---
+
+static void tw_indent(FILE *out, int depth) {
+  for (int i = 0; i < depth; i++)
+    fputs("  ", out);
+}
+
+// Returns the first row if `arr` is a non-empty array of objects that all
+// have the same scalar-valued keys in the same order (i.e. fits a table).
+static const ToonValue *tw_table_shape(const ToonValue *arr) {
+  if (arr->data.array.count == 0)
+    return NULL;
+  const ToonValue *first = arr->data.array.items[0];
+  if (first->type != TOON_OBJECT || first->data.object.count == 0)
+    return NULL;
+  for (size_t i = 0; i < arr->data.array.count; i++) {
+    const ToonValue *row = arr->data.array.items[i];
+    if (row->type != TOON_OBJECT ||
+        row->data.object.count != first->data.object.count)
+      return NULL;
+    for (size_t k = 0; k < row->data.object.count; k++) {
+      if (strcmp(row->data.object.entries[k].key,
+                 first->data.object.entries[k].key) != 0 ||
+          !tv_is_scalar(row->data.object.entries[k].value))
+        return NULL;
+    }
+  }
+  return first;
+}
+
+static int tw_object(FILE *out, const ToonValue *obj, int depth) {
+  for (size_t i = 0; i < obj->data.object.count; i++) {
+    const char *key = obj->data.object.entries[i].key;
+    const ToonValue *v = obj->data.object.entries[i].value;
+    tw_indent(out, depth);
+
+    if (tv_is_scalar(v)) {
+      fprintf(out, "%s: ", key);
+      tv_fprint_scalar(out, v);
+      fputc('\n', out);
+    } else if (v->type == TOON_OBJECT) {
+      fprintf(out, "%s:\n", key);
+      if (tw_object(out, v, depth + 1) != 0)
+        return -1;
+    } else {
+      size_t n = v->data.array.count;
+      const ToonValue *shape = tw_table_shape(v);
+      if (shape) {
+        fprintf(out, "%s[%zu]{", key, n);
+        for (size_t k = 0; k < shape->data.object.count; k++)
+          fprintf(out, k ? ",%s" : "%s", shape->data.object.entries[k].key);
+        fputs("}:\n", out);
+        for (size_t r = 0; r < n; r++) {
+          const ToonValue *row = v->data.array.items[r];
+          tw_indent(out, depth + 1);
+          for (size_t k = 0; k < row->data.object.count; k++) {
+            if (k)
+              fputc(',', out);
+            tv_fprint_scalar(out, row->data.object.entries[k].value);
+          }
+          fputc('\n', out);
+        }
       } else {
-        // Simple Array: key[n]: val1,val2...
-        if (p->src[p->pos] == ':')
-          p->pos++;
-        char *vals_str = parse_until(p, "\n");
-        if (p->src[p->pos] == '\n')
-          p->pos++;
-
-        ToonValue *arr = tv_new(TOON_ARRAY);
-        char *v_ptr = vals_str;
-        char *tok = strtok(v_ptr, ",");
-        while (tok) {
-          tv_arr_push(arr, tv_str(my_strdup(trim(tok))));
-          tok = strtok(NULL, ",");
+        fprintf(out, "%s[%zu]: ", key, n);
+        for (size_t k = 0; k < n; k++) {
+          if (!tv_is_scalar(v->data.array.items[k]))
+            return -1;
+          if (k)
+            fputc(',', out);
+          tv_fprint_scalar(out, v->data.array.items[k]);
         }
-        tv_obj_add(obj, key, arr);
-        free(vals_str);
+        fputc('\n', out);
       }
+    }
+  }
+  return 0;
+}
 
-    } else if (p->src[p->pos] == ':') {
-      p->pos++; // skip :
-      // Check if value is on same line or next block
-      size_t val_start = p->pos;
-      char *inline_val = parse_until(p, "\n");
-      char *trimmed_val = trim(inline_val);
-
-      if (strlen(trimmed_val) > 0) {
-        // Inline value
-        tv_obj_add(obj, key, tv_str(my_strdup(trimmed_val)));
-        if (p->src[p->pos] == '\n')
-          p->pos++;
-      } else {
-        // Nested block
-        if (p->src[p->pos] == '\n')
-          p->pos++;
-        ToonValue *child = parse_block(p, indent + 1);
-        tv_obj_add(obj, key, child);
+int toon_write(FILE *out, const ToonValue *root) {
+  if (!root || root->type != TOON_OBJECT)
+    return -1;
+  return tw_object(out, root, 0);
+}
+
+// --- Binary encoding ---
+
+#define TB_HEADER_SIZE 16
+
+typedef struct {
+  unsigned char *buf;
+  size_t len;
+  size_t cap;
+  int failed;
+  // Object keys are interned: table rows share one string node per column.
+  uint32_t *keys; // open-addressing table of string node offsets, 0 = empty
+  size_t key_cap;
+  size_t key_count;
+} TbWriter;
+
+static void tb_put32(TbWriter *w, size_t off, uint32_t v) {
+  memcpy(w->buf + off, &v, 4);
+}
+
+static uint32_t tb_get32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+// Appends `n` zeroed bytes rounded up to 8 and returns their offset.
+static size_t tb_reserve(TbWriter *w, size_t n) {
+  size_t off = w->len;
+  size_t need = off + ((n + 7) & ~(size_t)7);
+  if (w->failed || need > UINT32_MAX) {
+    w->failed = 1;
+    return 0;
+  }
+  if (need > w->cap) {
+    size_t cap = w->cap ? w->cap : 256;
+    while (cap < need)
+      cap *= 2;
+    unsigned char *nb = realloc(w->buf, cap);
+    if (!nb) {
+      w->failed = 1;
+      return 0;
+    }
+    w->buf = nb;
+    w->cap = cap;
+  }
+  memset(w->buf + off, 0, need - off);
+  w->len = need;
+  return off;
+}
+
+static uint32_t tb_string(TbWriter *w, const char *s) {
+  size_t n = strlen(s);
+  size_t off = tb_reserve(w, 8 + n + 1);
+  if (w->failed)
+    return 0;
+  tb_put32(w, off, TOON_STRING);
+  tb_put32(w, off + 4, (uint32_t)n);
+  memcpy(w->buf + off + 8, s, n);
+  return (uint32_t)off;
+}
+
+static uint32_t tb_hash(const char *s) {
+  uint32_t h = 2166136261u; // FNV-1a
+  while (*s)
+    h = (h ^ (unsigned char)*s++) * 16777619u;
+  return h;
+}
+
+static uint32_t tb_key(TbWriter *w, const char *key) {
+  if (w->key_count * 2 >= w->key_cap) {
+    size_t cap = w->key_cap ? w->key_cap * 2 : 64;
+    uint32_t *nk = calloc(cap, sizeof(uint32_t));
+    if (!nk) {
+      w->failed = 1;
+      return 0;
+    }
+    for (size_t i = 0; i < w->key_cap; i++) {
+      if (!w->keys[i])
+        continue;
+      size_t j = tb_hash((char *)w->buf + w->keys[i] + 8) & (cap - 1);
+      while (nk[j])
+        j = (j + 1) & (cap - 1);
+      nk[j] = w->keys[i];
+    }
+    free(w->keys);
+    w->keys = nk;
+    w->key_cap = cap;
+  }
+  size_t j = tb_hash(key) & (w->key_cap - 1);
+  while (w->keys[j]) {
+    if (strcmp((char *)w->buf + w->keys[j] + 8, key) == 0)
+      return w->keys[j];
+    j = (j + 1) & (w->key_cap - 1);
+  }
+  uint32_t off = tb_string(w, key);
+  if (!w->failed) {
+    w->keys[j] = off;
+    w->key_count++;
+  }
+  return off;
+}
+
+// Value nodes are written in preorder: a node, then each child's subtree
+// in turn. Walking the tree visits them in increasing offset order, so
+// toon_bin_to_value (and toon_bin_to_msgpack) reject any ref not past the
+// last one visited; that rules out cycles and shared children in corrupt
+// input, which could otherwise expand exponentially. Key nodes are shared,
+// but are only read as strings.
+static uint32_t tb_node(TbWriter *w, const ToonValue *v) {
+  size_t off;
+  switch (v->type) {
+  case TOON_STRING:
+    return tb_string(w, v->data.str_val);
+  case TOON_ARRAY:
+    off = tb_reserve(w, 8 + 4 * v->data.array.count);
+    if (w->failed)
+      return 0;
+    tb_put32(w, off, TOON_ARRAY);
+    tb_put32(w, off + 4, (uint32_t)v->data.array.count);
+    for (size_t i = 0; i < v->data.array.count; i++) {
+      uint32_t child = tb_node(w, v->data.array.items[i]);
+      if (w->failed)
+        return 0;
+      tb_put32(w, off + 8 + 4 * i, child);
+    }
+    return (uint32_t)off;
+  case TOON_OBJECT:
+    off = tb_reserve(w, 8 + 8 * v->data.object.count);
+    if (w->failed)
+      return 0;
+    tb_put32(w, off, TOON_OBJECT);
+    tb_put32(w, off + 4, (uint32_t)v->data.object.count);
+    for (size_t i = 0; i < v->data.object.count; i++) {
+      uint32_t k = tb_key(w, v->data.object.entries[i].key);
+      uint32_t val = tb_node(w, v->data.object.entries[i].value);
+      if (w->failed)
+        return 0;
+      tb_put32(w, off + 8 + 8 * i, k);
+      tb_put32(w, off + 12 + 8 * i, val);
+    }
+    return (uint32_t)off;
+  case TOON_INT:
+  case TOON_FLOAT:
+    off = tb_reserve(w, 16);
+    if (w->failed)
+      return 0;
+    tb_put32(w, off, v->type);
+    memcpy(w->buf + off + 8, &v->data, 8); // int_val / float_val
+    return (uint32_t)off;
+  case TOON_BOOL:
+    off = tb_reserve(w, 8);
+    if (w->failed)
+      return 0;
+    tb_put32(w, off, TOON_BOOL);
+    tb_put32(w, off + 4, v->data.bool_val ? 1 : 0);
+    return (uint32_t)off;
+  default:
+    off = tb_reserve(w, 8);
+    if (w->failed)
+      return 0;
+    tb_put32(w, off, TOON_NULL);
+    return (uint32_t)off;
+  }
+}
+
+void *toon_encode_binary(const ToonValue *value, size_t *out_size) {
+  if (!value)
+    return NULL;
+  TbWriter w = {0};
+  tb_reserve(&w, TB_HEADER_SIZE);
+  uint32_t root = tb_node(&w, value);
+  free(w.keys);
+  if (w.failed) {
+    free(w.buf);
+    return NULL;
+  }
+  memcpy(w.buf, "TOON", 4);
+  tb_put32(&w, 4, TOON_BIN_VERSION);
+  tb_put32(&w, 8, (uint32_t)w.len);
+  tb_put32(&w, 12, root);
+  if (out_size)
+    *out_size = w.len;
+  return w.buf;
+}
+
+int toon_bin_open(ToonBin *bin, const void *data, size_t size) {
+  const unsigned char *p = data;
+  bin->base = NULL;
+  bin->size = 0;
+  if (!p || size < TB_HEADER_SIZE || memcmp(p, "TOON", 4) != 0 ||
+      tb_get32(p + 4) != TOON_BIN_VERSION)
+    return -1;
+  size_t total = tb_get32(p + 8);
+  if (total < TB_HEADER_SIZE || total > size)
+    return -1;
+  bin->base = p;
+  bin->size = total;
+  return 0;
+}
+
+// Bounds-checked pointer to `need` bytes of the node at `ref`.
+static const unsigned char *tb_at(const ToonBin *b, ToonRef ref, size_t need) {
+  if (!b->base || ref < TB_HEADER_SIZE || (ref & 7) || ref > b->size ||
+      b->size - ref < need)
+    return NULL;
+  return b->base + ref;
+}
+
+ToonRef toon_bin_root(const ToonBin *bin) {
+  return bin->base ? tb_get32(bin->base + 12) : 0;
+}
+
+ToonType toon_bin_type(const ToonBin *bin, ToonRef ref) {
+  const unsigned char *n = tb_at(bin, ref, 8);
+  return n ? (ToonType)tb_get32(n) : TOON_NULL;
+}
+
+size_t toon_bin_len(const ToonBin *bin, ToonRef ref) {
+  ToonType t = toon_bin_type(bin, ref);
+  if (t != TOON_STRING && t != TOON_ARRAY && t != TOON_OBJECT)
+    return 0;
+  return tb_get32(bin->base + ref + 4);
+}
+
+const char *toon_bin_str(const ToonBin *bin, ToonRef ref) {
+  if (toon_bin_type(bin, ref) != TOON_STRING)
+    return NULL;
+  size_t n = tb_get32(bin->base + ref + 4);
+  const unsigned char *node = tb_at(bin, ref, 8 + n + 1);
+  return node && node[8 + n] == '\0' ? (const char *)node + 8 : NULL;
+}
+
+int toon_bin_bool(const ToonBin *bin, ToonRef ref) {
+  if (toon_bin_type(bin, ref) != TOON_BOOL)
+    return 0;
+  return tb_get32(bin->base + ref + 4) != 0;
+}
+
+int64_t toon_bin_int(const ToonBin *bin, ToonRef ref) {
+  int64_t v = 0;
+  const unsigned char *n = tb_at(bin, ref, 16);
+  if (n && tb_get32(n) == TOON_INT)
+    memcpy(&v, n + 8, 8);
+  return v;
+}
+
+double toon_bin_float(const ToonBin *bin, ToonRef ref) {
+  double v = 0;
+  const unsigned char *n = tb_at(bin, ref, 16);
+  if (n && tb_get32(n) == TOON_FLOAT)
+    memcpy(&v, n + 8, 8);
+  return v;
+}
+
+ToonRef toon_bin_at(const ToonBin *bin, ToonRef array, size_t index) {
+  if (toon_bin_type(bin, array) != TOON_ARRAY ||
+      index >= toon_bin_len(bin, array))
+    return 0;
+  const unsigned char *n = tb_at(bin, array, 8 + 4 * (index + 1));
+  return n ? tb_get32(n + 8 + 4 * index) : 0;
+}
+
+static const unsigned char *tb_entry(const ToonBin *bin, ToonRef object,
+                                     size_t index) {
+  if (toon_bin_type(bin, object) != TOON_OBJECT ||
+      index >= toon_bin_len(bin, object))
+    return NULL;
+  const unsigned char *n = tb_at(bin, object, 8 + 8 * (index + 1));
+  return n ? n + 8 + 8 * index : NULL;
+}
+
+const char *toon_bin_key(const ToonBin *bin, ToonRef object, size_t index) {
+  const unsigned char *e = tb_entry(bin, object, index);
+  return e ? toon_bin_str(bin, tb_get32(e)) : NULL;
+}
+
+ToonRef toon_bin_value(const ToonBin *bin, ToonRef object, size_t index) {
+  const unsigned char *e = tb_entry(bin, object, index);
+  return e ? tb_get32(e + 4) : 0;
+}
+
+ToonRef toon_bin_get(const ToonBin *bin, ToonRef object, const char *key) {
+  size_t n = toon_bin_len(bin, object);
+  for (size_t i = 0; i < n; i++) {
+    const char *k = toon_bin_key(bin, object, i);
+    if (k && strcmp(k, key) == 0)
+      return toon_bin_value(bin, object, i);
+  }
+  return 0;
+}
+
+// `*last` is the last ref visited; see tb_node().
+static ToonValue *tb_to_value(const ToonBin *bin, ToonRef ref, int depth,
+                              ToonRef *last) {
+  if (depth > TOON_BIN_MAX_DEPTH || ref <= *last || !tb_at(bin, ref, 8))
+    return NULL;
+  *last = ref;
+  ToonType t = toon_bin_type(bin, ref);
+  ToonValue *v;
+  switch (t) {
+  case TOON_STRING: {
+    const char *s = toon_bin_str(bin, ref);
+    return s ? tv_str(my_strdup(s)) : NULL;
+  }
+  case TOON_ARRAY:
+    if (!(v = tv_new(TOON_ARRAY)))
+      return NULL;
+    for (size_t i = 0; i < toon_bin_len(bin, ref); i++) {
+      ToonValue *child =
+          tb_to_value(bin, toon_bin_at(bin, ref, i), depth + 1, last);
+      if (tv_arr_push(v, child)) {
+        toon_free(v);
+        return NULL;
       }
-      free(inline_val);
-    } else {
-      // Unknown, skip line
-      skip_line(p);
     }
-    free(key);
+    return v;
+  case TOON_OBJECT:
+    if (!(v = tv_new(TOON_OBJECT)))
+      return NULL;
+    for (size_t i = 0; i < toon_bin_len(bin, ref); i++) {
+      const char *k = toon_bin_key(bin, ref, i);
+      ToonRef c = toon_bin_value(bin, ref, i);
+      ToonValue *child = k ? tb_to_value(bin, c, depth + 1, last) : NULL;
+      if (!child || tv_obj_add(v, k, child)) {
+        toon_free(v);
+        return NULL;
+      }
+    }
+    return v;
+  case TOON_BOOL:
+    if ((v = tv_new(TOON_BOOL)))
+      v->data.bool_val = toon_bin_bool(bin, ref);
+    return v;
+  case TOON_INT:
+    if (tb_at(bin, ref, 16) && (v = tv_new(TOON_INT))) {
+      v->data.int_val = toon_bin_int(bin, ref);
+      return v;
+    }
+    return NULL;
+  case TOON_FLOAT:
+    if (tb_at(bin, ref, 16) && (v = tv_new(TOON_FLOAT))) {
+      v->data.float_val = toon_bin_float(bin, ref);
+      return v;
+    }
+    return NULL;
+  case TOON_NULL:
+    return tv_new(TOON_NULL);
+  default:
+    return NULL;
   }
-  return obj;
 }
 
-ToonValue *toon_parse(const char *input) {
-  Parser p = {input, 0};
-  return parse_block(&p, 0);
+ToonValue *toon_bin_to_value(const ToonBin *bin, ToonRef ref) {
+  ToonRef last = 0;
+  return tb_to_value(bin, ref, 0, &last);
 }
 
 #endif // TOON_IMPLEMENTATION
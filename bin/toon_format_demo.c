@@ -1,9 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #define TOON_IMPLEMENTATION
 #include "toon_format.h"
 
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 int main() {
   const char *toon_source =
       "context:\n"
@@ -18,15 +25,62 @@ int main() {
 
   printf("Parsing Toon Source:\n%s\n", toon_source);
 
-  ToonValue *root = toon_parse(toon_source);
+  ToonValue *root = toon_parse_ex(toon_source, TOON_PARSE_INFER);
 
   if (root) {
     printf("Parsed successfully!\n");
     toon_print(root, 0);
-    toon_free(root);
   } else {
     printf("Failed to parse.\n");
+    return 1;
+  }
+
+  // Binary round trip: encode, query in place, then back to text.
+  size_t bin_size = 0;
+  void *bin_data = toon_encode_binary(root, &bin_size);
+  ToonBin bin;
+  if (!bin_data || toon_bin_open(&bin, bin_data, bin_size) != 0) {
+    printf("Binary encoding failed.\n");
+    toon_free(root);
+    return 1;
+  }
+  printf("\nBinary form: %zu bytes (text: %zu bytes)\n", bin_size,
+         strlen(toon_source));
+
+  ToonRef hikes = toon_bin_get(&bin, toon_bin_root(&bin), "hikes");
+  for (size_t i = 0; i < toon_bin_len(&bin, hikes); i++) {
+    ToonRef hike = toon_bin_at(&bin, hikes, i);
+    printf("  %-16s %5.1f km  +%lld m\n",
+           toon_bin_str(&bin, toon_bin_get(&bin, hike, "name")),
+           toon_bin_float(&bin, toon_bin_get(&bin, hike, "distanceKm")),
+           (long long)toon_bin_int(&bin, toon_bin_get(&bin, hike,
+                                                      "elevationGain")));
+  }
+
+  ToonValue *decoded = toon_bin_to_value(&bin, toon_bin_root(&bin));
+  printf("\nRound trip to text:\n");
+  if (!decoded || toon_write(stdout, decoded) != 0)
+    printf("Failed to write text.\n");
+  toon_free(decoded);
+
+  // Loading cost: re-parsing text vs attaching to the binary buffer.
+  const int iters = 100000;
+  double t0 = now_sec();
+  for (int i = 0; i < iters; i++)
+    toon_free(toon_parse_ex(toon_source, TOON_PARSE_INFER));
+  double t1 = now_sec();
+  volatile double sink = 0;
+  for (int i = 0; i < iters; i++) {
+    ToonBin b;
+    toon_bin_open(&b, bin_data, bin_size);
+    sink += toon_bin_float(
+        &b, toon_bin_get(&b, toon_bin_at(&b, hikes, 0), "distanceKm"));
   }
+  double t2 = now_sec();
+  printf("\nparse text: %.3f us/doc | open binary + lookup: %.3f us/doc\n",
+         (t1 - t0) * 1e6 / iters, (t2 - t1) * 1e6 / iters);
 
+  free(bin_data);
+  toon_free(root);
   return 0;
 }
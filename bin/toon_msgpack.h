@@ -0,0 +1,411 @@
+/* toon_msgpack.h - TOON <-> MessagePack bridge (single-header)
+
+   Converts ToonValue trees (and ToonBin views) straight to MessagePack bytes
+   and back, so a backend can parse TOON once and hand the result to Neovim's
+   msgpack-RPC without a Lua round trip. The encoder writes into one growable
+   caller-owned buffer that can be reused across calls; the decoder walks the
+   input in place and only allocates the resulting ToonValue nodes.
+
+   Mapping:
+     TOON_NULL   <-> nil          TOON_STRING <-> str (bin decodes as str)
+     TOON_BOOL   <-> bool         TOON_ARRAY  <-> array
+     TOON_INT    <-> int/uint     TOON_OBJECT <-> map with str keys
+     TOON_FLOAT  <-> float64      (float32 decodes as TOON_FLOAT)
+
+   Requires toon_format.h; define TOON_IMPLEMENTATION in exactly one file
+   before including both.
+*/
+
+#ifndef TOON_MSGPACK_H
+#define TOON_MSGPACK_H
+
+#include "toon_format.h"
+
+typedef struct {
+  unsigned char *data;
+  size_t size;
+  size_t cap;
+} ToonMpBuf;
+
+// Appends the encoding of `value` to `out`. Returns 0, or -1 on allocation
+// failure (out->size is then unspecified).
+int toon_to_msgpack(const ToonValue *value, ToonMpBuf *out);
+
+// Same, but reads directly from a binary TOON view without building a tree.
+// Fails on malformed nodes, nesting deeper than TOON_BIN_MAX_DEPTH and nodes
+// referenced more than once.
+int toon_bin_to_msgpack(const ToonBin *bin, ToonRef ref, ToonMpBuf *out);
+
+// Decodes one msgpack object. Returns NULL on malformed or unsupported input
+// (ext types, non-string map keys, nesting deeper than TOON_MP_MAX_DEPTH).
+// If `consumed` is given it receives the number of bytes read.
+ToonValue *toon_from_msgpack(const void *data, size_t size, size_t *consumed);
+
+void toon_mpbuf_reset(ToonMpBuf *buf); // keep capacity, drop contents
+void toon_mpbuf_free(ToonMpBuf *buf);
+
+#define TOON_MP_MAX_DEPTH 512
+
+#ifdef TOON_IMPLEMENTATION
+
+// --- Encoder ---
+
+static int mp_reserve(ToonMpBuf *b, size_t n) {
+  if (b->size + n <= b->cap)
+    return 0;
+  size_t cap = b->cap ? b->cap : 4096;
+  while (cap < b->size + n)
+    cap *= 2;
+  unsigned char *nd = realloc(b->data, cap);
+  if (!nd)
+    return -1;
+  b->data = nd;
+  b->cap = cap;
+  return 0;
+}
+
+static void mp_be(unsigned char *p, uint64_t v, int n) {
+  for (int i = n - 1; i >= 0; i--) {
+    p[i] = (unsigned char)v;
+    v >>= 8;
+  }
+}
+
+// Writes a one-byte tag followed by an n-byte big-endian payload.
+static int mp_tag(ToonMpBuf *b, unsigned char tag, uint64_t v, int n) {
+  if (mp_reserve(b, 1 + n))
+    return -1;
+  b->data[b->size] = tag;
+  mp_be(b->data + b->size + 1, v, n);
+  b->size += 1 + n;
+  return 0;
+}
+
+static int mp_int(ToonMpBuf *b, int64_t v) {
+  if (v >= 0) {
+    if (v < 128)
+      return mp_tag(b, (unsigned char)v, 0, 0);
+    if (v <= 0xff)
+      return mp_tag(b, 0xcc, v, 1);
+    if (v <= 0xffff)
+      return mp_tag(b, 0xcd, v, 2);
+    if (v <= 0xffffffffLL)
+      return mp_tag(b, 0xce, v, 4);
+    return mp_tag(b, 0xcf, v, 8);
+  }
+  if (v >= -32)
+    return mp_tag(b, (unsigned char)(0xe0 | (v + 32)), 0, 0);
+  if (v >= INT8_MIN)
+    return mp_tag(b, 0xd0, (uint8_t)v, 1);
+  if (v >= INT16_MIN)
+    return mp_tag(b, 0xd1, (uint16_t)v, 2);
+  if (v >= INT32_MIN)
+    return mp_tag(b, 0xd2, (uint32_t)v, 4);
+  return mp_tag(b, 0xd3, (uint64_t)v, 8);
+}
+
+static int mp_float(ToonMpBuf *b, double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, 8);
+  return mp_tag(b, 0xcb, bits, 8);
+}
+
+// Array (0x90/0xdc/0xdd) or map (0x80/0xde/0xdf) header.
+static int mp_container(ToonMpBuf *b, unsigned char fix, unsigned char t16,
+                        size_t n) {
+  if (n < 16)
+    return mp_tag(b, (unsigned char)(fix | n), 0, 0);
+  if (n <= 0xffff)
+    return mp_tag(b, t16, n, 2);
+  return mp_tag(b, t16 + 1, n, 4);
+}
+
+static int mp_str(ToonMpBuf *b, const char *s, size_t n) {
+  int rc;
+  if (n < 32)
+    rc = mp_tag(b, (unsigned char)(0xa0 | n), 0, 0);
+  else if (n <= 0xff)
+    rc = mp_tag(b, 0xd9, n, 1);
+  else if (n <= 0xffff)
+    rc = mp_tag(b, 0xda, n, 2);
+  else
+    rc = mp_tag(b, 0xdb, n, 4);
+  if (rc || mp_reserve(b, n))
+    return -1;
+  memcpy(b->data + b->size, s, n);
+  b->size += n;
+  return 0;
+}
+
+int toon_to_msgpack(const ToonValue *v, ToonMpBuf *out) {
+  if (!v)
+    return mp_tag(out, 0xc0, 0, 0);
+  switch (v->type) {
+  case TOON_STRING:
+    return mp_str(out, v->data.str_val, strlen(v->data.str_val));
+  case TOON_BOOL:
+    return mp_tag(out, v->data.bool_val ? 0xc3 : 0xc2, 0, 0);
+  case TOON_INT:
+    return mp_int(out, v->data.int_val);
+  case TOON_FLOAT:
+    return mp_float(out, v->data.float_val);
+  case TOON_ARRAY:
+    if (mp_container(out, 0x90, 0xdc, v->data.array.count))
+      return -1;
+    for (size_t i = 0; i < v->data.array.count; i++)
+      if (toon_to_msgpack(v->data.array.items[i], out))
+        return -1;
+    return 0;
+  case TOON_OBJECT:
+    if (mp_container(out, 0x80, 0xde, v->data.object.count))
+      return -1;
+    for (size_t i = 0; i < v->data.object.count; i++) {
+      const char *k = v->data.object.entries[i].key;
+      if (mp_str(out, k, strlen(k)) ||
+          toon_to_msgpack(v->data.object.entries[i].value, out))
+        return -1;
+    }
+    return 0;
+  default:
+    return mp_tag(out, 0xc0, 0, 0);
+  }
+}
+
+// `*last` is the last ref visited: each one must be past it (see tb_node()
+// in toon_format.h), so shared or cyclic children are rejected.
+static int mp_bin(const ToonBin *bin, ToonRef ref, ToonMpBuf *out, int depth,
+                  ToonRef *last) {
+  if (depth > TOON_BIN_MAX_DEPTH || ref <= *last || !tb_at(bin, ref, 8))
+    return -1;
+  *last = ref;
+  size_t n = toon_bin_len(bin, ref);
+  switch (toon_bin_type(bin, ref)) {
+  case TOON_STRING: {
+    const char *s = toon_bin_str(bin, ref);
+    return s ? mp_str(out, s, n) : -1;
+  }
+  case TOON_BOOL:
+    return mp_tag(out, toon_bin_bool(bin, ref) ? 0xc3 : 0xc2, 0, 0);
+  case TOON_INT:
+    return mp_int(out, toon_bin_int(bin, ref));
+  case TOON_FLOAT:
+    return mp_float(out, toon_bin_float(bin, ref));
+  case TOON_ARRAY:
+    if (mp_container(out, 0x90, 0xdc, n))
+      return -1;
+    for (size_t i = 0; i < n; i++)
+      if (mp_bin(bin, toon_bin_at(bin, ref, i), out, depth + 1, last))
+        return -1;
+    return 0;
+  case TOON_OBJECT:
+    if (mp_container(out, 0x80, 0xde, n))
+      return -1;
+    for (size_t i = 0; i < n; i++) {
+      const char *k = toon_bin_key(bin, ref, i);
+      if (!k || mp_str(out, k, strlen(k)) ||
+          mp_bin(bin, toon_bin_value(bin, ref, i), out, depth + 1, last))
+        return -1;
+    }
+    return 0;
+  default:
+    return mp_tag(out, 0xc0, 0, 0);
+  }
+}
+
+int toon_bin_to_msgpack(const ToonBin *bin, ToonRef ref, ToonMpBuf *out) {
+  ToonRef last = 0;
+  return mp_bin(bin, ref, out, 0, &last);
+}
+
+void toon_mpbuf_reset(ToonMpBuf *buf) { buf->size = 0; }
+
+void toon_mpbuf_free(ToonMpBuf *buf) {
+  free(buf->data);
+  buf->data = NULL;
+  buf->size = buf->cap = 0;
+}
+
+// --- Decoder ---
+
+typedef struct {
+  const unsigned char *p;
+  const unsigned char *end;
+} MpReader;
+
+static int mp_take(MpReader *r, int n, uint64_t *v) {
+  if (r->end - r->p < n)
+    return -1;
+  uint64_t x = 0;
+  for (int i = 0; i < n; i++)
+    x = (x << 8) | *r->p++;
+  *v = x;
+  return 0;
+}
+
+static ToonValue *mp_read(MpReader *r, int depth);
+
+static ToonValue *mp_read_str(MpReader *r, uint64_t n) {
+  if ((uint64_t)(r->end - r->p) < n)
+    return NULL;
+  ToonValue *v = tv_str(my_strndup((const char *)r->p, (size_t)n));
+  r->p += n;
+  return v;
+}
+
+static ToonValue *mp_read_array(MpReader *r, uint64_t n, int depth) {
+  // Every element takes at least one byte; reject impossible counts before
+  // allocating anything for them.
+  if ((uint64_t)(r->end - r->p) < n)
+    return NULL;
+  ToonValue *arr = tv_new(TOON_ARRAY);
+  if (!arr || !(arr->data.array.items = malloc((n ? n : 1) *
+                                               sizeof(ToonValue *)))) {
+    free(arr);
+    return NULL;
+  }
+  arr->data.array.cap = n;
+  for (uint64_t i = 0; i < n; i++) {
+    ToonValue *item = mp_read(r, depth + 1);
+    if (!item) {
+      toon_free(arr);
+      return NULL;
+    }
+    arr->data.array.items[arr->data.array.count++] = item;
+  }
+  return arr;
+}
+
+static ToonValue *mp_read_map(MpReader *r, uint64_t n, int depth) {
+  if ((uint64_t)(r->end - r->p) / 2 < n)
+    return NULL;
+  ToonValue *obj = tv_new(TOON_OBJECT);
+  if (!obj ||
+      !(obj->data.object.entries = malloc((n ? n : 1) * sizeof(ToonEntry)))) {
+    free(obj);
+    return NULL;
+  }
+  obj->data.object.cap = n;
+  for (uint64_t i = 0; i < n; i++) {
+    ToonValue *key = mp_read(r, depth + 1);
+    ToonValue *val = key && key->type == TOON_STRING ? mp_read(r, depth + 1)
+                                                     : NULL;
+    if (!val) {
+      toon_free(key);
+      toon_free(obj);
+      return NULL;
+    }
+    ToonEntry *e = &obj->data.object.entries[obj->data.object.count++];
+    e->key = key->data.str_val; // steal the string
+    e->value = val;
+    free(key);
+  }
+  return obj;
+}
+
+static ToonValue *mp_scalar_int(int64_t i) {
+  ToonValue *v = tv_new(TOON_INT);
+  if (v)
+    v->data.int_val = i;
+  return v;
+}
+
+static ToonValue *mp_scalar_float(double d) {
+  ToonValue *v = tv_new(TOON_FLOAT);
+  if (v)
+    v->data.float_val = d;
+  return v;
+}
+
+static ToonValue *mp_read(MpReader *r, int depth) {
+  uint64_t x;
+  if (depth > TOON_MP_MAX_DEPTH || r->p >= r->end)
+    return NULL;
+  unsigned char tag = *r->p++;
+
+  if (tag <= 0x7f)
+    return mp_scalar_int(tag);
+  if (tag >= 0xe0)
+    return mp_scalar_int((int8_t)tag);
+  if ((tag & 0xf0) == 0x80)
+    return mp_read_map(r, tag & 0x0f, depth);
+  if ((tag & 0xf0) == 0x90)
+    return mp_read_array(r, tag & 0x0f, depth);
+  if ((tag & 0xe0) == 0xa0)
+    return mp_read_str(r, tag & 0x1f);
+
+  switch (tag) {
+  case 0xc0:
+    return tv_new(TOON_NULL);
+  case 0xc2:
+  case 0xc3: {
+    ToonValue *v = tv_new(TOON_BOOL);
+    if (v)
+      v->data.bool_val = tag == 0xc3;
+    return v;
+  }
+  case 0xc4: // bin 8/16/32
+  case 0xd9: // str 8/16/32
+    return mp_take(r, 1, &x) ? NULL : mp_read_str(r, x);
+  case 0xc5:
+  case 0xda:
+    return mp_take(r, 2, &x) ? NULL : mp_read_str(r, x);
+  case 0xc6:
+  case 0xdb:
+    return mp_take(r, 4, &x) ? NULL : mp_read_str(r, x);
+  case 0xca: {
+    if (mp_take(r, 4, &x))
+      return NULL;
+    uint32_t bits = (uint32_t)x;
+    float f;
+    memcpy(&f, &bits, 4);
+    return mp_scalar_float(f);
+  }
+  case 0xcb: {
+    if (mp_take(r, 8, &x))
+      return NULL;
+    double d;
+    memcpy(&d, &x, 8);
+    return mp_scalar_float(d);
+  }
+  case 0xcc:
+    return mp_take(r, 1, &x) ? NULL : mp_scalar_int((int64_t)x);
+  case 0xcd:
+    return mp_take(r, 2, &x) ? NULL : mp_scalar_int((int64_t)x);
+  case 0xce:
+    return mp_take(r, 4, &x) ? NULL : mp_scalar_int((int64_t)x);
+  case 0xcf:
+    if (mp_take(r, 8, &x))
+      return NULL;
+    return x > INT64_MAX ? mp_scalar_float((double)x)
+                         : mp_scalar_int((int64_t)x);
+  case 0xd0:
+    return mp_take(r, 1, &x) ? NULL : mp_scalar_int((int8_t)x);
+  case 0xd1:
+    return mp_take(r, 2, &x) ? NULL : mp_scalar_int((int16_t)x);
+  case 0xd2:
+    return mp_take(r, 4, &x) ? NULL : mp_scalar_int((int32_t)x);
+  case 0xd3:
+    return mp_take(r, 8, &x) ? NULL : mp_scalar_int((int64_t)x);
+  case 0xdc:
+    return mp_take(r, 2, &x) ? NULL : mp_read_array(r, x, depth);
+  case 0xdd:
+    return mp_take(r, 4, &x) ? NULL : mp_read_array(r, x, depth);
+  case 0xde:
+    return mp_take(r, 2, &x) ? NULL : mp_read_map(r, x, depth);
+  case 0xdf:
+    return mp_take(r, 4, &x) ? NULL : mp_read_map(r, x, depth);
+  default: // ext types and the reserved 0xc1
+    return NULL;
+  }
+}
+
+ToonValue *toon_from_msgpack(const void *data, size_t size, size_t *consumed) {
+  MpReader r = {data, (const unsigned char *)data + size};
+  ToonValue *v = data ? mp_read(&r, 0) : NULL;
+  if (consumed)
+    *consumed = v ? (size_t)(r.p - (const unsigned char *)data) : 0;
+  return v;
+}
+
+#endif // TOON_IMPLEMENTATION
+#endif // TOON_MSGPACK_H
@@ -0,0 +1,99 @@
+// Throughput benchmark for the TOON <-> MessagePack bridge on a large
+// tabular document.
+//
+//   gcc -O2 -o toon_msgpack_bench toon_msgpack_bench.c
+//   ./toon_msgpack_bench [rows]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TOON_IMPLEMENTATION
+#include "toon_format.h"
+#include "toon_msgpack.h"
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *make_table(long rows, size_t *len) {
+  size_t cap = 128 + (size_t)rows * 96;
+  char *s = malloc(cap);
+  size_t n = (size_t)snprintf(
+      s, cap, "files[%ld]{id,path,size,mtime,score,dirty}:\n", rows);
+  for (long i = 0; i < rows; i++)
+    n += (size_t)snprintf(s + n, cap - n,
+                          "  %ld,lua/archives/lazy_%06ld.lua,%ld,%ld,%.3f,%s\n",
+                          i, i, (i * 7919) % 100000, 1700000000 + i,
+                          (double)(i % 1000) / 7.0, i % 3 ? "false" : "true");
+  *len = n;
+  return s;
+}
+
+static void report(const char *what, double secs, size_t bytes) {
+  printf("  %-28s %8.2f ms  %8.1f MB/s\n", what, secs * 1e3,
+         bytes / secs / (1024.0 * 1024.0));
+}
+
+int main(int argc, char **argv) {
+  long rows = argc > 1 ? atol(argv[1]) : 200000;
+  size_t text_len;
+  char *text = make_table(rows, &text_len);
+  printf("document: %ld rows, %.1f MB of TOON text\n", rows,
+         text_len / (1024.0 * 1024.0));
+
+  double t0 = now_sec();
+  ToonValue *root = toon_parse_ex(text, TOON_PARSE_INFER);
+  double t_parse = now_sec() - t0;
+
+  ToonMpBuf mp = {0};
+  t0 = now_sec();
+  toon_to_msgpack(root, &mp);
+  double t_enc = now_sec() - t0;
+
+  // Second encode into the same buffer: no reallocation at all.
+  toon_mpbuf_reset(&mp);
+  t0 = now_sec();
+  toon_to_msgpack(root, &mp);
+  double t_enc2 = now_sec() - t0;
+
+  size_t bin_size;
+  void *bin_data = toon_encode_binary(root, &bin_size);
+  ToonBin bin;
+  toon_bin_open(&bin, bin_data, bin_size);
+  ToonMpBuf mp2 = {0};
+  t0 = now_sec();
+  toon_bin_to_msgpack(&bin, toon_bin_root(&bin), &mp2);
+  double t_bin = now_sec() - t0;
+
+  size_t used;
+  t0 = now_sec();
+  ToonValue *back = toon_from_msgpack(mp.data, mp.size, &used);
+  double t_dec = now_sec() - t0;
+
+  // Round-trip check: decoding and re-encoding must reproduce the bytes.
+  ToonMpBuf mp3 = {0};
+  toon_to_msgpack(back, &mp3);
+  int same = used == mp.size && mp3.size == mp.size &&
+             memcmp(mp3.data, mp.data, mp.size) == 0 && mp2.size == mp.size &&
+             memcmp(mp2.data, mp.data, mp.size) == 0;
+
+  printf("msgpack: %.1f MB\n", mp.size / (1024.0 * 1024.0));
+  report("parse TOON text", t_parse, text_len);
+  report("ToonValue -> msgpack", t_enc, mp.size);
+  report("ToonValue -> msgpack (reuse)", t_enc2, mp.size);
+  report("ToonBin -> msgpack", t_bin, mp.size);
+  report("msgpack -> ToonValue", t_dec, mp.size);
+  printf("round trip: %s\n", same ? "ok" : "MISMATCH");
+
+  toon_mpbuf_free(&mp);
+  toon_mpbuf_free(&mp2);
+  toon_mpbuf_free(&mp3);
+  toon_free(back);
+  toon_free(root);
+  free(bin_data);
+  free(text);
+  return same ? 0 : 1;
+}